@@ -0,0 +1,408 @@
+/*       Power Management Aggregator Server
+
+The aggregator keeps links to several Battery Management System units and
+serves their records to any number of GUI clients on one TCP port.
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-aggregator-server.h"
+
+//-----------------------------------------------------------------------------
+/** @brief Aggregation Server Constructor
+
+@param[in] parent Parent object.
+*/
+
+AggregatorServer::AggregatorServer(QObject* parent) : QObject(parent)
+{
+    server = new QTcpServer(this);
+    connect(server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    checkTimer = new QTimer(this);
+    checkTimer->setInterval(AGGREGATOR_CHECK_INTERVAL);
+    connect(checkTimer, SIGNAL(timeout()), this, SLOT(checkSites()));
+    checkTimer->start();
+    commandTimer = new QTimer(this);
+    commandTimer->setInterval(AGGREGATOR_COMMAND_INTERVAL);
+    connect(commandTimer, SIGNAL(timeout()), this, SLOT(sendCommands()));
+    commandTimer->start();
+    relayMode = false;
+}
+
+AggregatorServer::~AggregatorServer()
+{
+    foreach (AggregatorSite* site, sites)
+    {
+        delete site->comms;
+        delete site;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add a site to be watched
+
+A serial port is opened at once. A TCP connection is only started, so that a
+site that cannot be reached does not hold up the others, and it is retried
+while the site is silent.
+
+@param[in] QString name: name by which clients select the site.
+@param[in] QString address: host address, or serial device if port is 0.
+@param[in] int port: TCP port, or 0 for a serial device.
+@param[in] int baudrate: serial baud rate.
+@returns bool false if the name is in use or the serial port cannot be opened.
+*/
+
+bool AggregatorServer::addSite(const QString& name, const QString& address,
+                               int port, int baudrate)
+{
+    if (name.isEmpty() || (findSite(name.toLatin1()) != NULL)) return false;
+    AggregatorSite* site = new AggregatorSite;
+    site->name = name;
+    site->address = address;
+    site->port = port;
+    site->baudrate = baudrate;
+    site->records = 0;
+    site->reconnects = 0;
+    site->comms = new PowerManagementComms(this);
+    if (port == 0)
+    {
+        if (! site->comms->openSerial(address,baudrate))
+        {
+            delete site->comms;
+            delete site;
+            return false;
+        }
+    }
+    else site->comms->requestConnection(address,port);
+    site->comms->setKeepAliveInterval(AGGREGATOR_KEEP_ALIVE);
+    connect(site->comms, SIGNAL(recordsAvailable()), this, SLOT(readSite()));
+    siteLinks.insert(site->comms,site);
+    sites.append(site);
+    site->lastRecord.start();
+/* Turn on communications and ask for all data */
+    site->comms->write("pc+\n\r");
+    site->comms->write("dS\n\r");
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start serving clients
+
+@param[in] quint16 port: TCP port.
+@returns bool false if the port could not be opened.
+*/
+
+bool AggregatorServer::listen(quint16 port)
+{
+    return server->listen(QHostAddress::Any, port);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Records have arrived from a site
+
+The records waiting are taken together, the latest of each kept, and passed on
+in one write to each client that receives the site.
+*/
+
+void AggregatorServer::readSite()
+{
+    AggregatorSite* site = siteLinks.value(sender());
+    if (site == NULL) return;
+    site->comms->clearNotify();
+    QByteArray prefix = QByteArray("@").append(site->name.toLatin1()).append(',');
+    QByteArray all;
+    QByteArray raw;
+    CommsRecord record;
+    while (site->comms->readRecord(&record))
+    {
+        if (record.line.isEmpty()) continue;
+        QByteArray line = record.line.toLatin1();
+        site->records++;
+// File records are answers to one client and are not part of the state
+        if (record.fields.identifier[0] != 'f')
+            site->latest.insert(QString::fromLatin1(record.fields.identifier),line);
+        all.append(prefix).append(line).append("\r\n");
+        raw.append(line).append("\r\n");
+    }
+    if (raw.isEmpty()) return;
+    site->lastRecord.restart();
+    QHash<QTcpSocket*,AggregatorClient>::const_iterator i;
+    for (i = clients.constBegin(); i != clients.constEnd(); ++i)
+    {
+        if (i.value().site == NULL) sendToClient(i.key(),all);
+        else if (i.value().site == site) sendToClient(i.key(),raw);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Revive sites that have gone silent
+
+A unit stops sending when it has not heard from the aggregator for a while, and
+a TCP link can be lost without notice, so a silent site is reconnected and
+communications turned on again. The reconnections are counted for the site
+list.
+*/
+
+void AggregatorServer::checkSites()
+{
+    foreach (AggregatorSite* site, sites)
+    {
+        if (! site->lastRecord.hasExpired(AGGREGATOR_SILENCE_TIME)) continue;
+        site->reconnects++;
+        if (site->port > 0) site->comms->requestConnection(site->address,site->port);
+        site->comms->write("pc+\n\r");
+        site->comms->write("dS\n\r");
+        site->lastRecord.restart();
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Send the next command waiting for each site
+
+The client whose turn it is sends one command, and goes to the back of the
+turns if it has more waiting.
+*/
+
+void AggregatorServer::sendCommands()
+{
+    foreach (AggregatorSite* site, sites)
+    {
+        if (site->commandTurns.isEmpty()) continue;
+        QTcpSocket* socket = site->commandTurns.takeFirst();
+        QList<QByteArray>& waiting = site->commands[socket];
+        site->comms->write(QByteArray(waiting.takeFirst()).append("\n\r")
+                                                      .constData());
+        if (waiting.isEmpty()) site->commands.remove(socket);
+        else site->commandTurns.append(socket);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Accept clients
+
+A new client receives all sites, starting with their current state, or in
+relay mode the first site unchanged.
+*/
+
+void AggregatorServer::newConnection()
+{
+    while (server->hasPendingConnections())
+    {
+        QTcpSocket* socket = server->nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readClient()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+        AggregatorClient client;
+        client.site = NULL;
+        if (relayMode && ! sites.isEmpty()) client.site = sites.first();
+        client.droppedRecords = 0;
+        clients.insert(socket,client);
+        if (client.site != NULL) sendState(socket,client.site);
+        else foreach (AggregatorSite* site, sites) sendState(socket,site);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Collect lines from a client
+
+Lines end at a carriage return or line feed, and empty lines are ignored. A
+line that grows too long is discarded.
+*/
+
+void AggregatorServer::readClient()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if ((socket == NULL) || ! clients.contains(socket)) return;
+    QByteArray data = socket->readAll();
+    for (int n=0; n<data.size(); n++)
+    {
+        char character = data.at(n);
+        if ((character == '\r') || (character == '\n'))
+        {
+            QByteArray line = clients[socket].line;
+            clients[socket].line.clear();
+            if (! line.isEmpty()) clientCommand(socket,line);
+// The client may have gone while its command was handled
+            if (! clients.contains(socket)) return;
+        }
+        else if (clients[socket].line.size() < AGGREGATOR_LINE_LENGTH)
+            clients[socket].line.append(character);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief A client has gone
+*/
+
+void AggregatorServer::clientDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket == NULL) return;
+    clients.remove(socket);
+    foreach (AggregatorSite* site, sites)
+    {
+        site->commands.remove(socket);
+        site->commandTurns.removeAll(socket);
+    }
+    socket->deleteLater();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Act on a line from a client
+
+@param[in] QTcpSocket* socket: the client.
+@param[in] QByteArray line: the line without its line ending.
+*/
+
+void AggregatorServer::clientCommand(QTcpSocket* socket, const QByteArray& line)
+{
+    AggregatorClient& client = clients[socket];
+    if (! line.startsWith('@'))
+    {
+        if (client.site != NULL) queueCommand(socket,client.site,line);
+        return;
+    }
+    QByteArray request = line.mid(1);
+// All sites
+    if (request.isEmpty())
+    {
+        client.site = NULL;
+        foreach (AggregatorSite* site, sites) sendState(socket,site);
+        return;
+    }
+// List of sites
+    if (request == "?")
+    {
+        QByteArray list;
+        foreach (AggregatorSite* site, sites)
+        {
+            list.append("@?,").append(site->name.toLatin1()).append(',')
+                .append(QByteArray::number(site->records)).append(',')
+                .append(QByteArray::number(site->lastRecord.elapsed()/1000))
+                .append(',').append(QByteArray::number(site->reconnects))
+                .append("\r\n");
+        }
+        sendToClient(socket,list);
+        return;
+    }
+// Select a site, or send a command to a site
+    int comma = request.indexOf(',');
+    AggregatorSite* site = findSite(comma < 0 ? request : request.left(comma));
+    if (site == NULL)
+    {
+        sendToClient(socket,QByteArray("@!,").append(request.left(comma))
+                                             .append("\r\n"));
+        return;
+    }
+    if (comma < 0)
+    {
+        client.site = site;
+        sendState(socket,site);
+    }
+    else queueCommand(socket,site,request.mid(comma+1));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Queue a command from a client for a site
+
+Commands that turn communications on or off are left to the aggregator. A
+command already waiting from any client is not queued again, and a client with
+too many commands waiting has further commands discarded.
+
+@param[in] QTcpSocket* socket: the client.
+@param[in] AggregatorSite* site: the site.
+@param[in] QByteArray command: the command without its line ending.
+*/
+
+void AggregatorServer::queueCommand(QTcpSocket* socket, AggregatorSite* site,
+                                    const QByteArray& command)
+{
+    if (command.startsWith("pc")) return;
+    QHash<QTcpSocket*,QList<QByteArray> >::const_iterator i;
+    for (i = site->commands.constBegin(); i != site->commands.constEnd(); ++i)
+        if (i.value().contains(command)) return;
+    QList<QByteArray>& waiting = site->commands[socket];
+    if (waiting.size() >= AGGREGATOR_COMMAND_QUEUE) return;
+    if (waiting.isEmpty()) site->commandTurns.append(socket);
+    waiting.append(command);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Send the current state of a site to a client
+
+The time record is sent first, followed by the latest of each other record,
+in the form the client receives the site.
+
+@param[in] QTcpSocket* socket: the client.
+@param[in] AggregatorSite* site: the site.
+*/
+
+void AggregatorServer::sendState(QTcpSocket* socket, AggregatorSite* site)
+{
+    QByteArray prefix;
+    if (clients.value(socket).site == NULL)
+        prefix = QByteArray("@").append(site->name.toLatin1()).append(',');
+    QByteArray state;
+    if (site->latest.contains("pH"))
+        state.append(prefix).append(site->latest.value("pH")).append("\r\n");
+    QHash<QString,QByteArray>::const_iterator i;
+    for (i = site->latest.constBegin(); i != site->latest.constEnd(); ++i)
+    {
+        if (i.key() == "pH") continue;
+        state.append(prefix).append(i.value()).append("\r\n");
+    }
+    sendToClient(socket,state);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write to a client unless it has fallen behind
+
+A client that has too much waiting to be sent has the lines dropped, so that a
+slow client does not hold memory or delay the others.
+
+@param[in] QTcpSocket* socket: the client.
+@param[in] QByteArray data: lines to be sent.
+*/
+
+void AggregatorServer::sendToClient(QTcpSocket* socket, const QByteArray& data)
+{
+    if (data.isEmpty()) return;
+    if (socket->bytesToWrite() > AGGREGATOR_WRITE_LIMIT)
+        clients[socket].droppedRecords += data.count('\n');
+    else socket->write(data);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find a site by name
+
+@param[in] QByteArray name: site name.
+@returns AggregatorSite* the site, or NULL if there is none of that name.
+*/
+
+AggregatorSite* AggregatorServer::findSite(const QByteArray& name) const
+{
+    foreach (AggregatorSite* site, sites)
+        if (site->name.toLatin1() == name) return site;
+    return NULL;
+}
@@ -0,0 +1,162 @@
+/*          Power Management Aggregator Server Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef POWER_MANAGEMENT_AGGREGATOR_SERVER_H
+#define POWER_MANAGEMENT_AGGREGATOR_SERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "power-management-comms.h"
+
+// TCP port on which GUI clients are served by default
+#define AGGREGATOR_PORT 6667
+// Interval in ms at which the sites are checked for silence
+#define AGGREGATOR_CHECK_INTERVAL 5000
+// Time in ms without a record after which a site is reconnected
+#define AGGREGATOR_SILENCE_TIME 15000
+// Unsent bytes held for a client before records to it are dropped
+#define AGGREGATOR_WRITE_LIMIT (1 << 20)
+// Longest command line accepted from a client
+#define AGGREGATOR_LINE_LENGTH 256
+// Interval in ms at which commands from clients are sent to each site
+#define AGGREGATOR_COMMAND_INTERVAL 50
+// Commands that a client can have waiting for a site
+#define AGGREGATOR_COMMAND_QUEUE 64
+// Least time in ms between keep-alive messages to a site
+#define AGGREGATOR_KEEP_ALIVE 2000
+
+//-----------------------------------------------------------------------------
+/** @brief A remote unit watched by the aggregator.
+
+The link is a serial port or a TCP address. The last line of each measurement
+and parameter record is kept so that a client joining later is given the
+current state of the site straight away.
+
+Commands from clients wait in a queue for each client, and the clients take
+turns in sending them.
+*/
+
+typedef struct
+{
+    QString name;
+    QString address;            // host name, or serial device if port is 0
+    int port;                   // TCP port, or 0 for a serial device
+    int baudrate;
+    PowerManagementComms* comms;
+    QHash<QString,QByteArray> latest;
+    qint64 records;
+    qint64 reconnects;
+    QElapsedTimer lastRecord;
+    QHash<QTcpSocket*,QList<QByteArray> > commands;
+    QList<QTcpSocket*> commandTurns;
+} AggregatorSite;
+
+//-----------------------------------------------------------------------------
+/** @brief A GUI or other client of the aggregator.
+
+A client with no site selected receives the records of all sites, each line
+preceded by @ and the site name. A client that has selected a site receives
+its lines unchanged, as if connected to the unit itself.
+*/
+
+typedef struct
+{
+    QByteArray line;
+    AggregatorSite* site;
+    qint64 droppedRecords;
+} AggregatorClient;
+
+//-----------------------------------------------------------------------------
+/** @brief Aggregation Server.
+
+Keeps a link open to each of a number of remote units, each read and decoded
+on its own I/O thread by the same communications code as the GUI, and serves
+their records to any number of clients on one TCP port.
+
+Lines from a client that begin with @ are for the aggregator:
+
+@       receive all sites, each line as @name,line
+@name   receive site name only, and send commands to it
+@?      list the sites as @?,name,records,seconds since the last record,
+        reconnections after going silent
+@name,command   send a command to a site while receiving all sites
+
+A site that is not known is answered with @!,name. Other lines are commands
+sent to the selected site. The aggregator keeps each link alive itself, so pc+
+and pc- from clients are not passed on.
+
+Commands are shared fairly over a link by sending one from each client in turn
+at a fixed interval. A command that is already waiting for a site is not queued
+again, since its response goes to every client of the site anyway.
+
+In relay mode a client starts out receiving the first site unchanged, so that
+several GUIs can watch one unit through a single serial or radio link as if
+each held the link itself.
+*/
+
+class AggregatorServer : public QObject
+{
+    Q_OBJECT
+public:
+    AggregatorServer(QObject* parent = 0);
+    ~AggregatorServer();
+    bool addSite(const QString& name, const QString& address, int port,
+                 int baudrate);
+    bool listen(quint16 port);
+    void setRelay(bool relay) { relayMode = relay; }
+    QString errorString() const { return server->errorString(); }
+private slots:
+    void readSite();
+    void checkSites();
+    void sendCommands();
+    void newConnection();
+    void readClient();
+    void clientDisconnected();
+private:
+    void clientCommand(QTcpSocket* socket, const QByteArray& line);
+    void queueCommand(QTcpSocket* socket, AggregatorSite* site,
+                      const QByteArray& command);
+    void sendState(QTcpSocket* socket, AggregatorSite* site);
+    void sendToClient(QTcpSocket* socket, const QByteArray& data);
+    AggregatorSite* findSite(const QByteArray& name) const;
+    QList<AggregatorSite*> sites;
+    QHash<QObject*,AggregatorSite*> siteLinks;
+    QHash<QTcpSocket*,AggregatorClient> clients;
+    QTcpServer* server;
+    QTimer* checkTimer;
+    QTimer* commandTimer;
+    bool relayMode;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/**
+@mainpage Power Management Aggregator
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+This watches several Solar-Battery Power Management Systems at once and serves
+their data to any number of GUI clients on one TCP port.
+
+Call with power-management-aggregator [options] site...
+
+-p   TCP port on which clients are served (6667 default)
+-r   relay mode, clients receive the first site as if connected to it
+
+Each site is given as name=address:port for a unit reached over TCP, or as
+name=device[:baudrate] for a unit on a serial port (38400 default). The name
+may be left out, and the sites are then named unit1, unit2 and so on.
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "power-management-aggregator-server.h"
+#include <QCoreApplication>
+
+// Baud rate of a serial site if none is given
+#define DEFAULT_SITE_BAUDRATE 38400
+
+//-----------------------------------------------------------------------------
+/** @brief Power Management Aggregator Main Program
+
+*/
+
+int main(int argc,char ** argv)
+{
+/* Interpret any command line options */
+    int c;
+    opterr = 0;
+    uint port = AGGREGATOR_PORT;
+    bool relay = false;
+    while ((c = getopt (argc, argv, "p:r")) != -1)
+    {
+        switch (c)
+        {
+// TCP port number
+        case 'p':
+            port = atoi(optarg);
+            break;
+// Relay mode
+        case 'r':
+            relay = true;
+            break;
+// Unknown
+        case '?':
+            if (optopt == 'p')
+                fprintf (stderr, "Option -%c requires an argument.\n", optopt);
+            else if (isprint (optopt))
+                fprintf (stderr, "Unknown option `-%c'.\n", optopt);
+            else
+                fprintf (stderr,"Unknown option character `\\x%x'.\n",optopt);
+            default: return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf (stderr, "No sites given.\n");
+        return 1;
+    }
+
+    QCoreApplication application(argc,argv);
+    AggregatorServer aggregator;
+    aggregator.setRelay(relay);
+/* Each site is [name=]address:port or [name=]device[:baudrate] */
+    for (int n=optind; n<argc; n++)
+    {
+        QString site = QString::fromLocal8Bit(argv[n]);
+        if (! site.contains('='))
+            site.prepend(QString("unit%1=").arg(n-optind+1));
+        QString name = site.section('=',0,0);
+        QString link = site.section('=',1);
+        QString address = link.section(':',0,0);
+        int parameter = link.section(':',1).toInt();
+        bool serial = address.startsWith('/');
+        if (name.isEmpty() || address.isEmpty() || (! serial && (parameter <= 0)))
+        {
+            fprintf (stderr, "Invalid site %s.\n", argv[n]);
+            return 1;
+        }
+        if (serial && (parameter <= 0)) parameter = DEFAULT_SITE_BAUDRATE;
+        if (! aggregator.addSite(name, address, serial ? 0 : parameter,
+                                 serial ? parameter : 0))
+        {
+            fprintf (stderr, "Unable to add site %s.\n", argv[n]);
+            return 1;
+        }
+    }
+    if (! aggregator.listen(port))
+    {
+        fprintf (stderr, "Unable to listen on port %u: %s\n", port,
+                 qPrintable(aggregator.errorString()));
+        return 1;
+    }
+    printf ("Serving %d sites on port %u\n", argc-optind, port);
+    fflush (stdout);
+    return application.exec();
+}
@@ -0,0 +1,22 @@
+PROJECT =       Power Management Aggregator
+TEMPLATE =      app
+TARGET          +=
+DEPENDPATH      += . ../gui
+INCLUDEPATH     += ../gui
+QT              -= gui
+QT              += network
+QT              += serialport
+
+OBJECTS_DIR     = obj
+MOC_DIR         = moc
+LANGUAGE        = C++
+CONFIG          += qt warn_on release console
+
+# Input
+HEADERS         += power-management-aggregator-server.h
+HEADERS         += ../gui/power-management-comms.h
+HEADERS         += ../gui/power-management-capture.h
+SOURCES         += power-management-aggregator.cpp
+SOURCES         += power-management-aggregator-server.cpp
+SOURCES         += ../gui/power-management-comms.cpp
+SOURCES         += ../gui/power-management-capture.cpp
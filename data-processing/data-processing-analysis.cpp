@@ -0,0 +1,259 @@
+/**
+@mainpage Power Management Data Processing Analysis
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+Analyses of a combined csv file. Each line is decoded once into a record that
+is given to every analyser in turn, each writing its own report, so that all
+the analyses are made in a single pass through the file.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-analysis.h"
+#include "data-processing-combine.h"
+
+//-----------------------------------------------------------------------------
+/** @brief Decode a line of a combined csv file.
+
+The field boundaries are found in one scan of the line and only the fields
+needed are converted. Line ending characters are removed with the surrounding
+white space of the first and last fields.
+
+@param[in] QByteArray line: line as read from the file.
+@returns false if the line does not have the full number of fields or does not
+start with a valid time.
+*/
+
+bool CsvRecord::decode(const QByteArray& line)
+{
+    int start[LINE_WIDTH+1];
+    int fields = 0;
+    start[fields++] = 0;
+    for (int i=0; i<line.size(); i++)
+    {
+        if (line.at(i) == ',')
+        {
+            if (fields >= LINE_WIDTH) return false;
+            start[fields++] = i+1;
+        }
+    }
+    if (fields != LINE_WIDTH) return false;
+    start[LINE_WIDTH] = line.size()+1;
+#define FIELD(n) line.mid(start[n],start[n+1]-start[n]-1).simplified()
+    timeText = QString::fromLatin1(FIELD(0));
+    time = QDateTime::fromString(timeText,Qt::ISODate);
+    if (! time.isValid()) return false;
+    for (int i=0; i<3; i++)
+    {
+        batteryCurrent[i] = FIELD(1+6*i).toFloat();
+        batteryVoltage[i] = FIELD(2+6*i).toFloat();
+        opState[i] = QString::fromLatin1(FIELD(4+6*i));
+        chargeMode[i] = QString::fromLatin1(FIELD(6+6*i));
+    }
+    panelVoltage = FIELD(24).toFloat();
+    switches = QString::fromLatin1(FIELD(27));
+    decisions = QString::fromLatin1(FIELD(28));
+    indicators = QString::fromLatin1(FIELD(29));
+#undef FIELD
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Analyser Constructor
+
+@param[in] QString reportFile: report to be written.
+@param[in] bool header: true if a header line is to be written first.
+*/
+
+Analyser::Analyser(const QString& reportFile, bool writeHeader)
+    : outFile(reportFile)
+{
+    header = writeHeader;
+}
+
+Analyser::~Analyser()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open the report.
+
+This will write to a new file, or append to the existing file.
+
+@returns false if the report could not be opened.
+*/
+
+bool Analyser::open()
+{
+    if (! outFile.open(QIODevice::WriteOnly | QIODevice::Append
+                                            | QIODevice::Text))
+        return false;
+    outStream.setDevice(&outFile);
+    if (header)
+    {
+        outStream << "Time,";
+        writeHeader();
+        outStream << "\n\r";
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Finish the report.
+*/
+
+void Analyser::close()
+{
+    if (! outFile.isOpen()) return;
+    outStream.flush();
+    outStream.setDevice(0);
+    outFile.close();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Fault Analyser Constructor
+*/
+
+FaultAnalyser::FaultAnalyser(const QString& reportFile, bool header)
+    : Analyser(reportFile,header)
+{
+}
+
+void FaultAnalyser::writeHeader()
+{
+    outStream << "B1 Op," << "B1 Charge,";
+    outStream << "B2 Op," << "B2 Charge,";
+    outStream << "B3 Op," << "B3 Charge,";
+    outStream << "B1 V," << "B2 V," << "B3 V," << "M1 V,";
+    outStream << "Switches," << "Decisions," << "Indicators";
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Look for charger not allocated but not all batteries in float or rest.
+*/
+
+void FaultAnalyser::analyse(const CsvRecord& record)
+{
+    bool ready = false;
+    for (int i=0; i<3; i++)
+    {
+        if (record.opState[i] == "Charge") return;
+        if ((record.chargeMode[i] != "Float") && (record.chargeMode[i] != "Rest")
+                && (record.panelVoltage > record.batteryVoltage[i]))
+            ready = true;
+    }
+    if (! ready) return;
+    outStream << record.timeText << ",";
+    for (int i=0; i<3; i++)
+    {
+        outStream << record.opState[i] << ",";
+        outStream << record.chargeMode[i] << ",";
+    }
+    for (int i=0; i<3; i++) outStream << record.batteryVoltage[i] << ",";
+    outStream << record.panelVoltage << ",";
+    outStream << record.switches << ",";
+    outStream << record.decisions << ",";
+    outStream << record.indicators;
+    outStream << "\n\r";
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Charger Analyser Constructor
+
+@param[in] int battery: battery to be analysed, counting from 0.
+*/
+
+ChargerAnalyser::ChargerAnalyser(int batteryNumber, const QString& reportFile,
+                                 bool header)
+    : Analyser(reportFile,header)
+{
+    battery = batteryNumber;
+}
+
+void ChargerAnalyser::writeHeader()
+{
+    outStream << "Mode,";
+    outStream << "V," << "I,";
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Look for charger allocated and battery not in rest.
+*/
+
+void ChargerAnalyser::analyse(const CsvRecord& record)
+{
+    if ((record.opState[battery] == "Charge") &&
+        (record.chargeMode[battery] != "Rest"))
+    {
+        outStream << record.timeText << ",";
+        outStream << record.chargeMode[battery] << ",";
+        outStream << record.batteryVoltage[battery] << ",";
+        outStream << record.batteryCurrent[battery];
+        outStream << "\n\r";
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Solar Analyser Constructor
+*/
+
+SolarAnalyser::SolarAnalyser(const QString& reportFile, bool header)
+    : Analyser(reportFile,header)
+{
+    firstRecord = true;
+}
+
+void SolarAnalyser::writeHeader()
+{
+    outStream << "V," << "I,";
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Look for charger allocated and battery in bulk.
+
+The first battery found in bulk charge is reported.
+*/
+
+void SolarAnalyser::analyse(const CsvRecord& record)
+{
+    if (firstRecord)
+    {
+        firstRecord = false;
+        return;
+    }
+    for (int i=0; i<3; i++)
+    {
+        if ((record.opState[i] == "Charge") && (record.chargeMode[i] == "Bulk"))
+        {
+            outStream << record.timeText << ",";
+            outStream << record.batteryVoltage[i] << ",";
+            outStream << record.batteryCurrent[i];
+            outStream << "\n\r";
+            return;
+        }
+    }
+    firstRecord = true;
+}
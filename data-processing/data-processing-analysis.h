@@ -0,0 +1,136 @@
+/*          Power Management Data Processing Analysis Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_ANALYSIS_H
+#define DATA_PROCESSING_ANALYSIS_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QTextStream>
+
+// Analyses of a csv file
+typedef enum {faultAnalysis, chargerAnalysis, solarAnalysis} AnalysisType;
+
+//-----------------------------------------------------------------------------
+/** @brief Line of a combined csv file.
+
+Only the fields used by the analyses are decoded, each once, with the text
+fields simplified as they are written to the reports.
+*/
+
+struct CsvRecord
+{
+    bool decode(const QByteArray& line);
+    QString timeText;
+    QDateTime time;
+    float batteryCurrent[3];
+    float batteryVoltage[3];
+    QString opState[3];
+    QString chargeMode[3];
+    float panelVoltage;
+    QString switches;
+    QString decisions;
+    QString indicators;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Analyser of csv records writing its own report file.
+*/
+
+class Analyser
+{
+public:
+    Analyser(const QString& reportFile, bool header);
+    virtual ~Analyser();
+    bool open();
+    void close();
+    virtual void analyse(const CsvRecord& record) = 0;
+protected:
+    virtual void writeHeader() = 0;
+    QFile outFile;
+    QTextStream outStream;
+private:
+    bool header;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Fault analysis.
+
+Looks for situations where the charger is not allocated but a battery is ready,
+that is no battery under charge and panel voltage above any battery not in
+float or rest.
+*/
+
+class FaultAnalyser : public Analyser
+{
+public:
+    FaultAnalyser(const QString& reportFile, bool header);
+    void analyse(const CsvRecord& record);
+protected:
+    void writeHeader();
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Charger analysis.
+
+Extracts the voltage and current of one battery while it is allocated to the
+charger and not resting.
+*/
+
+class ChargerAnalyser : public Analyser
+{
+public:
+    ChargerAnalyser(int battery, const QString& reportFile, bool header);
+    void analyse(const CsvRecord& record);
+protected:
+    void writeHeader();
+private:
+    int battery;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Solar analysis.
+
+Extracts the current of any battery in bulk charge. The first record when a
+battery enters bulk charge is not output, to avoid inaccuracies due to delays
+between the state change and the measurement.
+*/
+
+class SolarAnalyser : public Analyser
+{
+public:
+    SolarAnalyser(const QString& reportFile, bool header);
+    void analyse(const CsvRecord& record);
+protected:
+    void writeHeader();
+private:
+    bool firstRecord;
+};
+
+#endif
@@ -0,0 +1,433 @@
+/**
+@mainpage Power Management Data Processing Batch
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The processing operations can be run from the command line without a display,
+for example from a cron job working through each night's logs. The same jobs
+are used as in the window so that the results are the same. Many files can be
+given at once and these are processed in parallel.
+
+data-processing --batch [options] file...
+
+Raw data files (.txt) are dumped, split, extracted and have their energy
+balance computed. Combined csv files (.csv) are analysed.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-batch.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTime>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+/** @brief Batch Processor Constructor
+
+@param[in] QStringList arguments: command line arguments including the program.
+*/
+
+BatchProcessor::BatchProcessor(const QStringList& commandArguments)
+{
+    arguments = commandArguments;
+    jobEngine = new JobEngine(this);
+    connect(jobEngine, SIGNAL(jobFinished(ProcessingJob*)),
+            this, SLOT(jobFinished(ProcessingJob*)));
+    outputDirectory = QDir::current();
+    existing = existingOverwrite;
+    dump = false;
+    split = false;
+    energy = false;
+    fault = false;
+    charger = false;
+    solar = false;
+    zeroCurrent = false;
+    failures = 0;
+}
+
+BatchProcessor::~BatchProcessor()
+{
+    jobEngine->cancelAll();
+    jobEngine->waitForDone();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if the command line asks for batch processing.
+
+@param[in] QStringList arguments: command line arguments including the program.
+*/
+
+bool BatchProcessor::isBatch(const QStringList& arguments)
+{
+    return ((arguments.size() > 1) && (arguments[1] == "--batch"));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start processing the files.
+
+Raw data files are scanned first, and csv files analysed straight away.
+
+@returns false if the command line was not understood.
+*/
+
+bool BatchProcessor::start()
+{
+    if (! parseArguments())
+    {
+        usage();
+        return false;
+    }
+    for (int i=0; i<inputFiles.size(); i++)
+    {
+        if (inputFiles[i].endsWith(".csv", Qt::CaseInsensitive))
+            startAnalysisJobs(inputFiles[i]);
+        else if (dump || split || energy || (! extractTypes.isEmpty()))
+            jobEngine->start(new ScanJob(inputFiles[i]));
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Interpret the command line.
+
+@returns false if an argument is not recognised or missing.
+*/
+
+bool BatchProcessor::parseArguments()
+{
+    QStringList validTypes = ExtractJob::recordTypes();
+    for (int i=2; i<arguments.size(); i++)
+    {
+        QString argument = arguments[i];
+        bool hasValue = (i+1 < arguments.size());
+        if (argument == "--dump") dump = true;
+        else if (argument == "--split") split = true;
+        else if (argument == "--energy") energy = true;
+        else if (argument == "--fault") fault = true;
+        else if (argument == "--charger") charger = true;
+        else if (argument == "--solar") solar = true;
+        else if (argument == "--zero-current") zeroCurrent = true;
+        else if ((argument == "--extract") && hasValue)
+        {
+            extractTypes = arguments[++i].split(",");
+            for (int n=0; n<extractTypes.size(); n++)
+            {
+                if (! validTypes.contains(extractTypes[n])) return false;
+            }
+        }
+        else if ((argument == "--start") && hasValue)
+        {
+            startTime = QDateTime::fromString(arguments[++i], Qt::ISODate);
+            if (! startTime.isValid()) return false;
+        }
+        else if ((argument == "--end") && hasValue)
+        {
+            endTime = QDateTime::fromString(arguments[++i], Qt::ISODate);
+            if (! endTime.isValid()) return false;
+        }
+        else if ((argument == "--output") && hasValue)
+        {
+            outputDirectory = QDir(arguments[++i]);
+            if (! outputDirectory.exists()) return false;
+        }
+        else if ((argument == "--existing") && hasValue)
+        {
+            QString action = arguments[++i];
+            if (action == "overwrite") existing = existingOverwrite;
+            else if (action == "append") existing = existingAppend;
+            else if (action == "new") existing = existingNewFile;
+            else if (action == "skip") existing = existingSkip;
+            else return false;
+        }
+        else if ((argument == "--jobs") && hasValue)
+        {
+            bool ok;
+            int count = arguments[++i].toInt(&ok);
+            if ((! ok) || (count < 1)) return false;
+            jobEngine->setMaxThreadCount(count);
+        }
+        else if (argument.startsWith("--")) return false;
+        else inputFiles.append(argument);
+    }
+    return (! inputFiles.isEmpty());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Print the command line options.
+*/
+
+void BatchProcessor::usage() const
+{
+    std::cerr << "Usage: data-processing --batch [options] file..." << std::endl
+        << "Raw data files (.txt):" << std::endl
+        << "  --dump             combine records into name.csv" << std::endl
+        << "  --split            combine records into bms-data-date.csv"
+        << " for each day" << std::endl
+        << "  --energy           daily energy balance into name-energy.csv"
+        << std::endl
+        << "  --extract id,...   extract record types into name-extract.csv"
+        << std::endl
+        << "  --start time       start of time range (yyyy-MM-ddThh:mm:ss)"
+        << std::endl
+        << "  --end time         end of time range" << std::endl
+        << "  --zero-current     remove the current zero offsets" << std::endl
+        << "Combined csv files (.csv):" << std::endl
+        << "  --fault --charger --solar   analysis reports" << std::endl
+        << "General:" << std::endl
+        << "  --output dir       directory for output files" << std::endl
+        << "  --existing action  overwrite, append, new or skip existing"
+        << " day files and reports" << std::endl
+        << "  --jobs n           number of jobs run at once" << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Report a finished job and start what follows it.
+
+A scanned raw file has its operations started. The cache and index of a raw
+file are released when the last job reading it has finished.
+
+@param[in] ProcessingJob* job: the job finished.
+*/
+
+void BatchProcessor::jobFinished(ProcessingJob* job)
+{
+    if (job->succeeded())
+    {
+        if (job->message().isEmpty())
+            std::cout << qPrintable(job->title()) << " finished" << std::endl;
+        else
+            std::cout << qPrintable(job->title()) << " finished, "
+                      << qPrintable(job->message()) << std::endl;
+    }
+    else
+    {
+        std::cerr << qPrintable(job->title()) << ": "
+                  << qPrintable(job->message()) << std::endl;
+        failures++;
+    }
+    ScanJob* scan = dynamic_cast<ScanJob*>(job);
+    if ((scan != NULL) && scan->succeeded()) startRecordJobs(scan);
+    BatchLog* log = logJobs.take(job);
+    if ((log != NULL) && (--log->jobs == 0))
+    {
+        delete log->cache;
+        delete log->index;
+        delete log;
+    }
+    if (! jobEngine->isRunning()) emit finished();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start the operations on a scanned raw data file.
+
+The time range is that of the file unless given on the command line.
+
+@param[in] ScanJob* scan: the finished scan of the file.
+*/
+
+void BatchProcessor::startRecordJobs(ScanJob* scan)
+{
+    QString logName = scan->logName();
+    BatchLog* log = new BatchLog;
+    log->cache = scan->takeCache();
+    log->index = scan->takeIndex();
+    log->jobs = 1;
+    QDateTime fileStartTime = startTime;
+    QDateTime fileEndTime = endTime;
+    if (! fileStartTime.isValid()) fileStartTime = log->cache->startTime();
+    if (! fileEndTime.isValid()) fileEndTime = log->cache->endTime();
+    if (fileStartTime.isValid() && fileEndTime.isValid())
+    {
+        if (dump)
+            startRecordJob(new DumpJob(logName, log->cache, log->index,
+                           fileStartTime, fileEndTime,
+                           outputName(logName, ".csv")), log);
+        if (! extractTypes.isEmpty())
+        {
+            QStringList types = ExtractJob::recordTypes();
+            QStringList texts = ExtractJob::recordTexts();
+            QStringList extractTexts;
+            for (int n=0; n<extractTypes.size(); n++)
+                extractTexts << texts[types.indexOf(extractTypes[n])];
+            startRecordJob(new ExtractJob(logName, log->cache, log->index,
+                           fileStartTime, fileEndTime,
+                           outputName(logName, "-extract.csv"),
+                           extractTypes, extractTexts), log);
+        }
+        if (energy)
+            startRecordJob(new EnergyJob(logName, log->cache, log->index,
+                           fileStartTime, fileEndTime,
+                           outputName(logName, "-energy.csv")), log);
+        if (split)
+        {
+// Day files are named from their dates, as in the window
+            QDateTime splitEndTime(fileEndTime.date(),QTime(23,59,59));
+            QStringList saveFiles;
+            QList<SplitAction> actions;
+            for (QDate date = fileStartTime.date(); date <= fileEndTime.date();
+                                                    date = date.addDays(1))
+            {
+                QString saveFile = outputDirectory.filePath(
+                                    QString("bms-data-")
+                                    .append(date.toString("yyyy.MM.dd"))
+                                    .append(".csv"));
+                bool append = false;
+                SplitAction action = splitWrite;
+                if (QFile::exists(saveFile))
+                {
+                    if (! resolveExisting(&saveFile, &append))
+                        action = splitSkip;
+                    else if (append) action = splitAppend;
+                    else if (existing == existingNewFile) action = splitNewFile;
+                    else action = splitOverwrite;
+                }
+                saveFiles.append(saveFile);
+                actions.append(action);
+            }
+            startRecordJob(new SplitJob(logName, log->cache, log->index,
+                           fileStartTime, splitEndTime, saveFiles, actions),
+                           log);
+        }
+    }
+    else
+    {
+        std::cerr << qPrintable(logName) << ": no time records" << std::endl;
+        failures++;
+    }
+// Release the hold taken while the jobs were started
+    if (--log->jobs == 0)
+    {
+        delete log->cache;
+        delete log->index;
+        delete log;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start a job reading a scanned raw data file.
+
+@param[in] RecordJob* job: the job, which is then owned by the job engine.
+@param[in] BatchLog* log: the cache and index read by the job.
+*/
+
+void BatchProcessor::startRecordJob(RecordJob* job, BatchLog* log)
+{
+    if (zeroCurrent)
+        job->setCurrentZeros(log->cache->currentZero(0),
+                             log->cache->currentZero(1),
+                             log->cache->currentZero(2));
+    log->jobs++;
+    logJobs.insert(job, log);
+    jobEngine->start(job);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start the analyses of a combined csv file.
+
+The report names are made from the input file name and the current time as in
+the window.
+
+@param[in] QString inputFile: csv file to be analysed.
+*/
+
+void BatchProcessor::startAnalysisJobs(const QString& inputFile)
+{
+    QFileInfo inputFileInfo(inputFile);
+    QString inputFileStub(inputFileInfo.fileName());
+    QDateTime local(QDateTime::currentDateTime());
+    QString localTimeDate = local.toTimeSpec(Qt::LocalTime)
+                                 .toString("yyyy-MM-dd-hh-mm-ss");
+    localTimeDate.remove(QChar('-'));
+    QString outFileQualifier = QString("-").append(inputFileStub
+                              .left(inputFileStub.size()-4))
+                              .append("-").append(localTimeDate).append(".csv");
+    AnalysisJob* job = new AnalysisJob(inputFile);
+    bool append;
+    if (fault)
+    {
+        QString reportFile = outputDirectory.filePath(QString("fault")
+                                                .append(outFileQualifier));
+        if (resolveExisting(&reportFile, &append))
+            job->addAnalysis(faultAnalysis, 0, reportFile, ! append);
+    }
+    if (charger)
+    {
+        for (int i=0; i<3; i++)
+        {
+            QString reportFile = outputDirectory.filePath(
+                                    QString("charging-B%1").arg(i)
+                                    .append(outFileQualifier));
+            if (resolveExisting(&reportFile, &append))
+                job->addAnalysis(chargerAnalysis, i, reportFile, ! append);
+        }
+    }
+    if (solar)
+    {
+        QString reportFile = outputDirectory.filePath(QString("solar")
+                                                .append(outFileQualifier));
+        if (resolveExisting(&reportFile, &append))
+            job->addAnalysis(solarAnalysis, 0, reportFile, ! append);
+    }
+    if (job->analysisCount() > 0) jobEngine->start(job);
+    else delete job;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Name of an output file made from a raw data file name.
+
+@param[in] QString inputFile: raw data file.
+@param[in] QString suffix: added to the base name of the raw file.
+@returns QString output file in the output directory.
+*/
+
+QString BatchProcessor::outputName(const QString& inputFile,
+                                   const QString& suffix) const
+{
+    QFileInfo inputFileInfo(inputFile);
+    return outputDirectory.filePath(inputFileInfo.completeBaseName()
+                                    .append(suffix));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Apply the chosen action to an existing day file or report.
+
+An overwritten file is removed, and a new file is given a different name by
+adding a character at the end.
+
+@param[in,out] QString* fileName: output file, changed for a new file.
+@param[out] bool* append: true if the file is to be appended to.
+@returns false if the file is to be skipped.
+*/
+
+bool BatchProcessor::resolveExisting(QString* fileName, bool* append) const
+{
+    *append = false;
+    if (! QFile::exists(*fileName)) return true;
+    if (existing == existingSkip) return false;
+    if (existing == existingAppend) *append = true;
+    else if (existing == existingOverwrite) QFile::remove(*fileName);
+    else *fileName = fileName->left(fileName->length()-4).append("-a.csv");
+    return true;
+}
@@ -0,0 +1,103 @@
+/*          Power Management Data Processing Batch Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_BATCH_H
+#define DATA_PROCESSING_BATCH_H
+
+#include "data-processing-jobs.h"
+#include <QDateTime>
+#include <QDir>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+// Action taken on existing day files and reports
+typedef enum {existingOverwrite, existingAppend, existingNewFile, existingSkip}
+              ExistingAction;
+
+//-----------------------------------------------------------------------------
+/** @brief Cache and index of a raw data file shared by its jobs.
+*/
+
+struct BatchLog
+{
+    LogCache* cache;
+    TimeIndex* index;
+    int jobs;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Batch Processor.
+
+Runs the processing operations on files given on the command line without a
+display, using the same jobs as the window. All the raw files are scanned at
+once, and the operations on each file started as soon as it has been scanned.
+*/
+
+class BatchProcessor : public QObject
+{
+    Q_OBJECT
+public:
+    BatchProcessor(const QStringList& arguments);
+    ~BatchProcessor();
+    static bool isBatch(const QStringList& arguments);
+    bool start();
+    bool isRunning() const { return jobEngine->isRunning(); }
+    int exitCode() const { return (failures > 0) ? 1 : 0; }
+signals:
+    void finished();
+private slots:
+    void jobFinished(ProcessingJob* job);
+private:
+    bool parseArguments();
+    void usage() const;
+    void startRecordJobs(ScanJob* scan);
+    void startRecordJob(RecordJob* job, BatchLog* log);
+    void startAnalysisJobs(const QString& inputFile);
+    QString outputName(const QString& inputFile, const QString& suffix) const;
+    bool resolveExisting(QString* fileName, bool* append) const;
+    QStringList arguments;
+    QStringList inputFiles;
+    JobEngine* jobEngine;
+    QMap<ProcessingJob*,BatchLog*> logJobs;
+    QDir outputDirectory;
+    QDateTime startTime;
+    QDateTime endTime;
+    ExistingAction existing;
+    QStringList extractTypes;
+    bool dump;
+    bool split;
+    bool energy;
+    bool fault;
+    bool charger;
+    bool solar;
+    bool zeroCurrent;
+    int failures;
+};
+
+#endif
@@ -0,0 +1,235 @@
+/**
+@mainpage Power Management Data Processing Benchmark
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The scan of a raw data file for its start and end times and current zeros is
+timed as it was done before, reading each line through a QTextStream and
+splitting it into strings, and through the RecordReader used now. Both scans
+are run over the same files and must find the same results.
+
+data-processing --benchmark file...
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-benchmark.h"
+#include "data-processing-record.h"
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+/** @brief Results of a scan, which must be the same for both methods.
+*/
+
+typedef struct
+{
+    QDateTime startTime;
+    QDateTime endTime;
+    long long lines;
+    uint calibrationCount[3];
+    long long currentZero[3];
+} ScanResult;
+
+//-----------------------------------------------------------------------------
+/** @brief Compare two scan results.
+*/
+
+static bool sameResult(const ScanResult& a, const ScanResult& b)
+{
+    if ((a.startTime != b.startTime) || (a.endTime != b.endTime)) return false;
+    if (a.lines != b.lines) return false;
+    for (int i=0; i<3; i++)
+    {
+        if (a.calibrationCount[i] != b.calibrationCount[i]) return false;
+        if (a.currentZero[i] != b.currentZero[i]) return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Scan a file as done before.
+
+Each line is read into a QString and split at the commas into further strings.
+*/
+
+static void streamScan(QFile* inFile, ScanResult* result)
+{
+    static const char* current[3] = {"dB1","dB2","dB3"};
+    static const char* status[3] = {"dO1","dO2","dO3"};
+    int batteryCurrent[3] = {0, 0, 0};
+    QTextStream inStream(inFile);
+    while (! inStream.atEnd())
+    {
+        QString lineIn = inStream.readLine();
+        result->lines++;
+        QStringList breakdown = lineIn.split(",");
+        int length = breakdown.size();
+        if (length <= 1) continue;
+        QString firstText = breakdown[0].simplified();
+        QString secondText = breakdown[1].simplified();
+        if (firstText == "pH")
+        {
+            QDateTime time = QDateTime::fromString(secondText,Qt::ISODate);
+            if (result->startTime.isNull()) result->startTime = time;
+            result->endTime = time;
+        }
+        int secondField = secondText.toInt();
+        for (int i=0; i<3; i++)
+        {
+            if (firstText == current[i]) batteryCurrent[i] = secondField;
+            if ((firstText == status[i]) && ((secondField&0x03) == 2))
+            {
+                result->calibrationCount[i]++;
+                result->currentZero[i] += batteryCurrent[i];
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Scan a file through the RecordReader.
+*/
+
+static void readerScan(QFile* inFile, ScanResult* result)
+{
+    static const char* current[3] = {"dB1","dB2","dB3"};
+    static const char* status[3] = {"dO1","dO2","dO3"};
+    int batteryCurrent[3] = {0, 0, 0};
+    RecordReader reader(inFile);
+    while (reader.readRecord())
+    {
+        if (reader.fieldCount() <= 1) continue;
+        const RecordField& firstField = reader[0];
+        if (reader.isTimeRecord())
+        {
+            QDateTime time = reader.timeField();
+            if (result->startTime.isNull()) result->startTime = time;
+            result->endTime = time;
+        }
+        int secondField = reader.intField(1);
+        for (int i=0; i<3; i++)
+        {
+            if (firstField == current[i]) batteryCurrent[i] = secondField;
+            if ((firstField == status[i]) && ((secondField&0x03) == 2))
+            {
+                result->calibrationCount[i]++;
+                result->currentZero[i] += batteryCurrent[i];
+            }
+        }
+    }
+    result->lines = reader.lineCount();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Check if the benchmark is asked for.
+
+@param[in] QStringList arguments: the command line.
+@returns true if the first argument is --benchmark.
+*/
+
+bool isBenchmark(const QStringList& arguments)
+{
+    return ((arguments.size() > 1) && (arguments[1] == "--benchmark"));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Time both scans over each file given.
+
+Each scan is run BENCHMARK_REPEATS times in turn, so that both see the file in
+the page cache, and the best time of each is printed.
+
+@param[in] QStringList arguments: the command line.
+@returns int exit code, nonzero if a file could not be read or the results of
+the two scans differ.
+*/
+
+int benchmarkScan(const QStringList& arguments)
+{
+    if (arguments.size() < 3)
+    {
+        std::cerr << "Usage: data-processing --benchmark file..." << std::endl;
+        return 1;
+    }
+    int exitCode = 0;
+    for (int n=2; n<arguments.size(); n++)
+    {
+        QFile inFile(arguments[n]);
+        if (! inFile.open(QIODevice::ReadOnly))
+        {
+            std::cerr << qPrintable(arguments[n]) << ": unable to open"
+                      << std::endl;
+            exitCode = 1;
+            continue;
+        }
+        qint64 best[2] = {-1, -1};
+        ScanResult result[2];
+        QElapsedTimer timer;
+        for (int repeat=0; repeat<BENCHMARK_REPEATS; repeat++)
+        {
+            for (int method=0; method<2; method++)
+            {
+                ScanResult scan;
+                scan.lines = 0;
+                for (int i=0; i<3; i++)
+                {
+                    scan.calibrationCount[i] = 0;
+                    scan.currentZero[i] = 0;
+                }
+                inFile.seek(0);
+                timer.start();
+                if (method == 0) streamScan(&inFile,&scan);
+                else readerScan(&inFile,&scan);
+                qint64 elapsed = timer.nsecsElapsed();
+                if ((best[method] < 0) || (elapsed < best[method]))
+                    best[method] = elapsed;
+                result[method] = scan;
+            }
+        }
+        std::cout << qPrintable(arguments[n]) << ": "
+                  << result[0].lines << " lines, "
+                  << inFile.size() << " bytes" << std::endl;
+        const char* name[2] = {"QTextStream", "RecordReader"};
+        for (int method=0; method<2; method++)
+        {
+            double seconds = (double)qMax(best[method],(qint64)1)/1e9;
+            std::cout << "  " << name[method] << ": "
+                      << seconds*1000 << " ms, "
+                      << (long long)(result[method].lines/seconds) << " lines/s, "
+                      << (inFile.size()/seconds)/1e6 << " MB/s" << std::endl;
+        }
+        std::cout << "  speedup "
+                  << (double)best[0]/qMax(best[1],(qint64)1) << std::endl;
+        if (! sameResult(result[0],result[1]))
+        {
+            std::cerr << qPrintable(arguments[n])
+                      << ": the two scans found different results" << std::endl;
+            exitCode = 1;
+        }
+    }
+    return exitCode;
+}
@@ -0,0 +1,604 @@
+/**
+@mainpage Power Management Data Processing Log Cache
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+Parsing the raw text files, in particular the time records, takes most of the
+time in each processing pass. The file is parsed once when opened and the
+values held in a compact columnar form that is saved alongside the raw file.
+Later passes, and later sessions with the same unchanged raw file, read the
+cache instead of the text.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-cache.h"
+#include <QFileInfo>
+#include <cstring>
+
+// Record types in the order sent by the BMS following each time record. The
+// debug records follow, these being used by the combined csv output.
+static const char* cacheTypeNames[CACHE_TYPES] =
+    {"dB1","dC1","dO1","dB2","dC2","dO2","dB3","dC3","dO3",
+     "dL1","dL2","dM1","dT","dD","ds","dd","dI","D1","D2","D3"};
+
+//-----------------------------------------------------------------------------
+/** @brief Log Cache Constructor
+
+The cache is empty until built or loaded.
+*/
+
+LogCache::LogCache()
+{
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,CACHE_MAGIC,4);
+    header.version = CACHE_VERSION;
+    header.startTime = CACHE_NO_TIME;
+    header.endTime = CACHE_NO_TIME;
+    cacheFile = NULL;
+    map = NULL;
+    times = NULL;
+    masks = NULL;
+    values = NULL;
+}
+
+LogCache::~LogCache()
+{
+    if (map != NULL) cacheFile->unmap(map);
+    delete cacheFile;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Load a saved cache.
+
+The cache file is used only if it was made from a raw file of the same size
+and modification time as the one given.
+
+@param[in] QString logName: name of the raw data file.
+@returns true if a valid cache was found and mapped.
+*/
+
+bool LogCache::load(const QString& logName)
+{
+    QFileInfo logInfo(logName);
+    QFile* file = new QFile(cacheName(logName));
+    if (! file->open(QIODevice::ReadOnly))
+    {
+        delete file;
+        return false;
+    }
+    LogCacheHeader fileHeader;
+    bool valid = (file->read((char*)&fileHeader,sizeof(fileHeader))
+                    == sizeof(fileHeader));
+    if (valid)
+        valid = (memcmp(fileHeader.magic,CACHE_MAGIC,4) == 0) &&
+                (fileHeader.version == CACHE_VERSION) &&
+                (fileHeader.sourceSize == logInfo.size()) &&
+                (fileHeader.sourceModified ==
+                    logInfo.lastModified().toMSecsSinceEpoch()) &&
+                (file->size() == (qint64)sizeof(fileHeader) + fileHeader.frames*
+                    (qint64)(sizeof(qint64)+sizeof(quint32)
+                             +2*CACHE_TYPES*sizeof(qint16)));
+    uchar* fileMap = NULL;
+    if (valid)
+    {
+        fileMap = file->map(0,file->size());
+        valid = (fileMap != NULL);
+    }
+    if (! valid)
+    {
+        delete file;
+        return false;
+    }
+    if (map != NULL) cacheFile->unmap(map);
+    delete cacheFile;
+    cacheFile = file;
+    map = fileMap;
+    header = fileHeader;
+    timeColumn.clear();
+    maskColumn.clear();
+    for (int i=0; i<2*CACHE_TYPES; i++) valueColumns[i].clear();
+    setColumns(map);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Build the cache from a raw data file.
+
+The file is read from the start. The start and end times and the sums used
+for the current zero calibration are found at the same time. Records that
+cannot be held exactly in the cache are counted so that users can fall back to
+the raw file.
+
+@param[in] RecordReader* reader: reader of the opened raw data file.
+@param[out] TimeIndex* index: time index to be built alongside (may be NULL).
+*/
+
+void LogCache::build(RecordReader* reader, TimeIndex* index)
+{
+    if (map != NULL) cacheFile->unmap(map);
+    delete cacheFile;
+    cacheFile = NULL;
+    map = NULL;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,CACHE_MAGIC,4);
+    header.version = CACHE_VERSION;
+    header.startTime = CACHE_NO_TIME;
+    header.endTime = CACHE_NO_TIME;
+    times = NULL;
+    masks = NULL;
+    values = NULL;
+    timeColumn.clear();
+    maskColumn.clear();
+    for (int i=0; i<2*CACHE_TYPES; i++) valueColumns[i].clear();
+    int batteryCurrent[3] = {0,0,0};
+    if (index != NULL) index->clear();
+    reader->seek(0);
+    while (reader->readRecord())
+    {
+        int size = reader->fieldCount();
+        const RecordField& id = reader->field(0);
+        if (reader->isTimeRecord())
+        {
+            QDateTime time = reader->timeField();
+            qint64 timeMs = CACHE_NO_TIME;
+            if (time.isValid())
+            {
+                timeMs = time.toMSecsSinceEpoch();
+                if (header.startTime == CACHE_NO_TIME) header.startTime = timeMs;
+                header.endTime = timeMs;
+                if (index != NULL)
+                    index->add(timeMs,reader->recordPos(),timeColumn.size());
+            }
+// The time text must be recoverable exactly from the timestamp.
+            if ((! time.isValid()) ||
+                (time.toString(Qt::ISODate) != reader->timeText()))
+                header.inexactRecords++;
+            timeColumn.append(timeMs);
+            maskColumn.append(CACHE_TIME_BIT);
+            for (int i=0; i<2*CACHE_TYPES; i++) valueColumns[i].append(0);
+            continue;
+        }
+        int type = typeIndex(id);
+        if (type < 0) continue;
+        if (size <= 1)
+        {
+            header.inexactRecords++;
+            continue;
+        }
+// Records before the first time record go into a frame without a time.
+        if (timeColumn.isEmpty())
+        {
+            timeColumn.append(CACHE_NO_TIME);
+            maskColumn.append(0);
+            for (int i=0; i<2*CACHE_TYPES; i++) valueColumns[i].append(0);
+        }
+        qint64 frame = timeColumn.size()-1;
+        if ((maskColumn[frame] & (1 << type)) != 0) header.inexactRecords++;
+        maskColumn[frame] |= (1 << type);
+        int numberValues = isDual(type) ? 2 : 1;
+        if (size != numberValues+1) header.inexactRecords++;
+        for (int i=0; i<numberValues; i++)
+        {
+            bool ok;
+            int fieldValue = reader->field(i+1).toInt(&ok);
+            if (! ok) header.inexactRecords++;
+            if (isUnsigned(type))
+            {
+                if ((fieldValue < 0) || (fieldValue > 0xFFFF))
+                    header.inexactRecords++;
+            }
+            else if ((fieldValue < -32768) || (fieldValue > 32767))
+                header.inexactRecords++;
+            valueColumns[type*2+i][frame] = (qint16)fieldValue;
+        }
+// Gather the battery currents while isolated to find the current zero.
+        int secondField = reader->field(1).toInt();
+        for (int battery=0; battery<3; battery++)
+        {
+            if (type == 3*battery) batteryCurrent[battery] = secondField;
+            if ((type == 3*battery+2) && ((secondField & 0x03) == 2))
+            {
+                header.currentCount[battery]++;
+                header.currentSum[battery] += batteryCurrent[battery];
+            }
+        }
+    }
+    header.frames = timeColumn.size();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Save the cache alongside the raw file.
+
+The cache is written to a temporary file which then replaces any previous
+cache, so that an interrupted save does not leave a damaged cache. The columns
+are written one at a time from their blocks, and once saved are freed and the
+file mapped in their place.
+
+@param[in] QString logName: name of the raw data file.
+@returns true if the cache was saved.
+*/
+
+bool LogCache::save(const QString& logName)
+{
+    if (map != NULL) return true;
+    QFileInfo logInfo(logName);
+    header.sourceSize = logInfo.size();
+    header.sourceModified = logInfo.lastModified().toMSecsSinceEpoch();
+    QString saveName = cacheName(logName);
+    QFile file(saveName + ".tmp");
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    bool ok = (file.write((const char*)&header,sizeof(header))
+                    == sizeof(header));
+    if (ok) ok = timeColumn.write(&file);
+    if (ok) ok = maskColumn.write(&file);
+    for (int i=0; ok && (i<2*CACHE_TYPES); i++) ok = valueColumns[i].write(&file);
+    file.close();
+    if (ok)
+    {
+        QFile::remove(saveName);
+        ok = file.rename(saveName);
+    }
+    if (! ok) file.remove();
+// Map the saved cache, keeping the columns in memory if that fails
+    if (ok) load(logName);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if the cache holds all records exactly.
+
+@returns true if all passes can use the cache in place of the raw file.
+*/
+
+bool LogCache::isComplete() const
+{
+    return (header.inexactRecords == 0);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Value of a record field in a frame.
+
+@param[in] int type: record type index.
+@param[in] int field: 0 for the first value, 1 for the second.
+@param[in] qint64 frame: frame number.
+@returns integer value as it appeared in the raw record.
+*/
+
+int LogCache::value(int type, int field, qint64 frame) const
+{
+    qint16 rawValue;
+    if (map != NULL) rawValue = values[(type*2+field)*header.frames + frame];
+    else rawValue = valueColumns[type*2+field].at(frame);
+    if (isUnsigned(type)) return (int)(quint16)rawValue;
+    return (int)rawValue;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Time of the first time record.
+
+@returns QDateTime first time, null if none.
+*/
+
+QDateTime LogCache::startTime() const
+{
+    if (header.startTime == CACHE_NO_TIME) return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(header.startTime);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Time of the last time record.
+
+@returns QDateTime last time, null if none.
+*/
+
+QDateTime LogCache::endTime() const
+{
+    if (header.endTime == CACHE_NO_TIME) return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(header.endTime);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Current zero of a battery.
+
+This is the average battery current over records when the battery was
+isolated.
+
+@param[in] int battery: battery 0-2.
+@returns long long current zero x256, zero if the battery was never isolated.
+*/
+
+long long LogCache::currentZero(int battery) const
+{
+    if (header.currentCount[battery] == 0) return 0;
+    return header.currentSum[battery]/header.currentCount[battery];
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find the cache type of a record identifier.
+
+@param[in] RecordField id: record identifier.
+@returns int type index, -1 if not held in the cache.
+*/
+
+int LogCache::typeIndex(const RecordField& id)
+{
+    for (int type=0; type<CACHE_TYPES; type++)
+        if (id == cacheTypeNames[type]) return type;
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Record identifier of a cache type.
+
+@param[in] int type: record type index.
+@returns record identifier.
+*/
+
+const char* LogCache::typeName(int type)
+{
+    return cacheTypeNames[type];
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if a record type has two values.
+
+Battery, load and panel records carry current and voltage, and debug records
+carry two values.
+
+@param[in] int type: record type index.
+*/
+
+bool LogCache::isDual(int type)
+{
+    const char* name = cacheTypeNames[type];
+    return ((name[1] == 'B') || (name[1] == 'L') || (name[1] == 'M') ||
+            (name[0] == 'D'));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if a record type holds bit fields.
+
+Status and control records are 16 bit unsigned values in the BMS.
+
+@param[in] int type: record type index.
+*/
+
+bool LogCache::isUnsigned(int type)
+{
+    const char* name = cacheTypeNames[type];
+    return ((name[1] == 'O') || (name[1] == 'D') || (name[1] == 's') ||
+            (name[1] == 'd') || (name[1] == 'I'));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the column pointers into a mapped cache file.
+
+@param[in] uchar* base: start of the mapped file.
+*/
+
+void LogCache::setColumns(const uchar* base)
+{
+    times = (const qint64*)(base + sizeof(LogCacheHeader));
+    masks = (const quint32*)(times + header.frames);
+    values = (const qint16*)(masks + header.frames);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Cache Reader Constructor
+
+@param[in] LogCache* cache: a built or loaded cache.
+*/
+
+CacheReader::CacheReader(const LogCache* logCache)
+{
+    cache = logCache;
+    index = NULL;
+    rewind();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move to the start of the cache.
+*/
+
+void CacheReader::rewind()
+{
+    seekFrame(0);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move to a frame before a given time.
+
+If a time index has been given, reading starts shortly before the time,
+otherwise from the beginning of the cache.
+
+@param[in] QDateTime time: time to start from.
+*/
+
+void CacheReader::seekTime(const QDateTime& time)
+{
+    int entry = -1;
+    if (index != NULL) entry = index->find(time);
+    if (entry < 0) seekFrame(0);
+    else seekFrame(index->entry(entry).frame);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move to the start of a frame.
+
+@param[in] qint64 frame: frame number.
+*/
+
+void CacheReader::seekFrame(qint64 frame)
+{
+    seekItem(frame,-1);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move to a position within a frame.
+
+The position is one saved from frame() and item() so that reading can carry
+on from the same record, for example in another reader of the same cache.
+
+@param[in] qint64 frame: frame number.
+@param[in] int item: next record type to look for, -1 for the time record.
+*/
+
+void CacheReader::seekItem(qint64 frame, int item)
+{
+    currentFrame = frame;
+    nextItem = item;
+    currentType = -1;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the next record.
+
+@returns false if there are no more records.
+*/
+
+bool CacheReader::readRecord()
+{
+    while (currentFrame < cache->frameCount())
+    {
+        quint32 mask = cache->frameMask(currentFrame);
+        if (nextItem < 0)
+        {
+            nextItem = 0;
+            if ((mask & CACHE_TIME_BIT) != 0)
+            {
+                currentType = CACHE_TYPES;
+                idField = RecordField("pH",2);
+                return true;
+            }
+        }
+        while (nextItem < CACHE_TYPES)
+        {
+            int type = nextItem++;
+            if ((mask & (1 << type)) != 0)
+            {
+                currentType = type;
+                const char* name = LogCache::typeName(type);
+                idField = RecordField(name,strlen(name));
+                return true;
+            }
+        }
+        currentFrame++;
+        nextItem = -1;
+    }
+    currentType = -1;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test for the end of the cache.
+
+Every frame holds at least one record, so only the current frame need be
+checked for further records.
+
+@returns true if there are no more records to be read.
+*/
+
+bool CacheReader::atEnd() const
+{
+    if (currentFrame >= cache->frameCount()) return true;
+    quint32 mask = cache->frameMask(currentFrame);
+    if ((nextItem < 0) && ((mask & CACHE_TIME_BIT) != 0)) return false;
+    int from = (nextItem < 0) ? 0 : nextItem;
+    if (((mask & ~CACHE_TIME_BIT) >> from) != 0) return false;
+    return (currentFrame+1 >= cache->frameCount());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Number of fields of the current record.
+*/
+
+int CacheReader::fieldCount() const
+{
+    if (currentType < 0) return 0;
+    if (currentType == CACHE_TYPES) return 2;
+    if (LogCache::isDual(currentType)) return 3;
+    return 2;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Access a field of the current record as text.
+
+The text of value fields is made up as needed. It remains valid until the same
+field is requested again.
+
+@param[in] int index: field number, 0 being the record identifier.
+@returns RecordField view, empty if the field does not exist.
+*/
+
+const RecordField& CacheReader::field(int index) const
+{
+    if ((index < 0) || (index >= fieldCount())) return emptyField;
+    if (index == 0) return idField;
+    if (currentType == CACHE_TYPES) textBuffer[0] = timeText().toLatin1();
+    else textBuffer[index-1] = QByteArray::number(intField(index));
+    const QByteArray& text = textBuffer[(currentType == CACHE_TYPES) ? 0 : index-1];
+    textField[index-1] = RecordField(text.constData(),text.size());
+    return textField[index-1];
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Integer value of a field of the current record.
+
+@param[in] int index: field number.
+@returns int value, zero if the field does not exist or is a time.
+*/
+
+int CacheReader::intField(int index) const
+{
+    if ((currentType < 0) || (currentType == CACHE_TYPES)) return 0;
+    if ((index < 1) || (index >= fieldCount())) return 0;
+    return cache->value(currentType,index-1,currentFrame);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Time of the current time record.
+
+@returns QDateTime time, invalid if the record has no valid time.
+*/
+
+QDateTime CacheReader::timeField() const
+{
+    qint64 time = cache->frameTime(currentFrame);
+    if (time == CACHE_NO_TIME) return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(time);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Text of the current time record.
+
+@returns QString ISO 8601 time.
+*/
+
+QString CacheReader::timeText() const
+{
+    QDateTime time = timeField();
+    if (! time.isValid()) return QString();
+    return time.toString(Qt::ISODate);
+}
@@ -0,0 +1,209 @@
+/*          Power Management Data Processing Log Cache Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_CACHE_H
+#define DATA_PROCESSING_CACHE_H
+
+#include "data-processing-record.h"
+#include "data-processing-index.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+// Cache file identification. Change the version if the layout changes.
+#define CACHE_MAGIC "BMSC"
+#define CACHE_VERSION 2
+#define CACHE_SUFFIX ".bmc"
+
+// Number of record types held in the cache, excluding time records.
+#define CACHE_TYPES 20
+// Frame mask bit set when the frame starts with a time record.
+#define CACHE_TIME_BIT 0x80000000
+// Timestamp stored when there is no valid time.
+#define CACHE_NO_TIME (-0x7FFFFFFFFFFFFFFFLL-1)
+// Number of frames in each block of a column held in memory.
+#define CACHE_BLOCK_FRAMES 16384
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed header at the start of a cache file.
+
+All fields are 64 bit after the identification so that the columns following
+are aligned. The file uses the native byte order of the machine that made it.
+*/
+
+struct LogCacheHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 sourceSize;
+    qint64 sourceModified;
+    qint64 frames;
+    qint64 startTime;
+    qint64 endTime;
+    qint64 currentSum[3];
+    qint64 currentCount[3];
+    qint64 inexactRecords;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Column of a cache held in memory while it is built.
+
+The values are kept in blocks of CACHE_BLOCK_FRAMES so that the column can grow
+beyond the limit of a single QVector without being copied as it grows.
+*/
+
+template <typename T>
+class CacheColumn
+{
+public:
+    CacheColumn() : length(0) {}
+    void append(T value)
+    {
+        if ((length % CACHE_BLOCK_FRAMES) == 0)
+        {
+            blocks.append(QVector<T>());
+            blocks.last().reserve(CACHE_BLOCK_FRAMES);
+        }
+        blocks.last().append(value);
+        length++;
+    }
+    T& operator[](qint64 index)
+        { return blocks[index/CACHE_BLOCK_FRAMES][index%CACHE_BLOCK_FRAMES]; }
+    T at(qint64 index) const
+        { return blocks.at(index/CACHE_BLOCK_FRAMES).at(index%CACHE_BLOCK_FRAMES); }
+    qint64 size() const { return length; }
+    bool isEmpty() const { return (length == 0); }
+    void clear() { blocks.clear(); length = 0; }
+    bool write(QFile* file) const
+    {
+        for (int i=0; i<blocks.size(); i++)
+        {
+            qint64 bytes = blocks[i].size()*(qint64)sizeof(T);
+            if (file->write((const char*)blocks[i].constData(),bytes) != bytes)
+                return false;
+        }
+        return true;
+    }
+private:
+    QVector<QVector<T> > blocks;
+    qint64 length;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Columnar Cache of a Raw Data File.
+
+The raw records are gathered into frames, each starting with a time record and
+holding the records that follow it. The cache holds one column of timestamps
+(ms since epoch), one column of masks showing which record types were present
+in each frame, and two int16 columns (the raw x256 values) for each record
+type. Any records before the first time record form a frame without a time.
+
+The cache is saved alongside the raw file and memory mapped when the raw file
+is opened again unchanged. Once saved, the columns built in memory are freed and
+the saved file is mapped in their place. If it cannot be saved it is kept in
+memory.
+*/
+
+class LogCache
+{
+public:
+    LogCache();
+    ~LogCache();
+    bool load(const QString& logName);
+    void build(RecordReader* reader, TimeIndex* index = NULL);
+    bool save(const QString& logName);
+    static QString cacheName(const QString& logName)
+        { return logName + CACHE_SUFFIX; }
+    bool isComplete() const;
+    bool isMapped() const { return (map != NULL); }
+    qint64 frameCount() const { return header.frames; }
+    qint64 frameTime(qint64 frame) const
+        { return (map != NULL) ? times[frame] : timeColumn.at(frame); }
+    quint32 frameMask(qint64 frame) const
+        { return (map != NULL) ? masks[frame] : maskColumn.at(frame); }
+    int value(int type, int field, qint64 frame) const;
+    QDateTime startTime() const;
+    QDateTime endTime() const;
+    long long currentZero(int battery) const;
+    static int typeIndex(const RecordField& id);
+    static const char* typeName(int type);
+    static bool isDual(int type);
+private:
+    static bool isUnsigned(int type);
+    void setColumns(const uchar* base);
+    LogCacheHeader header;
+    QFile* cacheFile;
+    uchar* map;
+    CacheColumn<qint64> timeColumn;
+    CacheColumn<quint32> maskColumn;
+    CacheColumn<qint16> valueColumns[2*CACHE_TYPES];
+    const qint64* times;
+    const quint32* masks;
+    const qint16* values;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Record Source reading from a Log Cache.
+
+The frames are presented again as a sequence of records in the order sent by
+the BMS, so that processing passes see the same records as from the raw file.
+*/
+
+class CacheReader : public RecordSource
+{
+public:
+    CacheReader(const LogCache* cache);
+    bool readRecord();
+    bool atEnd() const;
+    void rewind();
+    void seekTime(const QDateTime& time);
+    void seekFrame(qint64 frame);
+    void seekItem(qint64 frame, int item);
+    void setIndex(const TimeIndex* timeIndex) { index = timeIndex; }
+    qint64 frame() const { return currentFrame; }
+    int item() const { return nextItem; }
+    int fieldCount() const;
+    const RecordField& field(int index) const;
+    int intField(int index) const;
+    bool isTimeRecord() const { return (currentType == CACHE_TYPES); }
+    QDateTime timeField() const;
+    QString timeText() const;
+private:
+    const LogCache* cache;
+    const TimeIndex* index;
+    qint64 currentFrame;
+    int nextItem;
+    int currentType;
+    RecordField idField;
+    RecordField emptyField;
+    mutable RecordField textField[2];
+    mutable QByteArray textBuffer[2];
+};
+
+#endif
@@ -0,0 +1,235 @@
+/**
+@mainpage Power Management Data Processing Capture File
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The GUI can save a session as a compressed capture instead of text. Each line
+is a fixed width record in a block of records that is compressed as a whole.
+The blocks are decoded here one at a time and the lines given back as text, so
+that a capture can be processed in the same way as a raw data file.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-capture.h"
+#include <QtEndian>
+#include <cstring>
+
+Q_STATIC_ASSERT(sizeof(CaptureRecord) == 32);
+Q_STATIC_ASSERT(sizeof(CaptureBlockHeader) == 32);
+
+//-----------------------------------------------------------------------------
+/** @brief Capture Decoder Constructor
+
+The block headers are read to find the records held in each block. A block that
+is cut short, as when the GUI was stopped while writing, ends the file.
+
+@param[in] QFile* file: the opened capture file.
+@param[in] const char* map: the file mapped into memory, or NULL.
+@param[in] qint64 size: size of the file in bytes.
+*/
+
+CaptureDecoder::CaptureDecoder(QFile* inFile, const char* fileMap,
+                               qint64 fileSize)
+{
+    file = inFile;
+    map = fileMap;
+    size = fileSize;
+    records = 0;
+    currentBlock = -1;
+    qint64 offset = sizeof(CaptureHeader);
+    CaptureBlockHeader header;
+    while ((offset+(qint64)sizeof(header) <= size) &&
+           readData(offset,(char*)&header,sizeof(header)))
+    {
+        if (memcmp(header.magic,CAPTURE_BLOCK_MAGIC,4) != 0) break;
+        CaptureBlock block;
+        block.offset = offset+sizeof(header);
+        block.firstRecord = records;
+        block.firstTime = qFromLittleEndian(header.firstTime);
+        block.records = qFromLittleEndian(header.records);
+        block.textSize = qFromLittleEndian(header.textSize);
+        block.compressedSize = qFromLittleEndian(header.compressedSize);
+        if (block.offset+block.compressedSize > size) break;
+        blocks.append(block);
+        records += block.records;
+        offset = block.offset+block.compressedSize;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test whether a file is a capture file.
+
+@param[in] QFile* file: the opened file.
+@param[in] const char* map: the file mapped into memory, or NULL.
+@param[in] qint64 size: size of the file in bytes.
+@returns true if the file starts with the capture header of this version.
+*/
+
+bool CaptureDecoder::isCapture(QFile* file, const char* map, qint64 size)
+{
+    if (size < (qint64)sizeof(CaptureHeader)) return false;
+    CaptureHeader header;
+    if (map != NULL) memcpy(&header,map,sizeof(header));
+    else
+    {
+        file->seek(0);
+        qint64 length = file->read((char*)&header,sizeof(header));
+        file->seek(0);
+        if (length != sizeof(header)) return false;
+    }
+    return ((memcmp(header.magic,CAPTURE_MAGIC,4) == 0) &&
+            (qFromLittleEndian(header.version) == CAPTURE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Give the text of a record.
+
+Records are best read in order, as a block is decompressed whenever a record
+is wanted from a different block.
+
+@param[in] qint64 record: record number from the start of the file.
+@param[out] QByteArray* line: the line as it was received.
+@returns false if the record could not be read, the line then being empty.
+*/
+
+bool CaptureDecoder::line(qint64 record, QByteArray* line)
+{
+    line->clear();
+    int block = currentBlock;
+    if ((block < 0) || (record < blocks[block].firstRecord) ||
+        (record >= blocks[block].firstRecord+blocks[block].records))
+    {
+        block = findBlock(record);
+        if ((block < 0) || ! loadBlock(block)) return false;
+    }
+    const CaptureRecord& entry =
+        blockRecords[(int)(record-blocks[block].firstRecord)];
+    if (entry.type == CAPTURE_TEXT)
+    {
+        if ((entry.field[0] < 0) || (entry.field[1] < 0) ||
+            (entry.field[0]+entry.field[1] > blockText.size())) return false;
+        line->append(blockText.constData()+entry.field[0],entry.field[1]);
+        return true;
+    }
+    for (int i=0; (i<3) && (entry.identifier[i] != 0); i++)
+        line->append(entry.identifier[i]);
+    for (int i=0; (i<entry.type) && (i<CAPTURE_FIELDS); i++)
+    {
+        line->append(',');
+        line->append(QByteArray::number(entry.field[i]));
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find where to start reading for a time.
+
+The block headers give the time of the first time record in each block. Reading
+starts at the last block before any block that starts after the time.
+
+@param[in] qint64 time: ms since epoch.
+@returns qint64 record number to start reading from.
+*/
+
+qint64 CaptureDecoder::findTime(qint64 time) const
+{
+    qint64 start = 0;
+    for (int n=0; n<blocks.size(); n++)
+    {
+        if (blocks[n].firstTime == CAPTURE_NO_TIME) continue;
+        if (blocks[n].firstTime > time) break;
+        start = blocks[n].firstRecord;
+    }
+    return start;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read bytes from the file or its map.
+*/
+
+bool CaptureDecoder::readData(qint64 offset, char* data, qint64 length)
+{
+    if ((offset < 0) || (offset+length > size)) return false;
+    if (map != NULL)
+    {
+        memcpy(data,map+offset,length);
+        return true;
+    }
+    if (! file->seek(offset)) return false;
+    return (file->read(data,length) == length);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find the block holding a record.
+
+@returns int block number, or -1 if the record is beyond the end.
+*/
+
+int CaptureDecoder::findBlock(qint64 record) const
+{
+    if ((record < 0) || (record >= records)) return -1;
+    int low = 0;
+    int high = blocks.size();
+    while (low+1 < high)
+    {
+        int middle = (low+high)/2;
+        if (blocks[middle].firstRecord <= record) low = middle;
+        else high = middle;
+    }
+    return low;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Decompress a block and restore its records from the word columns.
+
+@param[in] int block: block number.
+@returns false if the block is damaged.
+*/
+
+bool CaptureDecoder::loadBlock(int block)
+{
+    currentBlock = -1;
+    const CaptureBlock& entry = blocks[block];
+    QByteArray compressed(entry.compressedSize,0);
+    if (! readData(entry.offset,compressed.data(),entry.compressedSize))
+        return false;
+    QByteArray payload = qUncompress(compressed);
+    int count = entry.records;
+    if (payload.size() != count*(int)sizeof(CaptureRecord)+(int)entry.textSize)
+        return false;
+    blockRecords.resize(count);
+    const uchar* column = (const uchar*)payload.constData();
+    for (int word=0; word<8; word++)
+    {
+        for (int n=0; n<count; n++)
+        {
+            quint32 value = qFromLittleEndian<quint32>(column+4*(word*count+n));
+            memcpy((char*)&blockRecords[n]+4*word,&value,4);
+        }
+    }
+    blockText = payload.mid(count*sizeof(CaptureRecord));
+    currentBlock = block;
+    return true;
+}
@@ -0,0 +1,137 @@
+/*          Power Management Data Processing Capture File Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_CAPTURE_H
+#define DATA_PROCESSING_CAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QVector>
+
+/* The layout of the capture file is set by the GUI that writes it, and must be
+kept the same here. */
+#define CAPTURE_MAGIC "BMSR"
+#define CAPTURE_BLOCK_MAGIC "BMSB"
+#define CAPTURE_VERSION 1
+#define CAPTURE_SUFFIX ".bmr"
+
+// Number of integer fields held in a record, excluding the identifier
+#define CAPTURE_FIELDS 6
+// Record type for a line held as text
+#define CAPTURE_TEXT (-1)
+// Time stored in a block header when it has no time record
+#define CAPTURE_NO_TIME (-0x7FFFFFFFFFFFFFFFLL-1)
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed header at the start of a capture file.
+
+All values in the file are little endian.
+*/
+
+struct CaptureHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 startTime;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed header at the start of each compressed block.
+*/
+
+struct CaptureBlockHeader
+{
+    char magic[4];
+    quint32 records;
+    quint32 textSize;
+    quint32 compressedSize;
+    quint32 firstTick;
+    quint32 lastTick;
+    qint64 firstTime;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed width record of a line.
+
+The type is the number of integer fields, or CAPTURE_TEXT when the first two
+fields give the offset and length of the line in the text of the block.
+*/
+
+struct CaptureRecord
+{
+    quint32 tick;
+    char identifier[3];
+    qint8 type;
+    qint32 field[CAPTURE_FIELDS];
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Block of a capture file.
+*/
+
+struct CaptureBlock
+{
+    qint64 offset;
+    qint64 firstRecord;
+    qint64 firstTime;
+    quint32 records;
+    quint32 textSize;
+    quint32 compressedSize;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Capture File Decoder.
+
+Gives the lines of a compressed capture file by record number, so that the raw
+record reader can present a capture as if it were the text file. Only the
+block headers are read when the file is opened, and one block at a time is
+decompressed as it is needed.
+*/
+
+class CaptureDecoder
+{
+public:
+    CaptureDecoder(QFile* file, const char* map, qint64 size);
+    static bool isCapture(QFile* file, const char* map, qint64 size);
+    qint64 recordCount() const { return records; }
+    bool line(qint64 record, QByteArray* line);
+    qint64 findTime(qint64 time) const;
+private:
+    bool readData(qint64 offset, char* data, qint64 length);
+    int findBlock(qint64 record) const;
+    bool loadBlock(int block);
+    QFile* file;
+    const char* map;
+    qint64 size;
+    qint64 records;
+    QVector<CaptureBlock> blocks;
+    int currentBlock;
+    QVector<CaptureRecord> blockRecords;
+    QByteArray blockText;
+};
+
+#endif
@@ -0,0 +1,410 @@
+/**
+@mainpage Power Management Data Processing Record Combiner
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The BMS sends a time record followed by a set of measurement and status
+records. The combiner collects the records following each time record and
+writes them as one line of a csv file suitable for spreadsheet analysis.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-combine.h"
+
+//-----------------------------------------------------------------------------
+/** @brief Record Combiner Constructor
+
+All measurements start as undefined until the first record of each type.
+
+@param[in] long long battery1Zero: battery 1 current zero offset.
+@param[in] long long battery2Zero: battery 2 current zero offset.
+@param[in] long long battery3Zero: battery 3 current zero offset.
+*/
+
+RecordCombiner::RecordCombiner(long long battery1Zero, long long battery2Zero,
+                               long long battery3Zero)
+{
+    battery1CurrentZero = battery1Zero;
+    battery2CurrentZero = battery2Zero;
+    battery3CurrentZero = battery3Zero;
+    blockStart = false;
+    timePending = false;
+    battery1Voltage = -1;
+    battery1Current = 0;
+    battery1SoC = -1;
+    battery1OpState = -1;
+    battery2Voltage = -1;
+    battery2Current = 0;
+    battery2SoC = -1;
+    battery2OpState = -1;
+    battery3Voltage = -1;
+    battery3Current = 0;
+    battery3SoC = -1;
+    battery3OpState = -1;
+    load1Voltage = -1;
+    load1Current = 0;
+    load2Voltage = -1;
+    load2Current = 0;
+    panel1Voltage = -1;
+    panel1Current = 0;
+    temperature = -1;
+    controls = "     ";
+    debug1a = -1;
+    debug2a = -1;
+    debug3a = -1;
+    debug1b = -1;
+    debug2b = -1;
+    debug3b = -1;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Update the combined record from a raw record.
+
+Time records are not handled here as the caller decides when a block is to be
+written.
+
+@param[in] RecordField id: record identifier (first field).
+@param[in] int size: number of fields in the record.
+@param[in] int secondField: integer value of the second field.
+@param[in] int thirdField: integer value of the third field.
+*/
+
+void RecordCombiner::update(const RecordField& id, int size, int secondField,
+                            int thirdField)
+{
+    if (size <= 1) return;
+    if (id == "dB1")
+    {
+        battery1Current = secondField-battery1CurrentZero;
+        battery1Voltage = thirdField;
+    }
+    else if (id == "dB2")
+    {
+        battery2Current = secondField-battery2CurrentZero;
+        battery2Voltage = thirdField;
+    }
+    else if (id == "dB3")
+    {
+        battery3Current = secondField-battery3CurrentZero;
+        battery3Voltage = thirdField;
+    }
+    else if (id == "dC1") battery1SoC = secondField;
+    else if (id == "dC2") battery2SoC = secondField;
+    else if (id == "dC3") battery3SoC = secondField;
+    else if (id == "dO1") battery1OpState = secondField;
+    else if (id == "dO2") battery2OpState = secondField;
+    else if (id == "dO3") battery3OpState = secondField;
+    else if (id == "dL1")
+    {
+        load1Voltage = secondField;
+        load1Current = thirdField;
+    }
+    else if (id == "dL2")
+    {
+        load2Voltage = secondField;
+        load2Current = thirdField;
+    }
+    else if (id == "dM1")
+    {
+        panel1Voltage = secondField;
+        panel1Current = thirdField;
+    }
+    else if (id == "dT") temperature = secondField;
+// A = autotrack, R = recording, M = send measurements,
+// D = debug, Charger algorithm, X = load avoidance, I = maintain isolation
+    else if (id == "dD")
+    {
+        if ((secondField & (1 << 0)) > 0) controls[0] = 'A';
+        if ((secondField & (1 << 1)) > 0) controls[1] = 'R';
+        if ((secondField & (1 << 3)) > 0) controls[2] = 'M';
+        if ((secondField & (1 << 4)) > 0) controls[3] = 'D';
+        if (((secondField >> 5) & 3) == 0) controls[4] = '1';
+        if (((secondField >> 5) & 3) == 1) controls[4] = '2';
+        if (((secondField >> 5) & 3) == 2) controls[4] = '3';
+        if ((secondField & (1 << 7)) > 0) controls[5] = 'X';
+        if ((secondField & (1 << 8)) > 0) controls[6] = 'I';
+    }
+// Switch control bits - three 2-bit fields: battery number for each of
+// load1, load2 and panel.
+    else if (id == "ds")
+    {
+        switches.clear();
+        for (int i=0; i<6; i+=2)
+        {
+            uint battery = (secondField >> i) & 0x03;
+            switches.append(" ").append(QString::number(battery));
+        }
+    }
+    else if (id == "dd")
+    {
+        decision = QString("%1").arg(secondField,0,16);
+    }
+    else if (id == "dI")
+    {
+        indicatorString = "";
+        for (int i=0; i<12; i+=2)
+        {
+            if ((secondField & (1 << i)) > 0) indicatorString.append("_");
+            else indicatorString.append("O");
+            if ((secondField & (1 << (i+1))) > 0) indicatorString.append("_");
+            else indicatorString.append("U");
+        }
+    }
+    else if (id == "D1")
+    {
+        debug1a = secondField;
+        if (size > 2) debug1b = thirdField;
+    }
+    else if (id == "D2")
+    {
+        debug2a = secondField;
+        if (size > 2) debug2b = thirdField;
+    }
+    else if (id == "D3")
+    {
+        debug3a = secondField;
+        if (size > 2) debug3b = thirdField;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the next complete combined record.
+
+Records are read from the source until the following time record shows that
+the current block is complete. The block values, time and time text are then
+available until the next call. As with the csv output, the block following the
+last time record is not complete.
+
+@param[in] RecordSource* source: source of raw records.
+@returns false if no further complete block is available.
+*/
+
+bool RecordCombiner::readBlock(RecordSource* source)
+{
+// Begin the block started by the time record found on the last call
+    if (timePending)
+    {
+        time = pendingTime;
+        timeRecord = pendingTimeRecord;
+        timePending = false;
+    }
+    while (source->readRecord())
+    {
+        int size = source->fieldCount();
+        if (size <= 0) break;
+        if (source->isTimeRecord())
+        {
+            if (blockStart)
+            {
+                pendingTime = source->timeField();
+                pendingTimeRecord = source->timeText();
+                timePending = true;
+                return true;
+            }
+            time = source->timeField();
+            timeRecord = source->timeText();
+            blockStart = true;
+        }
+        else
+        {
+            int secondField = -1;
+            if (size > 1) secondField = source->intField(1);
+            int thirdField = -1;
+            if (size > 2) thirdField = source->intField(2);
+            update(source->field(0), size, secondField, thirdField);
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Numeric value of a column of the combined record.
+
+The columns are numbered as in the csv output. The battery operational,
+fill and charging columns give the 2-bit state code, -1 if not yet received.
+
+@param[in] int column: csv column number.
+@returns float value, zero for text columns.
+*/
+
+float RecordCombiner::columnValue(int column) const
+{
+    int battery = (column-1)/6;
+    int opState = -1;
+    if (battery == 0) opState = battery1OpState;
+    else if (battery == 1) opState = battery2OpState;
+    else if (battery == 2) opState = battery3OpState;
+    switch (column)
+    {
+        case 1: return (float)battery1Current/256;
+        case 2: return (float)battery1Voltage/256;
+        case 3: return (float)battery1SoC/256;
+        case 7: return (float)battery2Current/256;
+        case 8: return (float)battery2Voltage/256;
+        case 9: return (float)battery2SoC/256;
+        case 13: return (float)battery3Current/256;
+        case 14: return (float)battery3Voltage/256;
+        case 15: return (float)battery3SoC/256;
+        case 4: case 10: case 16:
+            if (opState < 0) return -1;
+            return opState & 0x03;
+        case 5: case 11: case 17:
+            if (opState < 0) return -1;
+            return (opState >> 2) & 0x03;
+        case 6: case 12: case 18:
+            if (opState < 0) return -1;
+            return (opState >> 4) & 0x03;
+        case 19: return (float)load1Voltage/256;
+        case 20: return (float)load1Current/256;
+        case 21: return (float)load2Voltage/256;
+        case 22: return (float)load2Current/256;
+        case 23: return (float)panel1Voltage/256;
+        case 24: return (float)panel1Current/256;
+        case 25: return (float)temperature/256;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write the csv header line.
+
+@param[in] QTextStream outStream: stream to write to.
+*/
+
+void RecordCombiner::writeHeader(QTextStream& outStream)
+{
+    outStream << "Time,";
+    outStream << "B1 I," << "B1 V," << "B1 Cap," << "B1 Op," << "B1 State," << "B1 Charge,";
+    outStream << "B2 I," << "B2 V," << "B2 Cap," << "B2 Op," << "B2 State," << "B2 Charge,";
+    outStream << "B3 I," << "B3 V," << "B3 Cap," << "B3 Op," << "B3 State," << "B3 Charge,";
+    outStream << "L1 I," << "L1 V," << "L2 I," << "L2 V," << "M1 I," << "M1 V,";
+    outStream << "Temp," << "Controls," << "Switches," << "Decisions," << "Indicators,";
+    outStream << "Debug 1a," << "Debug 1b," << "Debug 2a," << "Debug 2b," << "Debug 3a," << "Debug 3b";
+    outStream << "\n\r";
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write the combined record for the current time interval.
+
+@param[in] QTextStream outStream: stream to write to.
+*/
+
+void RecordCombiner::writeBlock(QTextStream& outStream) const
+{
+    outStream << timeRecord << ",";
+    outStream << (float)battery1Current/256 << ",";
+    outStream << (float)battery1Voltage/256 << ",";
+    outStream << (float)battery1SoC/256 << ",";
+    outStream << stateText(battery1OpState) << ",";
+    outStream << fillText(battery1OpState) << ",";
+    outStream << chargeText(battery1OpState) << ",";
+    outStream << (float)battery2Current/256 << ",";
+    outStream << (float)battery2Voltage/256 << ",";
+    outStream << (float)battery2SoC/256 << ",";
+    outStream << stateText(battery2OpState) << ",";
+    outStream << fillText(battery2OpState) << ",";
+    outStream << chargeText(battery2OpState) << ",";
+    outStream << (float)battery3Current/256 << ",";
+    outStream << (float)battery3Voltage/256 << ",";
+    outStream << (float)battery3SoC/256 << ",";
+    outStream << stateText(battery3OpState) << ",";
+    outStream << fillText(battery3OpState) << ",";
+    outStream << chargeText(battery3OpState) << ",";
+    outStream << (float)load1Voltage/256 << ",";
+    outStream << (float)load1Current/256 << ",";
+    outStream << (float)load2Voltage/256 << ",";
+    outStream << (float)load2Current/256 << ",";
+    outStream << (float)panel1Voltage/256 << ",";
+    outStream << (float)panel1Current/256 << ",";
+    outStream << (float)temperature/256 << ",";
+    outStream << controls << ",";
+    outStream << switches << ",";
+    outStream << decision << ",";
+    outStream << indicatorString << ",";
+    outStream << debug1a << ",";
+    outStream << debug1b << ",";
+    outStream << debug2a << ",";
+    outStream << debug2b << ",";
+    outStream << debug3a << ",";
+    outStream << debug3b;
+    outStream << "\n\r";
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Battery operational state text from the op state record.
+
+@param[in] int opState: op state field, negative if not yet received.
+@returns text of the operational state.
+*/
+
+const char* RecordCombiner::stateText(int opState)
+{
+    if (opState < 0) return "";
+    switch (opState & 0x03)
+    {
+        case 0: return "Loaded";
+        case 1: return "Charge";
+        case 2: return "Isolate";
+        default: return "Missing";
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Battery fill state text from the op state record.
+
+@param[in] int opState: op state field, negative if not yet received.
+@returns text of the fill state.
+*/
+
+const char* RecordCombiner::fillText(int opState)
+{
+    if (opState < 0) return "";
+    switch ((opState >> 2) & 0x03)
+    {
+        case 0: return "Normal";
+        case 1: return "Low";
+        case 2: return "Critical";
+        default: return "Faulty";
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Battery charging phase text from the op state record.
+
+@param[in] int opState: op state field, negative if not yet received.
+@returns text of the charging phase.
+*/
+
+const char* RecordCombiner::chargeText(int opState)
+{
+    if (opState < 0) return "";
+    switch ((opState >> 4) & 0x03)
+    {
+        case 0: return "Bulk";
+        case 1: return "Absorp";
+        case 2: return "Float";
+        default: return "Rest";
+    }
+}
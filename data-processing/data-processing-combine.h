@@ -0,0 +1,105 @@
+/*          Power Management Data Processing Record Combiner Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_COMBINE_H
+#define DATA_PROCESSING_COMBINE_H
+
+#include "data-processing-record.h"
+#include <QDateTime>
+#include <QString>
+#include <QTextStream>
+
+// Number of fields in a line of the combined csv file
+#define LINE_WIDTH 36
+
+//-----------------------------------------------------------------------------
+/** @brief Record Combiner.
+
+Holds the latest values of each raw record type seen between time records,
+and writes them as a single line of the combined csv format. Values persist
+from one time interval to the next until a new record of the same type is
+received.
+*/
+
+class RecordCombiner
+{
+public:
+    RecordCombiner(long long battery1Zero, long long battery2Zero,
+                   long long battery3Zero);
+    void update(const RecordField& id, int size, int secondField,
+                int thirdField);
+    void setTimeRecord(const QString& time) { timeRecord = time; }
+    bool readBlock(RecordSource* source);
+    QDateTime blockTime() const { return time; }
+    float columnValue(int column) const;
+    static void writeHeader(QTextStream& outStream);
+    void writeBlock(QTextStream& outStream) const;
+private:
+    static const char* stateText(int opState);
+    static const char* fillText(int opState);
+    static const char* chargeText(int opState);
+    long long battery1CurrentZero;
+    long long battery2CurrentZero;
+    long long battery3CurrentZero;
+    QString timeRecord;
+    QDateTime time;
+    bool blockStart;
+    bool timePending;
+    QDateTime pendingTime;
+    QString pendingTimeRecord;
+    int battery1Voltage;
+    int battery1Current;
+    int battery1SoC;
+    int battery1OpState;
+    int battery2Voltage;
+    int battery2Current;
+    int battery2SoC;
+    int battery2OpState;
+    int battery3Voltage;
+    int battery3Current;
+    int battery3SoC;
+    int battery3OpState;
+    int load1Voltage;
+    int load1Current;
+    int load2Voltage;
+    int load2Current;
+    int panel1Voltage;
+    int panel1Current;
+    int temperature;
+    QString controls;
+    QString switches;
+    QString decision;
+    QString indicatorString;
+    int debug1a;
+    int debug2a;
+    int debug3a;
+    int debug1b;
+    int debug2b;
+    int debug3b;
+};
+
+#endif
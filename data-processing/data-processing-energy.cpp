@@ -0,0 +1,342 @@
+/**
+@mainpage Power Management Data Processing Energy Balance
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The ampere-seconds taken from the batteries and supplied to loads and from
+the panel are added up for each day in a time range. The days are independent
+once it is known which record each day starts from, so when the raw file has a
+complete cache these are found first by a quick pass over the cache and the
+days then computed separately on as many threads as are available.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-energy.h"
+#include <QFile>
+#include <QTime>
+#include <climits>
+
+//-----------------------------------------------------------------------------
+/** @brief Energy Row Constructor
+*/
+
+EnergyRow::EnergyRow()
+{
+    day = 0;
+    battery1Energy = 0;
+    battery2Energy = 0;
+    battery3Energy = 0;
+    load1Energy = 0;
+    load2Energy = 0;
+    panelEnergy = 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Energy Row as Text.
+
+The energies are converted to ampere hours, followed by the total energy taken
+from the batteries (negative if charging).
+
+@returns QStringList date and energies as displayed and saved.
+*/
+
+QStringList EnergyRow::toStringList() const
+{
+    QStringList row;
+    long long totalEnergy = battery1Energy+battery2Energy+battery3Energy;
+    row << date.toString("dd/MM/yy");
+    row << QString("%1").arg((float)battery1Energy/921600,0,'g',3);
+    row << QString("%1").arg((float)battery2Energy/921600,0,'g',3);
+    row << QString("%1").arg((float)battery3Energy/921600,0,'g',3);
+    row << QString("%1").arg((float)load1Energy/921600,0,'g',3);
+    row << QString("%1").arg((float)load2Energy/921600,0,'g',3);
+    row << QString("%1").arg((float)panelEnergy/921600,0,'g',3);
+    row << QString("%1").arg((float)totalEnergy/921600,0,'g',3);
+    return row;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Energy Balance Constructor
+
+@param[in] QString logName: name of the raw data file.
+@param[in] LogCache* cache: cache of the raw file (may be NULL).
+@param[in] TimeIndex* index: time index of the raw file (may be NULL).
+@param[in] QDateTime startTime: start of the first day.
+@param[in] QDateTime finalTime: end of the last day.
+@param[in] long long battery1CurrentZero..battery3CurrentZero: current offsets.
+*/
+
+EnergyBalance::EnergyBalance(const QString& name, const LogCache* logCache,
+                             const TimeIndex* timeIndex,
+                             const QDateTime& start, const QDateTime& final,
+                             long long zero1, long long zero2, long long zero3)
+{
+    logName = name;
+    cache = logCache;
+    index = timeIndex;
+    cancelFlag = NULL;
+    startTime = start;
+    finalTime = final;
+    battery1CurrentZero = zero1;
+    battery2CurrentZero = zero2;
+    battery3CurrentZero = zero3;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if the days can be computed separately from the cache.
+
+The cache must hold every record of the raw file unchanged, otherwise the raw
+file is used.
+*/
+
+bool EnergyBalance::useCache() const
+{
+    return ((cache != NULL) && cache->isComplete());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start and end times of a day.
+
+The first day starts at the start time and ends at midnight. Later days start
+at midnight and end at midnight or the final time, whichever is earlier.
+
+@param[in] int day: day number counting from the start time.
+@param[out] QDateTime* dayStart: start of the day.
+@param[out] QDateTime* dayEnd: last second of the day.
+@returns false if the day starts after the final time.
+*/
+
+bool EnergyBalance::dayLimits(int day, QDateTime* dayStart,
+                              QDateTime* dayEnd) const
+{
+    if (day == 0)
+    {
+        *dayStart = startTime;
+        *dayEnd = QDateTime(startTime.date(),QTime(23,59,59));
+        return true;
+    }
+    *dayStart = QDateTime(startTime.date().addDays(day),QTime(0,0,0));
+    if (*dayStart > finalTime) return false;
+    *dayEnd = QDateTime(dayStart->date(),QTime(23,59,59));
+    if (*dayEnd > finalTime) *dayEnd = finalTime;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Divide the computation into days.
+
+The records are followed through exactly as the computation itself does, but
+without looking at any values, to find the record after which each day starts
+and the time in force there. A day moves on at the first record after the
+time passes the end of the day, so this is not always the first time record of
+the new day.
+
+Without a complete cache a single chunk covering all days is given. If
+cancelled, the days found so far are given.
+
+@returns QList<EnergyChunk> list of chunks in day order.
+*/
+
+QList<EnergyChunk> EnergyBalance::chunks() const
+{
+    QList<EnergyChunk> list;
+    EnergyChunk chunk;
+    chunk.firstDay = 0;
+    chunk.lastDay = INT_MAX;
+    chunk.frame = 0;
+    chunk.item = -1;
+    chunk.time = startTime;
+    if (! useCache())
+    {
+        list.append(chunk);
+        return list;
+    }
+    chunk.lastDay = 0;
+    list.append(chunk);
+    CacheReader reader(cache);
+    reader.setIndex(index);
+    reader.seekTime(startTime);
+    QDateTime time = startTime;
+    QDateTime dayStart;
+    QDateTime endTime;
+    int day = 0;
+    dayLimits(day,&dayStart,&endTime);
+    while (true)
+    {
+        if ((cancelFlag != NULL) && (*cancelFlag != 0)) break;
+        if (reader.readRecord() && reader.isTimeRecord())
+            time = reader.timeField();
+        if ((time > endTime) || reader.atEnd())
+        {
+            if (reader.atEnd()) break;
+            day++;
+            if (! dayLimits(day,&dayStart,&endTime)) break;
+            chunk.firstDay = day;
+            chunk.lastDay = day;
+            chunk.frame = reader.frame();
+            chunk.item = reader.item();
+            chunk.time = time;
+            list.append(chunk);
+        }
+    }
+    return list;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Compute the energy balance for the days of a chunk.
+
+Each call uses its own reader so that chunks can be run concurrently.
+
+@param[in] EnergyChunk chunk: days to compute, as given by chunks().
+@returns QList<EnergyRow> energy balance for each day completed.
+*/
+
+QList<EnergyRow> EnergyBalance::operator()(const EnergyChunk& chunk) const
+{
+    QList<EnergyRow> rows;
+    if (useCache())
+    {
+        CacheReader reader(cache);
+        reader.setIndex(index);
+        if (chunk.firstDay == 0) reader.seekTime(startTime);
+        else reader.seekItem(chunk.frame,chunk.item);
+        rows = accumulate(&reader,chunk);
+    }
+    else
+    {
+        QFile file(logName);
+        if (! file.open(QIODevice::ReadOnly)) return rows;
+        RecordReader reader(&file);
+        reader.setIndex(index);
+        reader.seekTime(startTime);
+        rows = accumulate(&reader,chunk);
+    }
+    return rows;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add up the currents over the days of a chunk.
+
+The source must be positioned where the first day of the chunk starts.
+
+Records are nominally 0.5 seconds apart but QT doesn't have fractions of
+a second. Therefore some intervals will be zero. This method however accounts
+for gaps in the records.
+
+@param[in] RecordSource* source: positioned records.
+@param[in] EnergyChunk chunk: days to compute.
+@returns QList<EnergyRow> energy balance for each day completed.
+*/
+
+QList<EnergyRow> EnergyBalance::accumulate(RecordSource* source,
+                                           const EnergyChunk& chunk) const
+{
+    QList<EnergyRow> rows;
+    int day = chunk.firstDay;
+    QDateTime dayStart;
+    QDateTime endTime;
+    if (! dayLimits(day,&dayStart,&endTime)) return rows;
+    QDateTime time = chunk.time;
+    QDateTime previousTime = chunk.time;
+    long elapsedSeconds = 0;
+    EnergyRow row;
+    row.day = day;
+    row.date = dayStart.date();
+    while (true)
+    {
+        if ((cancelFlag != NULL) && (*cancelFlag != 0)) break;
+        if (source->readRecord())
+        {
+            int size = source->fieldCount();
+            if (size <= 0) break;
+            const RecordField& firstText = source->field(0);
+            int secondField = 0;
+            if (size > 1)
+            {
+                if (firstText == "pH")
+                {
+                    previousTime = time;
+                    time = source->timeField();
+                    elapsedSeconds = previousTime.secsTo(time);
+                }
+                else
+                {
+                    secondField = source->intField(1);
+                }
+            }
+// The second field is the current times 256.
+            if (time >= dayStart)
+            {
+                if (firstText == "dB1")
+                {
+                    int battery1Current = secondField-battery1CurrentZero;
+                    row.battery1Energy += battery1Current*elapsedSeconds;
+                }
+                if (firstText == "dB2")
+                {
+                    int battery2Current = secondField-battery2CurrentZero;
+                    row.battery2Energy += battery2Current*elapsedSeconds;
+                }
+                if (firstText == "dB3")
+                {
+                    int battery3Current = secondField-battery3CurrentZero;
+                    row.battery3Energy += battery3Current*elapsedSeconds;
+                }
+// Sum only positive currents. Negatives are phantoms due to electronics.
+                if (firstText == "dL1")
+                {
+                    int load1Current = secondField;
+                    if (load1Current < 0) load1Current = 0;
+                    row.load1Energy += load1Current*elapsedSeconds;
+                }
+                if (firstText == "dL2")
+                {
+                    int load2Current = secondField;
+                    if (load2Current < 0) load2Current = 0;
+                    row.load2Energy += load2Current*elapsedSeconds;
+                }
+                if (firstText == "dM1")
+                {
+                    int panelCurrent = secondField;
+                    if (panelCurrent < 0) panelCurrent = 0;
+                    row.panelEnergy += panelCurrent*elapsedSeconds;
+                }
+            }
+        }
+// Completion of a day or file. Keep the day and get ready for the next.
+        if  ((time > endTime) || source->atEnd())
+        {
+            rows.append(row);
+            if (source->atEnd() || (day >= chunk.lastDay)) break;
+            elapsedSeconds = 0;
+            day++;
+            if (! dayLimits(day,&dayStart,&endTime)) break;
+            row = EnergyRow();
+            row.day = day;
+            row.date = dayStart.date();
+        }
+    }
+    return rows;
+}
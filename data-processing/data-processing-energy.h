@@ -0,0 +1,114 @@
+/*          Power Management Data Processing Energy Balance Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_ENERGY_H
+#define DATA_PROCESSING_ENERGY_H
+
+#include "data-processing-record.h"
+#include "data-processing-cache.h"
+#include "data-processing-index.h"
+#include <QAtomicInt>
+#include <QDate>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+//-----------------------------------------------------------------------------
+/** @brief Energy balance for one day.
+
+The energies are the sums of current x256 times elapsed seconds.
+*/
+
+struct EnergyRow
+{
+    EnergyRow();
+    QStringList toStringList() const;
+    int day;
+    QDate date;
+    long long battery1Energy;
+    long long battery2Energy;
+    long long battery3Energy;
+    long long load1Energy;
+    long long load2Energy;
+    long long panelEnergy;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Part of the energy balance computation that can run on its own.
+
+Gives the days covered and, for a cache, the record and time at which the
+first day starts.
+*/
+
+struct EnergyChunk
+{
+    int firstDay;
+    int lastDay;
+    qint64 frame;
+    int item;
+    QDateTime time;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Daily Energy Balance.
+
+Adds up the battery, load and panel currents over time for each day in a
+time range. When the raw file has a complete cache the days are found first
+so that each day can be computed separately, for example by
+QtConcurrent::mapped. Otherwise the raw file is read through in one chunk.
+*/
+
+class EnergyBalance
+{
+public:
+    typedef QList<EnergyRow> result_type;
+    EnergyBalance(const QString& logName, const LogCache* cache,
+                  const TimeIndex* index,
+                  const QDateTime& startTime, const QDateTime& finalTime,
+                  long long battery1CurrentZero, long long battery2CurrentZero,
+                  long long battery3CurrentZero);
+    void setCancelFlag(const QAtomicInt* flag) { cancelFlag = flag; }
+    QList<EnergyChunk> chunks() const;
+    QList<EnergyRow> operator()(const EnergyChunk& chunk) const;
+private:
+    bool useCache() const;
+    bool dayLimits(int day, QDateTime* dayStart, QDateTime* dayEnd) const;
+    QList<EnergyRow> accumulate(RecordSource* source,
+                                const EnergyChunk& chunk) const;
+    QString logName;
+    const LogCache* cache;
+    const TimeIndex* index;
+    const QAtomicInt* cancelFlag;
+    QDateTime startTime;
+    QDateTime finalTime;
+    long long battery1CurrentZero;
+    long long battery2CurrentZero;
+    long long battery3CurrentZero;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/**
+@mainpage Power Management Data Processing Time Index
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+Most processing is over a limited time range within a large raw data file.
+A sparse index of time records is made when the file is first scanned and
+saved alongside the raw file, so that each pass can go straight to its start
+time.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-index.h"
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+/** @brief Time Index Constructor
+*/
+
+TimeIndex::TimeIndex()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Empty the index.
+*/
+
+void TimeIndex::clear()
+{
+    entries.clear();
+    lastTime = 0;
+    ordered = true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add a time record to the index.
+
+This is called for every valid time record in file order. An entry is made
+only if the time has moved on by the index interval since the last entry.
+
+@param[in] qint64 time: time of the record (ms since epoch).
+@param[in] qint64 offset: byte offset of the record in the raw file.
+@param[in] qint64 frame: frame number of the record in the cache.
+*/
+
+void TimeIndex::add(qint64 time, qint64 offset, qint64 frame)
+{
+    if ((! entries.isEmpty()) && (time < lastTime)) ordered = false;
+    lastTime = time;
+    if ((! entries.isEmpty()) && (time < entries.last().time + INDEX_INTERVAL))
+        return;
+    TimeIndexEntry entry;
+    entry.time = time;
+    entry.offset = offset;
+    entry.frame = frame;
+    entries.append(entry);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find where to start reading for a given time.
+
+The entry returned is the last one before the given time, so that at least one
+time record earlier than the start time is read. This keeps the elapsed time
+and the record values correct at the start time.
+
+@param[in] QDateTime time: start time.
+@returns int entry to start from, -1 to start at the beginning of the file.
+*/
+
+int TimeIndex::find(const QDateTime& time) const
+{
+    if ((! ordered) || entries.isEmpty() || (! time.isValid())) return -1;
+    qint64 target = time.toMSecsSinceEpoch();
+    int low = 0;
+    int high = entries.size();
+// Binary search for the first entry at or after the target time
+    while (low < high)
+    {
+        int middle = (low+high)/2;
+        if (entries[middle].time < target) low = middle+1;
+        else high = middle;
+    }
+    return low-1;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Load a saved index.
+
+The index file is used only if it was made from a raw file of the same size
+and modification time as the one given.
+
+@param[in] QString logName: name of the raw data file.
+@returns true if a valid index was loaded.
+*/
+
+bool TimeIndex::load(const QString& logName)
+{
+    QFileInfo logInfo(logName);
+    QFile file(indexName(logName));
+    if (! file.open(QIODevice::ReadOnly)) return false;
+    TimeIndexHeader header;
+    if (file.read((char*)&header,sizeof(header)) != sizeof(header)) return false;
+    if ((memcmp(header.magic,INDEX_MAGIC,4) != 0) ||
+        (header.version != INDEX_VERSION) ||
+        (header.sourceSize != logInfo.size()) ||
+        (header.sourceModified != logInfo.lastModified().toMSecsSinceEpoch()) ||
+        (file.size() != (qint64)sizeof(header) +
+                        header.entries*(qint64)sizeof(TimeIndexEntry)))
+        return false;
+    clear();
+    entries.resize(header.entries);
+    qint64 length = header.entries*sizeof(TimeIndexEntry);
+    if (file.read((char*)entries.data(),length) != length)
+    {
+        clear();
+        return false;
+    }
+    ordered = (header.ordered != 0);
+    if (! entries.isEmpty()) lastTime = entries.last().time;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Save the index alongside the raw file.
+
+@param[in] QString logName: name of the raw data file.
+@returns true if the index was saved.
+*/
+
+bool TimeIndex::save(const QString& logName) const
+{
+    QFileInfo logInfo(logName);
+    TimeIndexHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,INDEX_MAGIC,4);
+    header.version = INDEX_VERSION;
+    header.sourceSize = logInfo.size();
+    header.sourceModified = logInfo.lastModified().toMSecsSinceEpoch();
+    header.entries = entries.size();
+    header.ordered = ordered ? 1 : 0;
+    QFile file(indexName(logName));
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    qint64 length = entries.size()*sizeof(TimeIndexEntry);
+    bool ok = (file.write((const char*)&header,sizeof(header))
+                    == sizeof(header)) &&
+              (file.write((const char*)entries.constData(),length) == length);
+    file.close();
+    if (! ok) file.remove();
+    return ok;
+}
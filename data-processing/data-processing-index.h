@@ -0,0 +1,100 @@
+/*          Power Management Data Processing Time Index Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_INDEX_H
+#define DATA_PROCESSING_INDEX_H
+
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+
+// Index file identification. Change the version if the layout changes.
+#define INDEX_MAGIC "BMSI"
+#define INDEX_VERSION 1
+#define INDEX_SUFFIX ".idx"
+
+// Minimum time between index entries (ms).
+#define INDEX_INTERVAL 60000
+
+//-----------------------------------------------------------------------------
+/** @brief Entry in the time index.
+
+Gives the time of a time record, the byte offset of the record in the raw
+file and the frame number of the record in the cache.
+*/
+
+struct TimeIndexEntry
+{
+    qint64 time;
+    qint64 offset;
+    qint64 frame;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed header at the start of an index file.
+*/
+
+struct TimeIndexHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 sourceSize;
+    qint64 sourceModified;
+    qint64 entries;
+    qint64 ordered;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Sparse Time Index of a Raw Data File.
+
+Holds one entry for about every minute of time records so that processing
+passes can start reading near a given start time instead of at the beginning
+of the file. The index is only usable if the times in the file never go
+backwards, as can happen if the BMS clock is reset.
+*/
+
+class TimeIndex
+{
+public:
+    TimeIndex();
+    void clear();
+    void add(qint64 time, qint64 offset, qint64 frame);
+    bool load(const QString& logName);
+    bool save(const QString& logName) const;
+    static QString indexName(const QString& logName)
+        { return logName + INDEX_SUFFIX; }
+    bool isOrdered() const { return ordered; }
+    int count() const { return entries.size(); }
+    const TimeIndexEntry& entry(int index) const { return entries[index]; }
+    int find(const QDateTime& time) const;
+private:
+    QVector<TimeIndexEntry> entries;
+    qint64 lastTime;
+    bool ordered;
+};
+
+#endif
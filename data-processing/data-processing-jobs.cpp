@@ -0,0 +1,937 @@
+/**
+@mainpage Power Management Data Processing Jobs
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The file processing operations are run as jobs on worker threads so that the
+window stays responsive and several jobs can run at once. The user interface
+gathers everything a job needs, including any decisions about existing output
+files, before the job is started.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-jobs.h"
+#include "data-processing-combine.h"
+#include <QByteArray>
+#include <QTextStream>
+
+//-----------------------------------------------------------------------------
+/** @brief Processing Job Constructor
+
+The job is not deleted by the thread pool, as its results may still be needed
+after it has run.
+
+@param[in] QString title: description of the job for display.
+*/
+
+ProcessingJob::ProcessingJob(const QString& title)
+{
+    jobTitle = title;
+    cancelled = 0;
+    success = false;
+    percent = -1;
+    setAutoDelete(false);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Run the job.
+
+Called on the worker thread.
+*/
+
+void ProcessingJob::run()
+{
+    success = process();
+    if ((! success) && isCancelled() && jobMessage.isEmpty())
+        jobMessage = "cancelled";
+    emit done();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Ask the job to stop.
+
+The job stops at the next record and leaves any output written so far.
+*/
+
+void ProcessingJob::cancel()
+{
+    cancelled = 1;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Report progress.
+
+A signal is sent only when the percentage changes.
+
+@param[in] qint64 done: amount of work done.
+@param[in] qint64 total: total amount of work.
+*/
+
+void ProcessingJob::setProgress(qint64 done, qint64 total)
+{
+    int newPercent = 100;
+    if (total > 0) newPercent = (int)(done*100/total);
+    if (newPercent < 0) newPercent = 0;
+    if (newPercent > 100) newPercent = 100;
+    if (newPercent == percent) return;
+    percent = newPercent;
+    emit progress(percent);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Record Job Constructor
+
+The cache and index must remain in existence until the job has finished.
+
+@param[in] QString title: description of the job for display.
+@param[in] QString logName: name of the raw data file.
+@param[in] LogCache* cache: cache of the raw file (may be NULL).
+@param[in] TimeIndex* index: time index of the raw file (may be NULL).
+@param[in] QDateTime startTime: start of the time range.
+@param[in] QDateTime endTime: end of the time range.
+*/
+
+RecordJob::RecordJob(const QString& title, const QString& name,
+                     const LogCache* logCache, const TimeIndex* timeIndex,
+                     const QDateTime& start, const QDateTime& end)
+    : ProcessingJob(title)
+{
+    logName = name;
+    cache = logCache;
+    index = timeIndex;
+    startTime = start;
+    endTime = end;
+    source = NULL;
+    file = NULL;
+    timeCount = 0;
+    battery1CurrentZero = 0;
+    battery2CurrentZero = 0;
+    battery3CurrentZero = 0;
+}
+
+RecordJob::~RecordJob()
+{
+    delete source;
+    delete file;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the current zero offsets to be removed from battery currents.
+*/
+
+void RecordJob::setCurrentZeros(long long battery1Zero, long long battery2Zero,
+                                long long battery3Zero)
+{
+    battery1CurrentZero = battery1Zero;
+    battery2CurrentZero = battery2Zero;
+    battery3CurrentZero = battery3Zero;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Make a reader for the job positioned just before the start time.
+
+@returns false if the raw file could not be opened.
+*/
+
+bool RecordJob::openSource()
+{
+    if ((cache != NULL) && cache->isComplete())
+    {
+        CacheReader* reader = new CacheReader(cache);
+        reader->setIndex(index);
+        source = reader;
+    }
+    else
+    {
+        file = new QFile(logName);
+        if (! file->open(QIODevice::ReadOnly))
+        {
+            setMessage("Could not open the input file");
+            return false;
+        }
+        RecordReader* reader = new RecordReader(file);
+        reader->setIndex(index);
+        source = reader;
+    }
+    source->seekTime(startTime);      // go to just before the start
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Report progress from the time of a time record.
+
+Time conversions are slow, so this only looks at every 256th time record.
+
+@param[in] QDateTime time: time of the latest time record.
+*/
+
+void RecordJob::timeProgress(const QDateTime& time)
+{
+    if ((timeCount++ & 0xFF) != 0) return;
+    if (! time.isValid()) return;
+    setProgress(startTime.secsTo(time),startTime.secsTo(endTime));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Dump Job Constructor
+
+@param[in] QString saveFile: csv file to be written.
+*/
+
+DumpJob::DumpJob(const QString& logName, const LogCache* cache,
+                 const TimeIndex* index, const QDateTime& startTime,
+                 const QDateTime& endTime, const QString& file)
+    : RecordJob(QString("Dump ").append(file),logName,cache,index,
+                startTime,endTime)
+{
+    saveFile = file;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Extract and Combine Raw Records to CSV.
+
+Raw records are combined into single records for each time interval, and written
+to a csv file. Format suitable for spreadsheet analysis.
+
+@returns true if the records were all written.
+*/
+
+bool DumpJob::process()
+{
+    QFile outFile(saveFile);
+    if (! outFile.open(QIODevice::WriteOnly))
+    {
+        setMessage("Could not open the output file");
+        return false;
+    }
+    if (! openSource()) return false;
+    RecordCombiner combiner(battery1CurrentZero, battery2CurrentZero,
+                            battery3CurrentZero);
+    bool blockStart = false;
+    QTextStream outStream(&outFile);
+    RecordCombiner::writeHeader(outStream);
+    QDateTime time = startTime;
+    while (! source->atEnd())
+    {
+        if (isCancelled()) break;
+        if  (time > endTime) break;
+        source->readRecord();
+        int size = source->fieldCount();
+        if (size <= 0) break;
+        const RecordField& firstText = source->field(0);
+// Find and extract the time record
+        if (source->isTimeRecord())
+        {
+            time = source->timeField();
+            timeProgress(time);
+            if ((blockStart) && (time > startTime))
+                combiner.writeBlock(outStream);
+            combiner.setTimeRecord(source->timeText());
+            blockStart = true;
+        }
+        else
+        {
+            int secondField = -1;
+            if (size > 1) secondField = source->intField(1);
+            int thirdField = -1;
+            if (size > 2) thirdField = source->intField(2);
+            combiner.update(firstText, size, secondField, thirdField);
+        }
+    }
+    outStream.flush();
+    outFile.close();
+    return (! isCancelled());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Split Job Constructor
+
+@param[in] QStringList saveFiles: day file for each day from the start date.
+@param[in] QList<SplitAction> actions: what to do with each day file.
+*/
+
+SplitJob::SplitJob(const QString& logName, const LogCache* cache,
+                   const TimeIndex* index, const QDateTime& startTime,
+                   const QDateTime& endTime, const QStringList& files,
+                   const QList<SplitAction>& fileActions)
+    : RecordJob(QString("Split to %1 days").arg(files.size()),logName,
+                cache,index,startTime,endTime)
+{
+    saveFiles = files;
+    actions = fileActions;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Split records to day record files.
+
+The input file is read once only. Each combined record is written to the day
+file for the date of its time record, the output moving on to the next day file
+when the time crosses midnight.
+
+@returns true if the records were all written.
+*/
+
+bool SplitJob::process()
+{
+    if (! openSource()) return false;
+    RecordCombiner combiner(battery1CurrentZero, battery2CurrentZero,
+                            battery3CurrentZero);
+    QFile* outFile = NULL;
+    QTextStream outStream;
+    int currentDay = -1;
+    bool blockStart = false;
+    bool ok = true;
+    QDateTime time = startTime;
+    QDateTime blockTime;
+    while (source->readRecord())
+    {
+        if (isCancelled()) break;
+        int size = source->fieldCount();
+        if (size <= 0) break;
+        const RecordField& firstText = source->field(0);
+        if (source->isTimeRecord())
+        {
+            time = source->timeField();
+            timeProgress(time);
+// Write out the block belonging to the previous time record.
+            if ((blockStart) && (time > startTime))
+            {
+                int day = startTime.date().daysTo(blockTime.date());
+                if (day < 0) day = 0;
+                if (day < saveFiles.size())
+                {
+                    if (day != currentDay)
+                    {
+                        if (outFile != NULL)
+                        {
+                            outStream.flush();
+                            outFile->close();
+                            delete outFile;
+                            outFile = NULL;
+                        }
+                        currentDay = day;
+                        if (actions[day] != splitSkip)
+                        {
+                            outFile = new QFile(saveFiles[day]);
+                            if (! outFile->open(QIODevice::WriteOnly |
+                                        QIODevice::Append | QIODevice::Text))
+                            {
+                                setMessage("Could not open the output file");
+                                delete outFile;
+                                outFile = NULL;
+                                ok = false;
+                                break;
+                            }
+                            outStream.setDevice(outFile);
+// Don't write the header into an appended file
+                            if (actions[day] != splitAppend)
+                                RecordCombiner::writeHeader(outStream);
+                        }
+                    }
+                    if (outFile != NULL) combiner.writeBlock(outStream);
+                }
+            }
+            combiner.setTimeRecord(source->timeText());
+            blockTime = time;
+            blockStart = true;
+            if (time > endTime) break;
+        }
+        else
+        {
+            int secondField = -1;
+            if (size > 1) secondField = source->intField(1);
+            int thirdField = -1;
+            if (size > 2) thirdField = source->intField(2);
+            combiner.update(firstText, size, secondField, thirdField);
+        }
+    }
+    if (outFile != NULL)
+    {
+        outStream.flush();
+        outFile->close();
+        delete outFile;
+    }
+    return (ok && (! isCancelled()));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Extract Job Constructor
+
+@param[in] QString saveFile: csv file to be written.
+@param[in] QStringList types: record identifiers selected.
+@param[in] QStringList texts: header text for each selected identifier.
+*/
+
+ExtractJob::ExtractJob(const QString& logName, const LogCache* cache,
+                       const TimeIndex* index, const QDateTime& startTime,
+                       const QDateTime& endTime, const QString& file,
+                       const QStringList& recordTypes,
+                       const QStringList& recordTexts)
+    : RecordJob(QString("Extract ").append(file),logName,cache,index,
+                startTime,endTime)
+{
+    saveFile = file;
+    types = recordTypes;
+    texts = recordTexts;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Record types that can be extracted.
+
+@returns QStringList record identifiers, in the order of recordTexts().
+*/
+
+QStringList ExtractJob::recordTypes()
+{
+    QStringList recordType;
+    recordType << "pH"  << "dT"  << "dD" << "ds";
+    recordType << "dB1" << "dB2" << "dB3";
+    recordType << "dC1" << "dC2" << "dC3";
+    recordType << "dO1" << "dO2" << "dO3";
+    recordType << "dL1" << "dL2" << "dM1";
+    return recordType;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Descriptions of the record types that can be extracted.
+
+@returns QStringList header text, in the order of recordTypes().
+*/
+
+QStringList ExtractJob::recordTexts()
+{
+    QStringList recordText;
+    recordText << "Time" << "Temperature" << "Controls" << "Switch Setting";
+    recordText << "Battery 1" << "Battery 2" << "Battery 3";
+    recordText << "Charge State 1" << "Charge State 2" << "Charge State 3";
+    recordText << "Charge Phase 1" << "Charge Phase 2" << "Charge Phase 3";
+    recordText << "Load 1" << "Load 2" << "Panel";
+    return recordText;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Extract Data.
+
+A header is built from the selected record types specified.
+Each record when found is written directly, excluding the ident field.
+This means that some records will have more than one field and so are dealt
+with individually.
+
+@returns true if the records were all written.
+*/
+
+bool ExtractJob::process()
+{
+    QFile outFile(saveFile);
+    if (! outFile.open(QIODevice::WriteOnly))
+    {
+        setMessage("Could not open the output file");
+        return false;
+    }
+    if (! openSource()) return false;
+    QTextStream outStream(&outFile);
+// Nothing further can be in range once past the end time, if times are ordered
+    bool ordered = (index != NULL) && index->isOrdered();
+    QDateTime time;
+    QString header;
+    QString comboRecord;
+// The first time record is a reference. Anything before that must be ignored.
+// firstTime allows the program to build a header and the first record.
+    bool firstTime = true;
+// The first record only is preceded by the constructed header.
+    bool firstRecord = true;
+// Record identifiers of the selected types, for comparison with raw fields
+    QList<QByteArray> selectedTypes;
+    for (int n=0; n<types.size(); n++) selectedTypes.append(types[n].toLatin1());
+    while (source->readRecord())
+    {
+        if (isCancelled()) break;
+        int size = source->fieldCount();
+        if (size <= 0) break;
+        const RecordField& firstText = source->field(0);
+// Extract the time record for time range comparison.
+        if (size > 1)
+        {
+            if (firstText == "pH")
+            {
+                time = source->timeField();
+                timeProgress(time);
+                if (ordered && (time > endTime)) break;
+                if ((time >= startTime) && (time <= endTime))
+                {
+                    if (!firstTime)
+                    {
+// On the first pass output the accumulated header string.
+                        if (firstRecord)
+                        {
+                            outStream << header << "\n\r";
+                            firstRecord = false;
+                        }
+// Output the combined record and null it for next pass.
+                        outStream << comboRecord << "\n\r";
+                        comboRecord = QString();
+                    }
+                    firstTime = false;
+                }
+            }
+        }
+// Extract records after the reference time record and between specified times.
+        if (!firstTime && (time >= startTime) && (time <= endTime))
+        {
+// Find the relevant records and extract their fields.
+            int rec = -1;
+            for (int n=0; n<selectedTypes.size(); n++)
+                if (firstText == selectedTypes[n].constData()) rec = n;
+            if (rec >= 0)
+            {
+                if (firstRecord)
+                {
+                    if (! header.isEmpty()) header += ",";
+                    header += texts[rec];
+                    if (size > 2) header += " I," + texts[rec] + " V";
+                }
+                if (! comboRecord.isEmpty()) comboRecord += ",";
+                comboRecord += source->field(1).toString();
+                if (size > 2) comboRecord += "," + source->field(2).toString();
+            }
+        }
+    }
+    outStream.flush();
+    outFile.close();
+    return (! isCancelled());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Energy Job Constructor
+
+@param[in] QString saveFile: csv file to be written.
+*/
+
+EnergyJob::EnergyJob(const QString& logName, const LogCache* cache,
+                     const TimeIndex* index, const QDateTime& startTime,
+                     const QDateTime& endTime, const QString& file)
+    : RecordJob(QString("Energy ").append(file),logName,cache,index,
+                startTime,endTime)
+{
+    saveFile = file;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Compute and save the daily energy balance.
+
+The rows are written in the same form as they are saved from the energy table.
+
+@returns true if all days were written.
+*/
+
+bool EnergyJob::process()
+{
+    QFile outFile(saveFile);
+    if (! outFile.open(QIODevice::WriteOnly))
+    {
+        setMessage("Could not open the output file");
+        return false;
+    }
+    QTextStream outStream(&outFile);
+    EnergyBalance energyBalance(logName, cache, index, startTime, endTime,
+                                battery1CurrentZero, battery2CurrentZero,
+                                battery3CurrentZero);
+    energyBalance.setCancelFlag(cancelFlag());
+    QList<EnergyChunk> chunks = energyBalance.chunks();
+    for (int i=0; i<chunks.size(); i++)
+    {
+        if (isCancelled()) break;
+        QList<EnergyRow> rows = energyBalance(chunks[i]);
+        for (int n=0; n<rows.size(); n++)
+            outStream << rows[n].toStringList().join(",") << "\n\r";
+        setProgress(i+1,chunks.size());
+    }
+    outStream.flush();
+    outFile.close();
+    return (! isCancelled());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Scan Job Constructor
+
+@param[in] QString logName: name of the raw data file.
+*/
+
+ScanJob::ScanJob(const QString& logName)
+    : ProcessingJob(QString("Scan ").append(logName))
+{
+    name = logName;
+    cache = NULL;
+    index = NULL;
+}
+
+ScanJob::~ScanJob()
+{
+    delete cache;
+    delete index;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take over the cache.
+
+@returns LogCache* the cache, now owned by the caller.
+*/
+
+LogCache* ScanJob::takeCache()
+{
+    LogCache* logCache = cache;
+    cache = NULL;
+    return logCache;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take over the time index.
+
+@returns TimeIndex* the index, now owned by the caller.
+*/
+
+TimeIndex* ScanJob::takeIndex()
+{
+    TimeIndex* timeIndex = index;
+    index = NULL;
+    return timeIndex;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Load or build the cache and time index.
+
+A cache or index that cannot be saved is still used for this run.
+
+@returns true if the raw file could be read.
+*/
+
+bool ScanJob::process()
+{
+    cache = new LogCache();
+    index = new TimeIndex();
+    if (cache->load(name) && index->load(name)) return true;
+    QFile file(name);
+    if (! file.open(QIODevice::ReadOnly))
+    {
+        setMessage("Could not open the input file");
+        return false;
+    }
+    RecordReader reader(&file);
+    cache->build(&reader, index);
+    if (! cache->save(name)) setMessage("cache not saved");
+    if (! index->save(name)) setMessage("index not saved");
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Plot Job Constructor
+
+@param[in] QString fileName: combined csv file or raw data file.
+@param[in] PlotSettings settings: series to be plotted.
+*/
+
+PlotJob::PlotJob(const QString& name, const PlotSettings& settings)
+    : ProcessingJob(QString("Plot ").append(name))
+{
+    fileName = name;
+    plotSettings = settings;
+    for (int series=0; series<4; series++) plotSeries[series] = NULL;
+    plotCache = NULL;
+    overviewBucket = 1;
+}
+
+PlotJob::~PlotJob()
+{
+    for (int series=0; series<4; series++) delete plotSeries[series];
+    delete plotCache;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take over the decimated points of a series.
+
+@param[in] int series: series number 0 to 3.
+@returns DecimatedData* points of the series, now owned by the caller. NULL if
+the series was not read.
+*/
+
+DecimatedData* PlotJob::takeSeries(int series)
+{
+    DecimatedData* data = plotSeries[series];
+    plotSeries[series] = NULL;
+    return data;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take over the cache of a raw data file.
+
+@returns LogCache* the cache, now owned by the caller. NULL for a csv file or
+if the records were not in time order.
+*/
+
+LogCache* PlotJob::takeCache()
+{
+    LogCache* cache = plotCache;
+    plotCache = NULL;
+    return cache;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read in the points to be plotted.
+
+A raw data file is read through its cache, built now if necessary, with the
+records combined as for the csv file. The cache is used from its saved file
+where possible so that it is mapped into memory rather than held there.
+
+@returns true if the file was read.
+*/
+
+bool PlotJob::process()
+{
+    QFile inFile(fileName);
+    if (! inFile.open(QIODevice::ReadOnly))
+    {
+        setMessage("Could not open the input file");
+        return false;
+    }
+    QTextStream inStream(&inFile);
+    CacheReader* plotReader = NULL;
+    RecordCombiner* combiner = NULL;
+    if (! fileName.endsWith(".csv",Qt::CaseInsensitive))
+    {
+        plotCache = new LogCache();
+        if (! plotCache->load(fileName))
+        {
+            RecordReader* reader = new RecordReader(&inFile);
+            plotCache->build(reader);
+            if (plotCache->save(fileName)) plotCache->load(fileName);
+            delete reader;
+        }
+        plotReader = new CacheReader(plotCache);
+        long long zero[3] = {0,0,0};
+        if (plotSettings.zeroCurrent)
+            for (int battery=0; battery<3; battery++)
+                zero[battery] = plotCache->currentZero(battery);
+        combiner = new RecordCombiner(zero[0],zero[1],zero[2]);
+// Keep the overview to a bounded number of points
+        overviewBucket = (int)(plotCache->frameCount()/PLOT_BUCKETS)+1;
+    }
+    PlotSampler sampler(plotSettings, overviewBucket);
+// Read in data from input file
+// Skip first line as it may be a header
+    QString lineIn;
+    if (plotReader == NULL) lineIn = inStream.readLine();
+    while (! isCancelled())
+    {
+// Values from the raw data cache, combined as for the csv file.
+        if (plotReader != NULL)
+        {
+            if (! combiner->readBlock(plotReader)) break;
+            setProgress(plotReader->frame(),plotCache->frameCount());
+            sampler.addBlock(*combiner);
+        }
+// Values from the csv file.
+        else
+        {
+            if (inStream.atEnd()) break;
+            lineIn = inStream.readLine();
+            setProgress(inFile.pos(),inFile.size());
+            sampler.addLine(lineIn);
+        }
+    }
+    delete combiner;
+    delete plotReader;
+    if (isCancelled()) return false;
+    sampler.finish();
+// Detail can only be found for a time window if the records are in order
+    if (! sampler.isOrdered())
+    {
+        delete plotCache;
+        plotCache = NULL;
+    }
+// Build the levels of detail, releasing the points as each is taken over
+    for (int series=0; series<4; series++)
+    {
+        QVector<QPointF> points = sampler.takePoints(series);
+        if (points.isEmpty()) continue;
+        plotSeries[series] = new DecimatedData(points);
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Analysis Job Constructor
+
+@param[in] QString inputFile: combined csv file to be analysed.
+*/
+
+AnalysisJob::AnalysisJob(const QString& input)
+    : ProcessingJob(QString("Analysis ").append(input))
+{
+    inputFile = input;
+}
+
+AnalysisJob::~AnalysisJob()
+{
+    qDeleteAll(analysers);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add an analysis with its report.
+
+@param[in] AnalysisType type: analysis to be made.
+@param[in] int battery: battery for the charger analysis, counting from 0.
+@param[in] QString reportFile: report to be written or appended to.
+@param[in] bool header: true if a header line is to be written first.
+*/
+
+void AnalysisJob::addAnalysis(AnalysisType type, int battery,
+                              const QString& reportFile, bool header)
+{
+    if (type == faultAnalysis)
+        analysers.append(new FaultAnalyser(reportFile,header));
+    else if (type == chargerAnalysis)
+        analysers.append(new ChargerAnalyser(battery,reportFile,header));
+    else
+        analysers.append(new SolarAnalyser(reportFile,header));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Analysis of a CSV file.
+
+Each line is decoded once and given to all the analysers. Lines that do not
+have the full number of fields or a valid time are ignored.
+
+@returns true if the analyses were completed.
+*/
+
+bool AnalysisJob::process()
+{
+    QFile inFile(inputFile);
+    if (! inFile.open(QIODevice::ReadOnly))
+    {
+        setMessage("Could not open the input file");
+        return false;
+    }
+    for (int i=0; i<analysers.size(); i++)
+    {
+        if (! analysers[i]->open())
+        {
+            setMessage("Could not open the output file");
+            return false;
+        }
+    }
+// Skip first line as it may be a header
+    inFile.readLine();
+    CsvRecord record;
+    while (! inFile.atEnd())
+    {
+        if (isCancelled()) break;
+        QByteArray lineIn = inFile.readLine();
+        setProgress(inFile.pos(),inFile.size());
+        if (! record.decode(lineIn)) continue;
+        for (int i=0; i<analysers.size(); i++) analysers[i]->analyse(record);
+    }
+    for (int i=0; i<analysers.size(); i++) analysers[i]->close();
+    return (! isCancelled());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Job Engine Constructor
+
+@param[in] QObject* parent: owner of the engine.
+*/
+
+JobEngine::JobEngine(QObject* parent) : QObject(parent)
+{
+}
+
+JobEngine::~JobEngine()
+{
+    cancelAll();
+    pool.waitForDone();
+    qDeleteAll(jobs);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start a job on a worker thread.
+
+The engine takes ownership of the job.
+
+@param[in] ProcessingJob* job: the job to run.
+*/
+
+void JobEngine::start(ProcessingJob* job)
+{
+    connect(job, SIGNAL(progress(int)), this, SLOT(progress(int)));
+    connect(job, SIGNAL(done()), this, SLOT(done()));
+    jobs.append(job);
+    emit jobStarted(job);
+    pool.start(job);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Ask all jobs to stop.
+*/
+
+void JobEngine::cancelAll()
+{
+    for (int i=0; i<jobs.size(); i++) jobs[i]->cancel();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Wait for all jobs to have run.
+
+The completion of each is handled later by the event loop.
+*/
+
+void JobEngine::waitForDone()
+{
+    pool.waitForDone();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Pass on progress of a job.
+
+@param[in] int percent: progress of the job.
+*/
+
+void JobEngine::progress(int percent)
+{
+    ProcessingJob* job = qobject_cast<ProcessingJob*>(sender());
+    if (job != NULL) emit jobProgress(job, percent);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Pass on completion of a job, then delete it.
+*/
+
+void JobEngine::done()
+{
+    ProcessingJob* job = qobject_cast<ProcessingJob*>(sender());
+    if (job == NULL) return;
+    jobs.removeAll(job);
+    emit jobFinished(job);
+    job->deleteLater();
+}
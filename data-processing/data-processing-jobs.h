@@ -0,0 +1,303 @@
+/*          Power Management Data Processing Jobs Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_JOBS_H
+#define DATA_PROCESSING_JOBS_H
+
+#include "data-processing-record.h"
+#include "data-processing-cache.h"
+#include "data-processing-index.h"
+#include "data-processing-energy.h"
+#include "data-processing-analysis.h"
+#include "data-processing-plot.h"
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QPointF>
+#include <QRunnable>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+// Action taken on each day file when splitting into an existing file
+typedef enum {splitWrite, splitOverwrite, splitAppend, splitNewFile, splitSkip}
+              SplitAction;
+
+//-----------------------------------------------------------------------------
+/** @brief Processing Job.
+
+A file processing operation that runs on a worker thread. Everything the job
+needs is given when it is made, so that it does not touch the user interface.
+Progress and completion are signalled and the job can be cancelled at any
+time from another thread.
+*/
+
+class ProcessingJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    ProcessingJob(const QString& title);
+    QString title() const { return jobTitle; }
+    QString message() const { return jobMessage; }
+    bool succeeded() const { return success; }
+    void run();
+public slots:
+    void cancel();
+signals:
+    void progress(int percent);
+    void done();
+protected:
+    virtual bool process() = 0;
+    bool isCancelled() const { return (cancelled != 0); }
+    void setProgress(qint64 done, qint64 total);
+    void setMessage(const QString& message) { jobMessage = message; }
+    const QAtomicInt* cancelFlag() const { return &cancelled; }
+private:
+    QString jobTitle;
+    QString jobMessage;
+    QAtomicInt cancelled;
+    bool success;
+    int percent;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Job reading the records of a raw data file.
+
+Each job has its own reader. The cache is shared and read from if it holds
+every record exactly, otherwise the raw file is opened again for the job.
+Progress is taken from the time of the records over the time range.
+*/
+
+class RecordJob : public ProcessingJob
+{
+public:
+    RecordJob(const QString& title, const QString& logName,
+              const LogCache* cache, const TimeIndex* index,
+              const QDateTime& startTime, const QDateTime& endTime);
+    ~RecordJob();
+    void setCurrentZeros(long long battery1Zero, long long battery2Zero,
+                         long long battery3Zero);
+protected:
+    bool openSource();
+    void timeProgress(const QDateTime& time);
+    RecordSource* source;
+    QDateTime startTime;
+    QDateTime endTime;
+    long long battery1CurrentZero;
+    long long battery2CurrentZero;
+    long long battery3CurrentZero;
+    const LogCache* cache;
+    const TimeIndex* index;
+    QString logName;
+private:
+    QFile* file;
+    int timeCount;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Combine all records over a time range into a csv file.
+*/
+
+class DumpJob : public RecordJob
+{
+public:
+    DumpJob(const QString& logName, const LogCache* cache,
+            const TimeIndex* index, const QDateTime& startTime,
+            const QDateTime& endTime, const QString& saveFile);
+protected:
+    bool process();
+private:
+    QString saveFile;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Combine records into a csv file for each day.
+*/
+
+class SplitJob : public RecordJob
+{
+public:
+    SplitJob(const QString& logName, const LogCache* cache,
+             const TimeIndex* index, const QDateTime& startTime,
+             const QDateTime& endTime, const QStringList& saveFiles,
+             const QList<SplitAction>& actions);
+protected:
+    bool process();
+private:
+    QStringList saveFiles;
+    QList<SplitAction> actions;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Extract selected record types into a csv file.
+*/
+
+class ExtractJob : public RecordJob
+{
+public:
+    ExtractJob(const QString& logName, const LogCache* cache,
+               const TimeIndex* index, const QDateTime& startTime,
+               const QDateTime& endTime, const QString& saveFile,
+               const QStringList& types, const QStringList& texts);
+    static QStringList recordTypes();
+    static QStringList recordTexts();
+protected:
+    bool process();
+private:
+    QString saveFile;
+    QStringList types;
+    QStringList texts;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Compute the daily energy balance into a csv file.
+
+The days are computed in turn, with one row written for each as displayed.
+*/
+
+class EnergyJob : public RecordJob
+{
+public:
+    EnergyJob(const QString& logName, const LogCache* cache,
+              const TimeIndex* index, const QDateTime& startTime,
+              const QDateTime& endTime, const QString& saveFile);
+protected:
+    bool process();
+private:
+    QString saveFile;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Scan a raw data file into its cache and time index.
+
+The cache and index are loaded if they are up to date, otherwise they are
+built and saved alongside the raw file. They are then taken over by whoever
+runs the jobs reading the file.
+*/
+
+class ScanJob : public ProcessingJob
+{
+public:
+    ScanJob(const QString& logName);
+    ~ScanJob();
+    QString logName() const { return name; }
+    LogCache* takeCache();
+    TimeIndex* takeIndex();
+protected:
+    bool process();
+private:
+    QString name;
+    LogCache* cache;
+    TimeIndex* index;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Read the points of a plot from a csv or raw data file.
+
+The points of each series are decimated into levels of detail here, and the
+plot itself is made from the series by the user interface.
+
+A raw data file is read through its cache as an overview of a bounded number
+of points. The cache is then kept for reading finer detail as the plot is
+zoomed in.
+*/
+
+class PlotJob : public ProcessingJob
+{
+    Q_OBJECT
+public:
+    PlotJob(const QString& fileName, const PlotSettings& settings);
+    ~PlotJob();
+    const PlotSettings& settings() const { return plotSettings; }
+    DecimatedData* takeSeries(int series);
+    LogCache* takeCache();
+    int bucket() const { return overviewBucket; }
+protected:
+    bool process();
+private:
+    QString fileName;
+    PlotSettings plotSettings;
+    DecimatedData* plotSeries[4];
+    LogCache* plotCache;
+    int overviewBucket;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Analyse a csv file into report files.
+
+All the analyses added are made together in a single pass through the file.
+*/
+
+class AnalysisJob : public ProcessingJob
+{
+public:
+    AnalysisJob(const QString& inputFile);
+    ~AnalysisJob();
+    void addAnalysis(AnalysisType type, int battery, const QString& reportFile,
+                     bool header);
+    int analysisCount() const { return analysers.size(); }
+protected:
+    bool process();
+private:
+    QString inputFile;
+    QList<Analyser*> analysers;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Job Engine.
+
+Runs jobs on a pool of worker threads, passing on their progress and
+completion. Finished jobs are deleted once the completion has been handled.
+*/
+
+class JobEngine : public QObject
+{
+    Q_OBJECT
+public:
+    JobEngine(QObject* parent = 0);
+    ~JobEngine();
+    void start(ProcessingJob* job);
+    void cancelAll();
+    void waitForDone();
+    void setMaxThreadCount(int count) { pool.setMaxThreadCount(count); }
+    bool isRunning() const { return (! jobs.isEmpty()); }
+signals:
+    void jobStarted(ProcessingJob* job);
+    void jobProgress(ProcessingJob* job, int percent);
+    void jobFinished(ProcessingJob* job);
+private slots:
+    void progress(int percent);
+    void done();
+private:
+    QThreadPool pool;
+    QList<ProcessingJob*> jobs;
+};
+
+#endif
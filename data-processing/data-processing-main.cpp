@@ -31,6 +31,7 @@ Utility program to aid in analysis if BMS data files.
 
 
 #include "data-processing-main.h"
+#include "data-processing-plot-window.h"
 #include <QApplication>
 #include <QString>
 #include <QLineEdit>
@@ -43,13 +44,16 @@ Utility program to aid in analysis if BMS data files.
 #include <QDir>
 #include <QFile>
 #include <QDebug>
-#include <qwt_plot.h>
-#include <qwt_plot_curve.h>
-#include <qwt_plot_grid.h>
-#include <qwt_symbol.h>
-#include <qwt_legend.h>
-#include <qwt_date_scale_draw.h>
-#include <qwt_date_scale_engine.h>
+#include <QElapsedTimer>
+#include <QComboBox>
+#include <QTableWidget>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 #include <cstdlib>
 #include <iostream>
 #include <unistd.h>
@@ -65,16 +69,8 @@ DataProcessingGui::DataProcessingGui()
 // Build the User Interface display from the Ui class in ui_mainwindowform.h
     DataProcessingMainUi.setupUi(this);
 // Build the record type list
-    recordType << "pH"  << "dT"  << "dD" << "ds";
-    recordType << "dB1" << "dB2" << "dB3";
-    recordType << "dC1" << "dC2" << "dC3";
-    recordType << "dO1" << "dO2" << "dO3";
-    recordType << "dL1" << "dL2" << "dM1";
-    recordText << "Time" << "Temperature" << "Controls" << "Switch Setting";
-    recordText << "Battery 1" << "Battery 2" << "Battery 3";
-    recordText << "Charge State 1" << "Charge State 2" << "Charge State 3";
-    recordText << "Charge Phase 1" << "Charge Phase 2" << "Charge Phase 3";
-    recordText << "Load 1" << "Load 2" << "Panel";
+    recordType = ExtractJob::recordTypes();
+    recordText = ExtractJob::recordTexts();
     DataProcessingMainUi.recordType_1->addItem("None");
     DataProcessingMainUi.recordType_2->addItem("None");
     DataProcessingMainUi.recordType_3->addItem("None");
@@ -99,11 +95,45 @@ DataProcessingGui::DataProcessingGui()
     DataProcessingMainUi.energyView->setHorizontalHeaderLabels(energyViewHeader);
 
     energyOutFile = NULL;
-    outFile = NULL;
+    inFile = NULL;
+    inReader = NULL;
+    inCache = NULL;
+    inCacheReader = NULL;
+    inIndex = NULL;
+    inSource = NULL;
+// Energy balance days are found and then reported as they are completed
+    energyBalance = NULL;
+    chunkWatcher = new QFutureWatcher<QList<EnergyChunk> >(this);
+    connect(chunkWatcher, SIGNAL(finished()), this, SLOT(energyChunksReady()));
+    energyWatcher = new QFutureWatcher<QList<EnergyRow> >(this);
+    connect(energyWatcher, SIGNAL(resultReadyAt(int)),
+            this, SLOT(energyRowsReady(int)));
+    connect(energyWatcher, SIGNAL(progressValueChanged(int)),
+            DataProcessingMainUi.energyProgressBar, SLOT(setValue(int)));
+    connect(energyWatcher, SIGNAL(finished()), this, SLOT(energyFinished()));
+    DataProcessingMainUi.energyProgressBar->hide();
+    DataProcessingMainUi.energyCancelButton->hide();
+// File processing jobs are listed while they run
+    jobEngine = new JobEngine(this);
+    connect(jobEngine, SIGNAL(jobStarted(ProcessingJob*)),
+            this, SLOT(jobStarted(ProcessingJob*)));
+    connect(jobEngine, SIGNAL(jobProgress(ProcessingJob*,int)),
+            this, SLOT(jobProgress(ProcessingJob*,int)));
+    connect(jobEngine, SIGNAL(jobFinished(ProcessingJob*)),
+            this, SLOT(jobFinished(ProcessingJob*)));
 }
 
 DataProcessingGui::~DataProcessingGui()
 {
+    stopEnergy();
+    jobEngine->cancelAll();
+    jobEngine->waitForDone();
+    delete energyBalance;
+    delete inCacheReader;
+    delete inCache;
+    delete inIndex;
+    delete inReader;
+    delete inFile;
 }
 
 //-----------------------------------------------------------------------------
@@ -127,18 +157,35 @@ void DataProcessingGui::on_openReadFileButton_clicked()
     QString errorMessage;
     QFileInfo fileInfo;
     QString filename = QFileDialog::getOpenFileName(this,
-                                "Data File","./","Text Files (*.txt *.TXT)");
+                                "Data File","./",
+                                "Text Files (*.txt *.TXT);;Compressed Captures (*.bmr)");
     if (filename.isEmpty())
     {
         displayErrorMessage("No filename specified");
         return;
     }
+// Release any previously opened file once nothing is reading it
+    stopEnergy();
+    jobEngine->cancelAll();
+    jobEngine->waitForDone();
+    delete energyBalance;
+    delete inCacheReader;
+    inCacheReader = NULL;
+    delete inCache;
+    inCache = NULL;
+    delete inIndex;
+    inIndex = NULL;
+    inSource = NULL;
+    delete inReader;
+    inReader = NULL;
+    delete inFile;
     inFile = new QFile(filename);
     fileInfo.setFile(filename);
 /* Look for start and end times, and determine current zero calibration */
     if (inFile->open(QIODevice::ReadOnly))
     {
-        scanFile(inFile);
+        inReader = new RecordReader(inFile);
+        scanFile(inReader);
     }
     else
     {
@@ -163,19 +210,11 @@ void DataProcessingGui::on_dumpAllButton_clicked()
 {
     QDateTime startTime = DataProcessingMainUi.startTime->dateTime();
     QDateTime endTime = DataProcessingMainUi.endTime->dateTime();
-    if (! inFile->isOpen()) return;
-    if (! openSaveFile()) return;
-    inFile->seek(0);      // rewind input file
-    combineRecords(startTime, endTime, inFile, outFile, true);
-    if (saveFile.isEmpty())
-        displayErrorMessage("File already closed");
-    else
-    {
-        outFile->close();
-        delete outFile;
-//! Clear the name to prevent the same file being used.
-        saveFile = QString();
-    }
+    if (inSource == NULL) return;
+    QString saveFile = saveFileName();
+    if (saveFile.isEmpty()) return;
+    startRecordJob(new DumpJob(inFile->fileName(), inCache, inIndex,
+                               startTime, endTime, saveFile));
 }
 
 //-----------------------------------------------------------------------------
@@ -188,99 +227,138 @@ An input file must already be opened using the Open button. Start time is taken
 from the first record of the input file and the end time is midnight.
 The save file is created from the input file name and the date on the first
 record of the input file. This is updated each time the record date changes.
-If the save file exists, abort and create a parallel save file or append data.
+
+The input file is read once only. Each combined record is written to the day
+file for the date of its time record, the output moving on to the next day file
+when the time crosses midnight. If any of the day files exist, the action for
+each (overwrite, append, create a parallel file or skip) is decided beforehand.
 */
 
 void DataProcessingGui::on_splitButton_clicked()
 {
-    if (! inFile->isOpen())
+    if (inSource == NULL)
     {
         displayErrorMessage("Open the input file first");
         return;
     }
     QDateTime startTime = DataProcessingMainUi.startTime->dateTime();
-    bool eof = false;
-    bool header = true;
-    while (! eof)
+    QDateTime finalTime = DataProcessingMainUi.endTime->dateTime();
+    if (! startTime.isValid()) return;
+// Set the end time to the record before midnight on the last day
+    QDateTime endTime(finalTime.date(),QTime(23,59,59));
+// Create the save filenames constructed from each date, and find those that
+// already exist.
+    QStringList saveFiles;
+    QList<SplitAction> actions;
+    QStringList existingFiles;
+    QList<int> existingDays;
+    for (QDate date = startTime.date(); date <= finalTime.date();
+                                        date = date.addDays(1))
     {
-        if (! startTime.isValid()) return;
-// Set the end time to the record before midnight
-        QDateTime endTime(startTime.date(),QTime(23,59,59));
-// Create a save filename constructed from start date
         QString filename = QString("bms-data-")
-                            .append(startTime.date().toString("yyyy.MM.dd"))
+                            .append(date.toString("yyyy.MM.dd"))
                             .append(".csv");
         QFileInfo fileInfo(filename);
         QDir saveDirectory = fileInfo.absolutePath();
         QString saveFile = saveDirectory.filePath(filename);
-// If it exists, decide what action to take.
-// Build a message box with options
-        bool skip = false;
         if (QFile::exists(saveFile))
         {
-            QMessageBox msgBox;
-            msgBox.setText(QString("A previous save file ").append(filename).
-                            append(" exists."));
-// Overwrite the existing file
-            QPushButton *overwriteButton = msgBox.addButton(tr("Overwrite"),
-                             QMessageBox::AcceptRole);
-// Append to the existing file
-            QPushButton *appendButton = msgBox.addButton(tr("Append"),
-                             QMessageBox::AcceptRole);
+            existingFiles.append(filename);
+            existingDays.append(saveFiles.size());
+        }
+        saveFiles.append(saveFile);
+        actions.append(splitWrite);
+    }
+// Decide on all existing files together.
+    if (! existingFiles.isEmpty())
+    {
+        QList<SplitAction> existingActions;
+        if (! splitConflictDialog(existingFiles, &existingActions)) return;
+        for (int i=0; i<existingDays.size(); i++)
+        {
+            int day = existingDays[i];
+            actions[day] = existingActions[i];
+            if (actions[day] == splitOverwrite) QFile::remove(saveFiles[day]);
 // Make a different filename by adding a character at the end
-            QPushButton *parallelButton = msgBox.addButton(tr("New File"),
-                             QMessageBox::AcceptRole);
-// Skip this file and go on to the next
-            QPushButton *skipButton = msgBox.addButton(tr("Skip"),
-                            QMessageBox::AcceptRole);
-// Quit altogether
-            QPushButton *abortButton = msgBox.addButton(tr("Abort"),
-                             QMessageBox::AcceptRole);
-            msgBox.exec();
-            if (msgBox.clickedButton() == overwriteButton)
-            {
-                QFile::remove(saveFile);
-            }
-            else if (msgBox.clickedButton() == parallelButton)
-            {
-                filename = filename.left(filename.length()-4).append("-a.csv");
-                QFileInfo fileInfo(filename);
-                QDir saveDirectory = fileInfo.absolutePath();
-                saveFile = saveDirectory.filePath(filename);
-            }
-            else if (msgBox.clickedButton() == skipButton)
-            {
-                skip = true;
-            }
-            else if (msgBox.clickedButton() == abortButton)
-            {
-                return;
-            }
-// Don't write the header into the appended file
-            else if (msgBox.clickedButton() == appendButton)
-            {
-                header = false;
-            }
+            else if (actions[day] == splitNewFile)
+                saveFiles[day] = saveFiles[day].left(saveFiles[day].length()-4)
+                                               .append("-a.csv");
         }
-// This will write to the file as created above, or append to the existing file.
-        if (! skip)
+    }
+// Single pass through the input file, changing the output file with the day.
+    startRecordJob(new SplitJob(inFile->fileName(), inCache, inIndex,
+                                startTime, endTime, saveFiles, actions));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Decide actions for existing split files.
+
+All the day files that already exist are listed with a choice of action for
+each, so that the split can proceed without further questions.
+
+@param[in] QStringList filenames: names of the existing files.
+@param[out] QList<SplitAction>* actions: action chosen for each file.
+@returns false if abort was selected.
+*/
+
+bool DataProcessingGui::splitConflictDialog(QStringList filenames,
+                                            QList<SplitAction>* actions)
+{
+    QStringList actionText;
+    actionText << "Overwrite" << "Append" << "New File" << "Skip";
+    QDialog dialog(this);
+    dialog.setWindowTitle("Existing Save Files");
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel(QString("%1 of the day files exist.")
+                                 .arg(filenames.size()),&dialog));
+// Selection of one action to apply to all files
+    QHBoxLayout* allLayout = new QHBoxLayout();
+    allLayout->addWidget(new QLabel("Set all to",&dialog));
+    QComboBox* allCombo = new QComboBox(&dialog);
+    allCombo->addItems(actionText);
+    allCombo->setCurrentIndex(3);
+    allLayout->addWidget(allCombo);
+    allLayout->addStretch();
+    layout->addLayout(allLayout);
+// Table of files with an action for each
+    QTableWidget* table = new QTableWidget(filenames.size(),2,&dialog);
+    table->setHorizontalHeaderLabels(QStringList() << "File" << "Action");
+    QList<QComboBox*> combos;
+    for (int i=0; i<filenames.size(); i++)
+    {
+        QTableWidgetItem* item = new QTableWidgetItem(filenames[i]);
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+        table->setItem(i, 0, item);
+        QComboBox* combo = new QComboBox(table);
+        combo->addItems(actionText);
+        combo->setCurrentIndex(3);      // Skip by default
+        table->setCellWidget(i, 1, combo);
+        connect(allCombo, SIGNAL(currentIndexChanged(int)),
+                combo, SLOT(setCurrentIndex(int)));
+        combos.append(combo);
+    }
+    table->resizeColumnsToContents();
+    layout->addWidget(table);
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok |
+                                                     QDialogButtonBox::Abort,
+                                                     Qt::Horizontal,&dialog);
+    connect(buttons, SIGNAL(accepted()), &dialog, SLOT(accept()));
+    connect(buttons, SIGNAL(rejected()), &dialog, SLOT(reject()));
+    layout->addWidget(buttons);
+    dialog.resize(400,300);
+    if (dialog.exec() != QDialog::Accepted) return false;
+    actions->clear();
+    for (int i=0; i<combos.size(); i++)
+    {
+        switch (combos[i]->currentIndex())
         {
-            QFile* outFile = new QFile(saveFile);   // Open file for output
-            if (! outFile->open(QIODevice::WriteOnly | QIODevice::Append
-                                                     | QIODevice::Text))
-            {
-                displayErrorMessage("Could not open the output file");
-                return;
-            }
-            inFile->seek(0);      // rewind input file
-            eof = combineRecords(startTime, endTime, inFile, outFile, header);
-            header = true;
-            outFile->close();
-            delete outFile;
+            case 0: actions->append(splitOverwrite); break;
+            case 1: actions->append(splitAppend); break;
+            case 2: actions->append(splitNewFile); break;
+            default: actions->append(splitSkip); break;
         }
-        startTime = QDateTime(startTime.date().addDays(1),QTime(0,0,0));
-        if (startTime > DataProcessingMainUi.endTime->dateTime()) return;
     }
+    return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -297,178 +375,145 @@ power usage. The total balance is displayed.
 The load and source currents show large negative swings when the undervoltage
 or overcurrent indicators are triggered. Any negative swing on those currents
 is set to zero. The indicator settings are captured but not used at this stage.
+
+The days are first found in the background, then computed in parallel and
+each row is filled in as its day is completed.
 */
 
 void DataProcessingGui::on_energyButton_clicked()
 {
-    if (inFile == NULL) return;
-    if (! inFile->isOpen()) return;
-    inFile->seek(0);      // rewind file
+    if (inSource == NULL) return;
+    if (energyRunning()) return;
     tableRow = 0;
 //    int interval = DataProcessingMainUi.intervalSpinBox->value();
 //    int intervaltype = DataProcessingMainUi.intervalType->currentIndex();
-    QTextStream inStream(inFile);
     QDateTime startTime = DataProcessingMainUi.startTime->dateTime();
     QDateTime finalTime = DataProcessingMainUi.endTime->dateTime();
-    QDateTime time = startTime;
-    QDateTime previousTime = startTime;
-// Cumulative energy measures
-    long long battery1Energy = 0;
-    long long battery2Energy = 0;
-    long long battery3Energy = 0;
-    long long load1Energy = 0;
-    long long load2Energy = 0;
-    long long panelEnergy = 0;
-    long battery1Seconds = 0;
-    long battery2Seconds = 0;
-    long battery3Seconds = 0;
-    long load1Seconds = 0;
-    long load2Seconds = 0;
-    long panelSeconds = 0;
-    long elapsedSeconds = 0;
-//    int indicators = 0;
     DataProcessingMainUi.energyView->clear();
-// Set the end time to the record before midnight
-    QDateTime endTime(startTime.date(),QTime(23,59,59));
-    while (true)
+    delete energyBalance;
+    energyBalance = new EnergyBalance(inFile->fileName(), inCache, inIndex,
+                                      startTime, finalTime, battery1CurrentZero,
+                                      battery2CurrentZero, battery3CurrentZero);
+    energyCancel = 0;
+    energyBalance->setCancelFlag(&energyCancel);
+// The progress bar shows as busy until the days are known
+    DataProcessingMainUi.energyProgressBar->setRange(0,0);
+    DataProcessingMainUi.energyProgressBar->show();
+    DataProcessingMainUi.energyCancelButton->show();
+    DataProcessingMainUi.energyButton->setEnabled(false);
+    chunkWatcher->setFuture(QtConcurrent::run(energyBalance,
+                                              &EnergyBalance::chunks));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief The days of the Energy Balance have been found.
+
+Each day is then computed in its own thread.
+*/
+
+void DataProcessingGui::energyChunksReady()
+{
+    if (energyCancel != 0)
     {
-        if (! inStream.atEnd())
-        {
-          	QString lineIn = inStream.readLine();
-            QStringList breakdown = lineIn.split(",");
-            int size = breakdown.size();
-            if (size <= 0) break;
-            QString firstText = breakdown[0].simplified();
-            int secondField = 0;
-//            int thirdField = 0;
-            if (size > 1)
-            {
-// Extract the time record for time range comparison.
-// records are nominally 0.5 seconds apart but QT doesn't have fractions of
-// a second. Therefore some intervals will be zero. This method however accounts
-// for gaps in the records.
-                if (firstText == "pH")
-                {
-                    previousTime = time;
-                    time = QDateTime::fromString(breakdown[1].simplified(),Qt::ISODate);
-                    elapsedSeconds = previousTime.secsTo(time);
-                }
-                else
-                {
-                    secondField = breakdown[1].simplified().toInt();
-                }
-            }
-//            if (size > 2) thirdField = breakdown[2].simplified().toInt();
-// Extract records of measured currents and add up. The second field is the
-// current times 256 and the third is the voltage times 256 (not needed).
-            if (time >= startTime)
-            {
-                if (firstText == "dB1")
-                {
-                    int battery1Current = secondField-battery1CurrentZero;
-                    battery1Energy += battery1Current*elapsedSeconds;
-                    battery1Seconds += elapsedSeconds;
-                }
-                if (firstText == "dB2")
-                {
-                    int battery2Current = secondField-battery2CurrentZero;
-                    battery2Energy += battery2Current*elapsedSeconds;
-                    battery2Seconds += elapsedSeconds;
-                }
-                if (firstText == "dB3")
-                {
-                    int battery3Current = secondField-battery3CurrentZero;
-                    battery3Energy += battery3Current*elapsedSeconds;
-                    battery3Seconds += elapsedSeconds;
-                }
-// Sum only positive currents. Negatives are phantoms due to electronics.
-                if (firstText == "dL1")
-                {
-                    int load1Current = secondField;
-                    if (load1Current < 0) load1Current = 0;
-                    load1Energy += load1Current*elapsedSeconds;
-                    load1Seconds += elapsedSeconds;
-                }
-                if (firstText == "dL2")
-                {
-                    int load2Current = secondField;
-                    if (load2Current < 0) load2Current = 0;
-                    load2Energy += load2Current*elapsedSeconds;
-                    load2Seconds += elapsedSeconds;
-                }
-                if (firstText == "dM1")
-                {
-                    int panelCurrent = secondField;
-                    if (panelCurrent < 0) panelCurrent = 0;
-                    panelEnergy += panelCurrent*elapsedSeconds;
-                    panelSeconds += elapsedSeconds;
-                }
-// Get record of indicators (not needed)
-//                if (firstText == "dI") indicators = secondField;
-            }
-        }
-// Completion of a day or file. Print out and get ready for next.
-        if  ((time > endTime) || inStream.atEnd())
-        {
+        energyFinished();
+        return;
+    }
+    QList<EnergyChunk> chunks = chunkWatcher->result();
+    DataProcessingMainUi.energyProgressBar->setRange(0,chunks.size());
+    DataProcessingMainUi.energyProgressBar->setValue(0);
+    energyWatcher->setFuture(QtConcurrent::mapped(chunks,*energyBalance));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Cancel the Energy Balance.
+
+Days not yet started are dropped and those running are stopped.
+*/
+
+void DataProcessingGui::on_energyCancelButton_clicked()
+{
+    energyCancel = 1;
+    energyWatcher->cancel();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Stop the Energy Balance and wait for it to finish.
+
+Used before the open file is released.
+*/
+
+void DataProcessingGui::stopEnergy()
+{
+    if (! energyRunning()) return;
+    on_energyCancelButton_clicked();
+    chunkWatcher->waitForFinished();
+    energyWatcher->waitForFinished();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if the Energy Balance is finding or computing its days.
+*/
+
+bool DataProcessingGui::energyRunning() const
+{
+    return (chunkWatcher->isRunning() || energyWatcher->isRunning());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the days of a completed Energy Balance chunk.
+
+@param[in] int index: index of the chunk result.
+*/
+
+void DataProcessingGui::energyRowsReady(int index)
+{
+    QList<EnergyRow> rows = energyWatcher->resultAt(index);
+    for (int i=0; i<rows.size(); i++) displayEnergyRow(rows[i]);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Energy Balance finished or cancelled.
+
+The rows to be saved are those filled in from the first day without a gap.
+*/
+
+void DataProcessingGui::energyFinished()
+{
+    DataProcessingMainUi.energyProgressBar->hide();
+    DataProcessingMainUi.energyCancelButton->hide();
+    DataProcessingMainUi.energyButton->setEnabled(true);
+    tableRow = 0;
+    while ((tableRow < DataProcessingMainUi.energyView->rowCount()) &&
+           (DataProcessingMainUi.energyView->item(tableRow,0) != NULL))
+        tableRow++;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Display the Energy Balance for a day in the table.
+
+The energies are converted to ampere hours.
+
+@param[in] EnergyRow row: energy balance for the day.
+*/
+
+void DataProcessingGui::displayEnergyRow(const EnergyRow& row)
+{
+    int dayRow = row.day;
 // Add a row if necessary
-            if (tableRow >= DataProcessingMainUi.energyView->rowCount())
-                DataProcessingMainUi.energyView->setRowCount(tableRow+1);
-
-            QDate date = startTime.date();
-            QTableWidgetItem *day = new QTableWidgetItem(date.toString("dd/MM/yy"));
-            DataProcessingMainUi.energyView->setItem(tableRow, 0, day);
-            QTableWidgetItem *battery1Item = new QTableWidgetItem(tr("%1")
-                 .arg((float)battery1Energy/921600,0,'g',3));
-            DataProcessingMainUi.energyView->setItem(tableRow, 1, battery1Item);
-            QTableWidgetItem *battery2Item = new QTableWidgetItem(tr("%1")
-                 .arg((float)battery2Energy/921600,0,'g',3));
-            DataProcessingMainUi.energyView->setItem(tableRow, 2, battery2Item);
-            QTableWidgetItem *battery3Item = new QTableWidgetItem(tr("%1")
-                 .arg((float)battery3Energy/921600,0,'g',3));
-            DataProcessingMainUi.energyView->setItem(tableRow, 3, battery3Item);
-            QTableWidgetItem *load1Item = new QTableWidgetItem(tr("%1")
-                 .arg((float)load1Energy/921600,0,'g',3));
-            DataProcessingMainUi.energyView->setItem(tableRow, 4, load1Item);
-            QTableWidgetItem *load2Item = new QTableWidgetItem(tr("%1")
-                 .arg((float)load2Energy/921600,0,'g',3));
-            DataProcessingMainUi.energyView->setItem(tableRow, 5, load2Item);
-            QTableWidgetItem *panelItem = new QTableWidgetItem(tr("%1")
-                 .arg((float)panelEnergy/921600,0,'g',3));
-            DataProcessingMainUi.energyView->setItem(tableRow, 6, panelItem);
+    if (dayRow >= DataProcessingMainUi.energyView->rowCount())
+        DataProcessingMainUi.energyView->setRowCount(dayRow+1);
+    QStringList text = row.toStringList();
+    for (int column = 0; column < text.size(); column++)
+    {
+        QTableWidgetItem *item = new QTableWidgetItem(text[column]);
 // Display total energy used (negative if charging) in last column
-            long long totalEnergy = battery1Energy+battery2Energy+battery3Energy;
-            QTableWidgetItem *energyTotal = new QTableWidgetItem(tr("%1")
-                 .arg((float)totalEnergy/921600,0,'g',3));
+        if (column == text.size()-1)
+        {
             QFont tableFont = QApplication::font();
             tableFont.setBold(true);
-            energyTotal->setFont(tableFont);
-            DataProcessingMainUi.energyView->setItem(tableRow, 7, energyTotal);
-
-            if (inStream.atEnd()) break;
-
-// Reset energy measures
-            battery1Energy = 0;
-            battery2Energy = 0;
-            battery3Energy = 0;
-            load1Energy = 0;
-            load2Energy = 0;
-            panelEnergy = 0;
-            battery1Seconds = 0;
-            battery2Seconds = 0;
-            battery3Seconds = 0;
-            load1Seconds = 0;
-            load2Seconds = 0;
-            panelSeconds = 0;
-            elapsedSeconds = 0;
-
-            tableRow++;
-// New start and end times
-            startTime = QDateTime(startTime.date().addDays(1),QTime(0,0,0));
-            if (startTime > DataProcessingMainUi.endTime->dateTime()) return;
-            endTime = QDateTime(startTime.date(),QTime(23,59,59));
-            if (endTime > DataProcessingMainUi.endTime->dateTime())
-                endTime = DataProcessingMainUi.endTime->dateTime();
+            item->setFont(tableFont);
         }
+        DataProcessingMainUi.energyView->setItem(dayRow, column, item);
     }
 }
 
@@ -527,98 +572,32 @@ with individually.
 
 void DataProcessingGui::on_extractButton_clicked()
 {
-    if (inFile == NULL) return;
-    if (! inFile->isOpen()) return;
-    if (! openSaveFile()) return;
-    inFile->seek(0);      // rewind input file
+    if (inSource == NULL) return;
+    QString saveFile = saveFileName();
+    if (saveFile.isEmpty()) return;
 //    int interval = DataProcessingMainUi.intervalSpinBox->value();
 //    int intervaltype = DataProcessingMainUi.intervalType->currentIndex();
-    QTextStream inStream(inFile);
-    QTextStream outStream(outFile);
     QDateTime startTime = DataProcessingMainUi.startTime->dateTime();
     QDateTime endTime = DataProcessingMainUi.endTime->dateTime();
-    QDateTime time;
-    QString header;
-    QString comboRecord;
-    int recordType_1 = DataProcessingMainUi.recordType_1->currentIndex();
-    int recordType_2 = DataProcessingMainUi.recordType_2->currentIndex();
-    int recordType_3 = DataProcessingMainUi.recordType_3->currentIndex();
-    int recordType_4 = DataProcessingMainUi.recordType_4->currentIndex();
-    int recordType_5 = DataProcessingMainUi.recordType_5->currentIndex();
-// The first time record is a reference. Anything before that must be ignored.
-// firstTime allows the program to build a header and the first record.
-    bool firstTime = true;
-// The first record only is preceded by the constructed header.
-    bool firstRecord = true;
-    while (! inStream.atEnd())
+// Record identifiers and header text of the selected types
+    QList<int> selections;
+    selections << DataProcessingMainUi.recordType_1->currentIndex();
+    selections << DataProcessingMainUi.recordType_2->currentIndex();
+    selections << DataProcessingMainUi.recordType_3->currentIndex();
+    selections << DataProcessingMainUi.recordType_4->currentIndex();
+    selections << DataProcessingMainUi.recordType_5->currentIndex();
+    QStringList types;
+    QStringList texts;
+    for (int n=0; n<selections.size(); n++)
     {
-      	QString lineIn = inStream.readLine();
-        QStringList breakdown = lineIn.split(",");
-        int size = breakdown.size();
-        if (size <= 0) break;
-        QString firstText = breakdown[0].simplified();
-// Extract the time record for time range comparison.
-        if (size > 1)
+        if (selections[n] > 0)
         {
-            if (firstText == "pH")
-            {
-                time = QDateTime::fromString(breakdown[1].simplified(),Qt::ISODate);
-                if ((time >= startTime) && (time <= endTime))
-                {
-                    if (!firstTime)
-                    {
-// On the first pass output the accumulated header string.
-                        if (firstRecord)
-                        {
-                            outStream << header << "\n\r";
-                            firstRecord = false;
-                        }
-// Output the combined record and null it for next pass.
-                        outStream << comboRecord << "\n\r";
-                        comboRecord = QString();
-                    }
-                    firstTime = false;
-                }
-            }
+            types << recordType[selections[n]-1];
+            texts << recordText[selections[n]-1];
         }
-// Extract records after the reference time record and between specified times.
-        if (!firstTime && (time >= startTime) && (time <= endTime))
-        {
-// Find the relevant records and extract their fields.
-            int rec = 0;
-            if ((recordType_1 > 0) && (firstText == recordType[recordType_1-1]))
-                rec = recordType_1;
-            if ((recordType_2 > 0) && (firstText == recordType[recordType_2-1]))
-                rec = recordType_2;
-            if ((recordType_3 > 0) && (firstText == recordType[recordType_3-1]))
-                rec = recordType_3;
-            if ((recordType_4 > 0) && (firstText == recordType[recordType_4-1]))
-                rec = recordType_4;
-            if ((recordType_5 > 0) && (firstText == recordType[recordType_5-1]))
-                rec = recordType_5;
-            if (rec > 0)
-            {
-                if (firstRecord)
-                {
-                    if (! header.isEmpty()) header += ",";
-                    header += recordText[rec-1];
-                    if (size > 2) header += " I," + recordText[rec-1] + " V";
-                }
-                if (! comboRecord.isEmpty()) comboRecord += ",";
-                comboRecord += breakdown[1].simplified();
-                if (size > 2) comboRecord += "," + breakdown[2].simplified();
-            }
-        }
-    }
-    if (saveFile.isEmpty())
-        displayErrorMessage("File already closed");
-    else
-    {
-        outFile->close();
-        delete outFile;
-//! Null the name to prevent the same file being used.
-        saveFile = QString();
     }
+    startRecordJob(new ExtractJob(inFile->fileName(), inCache, inIndex,
+                                  startTime, endTime, saveFile, types, texts));
 }
 
 //-----------------------------------------------------------------------------
@@ -731,267 +710,99 @@ options.
 
 void DataProcessingGui::on_plotFileSelectButton_clicked()
 {
-    bool showCurrent = ! DataProcessingMainUi.voltagePlotCheckBox->isChecked();
-    bool showTemperature = DataProcessingMainUi.temperaturePlotCheckbox->isChecked();
-    bool showStates = DataProcessingMainUi.statesPlotCheckbox->isChecked();
-    float yScaleLow,yScaleHigh;
-    bool showPlot1,showPlot2,showPlot3,showPlot4;
-    int i1 = 0;
-    int i2 = 0;
-    int i3 = 0;
-    int i4 = 0;                // Columns for data series
-
-// Get data file
+    PlotSettings settings;
+    settings.showCurrent = ! DataProcessingMainUi.voltagePlotCheckBox->isChecked();
+    settings.showTemperature = DataProcessingMainUi.temperaturePlotCheckbox->isChecked();
+    settings.showStates = DataProcessingMainUi.statesPlotCheckbox->isChecked();
+    settings.zeroCurrent = DataProcessingMainUi.zeroCurrentCheckBox->isChecked();
+    bool* showPlot = settings.showPlot;
+    int* column = settings.column;     // Columns for data series
+    for (int i=0; i<4; i++) column[i] = 0;
+
+// Get data file. This may be a combined csv file or a raw data file.
     QString fileName = QFileDialog::getOpenFileName(0,
-                                "Data File","./","CSV Files (*.csv)");
+                                "Data File","./",
+                                "CSV Files (*.csv);;Raw Data Files (*.txt *.TXT *.bmr)");
     if (fileName.isEmpty()) return;
-    QFileInfo fileInfo;
-    QFile* inFile = new QFile(fileName);
-    fileInfo.setFile(fileName);
-    if (! inFile->open(QIODevice::ReadOnly)) return;
-    QTextStream inStream(inFile);
-
-// Setup Plot objects
-    QwtPlotCurve *curve1;
-    curve1 = new QwtPlotCurve();
-    QPolygonF points1;
-    QwtPlotCurve *curve2;
-    curve2 = new QwtPlotCurve();
-    QPolygonF points2;
-    QwtPlotCurve *curve3;
-    curve3 = new QwtPlotCurve();
-    QPolygonF points3;
-    QwtPlotCurve *curve4;
-    curve4 = new QwtPlotCurve();
-    QPolygonF points4;
 
 // States display needs massaging of the data
-    if (showStates)                 // SoC, Voltage and charge state
+    if (settings.showStates)        // SoC, Voltage and charge state
     {
-        showPlot1 = true;
-        showPlot2 = true;
-        showPlot3 = true;
-        showPlot4 = false;
+        showPlot[0] = true;
+        showPlot[1] = true;
+        showPlot[2] = true;
+        showPlot[3] = false;
         if (DataProcessingMainUi.battery1Checkbox->isChecked())
         {
-            i1 = 2;
-            i2 = 3;
-            i3 = 4;
+            column[0] = 2;
+            column[1] = 3;
+            column[2] = 4;
         }
         else if (DataProcessingMainUi.battery2Checkbox->isChecked())
         {
-            i1 = 8;
-            i2 = 9;
-            i3 = 10;
+            column[0] = 8;
+            column[1] = 9;
+            column[2] = 10;
         }
         else if (DataProcessingMainUi.battery3Checkbox->isChecked())
         {
-            i1 = 14;
-            i2 = 15;
-            i3 = 16;
+            column[0] = 14;
+            column[1] = 15;
+            column[2] = 16;
         }
-        yScaleLow = 0;
-        yScaleHigh = 100;
+        settings.yScaleLow = 0;
+        settings.yScaleHigh = 100;
     }
 // At present Temperature ticked shows only the one plot.
-    else if (showTemperature)       // Temperature
+    else if (settings.showTemperature)  // Temperature
     {
-        showPlot1 = true;
-        showPlot2 = false;
-        showPlot3 = false;
-        showPlot4 = false;
-        i1 = 25;
-        yScaleLow = -10;
-        yScaleHigh = 50;
+        showPlot[0] = true;
+        showPlot[1] = false;
+        showPlot[2] = false;
+        showPlot[3] = false;
+        column[0] = 25;
+        settings.yScaleLow = -10;
+        settings.yScaleHigh = 50;
     }
-    else if (showCurrent)           // Current
+    else if (settings.showCurrent)  // Current
     {
-        showPlot1 = DataProcessingMainUi.battery1Checkbox->isChecked();
-        showPlot2 = DataProcessingMainUi.battery2Checkbox->isChecked();
-        showPlot3 = DataProcessingMainUi.battery3Checkbox->isChecked();
-        showPlot4 = DataProcessingMainUi.moduleCheckbox->isChecked();
-        i1 = 1;
-        i2 = 7;
-        i3 = 13;
-        i4 = 23;
-        yScaleLow = -20;
-        yScaleHigh = 20;
+        showPlot[0] = DataProcessingMainUi.battery1Checkbox->isChecked();
+        showPlot[1] = DataProcessingMainUi.battery2Checkbox->isChecked();
+        showPlot[2] = DataProcessingMainUi.battery3Checkbox->isChecked();
+        showPlot[3] = DataProcessingMainUi.moduleCheckbox->isChecked();
+        column[0] = 1;
+        column[1] = 7;
+        column[2] = 13;
+        column[3] = 23;
+        settings.yScaleLow = -20;
+        settings.yScaleHigh = 20;
     }
     else                            // Voltage
     {
-        showPlot1 = DataProcessingMainUi.battery1Checkbox->isChecked();
-        showPlot2 = DataProcessingMainUi.battery2Checkbox->isChecked();
-        showPlot3 = DataProcessingMainUi.battery3Checkbox->isChecked();
-        showPlot4 = false;
-        i1 = 2;
-        i2 = 8;
-        i3 = 14;
-        yScaleLow = 10;
-        yScaleHigh = 18;
+        showPlot[0] = DataProcessingMainUi.battery1Checkbox->isChecked();
+        showPlot[1] = DataProcessingMainUi.battery2Checkbox->isChecked();
+        showPlot[2] = DataProcessingMainUi.battery3Checkbox->isChecked();
+        showPlot[3] = false;
+        column[0] = 2;
+        column[1] = 8;
+        column[2] = 14;
+        settings.yScaleLow = 10;
+        settings.yScaleHigh = 18;
     }
+// The points are read in the background and plotted when done.
+    jobEngine->start(new PlotJob(fileName, settings));
+}
 
-// Set display parameters and titles
-    if (showStates)                 // SoC, Voltage and charge state
-    {
-        curve1->setTitle("Voltage");
-        curve1->setPen(Qt::blue, 2),
-        curve1->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-        curve2->setTitle("State of Charge");
-        curve2->setPen(Qt::red, 2),
-        curve2->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-        curve3->setTitle("Charging Mode");
-        curve3->setPen(Qt::black, 2),
-        curve3->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-    }
-    else
-    {
-        if (showPlot1)
-        {
-            if (showTemperature) curve1->setTitle("Temperature");
-            else curve1->setTitle("Battery 1");
-            curve1->setPen(Qt::blue, 2),
-            curve1->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-        }
-        if (showPlot2)
-        {
-            curve2->setTitle("Battery 2");
-            curve2->setPen(Qt::red, 2),
-            curve2->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-        }
-        if (showPlot3)
-        {
-            curve3->setTitle("Battery 3");
-            curve3->setPen(Qt::yellow, 2),
-            curve3->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-        }
-        if (showPlot4)
-        {
-            curve4->setTitle("Module");
-            curve4->setPen(Qt::green, 2),
-            curve4->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-        }
-    }
+//-----------------------------------------------------------------------------
+/** @brief Show a plot from the points read by a plot job
 
-    bool ok;
-// Read in data from input file
-// Skip first line as it may be a header
-  	QString lineIn;
-    lineIn = inStream.readLine();
-    bool startRun = true;
-// Index increments by about 0.5 seconds
-// To have x-axis in date-time index must be "double" type, ie ms since epoch.
-    double index = 0;
-    QDateTime startTime;
-    QDateTime previousTime;
-    while (! inStream.atEnd())
-    {
-      	lineIn = inStream.readLine();
-        QStringList breakdown = lineIn.split(",");
-        int size = breakdown.size();
-        if (size == LINE_WIDTH)
-        {
-            QDateTime time = QDateTime::fromString(breakdown[0].simplified(),Qt::ISODate);
-            if (time.isValid())
-            {
-// On the first run get the start time
-                if (startRun)
-                {
-                    startRun = false;
-                    startTime = time;
-                    previousTime = startTime;
-                    index = startTime.toMSecsSinceEpoch();
-                }
-// Try to keep index and time in sync to account for jumps in time.
-// Index is counting half seconds and time from records is integer seconds only
-                if (previousTime == time) index += 500;
-                else index = time.toMSecsSinceEpoch();
-// Create points to plot
-                if (showStates)
-                {
-// In this case data to be displayed needs to be converted to common scale.
-                    float batteryVoltage = (breakdown[i1].simplified().toFloat(&ok)-10)*100/10;
-                    points1 << QPointF(index,batteryVoltage);
-                    float stateOfCharge = breakdown[i2].simplified().toFloat(&ok);
-                    points2 << QPointF(index,stateOfCharge);
-                    QString chargeModetext = breakdown[i3].simplified();
-                    float chargeMode = 0;
-                    if (chargeModetext == "Isolate") chargeMode = 5;
-                    if (chargeModetext == "Charge") chargeMode = 10;
-                    if (chargeModetext == "Loaded") chargeMode = 0;
-                    points3 << QPointF(index,chargeMode);
-                }
-                else
-                {
-                    if (showPlot1)
-                    {
-                        float currentBattery1 = breakdown[i1].simplified().toFloat(&ok);
-                        points1 << QPointF(index,currentBattery1);
-                    }
-                    if (showPlot2)
-                    {
-                        float currentBattery2 = breakdown[i2].simplified().toFloat(&ok);
-                        points2 << QPointF(index,currentBattery2);
-                    }
-                    if (showPlot3)
-                    {
-                        float currentBattery3 = breakdown[i3].simplified().toFloat(&ok);
-                        points3 << QPointF(index,currentBattery3);
-                    }
-                    if (showPlot4)
-                    {
-                        float currentModule = breakdown[i4].simplified().toFloat(&ok);
-                        points4 << QPointF(index,currentModule);
-                    }
-                }
-            }
-        }
-    }
-// Build plot
-    QwtPlot *plot = new QwtPlot(0);
-    if (showStates) plot->setTitle("Battery States");
-    else if (showTemperature) plot->setTitle("Battery Temperature");
-    else
-    {
-        if (showCurrent) plot->setTitle("Battery Currents");
-        else plot->setTitle("Battery Voltages");
-    }
-    plot->setCanvasBackground(Qt::white);
-    plot->setAxisScale(QwtPlot::yLeft, yScaleLow, yScaleHigh);
-    //Set x-axis scaling.
-    QwtDateScaleDraw *qwtDateScaleDraw = new QwtDateScaleDraw(Qt::LocalTime);
-    QwtDateScaleEngine *qwtDateScaleEngine = new QwtDateScaleEngine(Qt::LocalTime);
-    qwtDateScaleDraw->setDateFormat(QwtDate::Hour, "hh");
- 
-    plot->setAxisScaleDraw(QwtPlot::xBottom, qwtDateScaleDraw);
-    plot->setAxisScaleEngine(QwtPlot::xBottom, qwtDateScaleEngine);
-//    plot->setAxisScale(QwtPlot::xBottom, xScaleLow, xScaleHigh);
-    plot->insertLegend(new QwtLegend());
-    QwtPlotGrid *grid = new QwtPlotGrid();
-    grid->attach(plot);
-
-    if (showPlot1)
-    {
-        curve1->setSamples(points1);
-        curve1->attach(plot);
-    }
-    if (showPlot2)
-    {
-        curve2->setSamples(points2);
-        curve2->attach(plot);
-    }
-    if (showPlot3)
-    {
-        curve3->setSamples(points3);
-        curve3->attach(plot);
-    }
-    if (showPlot4)
-    {
-        curve4->setSamples(points4);
-        curve4->attach(plot);
-    }
+@param[in] PlotJob* job: the completed plot job.
+*/
 
-    plot->resize(1000,600);
-    plot->show();
+void DataProcessingGui::showPlot(PlotJob* job)
+{
+    PlotWindow* plotWindow = new PlotWindow(job);
+    plotWindow->show();
 }
 
 //-----------------------------------------------------------------------------
@@ -999,7 +810,8 @@ void DataProcessingGui::on_plotFileSelectButton_clicked()
 
 The file is analysed for a variety of faults and other performance indicators.
 
-The results are printed out to a report file.
+The results are printed out to a report file for each analysis. All the
+selected analyses are made in a single pass through the file.
 
 - Situations where the charger is not allocated but a battery is ready. To show
   this look for no battery under charge and panel voltage above any battery.
@@ -1021,13 +833,10 @@ void DataProcessingGui::on_analysisFileSelectButton_clicked()
     QString inputFilename = QFileDialog::getOpenFileName(0,
                                 "Data File","./","CSV Files (*.csv)");
     if (inputFilename.isEmpty()) return;
-    QFile* inFile = new QFile(inputFilename);
     fileInfo.setFile(inputFilename);
-    if (! inFile->open(QIODevice::ReadOnly)) return;
-    QTextStream inStream(inFile);
 
 // Create a unique output report filename from the input filename and date-time
-    QFileInfo inputFileInfo(inFile->fileName());
+    QFileInfo inputFileInfo(inputFilename);
     QString inputFileStub(inputFileInfo.fileName());
     QDateTime local(QDateTime::currentDateTime());
     QString localTimeDate = local.toTimeSpec(Qt::LocalTime)
@@ -1036,121 +845,23 @@ void DataProcessingGui::on_analysisFileSelectButton_clicked()
     QString outFileQualifier = QString("-").append(inputFileStub
                               .left(inputFileStub.size()-4))
                               .append("-").append(localTimeDate).append(".csv");
-    QDir saveDirectory = fileInfo.absolutePath();
 
+// Decide on all report files before the analysis is started.
+    AnalysisJob* job = new AnalysisJob(inputFilename);
 // Analysis for faults.
     if (DataProcessingMainUi.faultAnalysisCheckbox->isChecked())
     {
         QString reportFilename = QString("fault").append(outFileQualifier);
         bool header = true;
-        if (outfileMessage(reportFilename, &header)) return; // Abort processing
-// This will write to the file as created above, or append to the existing file.
-        QFile* outFile = new QFile(reportFilename);   // Open file for output
-        if (! outFile->open(QIODevice::WriteOnly | QIODevice::Append
-                                                 | QIODevice::Text))
+        if (outfileMessage(reportFilename, &header))  // Abort processing
         {
-            displayErrorMessage("Could not open the output file");
+            delete job;
             return;
         }
-        QTextStream outStream(outFile);
-
-// Build header
-        if (header)
-        {
-            outStream << "Time,";
-            outStream << "B1 Op," << "B1 Charge,";
-            outStream << "B2 Op," << "B2 Charge,";
-            outStream << "B3 Op," << "B3 Charge,";
-            outStream << "B1 V," << "B2 V," << "B3 V," << "M1 V,";
-            outStream << "Switches," << "Decisions," << "Indicators";
-            outStream << "\n\r";
-        }
-// Read in data from input file
-// Skip first line as it may be a header
-        inFile->seek(0);      // rewind input file
-      	QString lineIn;
-        lineIn = inStream.readLine();
-        bool startRun = true;
-// Index increments by about 0.5 seconds
-// To have x-axis in date-time, index must be "double" type, ie ms since epoch.
-        double index = 0;
-        QDateTime startTime;
-        QDateTime previousTime;
-        while (! inStream.atEnd())
-        {
-          	lineIn = inStream.readLine();
-            QStringList breakdown = lineIn.split(",");
-            int size = breakdown.size();
-            if (size == LINE_WIDTH)
-            {
-                QDateTime time = QDateTime::fromString(breakdown[0].simplified(),Qt::ISODate);
-                if (time.isValid())
-                {
-// On the first run get the start time
-                    if (startRun)
-                    {
-                        startRun = false;
-                        startTime = time;
-                        previousTime = startTime;
-                        index = startTime.toMSecsSinceEpoch();
-                    }
-// Try to keep index and time in sync to account for jumps in time.
-// Index is counting half seconds and time from records is integer seconds only.
-                    if (previousTime == time) index += 500;
-                    else index = time.toMSecsSinceEpoch();
-
-// Analyse for faults.
-// Look for charger not allocated but not all batteries in float or rest.
-                    float battery1Voltage = breakdown[2].simplified().toFloat();
-                    float battery2Voltage = breakdown[8].simplified().toFloat();
-                    float battery3Voltage = breakdown[14].simplified().toFloat();
-                    float panel1Voltage = breakdown[24].simplified().toFloat();
-                    QString opState1 = breakdown[4].simplified();
-                    QString opState2 = breakdown[10].simplified();
-                    QString opState3 = breakdown[16].simplified();
-                    QString chargeState1 = breakdown[5].simplified();
-                    QString chargeState2 = breakdown[11].simplified();
-                    QString chargeState3 = breakdown[17].simplified();
-                    QString chargeMode1 = breakdown[6].simplified();
-                    QString chargeMode2 = breakdown[12].simplified();
-                    QString chargeMode3 = breakdown[18].simplified();
-                    if ((opState1 != "Charge") &&
-                        (opState2 != "Charge") &&
-                        (opState3 != "Charge") &&
-                        (((chargeMode1 != "Float") && (chargeMode1 != "Rest")
-                                                       && (panel1Voltage > battery1Voltage)) ||
-                        ((chargeMode2 != "Float") && (chargeMode2 != "Rest")
-                                                       && (panel1Voltage > battery2Voltage)) ||
-                        ((chargeMode3 != "Float") && (chargeMode3 != "Rest")
-                                                       && (panel1Voltage > battery3Voltage))))
-                    {
-                        outStream << breakdown[0].simplified() << ",";
-                        outStream << opState1 << ",";
-                        outStream << chargeMode1 << ",";
-                        outStream << opState2 << ",";
-                        outStream << chargeMode2 << ",";
-                        outStream << opState3 << ",";
-                        outStream << chargeMode3 << ",";
-                        outStream << battery1Voltage << ",";
-                        outStream << battery2Voltage << ",";
-                        outStream << battery3Voltage << ",";
-                        outStream << panel1Voltage << ",";
-                        outStream << breakdown[27].simplified() << ",";
-                        outStream << breakdown[28].simplified() << ",";
-                        outStream << breakdown[29].simplified();
-    //                    outStream << lineIn;
-                        outStream << "\n\r";
-                    }
-                }
-            }
-        }
-        outFile->close();
-        delete outFile;
+        job->addAnalysis(faultAnalysis, 0, reportFilename, header);
     }
 // Analyse file to extract battery charger data. Each battery is treated
 // independently and data for each is printed to a different output file.
-// Values of voltage and current are extracted following a short settling
-// period after the charger is applied. Charge state is also given.
     if (DataProcessingMainUi.chargerAnalysisCheckbox->isChecked())
     {
         for (int i=0; i<3; i++)
@@ -1158,469 +869,33 @@ void DataProcessingGui::on_analysisFileSelectButton_clicked()
             QString reportFilename = QString("charging-B%1").arg(i)
                                      .append(outFileQualifier);
             bool header = true;
-            if (outfileMessage(reportFilename, &header)) return; // Abort processing
-// This will write to the file as created above, or append to the existing file.
-            QFile* outFile = new QFile(reportFilename);   // Open file for output
-            if (! outFile->open(QIODevice::WriteOnly | QIODevice::Append
-                                                     | QIODevice::Text))
+            if (outfileMessage(reportFilename, &header)) // Abort processing
             {
-                displayErrorMessage("Could not open the output file");
+                delete job;
                 return;
             }
-            QTextStream outStream(outFile);
-
-// Build header
-            if (header)
-            {
-                outStream << "Time,";
-                outStream << "Mode,";
-                outStream << "V," << "I,";
-                outStream << "\n\r";
-            }
-// Read in data from input file
-// Skip first line as it may be a header
-            inFile->seek(0);                // rewind input file
-          	QString lineIn;
-            lineIn = inStream.readLine();
-            while (! inStream.atEnd())
-            {
-              	lineIn = inStream.readLine();
-                QStringList breakdown = lineIn.split(",");
-                int size = breakdown.size();
-                if (size == LINE_WIDTH)
-                {
-                    QDateTime time = QDateTime::fromString(breakdown[0].simplified(),Qt::ISODate);
-                    if (time.isValid())
-                    {
-
-// Look for charger allocated and battery not in rest
-                        float batteryVoltage = breakdown[2+6*i].simplified().toFloat();
-                        float batteryCurrent = breakdown[1+6*i].simplified().toFloat();
-                        QString opState = breakdown[4+6*i].simplified();
-                        QString chargeState = breakdown[5+6*i].simplified();
-                        QString chargeMode = breakdown[6+6*i].simplified();
-                        if ((opState == "Charge") &&
-                            (chargeMode != "Rest"))
-                        {
-                            outStream << breakdown[0].simplified() << ",";
-                            outStream << chargeMode << ",";
-                            outStream << batteryVoltage << ",";
-                            outStream << batteryCurrent;
-                            outStream << "\n\r";
-                        }
-                    }
-                }
-            }
-            outFile->close();
-            delete outFile;
+            job->addAnalysis(chargerAnalysis, i, reportFilename, header);
         }
     }
 // Analyse file to extract solar current data from all batteries.
-// This is extracted when a battery is in bulk charge.
-// Do not output the first record when a battery enters bulk charge to avoid
-// inaccuracies due to delays between the state change and the measurement.
     if (DataProcessingMainUi.solarAnalysisCheckbox->isChecked())
     {
-        bool firstRecord = true;
         QString reportFilename = QString("solar").append(outFileQualifier);
         bool header = true;
-        if (outfileMessage(reportFilename, &header)) return; // Abort processing
-// This will write to the file as created above, or append to the existing file.
-        QFile* outFile = new QFile(reportFilename);   // Open file for output
-        if (! outFile->open(QIODevice::WriteOnly | QIODevice::Append
-                                                 | QIODevice::Text))
+        if (outfileMessage(reportFilename, &header)) // Abort processing
         {
-            displayErrorMessage("Could not open the output file");
+            delete job;
             return;
         }
-        QTextStream outStream(outFile);
-
-// Build header
-        if (header)
-        {
-            outStream << "Time,";
-            outStream << "V," << "I,";
-            outStream << "\n\r";
-        }
-// Read in data from input file
-// Skip first line as it may be a header
-        inFile->seek(0);                // rewind input file
-      	QString lineIn;
-        lineIn = inStream.readLine();
-        while (! inStream.atEnd())
-        {
-          	lineIn = inStream.readLine();
-            QStringList breakdown = lineIn.split(",");
-            int size = breakdown.size();
-            if (size == LINE_WIDTH)
-            {
-                QDateTime time = QDateTime::fromString(breakdown[0].simplified(),Qt::ISODate);
-                if (time.isValid())
-                {
-
-// Look for charger allocated and battery in bulk
-                    float battery1Voltage = breakdown[2].simplified().toFloat();
-                    float battery2Voltage = breakdown[8].simplified().toFloat();
-                    float battery3Voltage = breakdown[14].simplified().toFloat();
-                    float battery1Current = breakdown[1].simplified().toFloat();
-                    float battery2Current = breakdown[7].simplified().toFloat();
-                    float battery3Current = breakdown[13].simplified().toFloat();
-                    QString op1State = breakdown[4].simplified();
-                    QString op2State = breakdown[10].simplified();
-                    QString op3State = breakdown[16].simplified();
-                    QString charge1Mode = breakdown[6].simplified();
-                    QString charge2Mode = breakdown[12].simplified();
-                    QString charge3Mode = breakdown[18].simplified();
-                    if (firstRecord) firstRecord = false;
-                    else
-                    {
-                        if ((op1State == "Charge") && (charge1Mode == "Bulk"))
-                        {
-                            outStream << breakdown[0].simplified() << ",";
-                            outStream << battery1Voltage << ",";
-                            outStream << battery1Current;
-                            outStream << "\n\r";
-                        }
-                        else if ((op2State == "Charge") && (charge2Mode == "Bulk"))
-                        {
-                            outStream << breakdown[0].simplified() << ",";
-                            outStream << battery2Voltage << ",";
-                            outStream << battery2Current;
-                            outStream << "\n\r";
-                        }
-                        else if ((op3State == "Charge") && (charge3Mode == "Bulk"))
-                        {
-                            outStream << breakdown[0].simplified() << ",";
-                            outStream << battery3Voltage << ",";
-                            outStream << battery3Current;
-                            outStream << "\n\r";
-                        }
-                        else firstRecord = true;
-                    }
-                }
-            }
-        }
-        outFile->close();
-        delete outFile;
-    }
-}
-
-//-----------------------------------------------------------------------------
-/** @brief Extract and Combine Raw Records to CSV.
-
-Raw records are combined into single records for each time interval, and written
-to a csv file. Format suitable for spreadsheet analysis.
-
-@param[in] QDateTime start time.
-@param[in] QDateTime end time.
-@param[in] QFile* input file.
-@param[in] QFile* output file.
-*/
-
-bool DataProcessingGui::combineRecords(QDateTime startTime, QDateTime endTime,
-                                       QFile* inFile, QFile* outFile,bool header)
-{
-    int battery1Voltage = -1;
-    int battery1Current = 0;
-    int battery1SoC = -1;
-    QString battery1StateText;
-    QString battery1FillText;
-    QString battery1ChargeText;
-    int battery2Voltage = -1;
-    int battery2Current = 0;
-    int battery2SoC = -1;
-    QString battery2StateText;
-    QString battery2FillText;
-    QString battery2ChargeText;
-    int battery3Voltage = -1;
-    int battery3Current = 0;
-    int battery3SoC = -1;
-    QString battery3StateText;
-    QString battery3FillText;
-    QString battery3ChargeText;
-    int load1Voltage = -1;
-    int load1Current = 0;
-    int load2Voltage = -1;
-    int load2Current = 0;
-    int panel1Voltage = -1;
-    int panel1Current = 0;
-    int temperature = -1;
-    QString controls = "     ";
-    QString switches;
-    QString decision;
-    QString indicatorString;
-    int debug1a = -1;
-    int debug2a = -1;
-    int debug3a = -1;
-    int debug1b = -1;
-    int debug2b = -1;
-    int debug3b = -1;
-    bool blockStart = false;
-    QTextStream inStream(inFile);
-    QTextStream outStream(outFile);
-    if (header)
-    {
-        outStream << "Time,";
-        outStream << "B1 I," << "B1 V," << "B1 Cap," << "B1 Op," << "B1 State," << "B1 Charge,";
-        outStream << "B2 I," << "B2 V," << "B2 Cap," << "B2 Op," << "B2 State," << "B2 Charge,";
-        outStream << "B3 I," << "B3 V," << "B3 Cap," << "B3 Op," << "B3 State," << "B3 Charge,";
-        outStream << "L1 I," << "L1 V," << "L2 I," << "L2 V," << "M1 I," << "M1 V,";
-        outStream << "Temp," << "Controls," << "Switches," << "Decisions," << "Indicators,";
-        outStream << "Debug 1a," << "Debug 1b," << "Debug 2a," << "Debug 2b," << "Debug 3a," << "Debug 3b";
-        outStream << "\n\r";
+        job->addAnalysis(solarAnalysis, 0, reportFilename, header);
     }
-    QDateTime time = startTime;
-    while (! inStream.atEnd())
+// All reports are made together in one pass through the input file.
+    if (job->analysisCount() == 0)
     {
-        if  (time > endTime) break;
-      	QString lineIn = inStream.readLine();
-        QStringList breakdown = lineIn.split(",");
-        int size = breakdown.size();
-        if (size <= 0) break;
-        QString firstText = breakdown[0].simplified();
-        QString secondText;
-        QString thirdText;
-        int secondField = -1;
-        if (size > 1)
-        {
-            secondText = breakdown[1].simplified();
-            secondField = secondText.toInt();
-        }
-        int thirdField = -1;
-        if (size > 2)
-        {
-            thirdText = breakdown[2].simplified();
-            thirdField = thirdText.toInt();
-        }
-        if (size > 1)
-        {
-// Find and extract the time record
-            if (firstText == "pH")
-            {
-                time = QDateTime::fromString(breakdown[1].simplified(),Qt::ISODate);
-                if ((blockStart) && (time > startTime))
-                {
-                    outStream << timeRecord << ",";
-                    outStream << (float)battery1Current/256 << ",";
-                    outStream << (float)battery1Voltage/256 << ",";
-                    outStream << (float)battery1SoC/256 << ",";
-                    outStream << battery1StateText << ",";
-                    outStream << battery1FillText << ",";
-                    outStream << battery1ChargeText << ",";
-                    outStream << (float)battery2Current/256 << ",";
-                    outStream << (float)battery2Voltage/256 << ",";
-                    outStream << (float)battery2SoC/256 << ",";
-                    outStream << battery2StateText << ",";
-                    outStream << battery2FillText << ",";
-                    outStream << battery2ChargeText << ",";
-                    outStream << (float)battery3Current/256 << ",";
-                    outStream << (float)battery3Voltage/256 << ",";
-                    outStream << (float)battery3SoC/256 << ",";
-                    outStream << battery3StateText << ",";
-                    outStream << battery3FillText << ",";
-                    outStream << battery3ChargeText << ",";
-                    outStream << (float)load1Voltage/256 << ",";
-                    outStream << (float)load1Current/256 << ",";
-                    outStream << (float)load2Voltage/256 << ",";
-                    outStream << (float)load2Current/256 << ",";
-                    outStream << (float)panel1Voltage/256 << ",";
-                    outStream << (float)panel1Current/256 << ",";
-                    outStream << (float)temperature/256 << ",";
-                    outStream << controls << ",";
-                    outStream << switches << ",";
-                    outStream << decision << ",";
-                    outStream << indicatorString << ",";
-                    outStream << debug1a << ",";
-                    outStream << debug1b << ",";
-                    outStream << debug2a << ",";
-                    outStream << debug2b << ",";
-                    outStream << debug3a << ",";
-                    outStream << debug3b;
-                    outStream << "\n\r";
-                }
-                timeRecord = breakdown[1].simplified();
-                blockStart = true;
-            }
-            if (firstText == "dB1")
-            {
-                battery1Current = secondField-battery1CurrentZero;
-                battery1Voltage = thirdField;
-            }
-            if (firstText == "dB2")
-            {
-                battery2Current = secondField-battery2CurrentZero;
-                battery2Voltage = thirdField;
-            }
-            if (firstText == "dB3")
-            {
-                battery3Current = secondField-battery3CurrentZero;
-                battery3Voltage = thirdField;
-            }
-            if (firstText == "dC1")
-            {
-                battery1SoC = secondField;
-            }
-            if (firstText == "dC2")
-            {
-                battery2SoC = secondField;
-            }
-            if (firstText == "dC3")
-            {
-                battery3SoC = secondField;
-            }
-            if (firstText == "dO1")
-            {
-                uint battery1State = (secondField & 0x03);
-                if (battery1State == 0) battery1StateText = "Loaded";
-                else if (battery1State == 1) battery1StateText = "Charge";
-                else if (battery1State == 2) battery1StateText = "Isolate";
-                else if (battery1State == 3) battery1StateText = "Missing";
-                else battery1StateText = "?";
-                uint battery1Fill = (secondField >> 2) & 0x03;
-                if (battery1Fill == 0) battery1FillText = "Normal";
-                else if (battery1Fill == 1) battery1FillText = "Low";
-                else if (battery1Fill == 2) battery1FillText = "Critical";
-                else if (battery1Fill == 3) battery1FillText = "Faulty";
-                else battery1FillText = "?";
-                uint battery1Charge = (secondField >> 4) & 0x03;
-                if (battery1Charge == 0) battery1ChargeText = "Bulk";
-                else if (battery1Charge == 1) battery1ChargeText = "Absorp";
-                else if (battery1Charge == 2) battery1ChargeText = "Float";
-                else if (battery1Charge == 3) battery1ChargeText = "Rest";
-                else battery1ChargeText = "?";
-            }
-            if (firstText == "dO2")
-            {
-                uint battery2State = (secondField & 0x03);
-                if (battery2State == 0) battery2StateText = "Loaded";
-                else if (battery2State == 1) battery2StateText = "Charge";
-                else if (battery2State == 2) battery2StateText = "Isolate";
-                else if (battery2State == 3) battery2StateText = "Missing";
-                else battery2StateText = "?";
-                uint battery2Fill = (secondField >> 2) & 0x03;
-                if (battery2Fill == 0) battery2FillText = "Normal";
-                else if (battery2Fill == 1) battery2FillText = "Low";
-                else if (battery2Fill == 2) battery2FillText = "Critical";
-                else if (battery2Fill == 3) battery2FillText = "Faulty";
-                else battery2FillText = "?";
-                uint battery2Charge = (secondField >> 4) & 0x03;
-                if (battery2Charge == 0) battery2ChargeText = "Bulk";
-                else if (battery2Charge == 1) battery2ChargeText = "Absorp";
-                else if (battery2Charge == 2) battery2ChargeText = "Float";
-                else if (battery2Charge == 3) battery2ChargeText = "Rest";
-                else battery2ChargeText = "?";
-            }
-            if (firstText == "dO3")
-            {
-                uint battery3State = (secondField & 0x03);
-                if (battery3State == 0) battery3StateText = "Loaded";
-                else if (battery3State == 1) battery3StateText = "Charge";
-                else if (battery3State == 2) battery3StateText = "Isolate";
-                else if (battery3State == 3) battery3StateText = "Missing";
-                else battery3StateText = "?";
-                uint battery3Fill = (secondField >> 2) & 0x03;
-                if (battery3Fill == 0) battery3FillText = "Normal";
-                else if (battery3Fill == 1) battery3FillText = "Low";
-                else if (battery3Fill == 2) battery3FillText = "Critical";
-                else if (battery3Fill == 3) battery3FillText = "Faulty";
-                else battery3FillText = "?";
-                uint battery3Charge = (secondField >> 4) & 0x03;
-                if (battery3Charge == 0) battery3ChargeText = "Bulk";
-                else if (battery3Charge == 1) battery3ChargeText = "Absorp";
-                else if (battery3Charge == 2) battery3ChargeText = "Float";
-                else if (battery3Charge == 3) battery3ChargeText = "Rest";
-                else battery3ChargeText = "?";
-            }
-            if (firstText == "dL1")
-            {
-                load1Voltage = secondField;
-                load1Current = thirdField;
-            }
-            if (firstText == "dL2")
-            {
-                load2Voltage = secondField;
-                load2Current = thirdField;
-            }
-            if (firstText == "dM1")
-            {
-                panel1Voltage = secondField;
-                panel1Current = thirdField;
-            }
-            if (firstText == "dT")
-            {
-                temperature = secondField;
-            }
-// A = autotrack, R = recording, M = send measurements,
-// D = debug, Charger algorithm, X = load avoidance, I = maintain isolation
-            if (firstText == "dD")
-            {
-                if ((secondField & (1 << 0)) > 0) controls[0] = 'A';
-                if ((secondField & (1 << 1)) > 0) controls[1] = 'R';
-                if ((secondField & (1 << 3)) > 0) controls[2] = 'M';
-                if ((secondField & (1 << 4)) > 0) controls[3] = 'D';
-                if (((secondField >> 5) & 3) == 0) controls[4] = '1';
-                if (((secondField >> 5) & 3) == 1) controls[4] = '2';
-                if (((secondField >> 5) & 3) == 2) controls[4] = '3';
-                if ((secondField & (1 << 7)) > 0) controls[5] = 'X';
-                if ((secondField & (1 << 8)) > 0) controls[6] = 'I';
-            }
-// Switch control bits - three 2-bit fields: battery number for each of
-// load1, load2 and panel.
-            if (firstText == "ds")
-            {
-                switches.clear();
-                uint load1Battery = (secondField >> 0) & 0x03;
-                QString load1BatteryText;
-                load1BatteryText.setNum(load1Battery);
-                if (load1Battery > 0) switches.append(" ").append(load1BatteryText);
-                else switches.append(" 0");
-                uint load2Battery = (secondField >> 2) & 0x03;
-                QString load2BatteryText;
-                load2BatteryText.setNum(load2Battery);
-                if (load2Battery > 0) switches.append(" ").append(load2BatteryText);
-                else switches.append(" 0");
-                uint panelBattery = (secondField >> 4) & 0x03;
-                QString panelBatteryText;
-                panelBatteryText.setNum(panelBattery);
-                if (panelBattery > 0) switches.append(" ").append(panelBatteryText);
-                else switches.append(" 0");
-            }
-            if (firstText == "dd")
-            {
-                bool ok;
-                decision = QString("%1").arg(secondText.toInt(&ok),0,16);
-            }
-            if (firstText == "dI")
-            {
-                bool ok;
-                indicatorString = "";
-                int indicators = secondText.toInt(&ok);
-                for (int i=0; i<12; i+=2)
-                {
-                    if ((indicators & (1 << i)) > 0) indicatorString.append("_");
-                    else indicatorString.append("O");
-                    if ((indicators & (1 << (i+1))) > 0) indicatorString.append("_");
-                    else indicatorString.append("U");
-                }
-            }
-            if (firstText == "D1")
-            {
-                debug1a = secondField;
-                if (size > 2) debug1b = thirdField;
-            }
-            if (firstText == "D2")
-            {
-                debug2a = secondField;
-                if (size > 2) debug2b = thirdField;
-            }
-            if (firstText == "D3")
-            {
-                debug3a = secondField;
-                if (size > 2) debug3b = thirdField;
-            }
-        }
+        delete job;
+        return;
     }
-    return inStream.atEnd();
+    jobEngine->start(job);
 }
 
 //-----------------------------------------------------------------------------
@@ -1629,25 +904,21 @@ bool DataProcessingGui::combineRecords(QDateTime startTime, QDateTime endTime,
 The input file is searched record by record until the first time record is
 found.
 
-@param[in] QFile* input file.
+@param[in] RecordSource* source of input records.
 @returns QDateTime time of first time record. Null if not found.
 */
 
-QDateTime DataProcessingGui::findFirstTimeRecord(QFile* inFile)
+QDateTime DataProcessingGui::findFirstTimeRecord(RecordSource* reader)
 {
     QDateTime time;
-    QTextStream inStream(inFile);
-    while (! inStream.atEnd())
+    while (reader->readRecord())
     {
-      	QString lineIn = inStream.readLine();
-        QStringList breakdown = lineIn.split(",");
-        int size = breakdown.size();
+        int size = reader->fieldCount();
         if (size <= 0) break;
-        QString firstText = breakdown[0].simplified();
 // Find and extract the time record
-        if ((size > 1) && (firstText == "pH"))
+        if (reader->isTimeRecord())
         {
-            time = QDateTime::fromString(breakdown[1].simplified(),Qt::ISODate);
+            time = reader->timeField();
             break;
         }
     }
@@ -1655,37 +926,106 @@ QDateTime DataProcessingGui::findFirstTimeRecord(QFile* inFile)
 }
 
 //-----------------------------------------------------------------------------
-/** @brief Open a Data File for Writing.
+/** @brief Ask for a csv File for Writing.
 
 This is called from other action functions. The file is requested in a file
-dialogue and opened. The function aborts if the file exists.
+dialogue but is not opened, as that is done by the job that writes it.
 
-@returns true if file successfully created and opened.
+@returns QString full name of the file, empty if none was given.
 */
 
-bool DataProcessingGui::openSaveFile()
+QString DataProcessingGui::saveFileName()
 {
-    if (! saveFile.isEmpty())
-    {
-        displayErrorMessage("A save file is already open - close first");
-        return false;
-    }
     QString filename = QFileDialog::getSaveFileName(this,
                         "Save csv Data",
                         QString(),
                         "Comma Separated Variables (*.csv)",0,0);
-    if (filename.isEmpty()) return false;
+    if (filename.isEmpty()) return QString();
     if (! filename.endsWith(".csv")) filename.append(".csv");
     QFileInfo fileInfo(filename);
     saveDirectory = fileInfo.absolutePath();
-    saveFile = saveDirectory.filePath(filename);
-    outFile = new QFile(saveFile);             // Open file for output
-    if (! outFile->open(QIODevice::WriteOnly))
+    return saveDirectory.filePath(filename);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start a job reading the open raw data file.
+
+@param[in] RecordJob* job: the job, which is then owned by the job engine.
+*/
+
+void DataProcessingGui::startRecordJob(RecordJob* job)
+{
+    job->setCurrentZeros(battery1CurrentZero,battery2CurrentZero,
+                         battery3CurrentZero);
+    jobEngine->start(job);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief A job has been started.
+
+@param[in] ProcessingJob* job: the job started.
+*/
+
+void DataProcessingGui::jobStarted(ProcessingJob* job)
+{
+    QListWidgetItem* item = new QListWidgetItem(job->title(),
+                                                DataProcessingMainUi.jobList);
+    jobItems.insert(job, item);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the progress of a job.
+
+@param[in] ProcessingJob* job: the job running.
+@param[in] int percent: progress of the job.
+*/
+
+void DataProcessingGui::jobProgress(ProcessingJob* job, int percent)
+{
+    QListWidgetItem* item = jobItems.value(job);
+    if (item != NULL)
+        item->setText(QString("%1 %2%").arg(job->title()).arg(percent));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief A job has finished, been cancelled or failed.
+
+A plot is drawn here from the points read by the job.
+
+@param[in] ProcessingJob* job: the job finished. It is deleted afterwards.
+*/
+
+void DataProcessingGui::jobFinished(ProcessingJob* job)
+{
+    delete jobItems.take(job);
+    if (job->succeeded())
+        displayErrorMessage(QString("%1 finished").arg(job->title()));
+    else
+        displayErrorMessage(QString("%1: %2").arg(job->title())
+                                             .arg(job->message()));
+    PlotJob* plotJob = qobject_cast<PlotJob*>(job);
+    if ((plotJob != NULL) && plotJob->succeeded()) showPlot(plotJob);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Cancel Jobs.
+
+The jobs selected in the list are cancelled. If none are selected, all jobs
+are cancelled including any energy balance.
+*/
+
+void DataProcessingGui::on_jobCancelButton_clicked()
+{
+    QList<QListWidgetItem*> selected =
+                            DataProcessingMainUi.jobList->selectedItems();
+    QMap<ProcessingJob*,QListWidgetItem*>::const_iterator i;
+    for (i = jobItems.constBegin(); i != jobItems.constEnd(); ++i)
     {
-        displayErrorMessage("Could not open the output file");
-        return false;
+        if (selected.isEmpty() || selected.contains(i.value()))
+            i.key()->cancel();
     }
-    return true;
+    if (selected.isEmpty() && energyRunning())
+        on_energyCancelButton_clicked();
 }
 
 //-----------------------------------------------------------------------------
@@ -1694,83 +1034,64 @@ bool DataProcessingGui::openSaveFile()
 Look for start and end times and record types. Obtain the current zeros from
 records that have isolated operational status.
 
+The file is parsed into a cache held alongside the file, which is used in
+place of the scan when the same unchanged file is opened again. All later
+passes read from the cache unless it could not hold every record exactly, in
+which case they read the raw file.
+
+A sparse time index is made at the same time and also saved with the file, so
+that passes over a time range can start reading just before the start time.
+
+The scan reads the entire file, so the rate achieved by the record reader is
+shown on completion as a measure of raw file throughput.
 */
 
-void DataProcessingGui::scanFile(QFile* inFile)
+void DataProcessingGui::scanFile(RecordReader* reader)
 {
-    if (! inFile->isOpen()) return;
-    QTextStream inStream(inFile);
-    QDateTime startTime, endTime;
-    uint calibration1Count = 0;
-    uint calibration2Count = 0;
-    uint calibration3Count = 0;
-    int battery1Current = 0;
-    int battery2Current = 0;
-    int battery3Current = 0;
-    battery1CurrentZero = 0;
-    battery2CurrentZero = 0;
-    battery3CurrentZero = 0;
-    while (! inStream.atEnd())
+    QElapsedTimer scanTimer;
+    scanTimer.start();
+    QString message;
+    inCache = new LogCache();
+    inIndex = new TimeIndex();
+    if (inCache->load(inFile->fileName()) && inIndex->load(inFile->fileName()))
     {
-      	QString lineIn = inStream.readLine();
-        QStringList breakdown = lineIn.split(",");
-        int length = breakdown.size();
-        if (length <= 0) break;
-        QString firstText = breakdown[0].simplified();
-        QString secondText = breakdown[1].simplified();
-        if ((firstText == "pH") && (length > 1))
-        {
-            QDateTime time = QDateTime::fromString(secondText,Qt::ISODate);
-            if (startTime.isNull()) startTime = time;
-            endTime = time;
-        }
-        int secondField = secondText.toInt();
-        if ((firstText == "dB1") && (length > 1))
-        {
-            battery1Current = secondField;
-        }
-        if ((firstText == "dB2") && (length > 1))
-        {
-            battery2Current = secondField;
-        }
-        if ((firstText == "dB3") && (length > 1))
-        {
-            battery3Current = secondField;
-        }
-        if ((firstText == "dO1") && (length > 1))
-        {
-            int operationalStatus = secondField&0x03;
-            if (operationalStatus == 2)
-            {
-                calibration1Count++;
-                battery1CurrentZero += battery1Current;
-            }
-        }
-        if ((firstText == "dO2") && (length > 1))
-        {
-            int operationalStatus = secondField&0x03;
-            if (operationalStatus == 2)
-            {
-                calibration2Count++;
-                battery2CurrentZero += battery2Current;
-            }
-        }
-        if ((firstText == "dO3") && (length > 1))
-        {
-            int operationalStatus = secondField&0x03;
-            if (operationalStatus == 2)
-            {
-                calibration3Count++;
-                battery3CurrentZero += battery3Current;
-            }
-        }
+        message = QString("Loaded cache of %1 records in %2 ms")
+                        .arg(inCache->frameCount()).arg(scanTimer.elapsed());
+    }
+    else
+    {
+        long long startLines = reader->lineCount();
+        inCache->build(reader, inIndex);
+// Report the scan rate
+        long long scannedLines = reader->lineCount() - startLines;
+        qint64 elapsed = scanTimer.elapsed();
+        if (elapsed < 1) elapsed = 1;
+        message = QString("Scanned %1 lines in %2 ms, %3 lines/s")
+                        .arg(scannedLines).arg(elapsed)
+                        .arg(scannedLines*1000/elapsed);
+        if (! inCache->save(inFile->fileName()))
+            message.append(", cache not saved");
+        if (! inIndex->save(inFile->fileName()))
+            message.append(", index not saved");
+    }
+    if (inCache->isComplete())
+    {
+        inCacheReader = new CacheReader(inCache);
+        inCacheReader->setIndex(inIndex);
+        inSource = inCacheReader;
+    }
+    else
+    {
+        reader->setIndex(inIndex);
+        inSource = reader;
+        message.append(", using raw file");
     }
 // Remove the zero point of current if required
-    if (DataProcessingMainUi.zeroCurrentCheckBox->isChecked())  
+    if (DataProcessingMainUi.zeroCurrentCheckBox->isChecked())
     {
-        battery1CurrentZero /= calibration1Count;
-        battery2CurrentZero /= calibration2Count;
-        battery3CurrentZero /= calibration3Count;
+        battery1CurrentZero = inCache->currentZero(0);
+        battery2CurrentZero = inCache->currentZero(1);
+        battery3CurrentZero = inCache->currentZero(2);
     }
     else
     {
@@ -1778,8 +1099,11 @@ void DataProcessingGui::scanFile(QFile* inFile)
         battery2CurrentZero = 0;
         battery3CurrentZero = 0;
     }
+    QDateTime startTime = inCache->startTime();
+    QDateTime endTime = inCache->endTime();
     if (! startTime.isNull()) DataProcessingMainUi.startTime->setDateTime(startTime);
     if (! endTime.isNull()) DataProcessingMainUi.endTime->setDateTime(endTime);
+    displayErrorMessage(message);
 }
 
 //-----------------------------------------------------------------------------
@@ -42,13 +42,20 @@
 #define Voffset R9*Vref/R5
 #define Vscale (1+R4/R5)/(1+R9/R7)
 
-#define LINE_WIDTH 36
-
 #include "ui_data-processing-main.h"
+#include "data-processing-record.h"
+#include "data-processing-combine.h"
+#include "data-processing-cache.h"
+#include "data-processing-energy.h"
+#include "data-processing-jobs.h"
+#include <QAtomicInt>
 #include <QDialog>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QListWidgetItem>
+#include <QMap>
 
 typedef enum {battery1UnderVoltage, battery2UnderVoltage, battery3UnderVoltage, 
               battery1OverCurrent, battery2OverCurrent, battery3OverCurrent,
@@ -76,6 +83,10 @@ private slots:
     void on_splitButton_clicked();
     void on_energyButton_clicked();
     void on_energySaveButton_clicked();
+    void on_energyCancelButton_clicked();
+    void energyChunksReady();
+    void energyRowsReady(int index);
+    void energyFinished();
     void on_extractButton_clicked();
     void on_voltagePlotCheckBox_clicked();
     void on_plotFileSelectButton_clicked();
@@ -85,22 +96,33 @@ private slots:
     void on_battery3Checkbox_clicked();
     void on_statesPlotCheckbox_clicked();
     void on_analysisFileSelectButton_clicked();
+    void on_jobCancelButton_clicked();
+    void jobStarted(ProcessingJob* job);
+    void jobProgress(ProcessingJob* job, int percent);
+    void jobFinished(ProcessingJob* job);
 private:
 // User Interface object instance
     Ui::DataProcessingMainWindow DataProcessingMainUi;
-    void scanFile(QFile* file);
-    bool combineRecords(QDateTime startTime, QDateTime endTime,
-                                   QFile* inFile, QFile* outFile, bool header);
+    void scanFile(RecordReader* reader);
     void displayErrorMessage(QString message);
-    QDateTime findFirstTimeRecord(QFile* inFile);
-    bool openSaveFile(void);
+    QDateTime findFirstTimeRecord(RecordSource* reader);
+    QString saveFileName();
+    void startRecordJob(RecordJob* job);
+    void showPlot(PlotJob* job);
     bool outfileMessage(QString filename, bool* append);
+    bool splitConflictDialog(QStringList filenames, QList<SplitAction>* actions);
+    void stopEnergy();
+    bool energyRunning() const;
+    void displayEnergyRow(const EnergyRow& row);
     QStringList recordType;
     QStringList recordText;
     QFile* inFile;
-    QFile* outFile;
+    RecordReader* inReader;
+    LogCache* inCache;
+    CacheReader* inCacheReader;
+    TimeIndex* inIndex;
+    RecordSource* inSource;
     QFile* energyOutFile;
-    QString saveFile;
     QString energySaveFile;
     QDir saveDirectory;
     QFileInfo fileInfo;
@@ -108,8 +130,15 @@ private:
     long long battery2CurrentZero;
     long long battery3CurrentZero;
 // Record information
-    QString timeRecord;
     int tableRow;
+// Energy balance running in the background, its days found first
+    EnergyBalance* energyBalance;
+    QFutureWatcher<QList<EnergyChunk> >* chunkWatcher;
+    QFutureWatcher<QList<EnergyRow> >* energyWatcher;
+    QAtomicInt energyCancel;
+// File processing jobs running in the background
+    JobEngine* jobEngine;
+    QMap<ProcessingJob*,QListWidgetItem*> jobItems;
 };
 
 #endif
@@ -0,0 +1,269 @@
+/**
+@mainpage Power Management Data Processing Plot Window
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+The plot of a raw data file is browsed by zooming and panning. Only an overview
+of the file is held in memory, with the detail of the visible time window read
+from the memory mapped cache as it is needed, so that a year of records can be
+browsed without holding all of it.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-plot-window.h"
+#include <QtConcurrentRun>
+#include <qwt_plot_curve.h>
+#include <qwt_plot_grid.h>
+#include <qwt_legend.h>
+#include <qwt_scale_div.h>
+#include <qwt_scale_widget.h>
+#include <qwt_date_scale_draw.h>
+#include <qwt_date_scale_engine.h>
+
+//-----------------------------------------------------------------------------
+/** @brief Plot Window Constructor
+
+The window deletes itself when closed.
+
+@param[in] PlotJob* job: the completed plot job. Its series and cache are
+taken over by the window.
+@param[in] parent Parent widget.
+*/
+
+PlotWindow::PlotWindow(PlotJob* job, QWidget* parent) : QwtPlot(parent)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    settings = job->settings();
+    cache = job->takeCache();
+    overviewBucket = job->bucket();
+    detailBucket = overviewBucket;
+    detailPending = false;
+
+// Setup Plot objects
+// The curves draw only the detail needed for the visible range.
+    QwtPlotCurve* curves[4];
+    for (int n=0; n<4; n++)
+    {
+        series[n] = job->takeSeries(n);
+        curves[n] = new DecimatedCurve(series[n]);
+        curves[n]->setRenderHint(QwtPlotItem::RenderAntialiased, true);
+    }
+
+// Set display parameters and titles
+    if (settings.showStates)        // SoC, Voltage and charge state
+    {
+        curves[0]->setTitle("Voltage");
+        curves[0]->setPen(Qt::blue, 2);
+        curves[1]->setTitle("State of Charge");
+        curves[1]->setPen(Qt::red, 2);
+        curves[2]->setTitle("Charging Mode");
+        curves[2]->setPen(Qt::black, 2);
+    }
+    else
+    {
+        if (settings.showTemperature) curves[0]->setTitle("Temperature");
+        else curves[0]->setTitle("Battery 1");
+        curves[0]->setPen(Qt::blue, 2);
+        curves[1]->setTitle("Battery 2");
+        curves[1]->setPen(Qt::red, 2);
+        curves[2]->setTitle("Battery 3");
+        curves[2]->setPen(Qt::yellow, 2);
+        curves[3]->setTitle("Module");
+        curves[3]->setPen(Qt::green, 2);
+    }
+
+// Build plot
+    if (settings.showStates) setTitle("Battery States");
+    else if (settings.showTemperature) setTitle("Battery Temperature");
+    else
+    {
+        if (settings.showCurrent) setTitle("Battery Currents");
+        else setTitle("Battery Voltages");
+    }
+    setCanvasBackground(Qt::white);
+    setAxisScale(QwtPlot::yLeft, settings.yScaleLow, settings.yScaleHigh);
+    //Set x-axis scaling.
+    QwtDateScaleDraw *qwtDateScaleDraw = new QwtDateScaleDraw(Qt::LocalTime);
+    QwtDateScaleEngine *qwtDateScaleEngine = new QwtDateScaleEngine(Qt::LocalTime);
+    qwtDateScaleDraw->setDateFormat(QwtDate::Hour, "hh");
+    setAxisScaleDraw(QwtPlot::xBottom, qwtDateScaleDraw);
+    setAxisScaleEngine(QwtPlot::xBottom, qwtDateScaleEngine);
+    insertLegend(new QwtLegend());
+    QwtPlotGrid *grid = new QwtPlotGrid();
+    grid->attach(this);
+
+    for (int n=0; n<4; n++)
+    {
+        if (settings.showPlot[n] && (series[n] != NULL))
+            curves[n]->attach(this);
+        else delete curves[n];
+    }
+    replot();
+
+// Zoom with a rectangle, pan with the middle button, and magnify time only
+// with the wheel.
+    zoomer = new QwtPlotZoomer(canvas());
+    zoomer->setZoomBase();
+    panner = new QwtPlotPanner(canvas());
+    panner->setMouseButton(Qt::MidButton);
+    magnifier = new QwtPlotMagnifier(canvas());
+    magnifier->setAxisEnabled(QwtPlot::yLeft, false);
+
+    detailWatcher = new QFutureWatcher<PlotDetail>(this);
+    connect(detailWatcher, SIGNAL(finished()), this, SLOT(detailReady()));
+    connect(axisWidget(QwtPlot::xBottom), SIGNAL(scaleDivChanged()),
+            this, SLOT(visibleRangeChanged()));
+    resize(1000,600);
+}
+
+PlotWindow::~PlotWindow()
+{
+    detailWatcher->waitForFinished();
+    delete cache;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief The time axis has been zoomed or panned.
+
+If detail is being read already, the new range is looked at when it arrives.
+*/
+
+void PlotWindow::visibleRangeChanged()
+{
+    if (cache == NULL) return;
+    if (detailWatcher->isRunning())
+    {
+        detailPending = true;
+        return;
+    }
+    requestDetail();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read detail for the visible range if what is shown is too coarse.
+
+The window read is widened by half the visible range on each side so that
+panning does not need another read straight away. It is reduced to the same
+bounded number of points as the overview, so it is read at full resolution
+only once the visible range is small enough.
+*/
+
+void PlotWindow::requestDetail()
+{
+    const QwtScaleDiv& scaleDiv = axisScaleDiv(QwtPlot::xBottom);
+    double xMin = scaleDiv.lowerBound();
+    double xMax = scaleDiv.upperBound();
+    if (xMin > xMax) qSwap(xMin, xMax);
+    qint64 firstFrame = frameAt(xMin);
+    qint64 lastFrame = frameAt(xMax);
+    qint64 frames = lastFrame-firstFrame+1;
+    int bucket = (int)(2*frames/PLOT_BUCKETS)+1;
+// Only read if the detail would be at least twice as fine as that shown
+    int shownBucket = overviewBucket;
+    for (int n=0; n<4; n++)
+    {
+        if ((series[n] != NULL) && series[n]->hasDetail(xMin, xMax))
+            shownBucket = detailBucket;
+    }
+    if (2*bucket > shownBucket) return;
+    qint64 margin = frames/2;
+    firstFrame -= margin;
+    if (firstFrame < 0) firstFrame = 0;
+    lastFrame += margin;
+    if (lastFrame >= cache->frameCount()) lastFrame = cache->frameCount()-1;
+    detailWatcher->setFuture(QtConcurrent::run(&PlotWindow::readDetail, cache,
+                             settings, firstFrame, lastFrame, bucket));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Detail has been read for a time window.
+
+The detail replaces any earlier detail, and the plot is redrawn.
+*/
+
+void PlotWindow::detailReady()
+{
+    PlotDetail detail = detailWatcher->result();
+    detailBucket = detail.bucket;
+    for (int n=0; n<4; n++)
+    {
+        if ((series[n] == NULL) || detail.points[n].isEmpty()) continue;
+        series[n]->setDetail(new DecimatedData(detail.points[n]),
+                             detail.from, detail.to);
+    }
+    replot();
+    if (detailPending)
+    {
+        detailPending = false;
+        requestDetail();
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find the frame in force at a time.
+
+@param[in] double time: ms since epoch.
+@returns qint64 last frame starting at or before the time, or the first frame.
+*/
+
+qint64 PlotWindow::frameAt(double time) const
+{
+    qint64 low = 0;
+    qint64 high = cache->frameCount();
+    while (low < high)
+    {
+        qint64 middle = (low+high)/2;
+        if (cache->frameTime(middle) <= time) low = middle+1;
+        else high = middle;
+    }
+    if (low > 0) low--;
+    return low;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the points of a time window from the cache.
+
+Runs on a worker thread.
+
+@param[in] LogCache* cache: cache of the raw data file.
+@param[in] PlotSettings settings: series to be plotted.
+@param[in] qint64 firstFrame: first frame of the window.
+@param[in] qint64 lastFrame: last frame of the window.
+@param[in] int bucket: number of samples reduced to their minimum and maximum.
+@returns PlotDetail points of the window and the times it covers.
+*/
+
+PlotDetail PlotWindow::readDetail(const LogCache* cache, PlotSettings settings,
+                                  qint64 firstFrame, qint64 lastFrame,
+                                  int bucket)
+{
+    PlotDetail detail;
+    detail.from = cache->frameTime(firstFrame);
+    detail.to = cache->frameTime(lastFrame);
+    detail.bucket = bucket;
+    PlotSampler::readFrames(cache, settings, firstFrame, lastFrame, bucket,
+                            detail.points);
+    return detail;
+}
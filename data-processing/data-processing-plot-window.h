@@ -0,0 +1,91 @@
+/*          Power Management Data Processing Plot Window Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_PLOT_WINDOW_H
+#define DATA_PROCESSING_PLOT_WINDOW_H
+
+#include "data-processing-plot.h"
+#include "data-processing-jobs.h"
+#include <QFutureWatcher>
+#include <QVector>
+#include <qwt_plot.h>
+#include <qwt_plot_zoomer.h>
+#include <qwt_plot_panner.h>
+#include <qwt_plot_magnifier.h>
+
+//-----------------------------------------------------------------------------
+/** @brief Points read from the cache for a time window.
+*/
+
+struct PlotDetail
+{
+    QVector<QPointF> points[4];
+    double from;
+    double to;
+    int bucket;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Plot Window.
+
+Shows the curves read by a plot job. The plot can be zoomed by selecting a
+rectangle, zoomed out with the right button, panned with the middle button and
+magnified in time with the wheel.
+
+For a raw data file the job gives an overview of the whole file, and the
+points for the visible time window are read from the cache in the background
+whenever the overview is too coarse for it.
+*/
+
+class PlotWindow : public QwtPlot
+{
+    Q_OBJECT
+public:
+    PlotWindow(PlotJob* job, QWidget* parent = 0);
+    ~PlotWindow();
+private slots:
+    void visibleRangeChanged();
+    void detailReady();
+private:
+    void requestDetail();
+    qint64 frameAt(double time) const;
+    static PlotDetail readDetail(const LogCache* cache, PlotSettings settings,
+                                 qint64 firstFrame, qint64 lastFrame,
+                                 int bucket);
+    PlotSettings settings;
+    LogCache* cache;
+    int overviewBucket;
+    int detailBucket;
+    bool detailPending;
+    DecimatedData* series[4];
+    QwtPlotZoomer* zoomer;
+    QwtPlotPanner* panner;
+    QwtPlotMagnifier* magnifier;
+    QFutureWatcher<PlotDetail>* detailWatcher;
+};
+
+#endif
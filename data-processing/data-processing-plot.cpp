@@ -0,0 +1,480 @@
+/**
+@mainpage Power Management Data Processing Plot
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+A month of records gives millions of points for each curve, far more than can
+be seen. The curves are drawn from a pyramid of decimated levels, taking for
+the visible range only the level that gives a few points for each pixel.
+
+The points are made from csv lines or from the log cache. When read from the
+cache they are reduced as they are read to a bounded number, whatever the size
+of the file, and finer detail is read again for a time window when needed.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-plot.h"
+#include <QStringList>
+#include <qwt_scale_map.h>
+
+//-----------------------------------------------------------------------------
+/** @brief Plot Sampler Constructor
+
+@param[in] PlotSettings settings: series to be plotted.
+@param[in] int bucket: number of samples reduced to their minimum and maximum.
+*/
+
+PlotSampler::PlotSampler(const PlotSettings& plotSettings, int bucketSize)
+{
+    settings = plotSettings;
+    bucket = bucketSize;
+    startRun = true;
+    ordered = true;
+    index = 0;
+    lastIndex = 0;
+    for (int series=0; series<4; series++) bucketCount[series] = 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add the values from a line of a csv file.
+
+@param[in] QString line: line of the csv file.
+@returns false if the line is not a complete record with a valid time.
+*/
+
+bool PlotSampler::addLine(const QString& line)
+{
+    bool ok;
+    QStringList breakdown = line.split(",");
+    int size = breakdown.size();
+    if (size != LINE_WIDTH) return false;
+    QDateTime time = QDateTime::fromString(breakdown[0].simplified(),Qt::ISODate);
+    if (! time.isValid()) return false;
+    float value1 = breakdown[settings.column[0]].simplified().toFloat(&ok);
+    float value2 = breakdown[settings.column[1]].simplified().toFloat(&ok);
+    float value3 = breakdown[settings.column[2]].simplified().toFloat(&ok);
+    float value4 = breakdown[settings.column[3]].simplified().toFloat(&ok);
+    float chargeMode = 0;
+    if (settings.showStates)
+    {
+        QString chargeModetext = breakdown[settings.column[2]].simplified();
+        if (chargeModetext == "Isolate") chargeMode = 5;
+        if (chargeModetext == "Charge") chargeMode = 10;
+        if (chargeModetext == "Loaded") chargeMode = 0;
+    }
+    add(time, value1, value2, value3, value4, chargeMode);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add the values from a combined block of raw records.
+
+@param[in] RecordCombiner combiner: holding the block just read.
+*/
+
+void PlotSampler::addBlock(const RecordCombiner& combiner)
+{
+    float chargeMode = 0;
+    if (settings.showStates)
+    {
+        int opState = (int)combiner.columnValue(settings.column[2]);
+        if (opState == 2) chargeMode = 5;
+        if (opState == 1) chargeMode = 10;
+    }
+    add(combiner.blockTime(),
+        combiner.columnValue(settings.column[0]),
+        combiner.columnValue(settings.column[1]),
+        combiner.columnValue(settings.column[2]),
+        combiner.columnValue(settings.column[3]), chargeMode);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Make the points for the values at a time.
+
+Index increments by about 0.5 seconds. To have x-axis in date-time index must
+be "double" type, ie ms since epoch.
+*/
+
+void PlotSampler::add(const QDateTime& time, float value1, float value2,
+                      float value3, float value4, float chargeMode)
+{
+    if (! time.isValid()) return;
+// On the first run get the start time
+    if (startRun)
+    {
+        startRun = false;
+        startTime = time;
+        previousTime = startTime;
+        index = startTime.toMSecsSinceEpoch();
+        lastIndex = index;
+    }
+// Try to keep index and time in sync to account for jumps in time.
+// Index is counting half seconds and time from records is integer seconds only
+    if (previousTime == time) index += 500;
+    else index = time.toMSecsSinceEpoch();
+    if (index < lastIndex) ordered = false;
+    lastIndex = index;
+// Create points to plot
+    if (settings.showStates)
+    {
+// In this case data to be displayed needs to be converted to common scale.
+        float batteryVoltage = (value1-10)*100/10;
+        append(0, QPointF(index,batteryVoltage));
+        float stateOfCharge = value2;
+        append(1, QPointF(index,stateOfCharge));
+        append(2, QPointF(index,chargeMode));
+    }
+    else
+    {
+        if (settings.showPlot[0]) append(0, QPointF(index,value1));
+        if (settings.showPlot[1]) append(1, QPointF(index,value2));
+        if (settings.showPlot[2]) append(2, QPointF(index,value3));
+        if (settings.showPlot[3]) append(3, QPointF(index,value4));
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add a point to a series, reducing each bucket to its extremes.
+*/
+
+void PlotSampler::append(int series, const QPointF& point)
+{
+    if (bucket <= 1)
+    {
+        points[series] << point;
+        return;
+    }
+    int position = bucketCount[series]++;
+    if ((position == 0) || (point.y() < bucketMinimum[series].y()))
+    {
+        bucketMinimum[series] = point;
+        minimumPosition[series] = position;
+    }
+    if ((position == 0) || (point.y() > bucketMaximum[series].y()))
+    {
+        bucketMaximum[series] = point;
+        maximumPosition[series] = position;
+    }
+    if (bucketCount[series] >= bucket) flush(series);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Output the extremes of a bucket in the order they occurred.
+*/
+
+void PlotSampler::flush(int series)
+{
+    if (bucketCount[series] == 0) return;
+    if (minimumPosition[series] == maximumPosition[series])
+        points[series] << bucketMinimum[series];
+    else if (minimumPosition[series] < maximumPosition[series])
+        points[series] << bucketMinimum[series] << bucketMaximum[series];
+    else
+        points[series] << bucketMaximum[series] << bucketMinimum[series];
+    bucketCount[series] = 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Output any partly filled buckets once all samples are added.
+*/
+
+void PlotSampler::finish()
+{
+    for (int series=0; series<4; series++) flush(series);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take over the points of a series.
+
+@param[in] int series: series number 0 to 3.
+@returns QVector<QPointF> points of the series, now cleared in the sampler.
+*/
+
+QVector<QPointF> PlotSampler::takePoints(int series)
+{
+    QVector<QPointF> seriesPoints = points[series];
+    points[series] = QVector<QPointF>();
+    return seriesPoints;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the points for a range of frames from the cache.
+
+This is safe to call from any thread, as each call has its own reader.
+
+@param[in] LogCache* cache: cache of the raw data file.
+@param[in] PlotSettings settings: series to be plotted.
+@param[in] qint64 firstFrame: frame to start from.
+@param[in] qint64 lastFrame: frame after which reading stops.
+@param[in] int bucket: number of samples reduced to their minimum and maximum.
+@param[out] QVector<QPointF>* points: array of four series to be filled.
+@returns false if the cache has no frames.
+*/
+
+bool PlotSampler::readFrames(const LogCache* cache, const PlotSettings& settings,
+                             qint64 firstFrame, qint64 lastFrame, int bucket,
+                             QVector<QPointF>* points)
+{
+    if (cache->frameCount() == 0) return false;
+    CacheReader reader(cache);
+    reader.seekFrame(firstFrame);
+    long long zero[3] = {0,0,0};
+    if (settings.zeroCurrent)
+        for (int battery=0; battery<3; battery++)
+            zero[battery] = cache->currentZero(battery);
+    RecordCombiner combiner(zero[0],zero[1],zero[2]);
+    PlotSampler sampler(settings, bucket);
+    while (combiner.readBlock(&reader))
+    {
+        sampler.addBlock(combiner);
+        if (reader.frame() > lastFrame) break;
+    }
+    sampler.finish();
+    for (int series=0; series<4; series++)
+        points[series] = sampler.takePoints(series);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Decimated Data Constructor
+
+The levels are built from the full resolution samples. Each bucket of a level
+takes twice the decimation factor of points from the level below, and gives
+its minimum and maximum, so each level is smaller by the decimation factor.
+
+@param[in] QVector<QPointF> samples: points in order of time.
+*/
+
+DecimatedData::DecimatedData(const QVector<QPointF>& samples)
+{
+    levels.append(samples);
+    ordered = true;
+    double minX = 0, maxX = 0, minY = 0, maxY = 0;
+    for (int i=0; i<samples.size(); i++)
+    {
+        const QPointF& point = samples[i];
+        if ((i > 0) && (point.x() < samples[i-1].x())) ordered = false;
+        if ((i == 0) || (point.x() < minX)) minX = point.x();
+        if ((i == 0) || (point.x() > maxX)) maxX = point.x();
+        if ((i == 0) || (point.y() < minY)) minY = point.y();
+        if ((i == 0) || (point.y() > maxY)) maxY = point.y();
+    }
+    if (samples.isEmpty()) d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+    else d_boundingRect = QRectF(minX, minY, maxX-minX, maxY-minY);
+    int bucket = 2*DECIMATION_FACTOR;
+    while (levels.last().size() > DECIMATION_MINIMUM)
+    {
+        const QVector<QPointF>& below = levels.last();
+        QVector<QPointF> points;
+        points.reserve(below.size()/DECIMATION_FACTOR+2);
+        for (int start=0; start<below.size(); start+=bucket)
+        {
+            int end = start+bucket;
+            if (end > below.size()) end = below.size();
+            int minimum = start;
+            int maximum = start;
+            for (int i=start+1; i<end; i++)
+            {
+                if (below[i].y() < below[minimum].y()) minimum = i;
+                if (below[i].y() > below[maximum].y()) maximum = i;
+            }
+// Keep the order of occurrence so that the line follows the data
+            if (minimum == maximum) points << below[minimum];
+            else if (minimum < maximum) points << below[minimum] << below[maximum];
+            else points << below[maximum] << below[minimum];
+        }
+        levels.append(points);
+    }
+    level = levels.size()-1;
+    first = 0;
+    count = levels[level].size();
+    detail = NULL;
+    detailFrom = 0;
+    detailTo = 0;
+    useDetail = false;
+}
+
+DecimatedData::~DecimatedData()
+{
+    delete detail;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Number of points presented for the visible range.
+*/
+
+size_t DecimatedData::size() const
+{
+    if (useDetail) return detail->size();
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Point presented for the visible range.
+*/
+
+QPointF DecimatedData::sample(size_t i) const
+{
+    if (useDetail) return detail->sample(i);
+    return levels[level][first+i];
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Bounds of all the samples, whatever is visible.
+*/
+
+QRectF DecimatedData::boundingRect() const
+{
+    return d_boundingRect;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Choose the level and points for a visible range.
+
+The finest level that gives no more than four points for each pixel is used,
+with one point either side of the range so that lines continue to the edges.
+If the samples are not in time order the whole of the level is presented.
+Detail covering the whole range is used in place of the levels.
+
+@param[in] double xMin: start of the visible range.
+@param[in] double xMax: end of the visible range.
+@param[in] int pixels: width of the visible range in pixels.
+*/
+
+void DecimatedData::setVisible(double xMin, double xMax, int pixels)
+{
+    if (pixels < 1) pixels = 1;
+    useDetail = hasDetail(xMin, xMax);
+    if (useDetail)
+    {
+        detail->setVisible(xMin, xMax, pixels);
+        return;
+    }
+    for (level = 0; level < levels.size(); level++)
+    {
+        const QVector<QPointF>& points = levels[level];
+        if (ordered)
+        {
+            first = lowerBound(points, xMin);
+            int last = lowerBound(points, xMax);
+            if (first > 0) first--;
+            if (last < points.size()) last++;
+            count = last-first;
+        }
+        else
+        {
+            first = 0;
+            count = points.size();
+        }
+        if ((count <= 4*pixels) || (level == levels.size()-1)) break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add finer detail for a time window.
+
+Any previous detail is replaced.
+
+@param[in] DecimatedData* data: points of the window, owned by this object.
+@param[in] double from: start of the window.
+@param[in] double to: end of the window.
+*/
+
+void DecimatedData::setDetail(DecimatedData* data, double from, double to)
+{
+    useDetail = false;
+    delete detail;
+    detail = data;
+    detailFrom = from;
+    detailTo = to;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test if the detail covers a range.
+
+@param[in] double xMin: start of the range.
+@param[in] double xMax: end of the range.
+*/
+
+bool DecimatedData::hasDetail(double xMin, double xMax) const
+{
+    return ((detail != NULL) && (xMin >= detailFrom) && (xMax <= detailTo));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find the first point at or after a time.
+
+@param[in] QVector<QPointF> points: points in order of time.
+@param[in] double x: time to find.
+@returns int index of the point, or the number of points if all are before.
+*/
+
+int DecimatedData::lowerBound(const QVector<QPointF>& points, double x) const
+{
+    int low = 0;
+    int high = points.size();
+    while (low < high)
+    {
+        int middle = (low+high)/2;
+        if (points[middle].x() < x) low = middle+1;
+        else high = middle;
+    }
+    return low;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Decimated Curve Constructor
+
+@param[in] DecimatedData* data: points of the curve, owned by the curve.
+*/
+
+DecimatedCurve::DecimatedCurve(DecimatedData* data)
+{
+    decimated = data;
+    if (decimated != NULL) setData(decimated);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Draw the points needed for the visible range.
+
+The range given is ignored as the data presents only the visible points.
+*/
+
+void DecimatedCurve::drawSeries(QPainter* painter, const QwtScaleMap& xMap,
+                                const QwtScaleMap& yMap,
+                                const QRectF& canvasRect,
+                                int from, int to) const
+{
+    Q_UNUSED(from);
+    Q_UNUSED(to);
+    if (decimated == NULL) return;
+    double xMin = xMap.invTransform(canvasRect.left());
+    double xMax = xMap.invTransform(canvasRect.right());
+    if (xMin > xMax) qSwap(xMin, xMax);
+    decimated->setVisible(xMin, xMax, (int)canvasRect.width());
+    if (decimated->size() == 0) return;
+    QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect,
+                             0, (int)decimated->size()-1);
+}
@@ -0,0 +1,163 @@
+/*          Power Management Data Processing Plot Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_PLOT_H
+#define DATA_PROCESSING_PLOT_H
+
+#include "data-processing-cache.h"
+#include "data-processing-combine.h"
+#include <QDateTime>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+#include <qwt_series_data.h>
+#include <qwt_plot_curve.h>
+
+// Number of samples combined into each bucket of the next coarser level
+#define DECIMATION_FACTOR 4
+// Coarsest level is not made smaller than this number of points
+#define DECIMATION_MINIMUM 2048
+// Number of buckets read from the cache for the whole file or a time window
+#define PLOT_BUCKETS 32768
+
+//-----------------------------------------------------------------------------
+/** @brief Selection of the series to be plotted.
+*/
+
+struct PlotSettings
+{
+    bool showCurrent;
+    bool showTemperature;
+    bool showStates;
+    bool showPlot[4];
+    int column[4];
+    float yScaleLow;
+    float yScaleHigh;
+    bool zeroCurrent;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Plot Sampler.
+
+Makes the points of each series from csv lines or combined raw records. Where
+more samples are read than can be shown, the samples are reduced as they are
+read to the minimum and maximum of each bucket of samples.
+*/
+
+class PlotSampler
+{
+public:
+    PlotSampler(const PlotSettings& settings, int bucket = 1);
+    bool addLine(const QString& line);
+    void addBlock(const RecordCombiner& combiner);
+    void finish();
+    QVector<QPointF> takePoints(int series);
+    bool isOrdered() const { return ordered; }
+    static bool readFrames(const LogCache* cache, const PlotSettings& settings,
+                           qint64 firstFrame, qint64 lastFrame, int bucket,
+                           QVector<QPointF>* points);
+private:
+    void add(const QDateTime& time, float value1, float value2, float value3,
+             float value4, float chargeMode);
+    void append(int series, const QPointF& point);
+    void flush(int series);
+    PlotSettings settings;
+    int bucket;
+    bool startRun;
+    bool ordered;
+    double index;
+    double lastIndex;
+    QDateTime startTime;
+    QDateTime previousTime;
+    QVector<QPointF> points[4];
+    QPointF bucketMinimum[4];
+    QPointF bucketMaximum[4];
+    int minimumPosition[4];
+    int maximumPosition[4];
+    int bucketCount[4];
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Decimated Series Data.
+
+The samples are held as read and in a pyramid of coarser levels.
+Each bucket of a level is represented by its minimum and maximum points in
+the order they occur, so that the envelope of the curve is kept at every level.
+
+Only the points of one level within the visible range are presented to the
+curve. The level is chosen to give a few points for each pixel.
+
+Finer detail read for a time window can be added, and is presented in place of
+the levels whenever the visible range lies within that window.
+*/
+
+class DecimatedData : public QwtSeriesData<QPointF>
+{
+public:
+    DecimatedData(const QVector<QPointF>& samples);
+    ~DecimatedData();
+    virtual size_t size() const;
+    virtual QPointF sample(size_t i) const;
+    virtual QRectF boundingRect() const;
+    void setVisible(double xMin, double xMax, int pixels);
+    void setDetail(DecimatedData* data, double from, double to);
+    bool hasDetail(double xMin, double xMax) const;
+    int levelCount() const { return levels.size(); }
+private:
+    int lowerBound(const QVector<QPointF>& points, double x) const;
+    QVector<QVector<QPointF> > levels;
+    bool ordered;
+    int level;
+    int first;
+    int count;
+    DecimatedData* detail;
+    double detailFrom;
+    double detailTo;
+    bool useDetail;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Curve drawing decimated data.
+
+The visible range and width of the canvas are given to the data before each
+drawing, so zooming or panning brings in the level of detail needed.
+*/
+
+class DecimatedCurve : public QwtPlotCurve
+{
+public:
+    DecimatedCurve(DecimatedData* data);
+protected:
+    virtual void drawSeries(QPainter* painter, const QwtScaleMap& xMap,
+                            const QwtScaleMap& yMap, const QRectF& canvasRect,
+                            int from, int to) const;
+private:
+    DecimatedData* decimated;
+};
+
+#endif
@@ -0,0 +1,290 @@
+/**
+@mainpage Power Management Data Processing Raw Record Reader
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+Raw data files are text files of comma separated records as sent by the BMS,
+one record per line with an identifier as the first field. These can run to
+tens of millions of lines, so the reader avoids creating strings for each line
+and field. The file is memory mapped and each line is broken into field views
+that point directly into the mapped data.
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "data-processing-record.h"
+#include "data-processing-index.h"
+#include "data-processing-capture.h"
+#include <QFile>
+#include <QDateTime>
+#include <cstring>
+#include <cctype>
+#include <climits>
+
+//-----------------------------------------------------------------------------
+/** @brief Compare a field with a text string.
+
+@param[in] const char* text: null terminated string to compare.
+@returns true if the field is identical to the text.
+*/
+
+bool RecordField::operator==(const char* text) const
+{
+    int i = 0;
+    while (i < length)
+    {
+        if (text[i] != data[i]) return false;
+        i++;
+    }
+    return (text[i] == 0);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Convert a field to a decimal integer.
+
+This behaves as QString::toInt for base 10, returning zero if the field is not
+a valid integer, but does not create any intermediate strings.
+
+@param[out] bool* ok: set false if the conversion failed (may be NULL).
+@returns int value of the field.
+*/
+
+int RecordField::toInt(bool* ok) const
+{
+    if (ok != 0) *ok = false;
+    int i = 0;
+    bool negative = false;
+    if ((length > 0) && ((data[0] == '-') || (data[0] == '+')))
+    {
+        negative = (data[0] == '-');
+        i++;
+    }
+    if (i >= length) return 0;
+    long long value = 0;
+    while (i < length)
+    {
+        char digit = data[i];
+        if ((digit < '0') || (digit > '9')) return 0;
+        value = value*10 + (digit - '0');
+        if (value > (long long)INT_MAX+1) return 0;
+        i++;
+    }
+    if (negative) value = -value;
+    if ((value > INT_MAX) || (value < INT_MIN)) return 0;
+    if (ok != 0) *ok = true;
+    return (int)value;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Convert a field to a date-time.
+
+@returns QDateTime from an ISO 8601 formatted field. Invalid if not a time.
+*/
+
+QDateTime RecordField::toDateTime() const
+{
+    return QDateTime::fromString(toString(),Qt::ISODate);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Raw Record Reader Constructor
+
+The file must already be open for reading. An attempt is made to map the whole
+file into memory. If that fails (for example the address space is too small)
+lines are read from the file into a buffer instead.
+
+If the file is a capture, a decoder is made for it and the size is the number
+of records.
+
+@param[in] QFile* file: the opened raw data file or capture.
+*/
+
+RecordReader::RecordReader(QFile* inFile)
+{
+    file = inFile;
+    index = NULL;
+    capture = NULL;
+    map = NULL;
+    size = file->size();
+    if (size > 0) map = (const char*)file->map(0,size);
+    if (CaptureDecoder::isCapture(file,map,size))
+    {
+        capture = new CaptureDecoder(file,map,size);
+        size = capture->recordCount();
+    }
+    position = 0;
+    recordPosition = 0;
+    numberFields = 0;
+    lines = 0;
+    if (map == NULL) file->seek(0);
+}
+
+RecordReader::~RecordReader()
+{
+    delete capture;
+    if (map != NULL) file->unmap((uchar*)map);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the next record.
+
+The line is broken into fields which are available until the next call.
+
+@returns false if the end of file was reached and no line was read.
+*/
+
+bool RecordReader::readRecord()
+{
+    numberFields = 0;
+    if (atEnd()) return false;
+    recordPosition = position;
+    if (capture != NULL)
+    {
+        capture->line(position,&lineBuffer);
+        position++;
+        splitLine(lineBuffer.constData(), lineBuffer.size());
+    }
+    else if (map != NULL)
+    {
+        const char* line = map + position;
+        qint64 remaining = size - position;
+        const char* end = (const char*)memchr(line, '\n', remaining);
+        int length;
+        if (end == NULL)
+        {
+            length = (int)remaining;
+            position = size;
+        }
+        else
+        {
+            length = (int)(end - line);
+            position += length + 1;
+        }
+        splitLine(line, length);
+    }
+    else
+    {
+        lineBuffer = file->readLine();
+        position = file->pos();
+        splitLine(lineBuffer.constData(), lineBuffer.size());
+    }
+    lines++;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test for the end of the file.
+
+@returns true if there are no more lines to be read.
+*/
+
+bool RecordReader::atEnd() const
+{
+    if ((capture != NULL) || (map != NULL)) return (position >= size);
+    return file->atEnd();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move to a new read position.
+
+The position should be the start of a line, as given by pos() or recordPos().
+
+@param[in] qint64 newPosition: byte offset from the start of the file.
+*/
+
+void RecordReader::seek(qint64 newPosition)
+{
+    if (newPosition < 0) newPosition = 0;
+    if (newPosition > size) newPosition = size;
+    position = newPosition;
+    recordPosition = newPosition;
+    numberFields = 0;
+    if ((capture == NULL) && (map == NULL)) file->seek(newPosition);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move to a position before a given time.
+
+If a time index has been given, reading starts shortly before the time,
+otherwise from the beginning of the file, or for a capture from the block
+holding the time.
+
+@param[in] QDateTime time: time to start from.
+*/
+
+void RecordReader::seekTime(const QDateTime& time)
+{
+    int entry = -1;
+    if (index != NULL) entry = index->find(time);
+    if (entry >= 0) seek(index->entry(entry).offset);
+    else if (capture != NULL) seek(capture->findTime(time.toMSecsSinceEpoch()));
+    else seek(0);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Access a field of the current record.
+
+@param[in] int index: field number, 0 being the record identifier.
+@returns RecordField view, empty if the field does not exist.
+*/
+
+const RecordField& RecordReader::field(int index) const
+{
+    if ((index < 0) || (index >= numberFields)) return emptyField;
+    return fields[index];
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Break a line into fields.
+
+Fields are separated by commas and have surrounding whitespace (including any
+line ending characters) removed. An empty line gives a single empty field, as
+QString::split would.
+
+@param[in] const char* line: start of the line.
+@param[in] int length: length of the line excluding the newline.
+*/
+
+void RecordReader::splitLine(const char* line, int length)
+{
+    int start = 0;
+    while (true)
+    {
+        int end = start;
+        while ((end < length) && (line[end] != ',')) end++;
+        int fieldStart = start;
+        int fieldEnd = end;
+        while ((fieldStart < fieldEnd) && isspace((uchar)line[fieldStart]))
+            fieldStart++;
+        while ((fieldEnd > fieldStart) && isspace((uchar)line[fieldEnd-1]))
+            fieldEnd--;
+        if (numberFields < MAX_RECORD_FIELDS)
+        {
+            fields[numberFields] = RecordField(line+fieldStart, fieldEnd-fieldStart);
+            numberFields++;
+        }
+        if (end >= length) break;
+        start = end+1;
+    }
+}
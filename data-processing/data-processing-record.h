@@ -0,0 +1,139 @@
+/*          Power Management Data Processing Raw Record Reader Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@trinity.asn.au                                                *
+ *                                                                          *
+ *   This file is part of Power Management                                  *
+ *                                                                          *
+ *   Power Management is free software; you can redistribute it and/or      *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management is distributed in the hope that it will be useful,    *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management if not, write to the                       *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef DATA_PROCESSING_RECORD_H
+#define DATA_PROCESSING_RECORD_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+class TimeIndex;
+class CaptureDecoder;
+
+// Maximum number of fields kept for a line. Further fields are ignored.
+#define MAX_RECORD_FIELDS 40
+
+//-----------------------------------------------------------------------------
+/** @brief View of a single field of a raw record.
+
+The field points into the line held by the RecordReader and is valid only
+until the next line is read. Leading and trailing whitespace is excluded.
+*/
+
+class RecordField
+{
+public:
+    RecordField() : data(0), length(0) {}
+    RecordField(const char* fieldData, int fieldLength)
+                                    : data(fieldData), length(fieldLength) {}
+    bool isEmpty() const { return (length == 0); }
+    bool operator==(const char* text) const;
+    bool operator!=(const char* text) const { return ! (*this == text); }
+    int toInt(bool* ok = 0) const;
+    QString toString() const { return QString::fromLatin1(data, length); }
+    QDateTime toDateTime() const;
+    const char* data;
+    int length;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Source of BMS records.
+
+Processing passes read records one at a time through this interface, so that
+they can work from either the raw text file or the parsed cache.
+*/
+
+class RecordSource
+{
+public:
+    virtual ~RecordSource() {}
+    virtual bool readRecord() = 0;
+    virtual bool atEnd() const = 0;
+    virtual void rewind() = 0;
+    virtual void seekTime(const QDateTime& time) = 0;
+    virtual int fieldCount() const = 0;
+    virtual const RecordField& field(int index) const = 0;
+    virtual int intField(int index) const = 0;
+    virtual bool isTimeRecord() const = 0;
+    virtual QDateTime timeField() const = 0;
+    virtual QString timeText() const = 0;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Raw Record Reader.
+
+Reads a raw data file line by line and breaks each line at the commas into
+fields without copying. The file is memory mapped where possible, otherwise
+lines are read into a buffer that is reused.
+
+A compressed capture saved by the GUI is read in the same way, its records
+being given back as lines. Positions in a capture count records rather than
+bytes.
+*/
+
+class RecordReader : public RecordSource
+{
+public:
+    RecordReader(QFile* file);
+    ~RecordReader();
+    bool readRecord();
+    bool atEnd() const;
+    void rewind() { seek(0); }
+    void seekTime(const QDateTime& time);
+    void seek(qint64 position);
+    void setIndex(const TimeIndex* timeIndex) { index = timeIndex; }
+    qint64 pos() const { return position; }
+    qint64 recordPos() const { return recordPosition; }
+    qint64 fileSize() const { return size; }
+    int fieldCount() const { return numberFields; }
+    const RecordField& field(int index) const;
+    const RecordField& operator[](int index) const { return field(index); }
+    int intField(int index) const { return field(index).toInt(); }
+    bool isTimeRecord() const
+        { return ((numberFields > 1) && (fields[0] == "pH")); }
+    QDateTime timeField() const { return field(1).toDateTime(); }
+    QString timeText() const { return field(1).toString(); }
+    long long lineCount() const { return lines; }
+private:
+    void splitLine(const char* line, int length);
+    QFile* file;
+    const TimeIndex* index;
+    CaptureDecoder* capture;
+    const char* map;
+    qint64 size;
+    qint64 position;
+    qint64 recordPosition;
+    QByteArray lineBuffer;
+    RecordField fields[MAX_RECORD_FIELDS];
+    RecordField emptyField;
+    int numberFields;
+    long long lines;
+};
+
+#endif
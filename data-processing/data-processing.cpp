@@ -35,15 +35,37 @@ Uses: Qt version 4.8.1
  ***************************************************************************/
 
 #include "data-processing-main.h"
+#include "data-processing-batch.h"
+#include "data-processing-benchmark.h"
 #include <QApplication>
+#include <QCoreApplication>
 
 //-----------------------------------------------------------------------------
 /** @brief Power Management Data Processing Main Program
 
+With --batch as the first argument the files given are processed without a
+display, and the program exits when all are finished. With --benchmark the
+scan of the files given is timed with the old and new record readers.
 */
 
 int main(int argc,char ** argv)
 {
+    QStringList arguments;
+    for (int i=0; i<argc; i++) arguments << QString::fromLocal8Bit(argv[i]);
+    if (isBenchmark(arguments)) return benchmarkScan(arguments);
+    if (BatchProcessor::isBatch(arguments))
+    {
+        QCoreApplication application(argc,argv);
+        BatchProcessor batchProcessor(arguments);
+        if (! batchProcessor.start()) return 1;
+        if (batchProcessor.isRunning())
+        {
+            QObject::connect(&batchProcessor, SIGNAL(finished()),
+                             &application, SLOT(quit()));
+            application.exec();
+        }
+        return batchProcessor.exitCode();
+    }
     QApplication application(argc,argv);
     DataProcessingGui dataProcessingGui;
     if (dataProcessingGui.success())
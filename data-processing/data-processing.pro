@@ -15,10 +15,35 @@ UI_HEADERS_DIR  = ui
 UI_SOURCES_DIR  = ui
 LANGUAGE        = C++
 CONFIG          += qt warn_on release
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
 
 # Input
 FORMS           += data-processing-main.ui
 HEADERS         += data-processing-main.h
+HEADERS         += data-processing-record.h
+HEADERS         += data-processing-capture.h
+HEADERS         += data-processing-combine.h
+HEADERS         += data-processing-cache.h
+HEADERS         += data-processing-index.h
+HEADERS         += data-processing-energy.h
+HEADERS         += data-processing-analysis.h
+HEADERS         += data-processing-plot.h
+HEADERS         += data-processing-plot-window.h
+HEADERS         += data-processing-jobs.h
+HEADERS         += data-processing-batch.h
+HEADERS         += data-processing-benchmark.h
 SOURCES         += data-processing.cpp
 SOURCES         += data-processing-main.cpp
+SOURCES         += data-processing-record.cpp
+SOURCES         += data-processing-capture.cpp
+SOURCES         += data-processing-combine.cpp
+SOURCES         += data-processing-cache.cpp
+SOURCES         += data-processing-index.cpp
+SOURCES         += data-processing-energy.cpp
+SOURCES         += data-processing-analysis.cpp
+SOURCES         += data-processing-plot.cpp
+SOURCES         += data-processing-plot-window.cpp
+SOURCES         += data-processing-jobs.cpp
+SOURCES         += data-processing-batch.cpp
+SOURCES         += data-processing-benchmark.cpp
 
@@ -69,6 +69,8 @@ static void commsPrintInt(int32_t value);
 static void commsPrintHex(uint32_t value);
 static void commsPrintString(char *ch);
 static void commsPrintChar(char *ch);
+static char* nextParameter(char* parameter);
+static void sendFileBlock(uint32_t offset, uint8_t* block, uint16_t length);
 
 /*--------------------------------------------------------------------------*/
 /* Global Variables */
@@ -94,6 +96,9 @@ static char writeFileName[12];
 static char readFileName[12];
 static uint8_t writeFileHandle;
 static uint8_t readFileHandle;
+/* Circular buffer positions of the G command, emptied when the file moves */
+static uint8_t getReadPointer;
+static uint8_t getWritePointer;
 static int lapseCommsID;
 static xTimerHandle lapseCommsTimer;
 
@@ -163,6 +168,8 @@ static void initGlobals(void)
     readFileName[0] = 0;
     writeFileHandle = 0xFF;
     readFileHandle = 0xFF;
+    getReadPointer = 0;
+    getWritePointer = 0;
 }
 
 /*--------------------------------------------------------------------------*/
@@ -562,8 +569,10 @@ Rfilename   - Open file read only. Filename is 8.3 string style. Returns handle.
 Xfilename   - Delete the file. Filename is 8.3 string style.
 Cxx         - Close file. x is the file handle.
 Gxx         - Read a record from read or write file.
+Bxx,o,n     - Read n blocks from the read or write file from byte offset o.
 Ddirname    - Get a directory listing. Directory name is 8.3 string style.
 d[dirname]  - Get the first (if dirname present) or next entry in directory.
+ln[,dirname] - Get the first (if dirname present) or next n entries in directory.
 s           - Get status of open files and configData.config.recording flag
 M           - Mount the SD card.
 All commands return an error status byte at the end.
@@ -637,6 +646,7 @@ Data is not written to the file externally. */
                     if (xSemaphoreTake(fileSendSemaphore,COMMS_FILE_TIMEOUT))
                     {
                         stringCopy(readFileName,(char*)line+2);
+                        getReadPointer = getWritePointer;
                         sendFileCommand('R',13,line+2);
                         xQueueReceive(fileReceiveQueue,&readFileHandle,portMAX_DELAY);
                         sendResponse("fR",readFileHandle);
@@ -657,6 +667,7 @@ file handle is a two character integer. */
                 {
                     uint8_t fileHandle = asciiToInt((char*)line+2);
                     sendFileCommand('C',1,&fileHandle);
+                    getReadPointer = getWritePointer;
                     xQueueReceive(fileReceiveQueue,&fileStatus,portMAX_DELAY);
                     if (fileStatus == FR_OK)
                     {
@@ -693,8 +704,6 @@ request. */
                     if (numberRecords < 1) numberRecords = 1;
                     static FRESULT fileStatus = FR_OK;
                     static uint8_t buffer[GET_RECORD_SIZE];
-                    static uint8_t readPointer = 0;
-                    static uint8_t writePointer = 0;
                     char sendData[GET_RECORD_SIZE];
                     uint8_t sendPointer = 0;
                     uint8_t fileHandle = asciiToInt((char*)line+2);
@@ -704,7 +713,7 @@ request. */
                     while (numberRecords > 0)
                     {
 /* The buffer is empty, so fill up. */
-                        if (readPointer == writePointer)
+                        if (getReadPointer == getWritePointer)
                         {
                             sendFileCommand('G',2,parameters);
                             numRead = 0;
@@ -719,11 +728,11 @@ request. */
 /* Read the entire block to the local buffer. */
                             for (i=0; i<numRead; i++)
                             {
-                                uint8_t nextWritePointer = (writePointer+1)
+                                uint8_t nextWritePointer = (getWritePointer+1)
                                                 % GET_RECORD_SIZE;
                                 xQueueReceive(fileReceiveQueue,
-                                    buffer+writePointer,portMAX_DELAY);
-                                writePointer = nextWritePointer;
+                                    buffer+getWritePointer,portMAX_DELAY);
+                                getWritePointer = nextWritePointer;
                             }
 /* Get status byte. */
                             xQueueReceive(fileReceiveQueue,&fileStatus,portMAX_DELAY);
@@ -731,8 +740,8 @@ request. */
 /* Assemble the data message until EOL encountered, or block exhausted. */
                         while (sendPointer < GET_RECORD_SIZE-1)
                         {
-                            sendData[sendPointer] = buffer[readPointer];
-                            readPointer = (readPointer+1) % GET_RECORD_SIZE;
+                            sendData[sendPointer] = buffer[getReadPointer];
+                            getReadPointer = (getReadPointer+1) % GET_RECORD_SIZE;
                             if (sendData[sendPointer] == '\n')
                             {
                                 sendData[sendPointer+1] = 0;
@@ -742,7 +751,7 @@ request. */
                                 break;
                             }
 /* If the current block is exhausted, go get some more. */
-                            if (readPointer == writePointer) break;
+                            if (getReadPointer == getWritePointer) break;
                             sendPointer++;
                         }
                     }
@@ -753,6 +762,74 @@ request. */
                 break;
             }
 /**
+<li> <b>Bhh,o,n</b> hh is the file handle, o the byte offset in the file and n
+the number of blocks wanted (1 to FILE_BLOCK_WINDOW). Blocks of FILE_BLOCK_SIZE
+bytes are read from the offset and sent back to back as fb,oooooooo,data,cccc
+where o is the offset of the block in hex, the data is base64 encoded and c is
+the CRC-16 of the data in hex. A short or empty block marks the end of the file
+and ends the request. The GUI keeps more than one request waiting so that the
+link stays busy, checks each block, and asks again from any block that is bad
+or missing. This moves the file position used by G, so any data G has read
+ahead is discarded. */
+            case 'B':
+            {
+                uint8_t fileStatus = FR_INT_ERR;
+                char* parameter = (char*)line+2;
+                uint8_t fileHandle = asciiToInt(parameter);
+                parameter = nextParameter(parameter);
+                uint32_t offset = asciiToInt(parameter);
+                parameter = nextParameter(parameter);
+                int numberBlocks = asciiToInt(parameter);
+                if (numberBlocks < 1) numberBlocks = 1;
+                if (numberBlocks > FILE_BLOCK_WINDOW) numberBlocks = FILE_BLOCK_WINDOW;
+/* The file semaphore is held only for the seek and for the reading of each
+block, not while the block is sent, so that recording from the monitor task is
+not held up for the whole request. Only this task moves the read position. */
+                if (xSemaphoreTake(fileSendSemaphore,COMMS_FILE_TIMEOUT))
+                {
+                    uint8_t position[5] = {fileHandle, (offset >> 24) & 0xFF,
+                                           (offset >> 16) & 0xFF,
+                                           (offset >> 8) & 0xFF, offset & 0xFF};
+                    sendFileCommand('L',5,position);
+                    getReadPointer = getWritePointer;
+                    xQueueReceive(fileReceiveQueue,&fileStatus,portMAX_DELAY);
+                    xSemaphoreGive(fileSendSemaphore);
+                    while ((fileStatus == FR_OK) && (numberBlocks-- > 0))
+                    {
+                        static uint8_t block[FILE_BLOCK_SIZE];
+                        uint16_t blockLength = 0;
+                        uint8_t parameters[2] = {fileHandle, FILE_BLOCK_PIECE};
+                        if (! xSemaphoreTake(fileSendSemaphore,COMMS_FILE_TIMEOUT))
+                        {
+                            fileStatus = FR_INT_ERR;
+                            break;
+                        }
+/* Fill the block in pieces, stopping early at the end of the file. */
+                        while (blockLength < FILE_BLOCK_SIZE)
+                        {
+                            uint8_t numRead = 0;
+                            sendFileCommand('G',2,parameters);
+                            xQueueReceive(fileReceiveQueue,&numRead,portMAX_DELAY);
+                            uint8_t i;
+                            for (i=0; i<numRead; i++)
+                                xQueueReceive(fileReceiveQueue,block+blockLength+i,
+                                              portMAX_DELAY);
+                            xQueueReceive(fileReceiveQueue,&fileStatus,portMAX_DELAY);
+                            blockLength += numRead;
+                            if ((fileStatus != FR_OK) || (numRead < FILE_BLOCK_PIECE))
+                                break;
+                        }
+                        xSemaphoreGive(fileSendSemaphore);
+                        if (fileStatus != FR_OK) break;
+                        sendFileBlock(offset,block,blockLength);
+                        offset += blockLength;
+                        if (blockLength < FILE_BLOCK_SIZE) break;
+                    }
+                }
+                sendResponse("fE",(uint8_t)fileStatus);
+                break;
+            }
+/**
 <li> <b>Dd</b> Get a directory listing d=dirname. Directory name is 8.3 string
 style. Gets all items in the directory and sends the type,size and name, each
 group preceded by a comma. The file command requests each entry in turn,
@@ -867,6 +944,98 @@ no further entries found in the directory, then an empty string is sent back. */
                 break;
             }
 /**
+<li> <b>ln[,d]</b> d is the directory name. Get up to n entries (at most
+FILE_LIST_BATCH) of the directory, from the first if d is present or else
+following those already sent. The response is fl,cccccccc,i followed by the
+type, size and name of each entry preceded by a comma as for the full listing.
+c is a count in hex of changes to the directory entries on the card, and i is
+the position in the listing of the first entry sent, so that a lost response
+can be noticed. Fewer than n entries means that the listing has ended. With n
+zero only fl,cccccccc is sent, so that a listing held by the GUI is fetched
+again only when it has changed. */
+            case 'l':
+            {
+                if (! xSemaphoreTake(commsSendSemaphore,COMMS_SEND_TIMEOUT))
+                    break;
+                uint8_t fileStatus = FR_INT_ERR;
+                char* parameter = (char*)line+2;
+                int numberEntries = asciiToInt(parameter);
+                if (numberEntries > FILE_LIST_BATCH) numberEntries = FILE_LIST_BATCH;
+                parameter = nextParameter(parameter);
+                if (xSemaphoreTake(fileSendSemaphore,COMMS_FILE_TIMEOUT))
+                {
+                    uint32_t changes = 0;
+                    uint8_t i;
+                    sendFileCommand('V',0,line+2);
+                    for (i=0; i<4; i++)
+                    {
+                        uint8_t wordBuf = 0;
+                        xQueueReceive(fileReceiveQueue,&wordBuf,portMAX_DELAY);
+                        changes |= ((uint32_t)wordBuf << 8*i);
+                    }
+                    xQueueReceive(fileReceiveQueue,&fileStatus,portMAX_DELAY);
+                    commsPrintString("fl,");
+                    commsPrintHex(changes >> 16);
+                    commsPrintHex(changes & 0xFFFF);
+/* The first request carries the directory name, later ones a zero to ask for
+the next entry. */
+                    static uint16_t listPosition = 0;
+                    uint8_t eol = 0;
+                    if (numberEntries > 0)
+                    {
+                        if (*parameter > 0)
+                        {
+                            listPosition = 0;
+                            sendFileCommand('D',13,(uint8_t*)parameter);
+                        }
+                        else sendFileCommand('D',1,&eol);
+                        commsPrintString(",");
+                        commsPrintInt(listPosition);
+                    }
+                    while (numberEntries-- > 0)
+                    {
+                        char type = 0;
+                        xQueueReceive(fileReceiveQueue,&type,portMAX_DELAY);
+                        char character;
+                        uint32_t fileSize = 0;
+                        for (i=0; i<4; i++)
+                        {
+                            character = 0;
+                            xQueueReceive(fileReceiveQueue,&character,portMAX_DELAY);
+                            fileSize = (fileSize << 8) + character;
+                        }
+/* Wait for room for the longest entry so that none is cut short. */
+                        while ((uint16_t)uxQueueSpacesAvailable(commsSendQueue) < 24)
+                            vTaskDelay(1);
+                        character = 0;
+                        xQueueReceive(fileReceiveQueue,&character,portMAX_DELAY);
+                        bool ended = (character == 0);
+                        if (! ended)
+                        {
+                            commsPrintString(",");
+                            commsPrintChar(&type);
+                            commsPrintHex(fileSize >> 16);
+                            commsPrintHex(fileSize & 0xFFFF);
+                        }
+                        while (character > 0)
+                        {
+                            commsPrintChar(&character);
+                            character = 0;
+                            xQueueReceive(fileReceiveQueue,&character,portMAX_DELAY);
+                        }
+                        xQueueReceive(fileReceiveQueue,&fileStatus,portMAX_DELAY);
+                        if (ended) break;
+                        listPosition++;
+                        if (numberEntries > 0) sendFileCommand('D',1,&eol);
+                    }
+                    commsPrintString("\r\n");
+                    xSemaphoreGive(fileSendSemaphore);
+                }
+                xSemaphoreGive(commsSendSemaphore);
+                sendResponse("fE",(uint8_t)fileStatus);
+                break;
+            }
+/**
 <li> <b>M</b> Register (mount or remount) the SD card. */
             case 'M':
             {
@@ -1187,6 +1356,52 @@ Block indefinitely as the message must not be abandoned */
     }
 }
 
+/*--------------------------------------------------------------------------*/
+/** @brief Send a Block of a File
+
+The block is sent as one line with its offset, base64 encoded data and CRC.
+Other tasks are held off while waiting for room on the send queue, so that the
+line is never cut short.
+
+@param[in] offset: uint32_t offset of the block in the file.
+@param[in] block: uint8_t* the data.
+@param[in] length: uint16_t number of bytes, up to FILE_BLOCK_SIZE.
+*/
+
+static void sendFileBlock(uint32_t offset, uint8_t* block, uint16_t length)
+{
+    char encoded[4*(FILE_BLOCK_SIZE/3)+1];
+    base64Encode(block,length,encoded);
+    uint16_t crc = crc16(block,length);
+    uint16_t lineLength = stringLength(encoded)+19;
+    if (! xSemaphoreTake(commsSendSemaphore,COMMS_SEND_TIMEOUT)) return;
+    while ((uint16_t)uxQueueSpacesAvailable(commsSendQueue) < lineLength)
+        vTaskDelay(1);
+    commsPrintString("fb,");
+    commsPrintHex(offset >> 16);
+    commsPrintHex(offset & 0xFFFF);
+    commsPrintString(",");
+    commsPrintString(encoded);
+    commsPrintString(",");
+    commsPrintHex(crc);
+    commsPrintString("\r\n");
+    xSemaphoreGive(commsSendSemaphore);
+}
+
+/*--------------------------------------------------------------------------*/
+/** @brief Find the Next of a Comma Separated List of Parameters
+
+@param[in] parameter: char* a parameter in the list.
+@returns char*: the parameter following, or the end of the string.
+*/
+
+static char* nextParameter(char* parameter)
+{
+    while ((*parameter > 0) && (*parameter != ',')) parameter++;
+    if (*parameter == ',') parameter++;
+    return parameter;
+}
+
 /*--------------------------------------------------------------------------*/
 /** @brief Print out the contents of a register (debug)
 
@@ -89,6 +89,7 @@ static bool fileUsable;
 static uint8_t filemap=0;           /* map of open file handles */
 static uint8_t writeFileHandle;
 static uint8_t readFileHandle;
+static uint32_t directoryChanges;   /* count of changes to directory entries */
 /*--------------------------------------------------------------------------*/
 /** @brief File Management Task
 
@@ -149,6 +150,9 @@ static void initFile(void)
     uint8_t i=0;
     for (i=0; i<MAX_OPEN_FILES; i++) fileInfo[i].fname[0] = 0;
     filemap = 0;
+/* Start the count of directory changes from the time, so that a count held by
+the GUI from before a restart is not taken to be current. */
+    directoryChanges = getSecondsCount() << 8;
 }
 
 /*--------------------------------------------------------------------------*/
@@ -164,6 +168,8 @@ C - close a file.
 S - store a block of data.
 G - retrieve a block of data.
 F - Free space on drive
+L - move the position in a file.
+V - count of changes to the directory entries.
 
 All commands return a status value at the end of any other data sent.
 
@@ -193,6 +199,9 @@ static void parseFileCommand(char *line)
                     fileStatus = FR_TOO_MANY_OPEN_FILES;
                 else
                 {
+/* Note whether the file exists, as opening it otherwise creates an entry */
+                    bool created = (f_stat(line+2, fileInfo+fileHandle)
+                                    == FR_NO_FILE);
 /* Try to open a file write/read, creating it if necessary */
                     fileStatus = f_open(&file[fileHandle], line+2, \
                                         FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
@@ -207,6 +216,7 @@ static void parseFileCommand(char *line)
                     writeFileHandle = fileHandle;
                     if (fileStatus == FR_OK)
                         fileStatus = f_stat(line+2, fileInfo+writeFileHandle);
+                    if ((fileStatus == FR_OK) && created) directoryChanges++;
                 }
             }
           	xQueueSendToBack(fileReceiveQueue,&fileHandle,FILE_SEND_TIMEOUT);
@@ -260,7 +270,13 @@ static void parseFileCommand(char *line)
                 fileStatus = FR_INVALID_OBJECT;
                 break;
             }
-            if (writeFileHandle == fileHandle) writeFileHandle = 0xFF;
+            if (writeFileHandle == fileHandle)
+            {
+                writeFileHandle = 0xFF;
+/* The size in the entry settles if the file was written since it was opened */
+                if (f_size(&file[fileHandle]) != fileInfo[fileHandle].fsize)
+                    directoryChanges++;
+            }
             else if (readFileHandle == fileHandle) readFileHandle = 0xFF;
             else
             {
@@ -320,6 +336,24 @@ differ from the number requested if EOF reached. */
             }
             break;
         }
+/* Move the position in a file for the next read or write. */
+/* Parameters are the file handle and the offset from the start of the file as
+four bytes, MSB first. A read file cannot be moved past its end. */
+        case 'L':
+        {
+            uint8_t fileHandle = line[2];
+            if ((line[1] != 7) || (fileHandle >= MAX_OPEN_FILES))
+            {
+                fileStatus = FR_INVALID_PARAMETER;
+                break;
+            }
+            uint32_t offset = ((uint32_t)(uint8_t)line[3] << 24) |
+                              ((uint32_t)(uint8_t)line[4] << 16) |
+                              ((uint32_t)(uint8_t)line[5] << 8) |
+                              (uint32_t)(uint8_t)line[6];
+            fileStatus = f_lseek(&file[fileHandle], offset);
+            break;
+        }
 /* Directory listing. */
 /* If the name is given, the directory specified is opened and the first entry
 returned. Subsequent calls with zero length name will return subsequent entries.
@@ -433,6 +467,7 @@ Checks the filename and handle for the write and read files, if they are open. *
                 stringEqual((char*)line+2, fileInfo[readFileHandle].fname)))
             {
                 fileStatus = f_unlink(line+2);
+                if (fileStatus == FR_OK) directoryChanges++;
             }
             else
                 fileStatus = FR_DENIED;
@@ -448,6 +483,25 @@ Checks the filename and handle for the write and read files, if they are open. *
             uint8_t i=0;
             for (i=0; i<MAX_OPEN_FILES; i++) fileInfo[i].fname[0] = 0;
             filemap = 0;
+/* The card may have been changed, so all entries may differ */
+            directoryChanges++;
+            break;
+        }
+/* Return the count of changes to directory entries. */
+/* No parameters. Returns the count as 4 bytes (32 bit word), lowest first. The
+count changes whenever the entries shown by a listing may differ: when a file
+is created or deleted, when a file written is closed with a changed size, or
+when the card is remounted. Sizes of a file being written are not counted while
+it is open. */
+        case 'V':
+        {
+            uint8_t i;
+            for (i=0; i<4; i++)
+            {
+                uint8_t wordBuf = (directoryChanges >> 8*i) & 0xFF;
+                xQueueSendToBack(fileReceiveQueue,&wordBuf,FILE_SEND_TIMEOUT);
+            }
+            fileStatus = FR_OK;
             break;
         }
     }
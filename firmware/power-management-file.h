@@ -33,6 +33,15 @@ Initial 1 October 2013
 
 #define MAX_OPEN_FILES              2
 
+/* Block transfer of files. The block is a multiple of 3 bytes so that only the
+last block has base64 padding, and is read in pieces the file task can handle. */
+#define FILE_BLOCK_SIZE             180
+#define FILE_BLOCK_PIECE            60
+#define FILE_BLOCK_WINDOW           16
+
+/* Most directory entries sent in one line of a batched listing. */
+#define FILE_LIST_BATCH             10
+
 /*--------------------------------------------------------------------------*/
 /* Prototypes */
 /*--------------------------------------------------------------------------*/
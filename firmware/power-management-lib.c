@@ -32,6 +32,9 @@ Initial 30 November 2013
 
 #include "power-management-lib.h"
 
+#define BASE64_ALPHABET \
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+
 /*--------------------------------------------------------------------------*/
 /** @brief Convert an ASCII decimal string to an integer
 
@@ -156,5 +159,62 @@ uint16_t stringEqual(char* string1,char* string2)
     return 1;
 }
 
+/*--------------------------------------------------------------------------*/
+/** @brief Encode Bytes in Base64 Form
+
+Each group of three bytes gives four characters, the last group being padded
+with = characters.
+
+@param[in] data: uint8_t* bytes to be encoded.
+@param[in] length: uint16_t number of bytes.
+@param[out] buffer: char* externally defined buffer to hold the result, of at
+least four characters for each three bytes plus one.
+*/
+
+void base64Encode(uint8_t* data, uint16_t length, char* buffer)
+{
+    uint16_t i;
+    uint16_t j=0;
+    for (i=0; i<length; i+=3)
+    {
+        uint32_t group = (uint32_t)data[i] << 16;
+        if (i+1 < length) group |= (uint32_t)data[i+1] << 8;
+        if (i+2 < length) group |= data[i+2];
+        buffer[j++] = BASE64_ALPHABET[(group >> 18) & 0x3F];
+        buffer[j++] = BASE64_ALPHABET[(group >> 12) & 0x3F];
+        buffer[j++] = (i+1 < length) ? BASE64_ALPHABET[(group >> 6) & 0x3F] : '=';
+        buffer[j++] = (i+2 < length) ? BASE64_ALPHABET[group & 0x3F] : '=';
+    }
+    buffer[j] = 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/** @brief CRC-16 of a Block of Bytes
+
+CCITT polynomial 0x1021, initial value 0xFFFF, bits taken MSB first and no
+final inversion.
+
+@param[in] data: uint8_t* bytes to be checked.
+@param[in] length: uint16_t number of bytes.
+@returns uint16_t: the CRC.
+*/
+
+uint16_t crc16(uint8_t* data, uint16_t length)
+{
+    uint16_t crc = 0xFFFF;
+    uint16_t i;
+    uint8_t bit;
+    for (i=0; i<length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit=0; bit<8; bit++)
+        {
+            if (crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+            else crc <<= 1;
+        }
+    }
+    return crc;
+}
+
 /**@}*/
 
@@ -0,0 +1,218 @@
+/*       Power Management Response Benchmark
+
+The lines of a saved session are decoded and dispatched both as the GUI did
+before, splitting each line into strings and comparing the identifier against
+every known record, and through the in-place parse and switch on the packed
+identifier used now. The time taken by each is printed so that the two can be
+compared on the same log.
+
+Only the decoding and dispatch are timed. The updates of the display that
+follow are the same for both and are left out. The values decoded by each path
+are added into a check sum, which must agree.
+
+@date 16 October 2026
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-benchmark.h"
+#include "power-management-comms.h"
+#include "power-management-capture.h"
+#include <QFile>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <stdio.h>
+
+//-----------------------------------------------------------------------------
+/** @brief Decode a Line as the GUI Did Before
+
+Each identifier comparison of the old processResponse is made in turn, and the
+fields of a matching record are converted from their strings.
+
+@param[in] QString response: the line received.
+@returns qint64 sum of the values decoded.
+*/
+
+static qint64 splitPath(const QString& response)
+{
+    static const char* currentVoltage[6] = {"dL1","dL2","dM1","dB1","dB2","dB3"};
+    static const char* settings[9] = {"dD","dS","ds","dS","dI",
+                                      "dO1","dO2","dO3",NULL};
+    static const char* scaled[4] = {"dC1","dC2","dC3","dT"};
+    qint64 check = 0;
+    QStringList breakdown = response.split(",");
+    int size = breakdown.size();
+    QString firstField = breakdown[0].simplified();
+    QString secondField;
+    if (size > 1) secondField = breakdown[1].simplified();
+    if ((size > 0) && ((firstField == "pH") || (firstField == "pQ"))) check++;
+    for (int i=0; i<6; i++)
+    {
+        if ((size > 0) && (firstField == currentVoltage[i]))
+        {
+            if (size > 1) check += (qint64)(breakdown[1].simplified().toFloat()/256*100);
+            if (size > 2) check += (qint64)(breakdown[2].simplified().toFloat()/256*100);
+        }
+    }
+    for (int i=0; settings[i] != NULL; i++)
+        if ((size > 0) && (firstField == settings[i]) && (i != 3))
+            check += secondField.toInt();
+    for (int i=0; i<4; i++)
+        if ((size > 0) && (firstField == scaled[i]) && (size > 1))
+            check += (qint64)(secondField.toFloat()/256*100);
+    if ((size > 0) && (firstField.left(1) == "f")) check++;
+    if ((size > 0) && ((firstField.left(1) == "p") || (firstField.left(2) == "dO")
+                                                   || (firstField.left(2) == "dE")
+                                                   || (firstField.left(2) == "dD")))
+        check++;
+    if ((size > 0) && (firstField.left(1) == "D")) check++;
+    return check;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Decode a Line as the GUI Does Now
+
+@param[in] QString response: the line received.
+@returns qint64 sum of the values decoded.
+*/
+
+static qint64 packedPath(const QString& response)
+{
+    qint64 check = 0;
+    ResponseFields fields;
+    parseResponse(response,&fields);
+    switch (fields.code)
+    {
+        case RESPONSE_CODE('p','H',0):
+        case RESPONSE_CODE('p','Q',0):
+            check++;
+            break;
+        case RESPONSE_CODE('d','L','1'):
+        case RESPONSE_CODE('d','L','2'):
+        case RESPONSE_CODE('d','M','1'):
+        case RESPONSE_CODE('d','B','1'):
+        case RESPONSE_CODE('d','B','2'):
+        case RESPONSE_CODE('d','B','3'):
+            if (fields.size > 1) check += (qint64)((float)fields.field[1]/256*100);
+            if (fields.size > 2) check += (qint64)((float)fields.field[2]/256*100);
+            break;
+        case RESPONSE_CODE('d','D',0):
+        case RESPONSE_CODE('d','S',0):
+        case RESPONSE_CODE('d','s',0):
+        case RESPONSE_CODE('d','I',0):
+        case RESPONSE_CODE('d','O','1'):
+        case RESPONSE_CODE('d','O','2'):
+        case RESPONSE_CODE('d','O','3'):
+            check += fields.field[1];
+            break;
+        case RESPONSE_CODE('d','C','1'):
+        case RESPONSE_CODE('d','C','2'):
+        case RESPONSE_CODE('d','C','3'):
+        case RESPONSE_CODE('d','T',0):
+            if (fields.size > 1) check += (qint64)((float)fields.field[1]/256*100);
+            break;
+    }
+    char first = fields.identifier[0];
+    char second = fields.identifier[1];
+    if (first == 'f') check++;
+    if ((first == 'p') || ((first == 'd') &&
+        ((second == 'O') || (second == 'E') || (second == 'D')))) check++;
+    if (first == 'D') check++;
+    return check;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Time Both Decoding Paths over a Saved Session
+
+The session is read into memory first, as a text file or a capture, so that
+only the decoding is timed. Each path is run BENCHMARK_REPEATS times in turn and
+the best time of each is printed.
+
+@param[in] QString fileName: saved session.
+@returns int exit code, nonzero if the file could not be read or the two paths
+disagree.
+*/
+
+int benchmarkResponses(const QString& fileName)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::ReadOnly))
+    {
+        fprintf (stderr, "Unable to open %s.\n", qPrintable(fileName));
+        return 1;
+    }
+    QStringList lines;
+    if (CaptureReader::isCapture(&file))
+    {
+        CaptureReader capture(&file);
+        QByteArray line;
+        qint64 tick;
+        while (capture.readLine(&line,&tick)) lines.append(QString::fromLatin1(line));
+    }
+    else
+    {
+        while (! file.atEnd())
+        {
+            QByteArray line = file.readLine();
+            line.replace('\r',"");
+            line.replace('\n',"");
+            lines.append(QString::fromLatin1(line));
+        }
+    }
+    if (lines.isEmpty())
+    {
+        fprintf (stderr, "No lines in %s.\n", qPrintable(fileName));
+        return 1;
+    }
+    qint64 best[2] = {-1, -1};
+    qint64 check[2] = {0, 0};
+    QElapsedTimer timer;
+    for (int repeat=0; repeat<BENCHMARK_REPEATS; repeat++)
+    {
+        for (int path=0; path<2; path++)
+        {
+            qint64 sum = 0;
+            timer.start();
+            for (int i=0; i<lines.size(); i++)
+                sum += (path == 0) ? splitPath(lines[i]) : packedPath(lines[i]);
+            qint64 elapsed = timer.nsecsElapsed();
+            if ((best[path] < 0) || (elapsed < best[path])) best[path] = elapsed;
+            check[path] = sum;
+        }
+    }
+    const char* name[2] = {"split strings", "packed identifier"};
+    for (int path=0; path<2; path++)
+    {
+        double seconds = (double)qMax(best[path],(qint64)1)/1e9;
+        printf ("%-18s %9.3f ms %12.0f lines/s\n", name[path], seconds*1000,
+                lines.size()/seconds);
+    }
+    printf ("%d lines, speedup %.2f\n", lines.size(),
+            (double)best[0]/qMax(best[1],(qint64)1));
+    if (check[0] != check[1])
+    {
+        fprintf (stderr, "Check sums differ: %lld and %lld.\n",
+                 (long long)check[0], (long long)check[1]);
+        return 1;
+    }
+    return 0;
+}
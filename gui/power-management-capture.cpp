@@ -0,0 +1,308 @@
+/*       Power Management Capture File
+
+Lines received from the remote unit can be saved in a compact binary form
+instead of text. Each line becomes a fixed width record holding a timestamp,
+the identifier and its integer fields, and the records are written in
+compressed blocks with a header that allows the file to be stepped through a
+block at a time. A capture can be read back to replay a session.
+
+@date 16 October 2026
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-capture.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <climits>
+#include <cstring>
+
+Q_STATIC_ASSERT(sizeof(CaptureRecord) == 32);
+Q_STATIC_ASSERT(sizeof(CaptureBlockHeader) == 32);
+
+//-----------------------------------------------------------------------------
+/** @brief Capture Writer Constructor
+
+@param[in] QFile* file: the file opened for writing.
+*/
+
+CaptureWriter::CaptureWriter(QFile* outFile)
+{
+    file = outFile;
+    firstTime = CAPTURE_NO_TIME;
+    baseTick = 0;
+    haveBase = false;
+    records.reserve(CAPTURE_BLOCK_RECORDS);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    writeBlock();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write the file header
+
+@returns bool true if the header was written.
+*/
+
+bool CaptureWriter::start()
+{
+    CaptureHeader header;
+    memcpy(header.magic,CAPTURE_MAGIC,4);
+    header.version = qToLittleEndian((quint32)CAPTURE_VERSION);
+    header.startTime = qToLittleEndian(QDateTime::currentMSecsSinceEpoch());
+    return (file->write((const char*)&header,sizeof(header)) == sizeof(header));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add a line to the current block
+
+The block is written when it is full.
+
+@param[in] QByteArray line: the line, without a line ending.
+@param[in] qint64 tick: monotonic time in ms when the line was received.
+*/
+
+void CaptureWriter::add(const QByteArray& line, qint64 tick)
+{
+    if (! haveBase)
+    {
+        baseTick = tick;
+        haveBase = true;
+    }
+    CaptureRecord record;
+    encode(line,&record);
+    record.tick = (quint32)(tick - baseTick);
+    records.append(record);
+    if (records.size() >= CAPTURE_BLOCK_RECORDS) writeBlock();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Encode a line as a fixed width record
+
+A line with an identifier of up to three characters followed by no more than
+CAPTURE_FIELDS integers is held in the record, and restored without any
+spaces. Anything else, including time records, is held as text. The first time
+record of a block gives the time of the block.
+
+@param[in] QByteArray line: the line.
+@param[out] CaptureRecord* record: the record.
+*/
+
+void CaptureWriter::encode(const QByteArray& line, CaptureRecord* record)
+{
+    memset(record,0,sizeof(CaptureRecord));
+    const char* data = line.constData();
+    int length = line.size();
+    int idLength = 0;
+    while ((idLength < length) && (data[idLength] != ',')) idLength++;
+    for (int i=0; (i<idLength) && (i<3); i++) record->identifier[i] = data[i];
+    bool numeric = (idLength > 0) && (idLength <= 3);
+    int position = idLength;
+    int fields = 0;
+    while (numeric && (position < length))
+    {
+        position++;                 // Skip the comma
+        while ((position < length) && (data[position] == ' ')) position++;
+        bool negative = false;
+        if ((position < length) &&
+            ((data[position] == '-') || (data[position] == '+')))
+        {
+            negative = (data[position] == '-');
+            position++;
+        }
+        long long value = 0;
+        int digits = 0;
+        while ((position < length) && (data[position] >= '0') &&
+               (data[position] <= '9') && (digits < 10))
+        {
+            value = value*10 + (data[position] - '0');
+            digits++;
+            position++;
+        }
+        while ((position < length) && (data[position] == ' ')) position++;
+        if (negative) value = -value;
+        numeric = (digits > 0) && (fields < CAPTURE_FIELDS) &&
+                  ((position >= length) || (data[position] == ',')) &&
+                  (value >= INT_MIN) && (value <= INT_MAX);
+        if (numeric) record->field[fields++] = (qint32)value;
+    }
+    if (numeric)
+    {
+        record->type = fields;
+        return;
+    }
+    record->type = CAPTURE_TEXT;
+    record->field[0] = text.size();
+    record->field[1] = length;
+    text.append(line);
+    if ((firstTime == CAPTURE_NO_TIME) && (idLength == 2) &&
+        (data[0] == 'p') && (data[1] == 'H'))
+    {
+        QDateTime time = QDateTime::fromString(
+            QString::fromLatin1(line.mid(3)).trimmed(),Qt::ISODate);
+        if (time.isValid()) firstTime = time.toMSecsSinceEpoch();
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Compress and write the current block
+
+The records are laid out as columns of 32 bit words, which compress much
+better than whole records as each column changes slowly.
+
+@returns bool false if the block could not be written.
+*/
+
+bool CaptureWriter::writeBlock()
+{
+    int count = records.size();
+    if (count == 0) return true;
+    QByteArray payload(count*sizeof(CaptureRecord)+text.size(),0);
+    quint32* column = (quint32*)payload.data();
+    for (int word=0; word<8; word++)
+    {
+        for (int n=0; n<count; n++)
+        {
+            quint32 value;
+            memcpy(&value,(const char*)&records[n]+4*word,4);
+            column[word*count+n] = qToLittleEndian(value);
+        }
+    }
+    memcpy(payload.data()+count*sizeof(CaptureRecord),text.constData(),
+           text.size());
+    QByteArray compressed = qCompress(payload);
+    CaptureBlockHeader header;
+    memcpy(header.magic,CAPTURE_BLOCK_MAGIC,4);
+    header.records = qToLittleEndian((quint32)count);
+    header.textSize = qToLittleEndian((quint32)text.size());
+    header.compressedSize = qToLittleEndian((quint32)compressed.size());
+    header.firstTick = qToLittleEndian(records.first().tick);
+    header.lastTick = qToLittleEndian(records.last().tick);
+    header.firstTime = qToLittleEndian(firstTime);
+    records.clear();
+    text.clear();
+    firstTime = CAPTURE_NO_TIME;
+    if (file->write((const char*)&header,sizeof(header)) != sizeof(header))
+        return false;
+    return (file->write(compressed) == compressed.size());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Capture Reader Constructor
+
+@param[in] QFile* file: the capture file, opened and positioned after the
+file header.
+*/
+
+CaptureReader::CaptureReader(QFile* inFile)
+{
+    file = inFile;
+    next = 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Test whether a file is a capture file.
+
+The header is read, leaving the file positioned at the first block if it is a
+capture, or at the start otherwise.
+
+@param[in] QFile* file: the opened file.
+@returns true if the file starts with the capture header of this version.
+*/
+
+bool CaptureReader::isCapture(QFile* file)
+{
+    CaptureHeader header;
+    file->seek(0);
+    if ((file->read((char*)&header,sizeof(header)) == sizeof(header)) &&
+        (memcmp(header.magic,CAPTURE_MAGIC,4) == 0) &&
+        (qFromLittleEndian(header.version) == CAPTURE_VERSION)) return true;
+    file->seek(0);
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the next line.
+
+@param[out] QByteArray* line: the line as it was received.
+@param[out] qint64* tick: ms from the first line of the file.
+@returns false at the end of the file or at a damaged block.
+*/
+
+bool CaptureReader::readLine(QByteArray* line, qint64* tick)
+{
+    if ((next >= records.size()) && ! readBlock()) return false;
+    const CaptureRecord& record = records[next++];
+    line->clear();
+    *tick = record.tick;
+    if (record.type == CAPTURE_TEXT)
+    {
+        if ((record.field[0] < 0) || (record.field[1] < 0) ||
+            (record.field[0]+record.field[1] > text.size())) return false;
+        line->append(text.constData()+record.field[0],record.field[1]);
+        return true;
+    }
+    for (int i=0; (i<3) && (record.identifier[i] != 0); i++)
+        line->append(record.identifier[i]);
+    for (int i=0; (i<record.type) && (i<CAPTURE_FIELDS); i++)
+    {
+        line->append(',');
+        line->append(QByteArray::number(record.field[i]));
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read and decompress the next block.
+
+@returns false at the end of the file or if the block is damaged.
+*/
+
+bool CaptureReader::readBlock()
+{
+    records.clear();
+    next = 0;
+    CaptureBlockHeader header;
+    if (file->read((char*)&header,sizeof(header)) != sizeof(header)) return false;
+    if (memcmp(header.magic,CAPTURE_BLOCK_MAGIC,4) != 0) return false;
+    int count = qFromLittleEndian(header.records);
+    int textSize = qFromLittleEndian(header.textSize);
+    int compressedSize = qFromLittleEndian(header.compressedSize);
+    QByteArray payload = qUncompress(file->read(compressedSize));
+    if ((count <= 0) ||
+        (payload.size() != count*(int)sizeof(CaptureRecord)+textSize))
+        return false;
+    records.resize(count);
+    const uchar* column = (const uchar*)payload.constData();
+    for (int word=0; word<8; word++)
+    {
+        for (int n=0; n<count; n++)
+        {
+            quint32 value = qFromLittleEndian<quint32>(column+4*(word*count+n));
+            memcpy((char*)&records[n]+4*word,&value,4);
+        }
+    }
+    text = payload.mid(count*sizeof(CaptureRecord));
+    return true;
+}
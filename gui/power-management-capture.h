@@ -0,0 +1,149 @@
+/*          Power Management GUI Capture File Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef POWER_MANAGEMENT_CAPTURE_H
+#define POWER_MANAGEMENT_CAPTURE_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+/* The layout of the capture file is shared with the data-processing reader and
+must be kept the same there. Change the version if it changes. */
+#define CAPTURE_MAGIC "BMSR"
+#define CAPTURE_BLOCK_MAGIC "BMSB"
+#define CAPTURE_VERSION 1
+#define CAPTURE_SUFFIX ".bmr"
+
+// Number of integer fields held in a record, excluding the identifier
+#define CAPTURE_FIELDS 6
+// Record type for a line held as text
+#define CAPTURE_TEXT (-1)
+// Number of records gathered into a compressed block
+#define CAPTURE_BLOCK_RECORDS 4096
+// Time stored in a block header when it has no time record
+#define CAPTURE_NO_TIME (-0x7FFFFFFFFFFFFFFFLL-1)
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed header at the start of a capture file.
+
+All values in the file are little endian.
+*/
+
+struct CaptureHeader
+{
+    char magic[4];
+    quint32 version;
+    qint64 startTime;               // ms since epoch when the file was opened
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed header at the start of each block.
+
+The compressed data follows. The header alone is enough to step to the next
+block, and gives the time of the first time record in the block for seeking.
+*/
+
+struct CaptureBlockHeader
+{
+    char magic[4];
+    quint32 records;
+    quint32 textSize;
+    quint32 compressedSize;
+    quint32 firstTick;
+    quint32 lastTick;
+    qint64 firstTime;               // ms since epoch, or CAPTURE_NO_TIME
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Fixed width record of a line.
+
+The tick is in ms from the first record of the file. The type is the number of
+integer fields, or CAPTURE_TEXT for a line that does not have the identifier
+and integer fields form, in which case the first two fields give the offset
+and length of the whole line in the text of the block.
+
+In a block the records are stored as eight columns of 32 bit words, followed by
+the text, and the whole is compressed.
+*/
+
+struct CaptureRecord
+{
+    quint32 tick;
+    char identifier[3];
+    qint8 type;
+    qint32 field[CAPTURE_FIELDS];
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Capture File Writer.
+
+Lines are encoded into fixed width records and written in compressed blocks,
+when a block is full or when asked to.
+*/
+
+class CaptureWriter
+{
+public:
+    CaptureWriter(QFile* file);
+    ~CaptureWriter();
+    bool start();
+    void add(const QByteArray& line, qint64 tick);
+    bool writeBlock();
+private:
+    void encode(const QByteArray& line, CaptureRecord* record);
+    QFile* file;
+    QVector<CaptureRecord> records;
+    QByteArray text;
+    qint64 firstTime;
+    qint64 baseTick;
+    bool haveBase;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Capture File Reader.
+
+Gives the lines of a capture file in order with their ticks, decompressing a
+block at a time.
+*/
+
+class CaptureReader
+{
+public:
+    CaptureReader(QFile* file);
+    static bool isCapture(QFile* file);
+    bool readLine(QByteArray* line, qint64* tick);
+private:
+    bool readBlock();
+    QFile* file;
+    QVector<CaptureRecord> records;
+    QByteArray text;
+    int next;
+};
+
+#endif
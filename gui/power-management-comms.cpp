@@ -0,0 +1,632 @@
+/*       Power Management Communications
+
+The serial port or TCP socket to the remote unit is handled on a dedicated I/O
+thread so that reception is not held up while the user interface is busy.
+Incoming data is framed into lines and decoded there, and the records are
+passed to the user interface through a lock-free queue.
+
+@date 16 October 2026
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-comms.h"
+#include <QSerialPort>
+#include <QTcpSocket>
+#include <QMetaObject>
+#include <QDateTime>
+#include <QDebug>
+
+//-----------------------------------------------------------------------------
+/** @brief Parse a response line in place
+
+The identifier and the integer fields are found in a single scan of the line
+without splitting it into strings. Spaces around a field are ignored, and a
+field that is not an integer is taken as zero.
+
+@param[in] QString response: the line received.
+@param[out] ResponseFields* fields: the identifier and fields of the line.
+*/
+
+void parseResponse(const QString& response, ResponseFields* fields)
+{
+    const QChar* data = response.constData();
+    int length = response.size();
+    int position = 0;
+    fields->size = 1;
+    for (int i=0; i<RESPONSE_FIELDS; i++) fields->field[i] = 0;
+// Identifier, of which the first three characters are kept
+    while ((position < length) && data[position].isSpace()) position++;
+    int idLength = 0;
+    while ((position < length) && (data[position] != ','))
+    {
+        if (data[position].isSpace()) break;
+        if (idLength < 3) fields->identifier[idLength] = data[position].toLatin1();
+        idLength++;
+        position++;
+    }
+    for (int i=qMin(idLength,3); i<4; i++) fields->identifier[i] = 0;
+    fields->code = 0;
+    if (idLength <= 3)
+        fields->code = RESPONSE_CODE(fields->identifier[0],
+                                     fields->identifier[1],
+                                     fields->identifier[2]);
+    while ((position < length) && (data[position] != ',')) position++;
+// Integer fields
+    while (position < length)
+    {
+        position++;                 // Skip the comma
+        int value = 0;
+        bool negative = false;
+        bool valid = false;
+        while ((position < length) && data[position].isSpace()) position++;
+        if ((position < length) &&
+            ((data[position] == '-') || (data[position] == '+')))
+        {
+            negative = (data[position] == '-');
+            position++;
+        }
+        while ((position < length) && data[position].isDigit())
+        {
+            value = value*10 + data[position].digitValue();
+            valid = true;
+            position++;
+        }
+        while ((position < length) && data[position].isSpace()) position++;
+        if ((position < length) && (data[position] != ','))
+        {
+            valid = false;
+            while ((position < length) && (data[position] != ',')) position++;
+        }
+        if (fields->size < RESPONSE_FIELDS)
+            fields->field[fields->size] = (valid ? (negative ? -value : value) : 0);
+        fields->size++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Communications Queue Constructor
+*/
+
+CommsQueue::CommsQueue() : head(0), tail(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add a record to the queue
+
+Called only from the I/O thread.
+
+@param[in] CommsRecord record: the record to be added.
+@returns bool false if the queue is full.
+*/
+
+bool CommsQueue::push(const CommsRecord& record)
+{
+    int position = tail.loadAcquire();
+    int next = (position+1) & (COMMS_QUEUE_SIZE-1);
+    if (next == head.loadAcquire()) return false;
+    records[position] = record;
+    tail.storeRelease(next);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take a record from the queue
+
+Called only from the user interface thread.
+
+@param[out] CommsRecord* record: the record taken.
+@returns bool false if the queue is empty.
+*/
+
+bool CommsQueue::pop(CommsRecord* record)
+{
+    int position = head.loadAcquire();
+    if (position == tail.loadAcquire()) return false;
+    *record = records[position];
+// Release the line so that it is not held until the entry is reused
+    records[position].line = QString();
+    head.storeRelease((position+1) & (COMMS_QUEUE_SIZE-1));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Communications Worker Constructor
+
+@param[in] CommsQueue* queue: queue to which received records are added.
+*/
+
+CommsWorker::CommsWorker(CommsQueue* recordQueue) : QObject(0)
+{
+    device = NULL;
+    queue = recordQueue;
+    discardLine = false;
+    droppedRecords = 0;
+    overlongLines = 0;
+    notifyPending = 0;
+    replayFile = NULL;
+    replayCapture = NULL;
+    replaySpeed = 0;
+    replayTime = -1;
+    replayFirstTime = -1;
+    replayedLines = 0;
+    replayPending = false;
+    keepAliveInterval = 0;
+// The timer is a child so that it moves to the I/O thread with the worker
+    replayTimer = new QTimer(this);
+    replayTimer->setSingleShot(true);
+    connect(replayTimer, SIGNAL(timeout()), this, SLOT(replayLines()));
+}
+
+CommsWorker::~CommsWorker()
+{
+    closeDevice();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open a serial port
+
+Any device already open is closed first.
+
+@param[in] QString deviceName: serial port device.
+@param[in] int baudrate: baud rate.
+@returns bool true if the port was opened.
+*/
+
+bool CommsWorker::openSerial(const QString& deviceName, int baudrate)
+{
+    closeDevice();
+    QSerialPort* port = new QSerialPort(deviceName,this);
+    if (! port->open(QIODevice::ReadWrite))
+    {
+        delete port;
+        return false;
+    }
+    port->setBaudRate(baudrate);
+    port->setDataBits(QSerialPort::Data8);
+    port->setParity(QSerialPort::NoParity);
+    port->setStopBits(QSerialPort::OneStop);
+    port->setFlowControl(QSerialPort::NoFlowControl);
+    connect(port, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    device = port;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Make an attempt to connect to a TCP host
+
+The socket is kept if the attempt fails so that another attempt can be made.
+
+@param[in] QString address: host address.
+@param[in] int port: TCP port.
+@returns bool true if connected within one second.
+*/
+
+bool CommsWorker::connectToHost(const QString& address, int port)
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(device);
+    if (socket == NULL)
+    {
+        closeDevice();
+        socket = new QTcpSocket(this);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        device = socket;
+    }
+    socket->abort();
+    socket->connectToHost(address, port);
+    return socket->waitForConnected(1000);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Close and delete the serial port or socket
+*/
+
+void CommsWorker::closeDevice()
+{
+    closeReplay();
+    if (device == NULL) return;
+    device->close();
+    delete device;
+    device = NULL;
+    line.clear();
+    discardLine = false;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write to the remote unit
+
+@param[in] QByteArray data: the data to be written.
+*/
+
+void CommsWorker::writeData(const QByteArray& data)
+{
+    if (device != NULL) device->write(data);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Handle incoming data
+
+Data is pulled in until a newline occurs, at which point the assembled line is
+framed. Carriage returns are dropped. A line longer than COMMS_LINE_LIMIT, for
+example from noise on the link, is dropped up to its newline and counted. The
+user interface is signalled once until it has emptied the queue.
+*/
+
+void CommsWorker::onReadyRead()
+{
+    QByteArray data = device->readAll();
+    int start = 0;
+    while (start < data.size())
+    {
+        int end = data.indexOf('\n',start);
+        int stop = (end < 0) ? data.size() : end;
+        for (int n=start; (n<stop) && ! discardLine; n++)
+        {
+            if (data.at(n) == '\r') continue;
+            if (line.size() >= COMMS_LINE_LIMIT)
+            {
+                if (overlongLines == 0) qDebug() << "Overlong line received, data lost";
+                overlongLines++;
+                line.clear();
+                discardLine = true;
+            }
+            else line += data.at(n);
+        }
+        if (end < 0) break;
+        if (discardLine) discardLine = false;
+        else frameLine();
+        start = end+1;
+    }
+    notify();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Signal the user interface once until it has emptied the queue
+*/
+
+void CommsWorker::notify()
+{
+    if (notifyPending.testAndSetOrdered(0,1)) emit recordsAvailable();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Queue a complete line for the user interface
+*/
+
+void CommsWorker::frameLine()
+{
+    if (! queueLine(line))
+    {
+        if (droppedRecords == 0) qDebug() << "Receive queue full, records lost";
+        droppedRecords++;
+    }
+    line.clear();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Decode a line and queue it for the user interface
+
+When a time record is received, send back a short message to keep comms alive.
+If a keep-alive interval is set, the message is sent no more often than that.
+
+@param[in] QByteArray data: the line without its line ending.
+@returns bool false if the queue is full.
+*/
+
+bool CommsWorker::queueLine(const QByteArray& data)
+{
+    CommsRecord record;
+    record.line = QString::fromLatin1(data);
+    record.time = QDateTime::currentMSecsSinceEpoch();
+    parseResponse(record.line,&record.fields);
+    if ((device != NULL) &&
+        ((record.fields.code == RESPONSE_CODE('p','H',0)) ||
+         (record.fields.code == RESPONSE_CODE('p','Q',0))) &&
+        ((keepAliveInterval == 0) || ! keepAliveClock.isValid() ||
+         keepAliveClock.hasExpired(keepAliveInterval)))
+    {
+        device->write("pc+\n\r");
+        keepAliveClock.start();
+    }
+    return queue->push(record);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the least time between keep-alive messages
+
+@param[in] int interval: time in ms, or 0 to reply to every time record.
+*/
+
+void CommsWorker::setKeepAliveInterval(int interval)
+{
+    keepAliveInterval = interval;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start replaying a saved session
+
+Any device already open is closed first. The file may be text as saved by the
+GUI or a capture. The times of a text file are taken from its time records.
+
+@param[in] QString fileName: the saved session.
+@param[in] double speed: times faster than received, or 0 for as fast as
+possible.
+@returns bool true if the file was opened.
+*/
+
+bool CommsWorker::openReplay(const QString& fileName, double speed)
+{
+    closeDevice();
+    replayFile = new QFile(fileName);
+    if (! replayFile->open(QIODevice::ReadOnly))
+    {
+        delete replayFile;
+        replayFile = NULL;
+        return false;
+    }
+    if (CaptureReader::isCapture(replayFile))
+        replayCapture = new CaptureReader(replayFile);
+    replaySpeed = speed;
+    replayTime = -1;
+    replayFirstTime = -1;
+    replayedLines = 0;
+    replayPending = readReplayLine();
+    replayClock.start();
+    replayTimer->start(0);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Queue the replayed lines that are due
+
+Runs until a line is not yet due, a batch has been queued or the queue is
+full, and then waits on the timer so that other events are handled.
+*/
+
+void CommsWorker::replayLines()
+{
+    int count = 0;
+    int wait = 0;
+    while (replayPending)
+    {
+        if ((replaySpeed > 0) && (replayTime >= 0))
+        {
+            qint64 ahead = (qint64)((replayTime-replayFirstTime)/replaySpeed)
+                           - replayClock.elapsed();
+            if (ahead > 0)
+            {
+                wait = (int)qMin(ahead,(qint64)1000);
+                break;
+            }
+        }
+        if (count >= REPLAY_BATCH) break;
+        if (! queueLine(replayLine))
+        {
+            wait = REPLAY_RETRY;
+            break;
+        }
+        count++;
+        replayedLines++;
+        replayPending = readReplayLine();
+    }
+    if (count > 0) notify();
+    if (replayPending)
+    {
+        replayTimer->start(wait);
+        return;
+    }
+    qint64 lines = replayedLines;
+    closeReplay();
+    emit replayEnded(lines);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Read the next line to be replayed and the time it was received
+
+@returns bool false at the end of the file.
+*/
+
+bool CommsWorker::readReplayLine()
+{
+    if (replayCapture != NULL)
+    {
+        if (! replayCapture->readLine(&replayLine,&replayTime)) return false;
+    }
+    else
+    {
+        if (replayFile->atEnd()) return false;
+        replayLine = replayFile->readLine();
+        replayLine.replace('\r',"");
+        replayLine.replace('\n',"");
+        if (replayLine.startsWith("pH,"))
+        {
+            QDateTime time = QDateTime::fromString(
+                QString::fromLatin1(replayLine.mid(3)).trimmed(),Qt::ISODate);
+            if (time.isValid()) replayTime = time.toMSecsSinceEpoch();
+        }
+    }
+    if ((replayFirstTime < 0) && (replayTime >= 0)) replayFirstTime = replayTime;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Stop any replay and close its file
+*/
+
+void CommsWorker::closeReplay()
+{
+    replayTimer->stop();
+    delete replayCapture;
+    replayCapture = NULL;
+    delete replayFile;
+    replayFile = NULL;
+    replayPending = false;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Communications Link Constructor
+
+The I/O thread is started, with no device open.
+
+@param[in] parent Parent object.
+*/
+
+PowerManagementComms::PowerManagementComms(QObject* parent) : QObject(parent)
+{
+    worker = new CommsWorker(&queue);
+    worker->moveToThread(&ioThread);
+    connect(worker, SIGNAL(recordsAvailable()), this, SIGNAL(recordsAvailable()));
+    connect(worker, SIGNAL(replayEnded(qint64)), this, SIGNAL(replayEnded(qint64)));
+// The worker is deleted on the I/O thread, with its device, as the thread ends
+    connect(&ioThread, SIGNAL(finished()), worker, SLOT(deleteLater()));
+    ioThread.start();
+}
+
+PowerManagementComms::~PowerManagementComms()
+{
+    QMetaObject::invokeMethod(worker, "closeDevice",
+                              Qt::BlockingQueuedConnection);
+    ioThread.quit();
+    ioThread.wait();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open a serial port on the I/O thread
+
+@param[in] QString device: serial port device.
+@param[in] int baudrate: baud rate.
+@returns bool true if the port was opened.
+*/
+
+bool PowerManagementComms::openSerial(const QString& device, int baudrate)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(worker, "openSerial",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok),
+                              Q_ARG(QString, device), Q_ARG(int, baudrate));
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Make an attempt to connect to a TCP host on the I/O thread
+
+@param[in] QString address: host address.
+@param[in] int port: TCP port.
+@returns bool true if connected within one second.
+*/
+
+bool PowerManagementComms::connectToHost(const QString& address, int port)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(worker, "connectToHost",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok),
+                              Q_ARG(QString, address), Q_ARG(int, port));
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start an attempt to connect to a TCP host without waiting
+
+The attempt is made on the I/O thread. Anything written meanwhile is sent once
+the connection is made.
+
+@param[in] QString address: host address.
+@param[in] int port: TCP port.
+*/
+
+void PowerManagementComms::requestConnection(const QString& address, int port)
+{
+    QMetaObject::invokeMethod(worker, "connectToHost", Qt::QueuedConnection,
+                              Q_ARG(QString, address), Q_ARG(int, port));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the least time between keep-alive messages to the remote unit
+
+@param[in] int interval: time in ms, or 0 to reply to every time record.
+*/
+
+void PowerManagementComms::setKeepAliveInterval(int interval)
+{
+    QMetaObject::invokeMethod(worker, "setKeepAliveInterval",
+                              Qt::QueuedConnection, Q_ARG(int, interval));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Replay a saved session on the I/O thread
+
+@param[in] QString fileName: the saved session.
+@param[in] double speed: times faster than received, or 0 for as fast as
+possible.
+@returns bool true if the file was opened.
+*/
+
+bool PowerManagementComms::openReplay(const QString& fileName, double speed)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(worker, "openReplay",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok),
+                              Q_ARG(QString, fileName), Q_ARG(double, speed));
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write to the remote unit
+
+The data is copied and written by the I/O thread.
+
+@param[in] char* data: null terminated data to be written.
+*/
+
+void PowerManagementComms::write(const char* data)
+{
+    QMetaObject::invokeMethod(worker, "writeData", Qt::QueuedConnection,
+                              Q_ARG(QByteArray, QByteArray(data)));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take the next record received
+
+@param[out] CommsRecord* record: the record taken.
+@returns bool false if no record is waiting.
+*/
+
+bool PowerManagementComms::readRecord(CommsRecord* record)
+{
+    return queue.pop(record);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Allow the next record received to be signalled
+
+Called before the queue is emptied, so that a record added after that is
+signalled again.
+*/
+
+void PowerManagementComms::clearNotify()
+{
+    worker->clearNotify();
+}
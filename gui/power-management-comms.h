@@ -0,0 +1,200 @@
+/*          Power Management GUI Communications Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef POWER_MANAGEMENT_COMMS_H
+#define POWER_MANAGEMENT_COMMS_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QIODevice>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "power-management-capture.h"
+
+// Maximum number of fields, including the identifier, kept from a response
+#define RESPONSE_FIELDS 8
+// Identifier of up to three characters packed into an integer for dispatch
+#define RESPONSE_CODE(a,b,c) ((((a) & 0xFF) << 16) | (((b) & 0xFF) << 8) \
+                              | ((c) & 0xFF))
+// Longest line accepted, longer lines being dropped up to their line ending
+#define COMMS_LINE_LIMIT 1024
+// Number of records that can wait for the user interface (power of two)
+#define COMMS_QUEUE_SIZE 8192
+// Number of replayed lines queued before other events are let through
+#define REPLAY_BATCH 256
+// Time in ms to wait for the user interface when the queue is full in replay
+#define REPLAY_RETRY 5
+
+//-----------------------------------------------------------------------------
+/** @brief Fields of a response line.
+
+The identifier is kept as its first three characters, and packed into the code
+if it is no longer than that. Further fields are integers.
+*/
+
+typedef struct
+{
+    char identifier[4];
+    int code;
+    int size;
+    int field[RESPONSE_FIELDS];
+} ResponseFields;
+
+void parseResponse(const QString& response, ResponseFields* fields);
+
+//-----------------------------------------------------------------------------
+/** @brief A line received with its decoded fields.
+
+The record is decoded once on the I/O thread and passed by reference to each
+window that handles it. The line is kept for saving and for the few records
+that carry text.
+*/
+
+typedef struct
+{
+    QString line;
+    qint64 time;                // ms since epoch when received
+    ResponseFields fields;
+} CommsRecord;
+
+//-----------------------------------------------------------------------------
+/** @brief Queue of records from the I/O thread to the user interface.
+
+There is a single producer and a single consumer, each of which only moves its
+own end of the queue, so no lock is needed.
+*/
+
+class CommsQueue
+{
+public:
+    CommsQueue();
+    bool push(const CommsRecord& record);
+    bool pop(CommsRecord* record);
+private:
+    CommsRecord records[COMMS_QUEUE_SIZE];
+    QAtomicInt head;
+    QAtomicInt tail;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Communications Worker.
+
+Lives in the I/O thread and owns the serial port or TCP socket. Incoming data
+is framed into lines which are decoded and queued for the user interface. The
+keep-alive reply to time records is written from here so it is not held up by
+the user interface.
+
+In place of a device, a saved session can be replayed from a text file or a
+capture. Lines are queued at the times they were received, scaled by a speed
+factor, or as fast as the user interface takes them. Nothing is lost when the
+queue is full, the replay waits instead.
+*/
+
+class CommsWorker : public QObject
+{
+    Q_OBJECT
+public:
+    CommsWorker(CommsQueue* queue);
+    ~CommsWorker();
+    void clearNotify() { notifyPending.storeRelease(0); }
+public slots:
+    bool openSerial(const QString& deviceName, int baudrate);
+    bool connectToHost(const QString& address, int port);
+    bool openReplay(const QString& fileName, double speed);
+    void closeDevice();
+    void writeData(const QByteArray& data);
+    void setKeepAliveInterval(int interval);
+signals:
+    void recordsAvailable();
+    void replayEnded(qint64 lines);
+private slots:
+    void onReadyRead();
+    void replayLines();
+private:
+    void frameLine();
+    bool queueLine(const QByteArray& data);
+    void notify();
+    bool readReplayLine();
+    void closeReplay();
+    QIODevice* device;
+    CommsQueue* queue;
+    QByteArray line;
+    bool discardLine;
+    quint32 droppedRecords;
+    quint32 overlongLines;
+    QAtomicInt notifyPending;
+    QFile* replayFile;
+    CaptureReader* replayCapture;
+    QTimer* replayTimer;
+    QElapsedTimer replayClock;
+    double replaySpeed;
+    QByteArray replayLine;
+    qint64 replayTime;
+    qint64 replayFirstTime;
+    qint64 replayedLines;
+    bool replayPending;
+    int keepAliveInterval;
+    QElapsedTimer keepAliveClock;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Communications Link to the remote unit.
+
+Created by the user interface for a connection. The serial port or socket is
+handled on a dedicated I/O thread, and records received are taken from the
+queue when recordsAvailable is signalled. Writes can be made from the user
+interface and are passed to the I/O thread.
+*/
+
+class PowerManagementComms : public QObject
+{
+    Q_OBJECT
+public:
+    PowerManagementComms(QObject* parent = 0);
+    ~PowerManagementComms();
+    bool openSerial(const QString& device, int baudrate);
+    bool connectToHost(const QString& address, int port);
+    void requestConnection(const QString& address, int port);
+    void setKeepAliveInterval(int interval);
+    bool openReplay(const QString& fileName, double speed);
+    void write(const char* data);
+    bool readRecord(CommsRecord* record);
+    void clearNotify();
+signals:
+    void recordsAvailable();
+    void replayEnded(qint64 lines);
+private:
+    QThread ioThread;
+    CommsQueue queue;
+    CommsWorker* worker;
+};
+
+#endif
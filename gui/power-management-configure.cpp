@@ -51,21 +51,14 @@ algorithmic configurations, calibration and general operational configuration.
 //-----------------------------------------------------------------------------
 /** Power Management Configuration Window Constructor
 
-@param[in] socket TCP Socket object pointer
+@param[in] socket Communications link to the remote unit
 @param[in] parent Parent widget.
 */
 
-#ifdef SERIAL
-PowerManagementConfigGui::PowerManagementConfigGui(QSerialPort* p, QWidget* parent)
+PowerManagementConfigGui::PowerManagementConfigGui(PowerManagementComms* p, QWidget* parent)
                                                     : QDialog(parent)
 {
     socket = p;
-#else
-PowerManagementConfigGui::PowerManagementConfigGui(QTcpSocket* tcpSocket, QWidget* parent)
-                                                    : QDialog(parent)
-{
-    socket = tcpSocket;
-#endif
 // Build the User Interface display from the Ui class in ui_mainwindowform.h
     PowerManagementConfigUi.setupUi(this);
     PowerManagementConfigUi.battery1AbsorptionCurrent->setDecimals(2);
@@ -700,52 +693,51 @@ void PowerManagementConfigGui::on_closeButton_clicked()
 }
 
 //-----------------------------------------------------------------------------
-/** @brief Process a Message.
+/** @brief Process a Record.
 
-After a command is sent, response messages from the remote are passed here for
-processing. Appropriate fields on the form are updated.
+After a command is sent, response records from the remote are passed here
+already decoded, and appropriate fields on the form are updated. Only the
+version strings and the system time are taken from the text of the line.
 
 The message type can be p (parameter) or one of three cases d (data message).
 The function doesn't check the type, only the command.
 
-@todo This interprets response as done in main. See if this can be made
-independent of formats.
+@param CommsRecord record: the line received and its decoded fields.
 */
 
-void PowerManagementConfigGui::onMessageReceived(const QString &response)
+void PowerManagementConfigGui::onRecordReceived(const CommsRecord& record)
 {
-    QStringList breakdown = response.split(",");
-    int size = breakdown.size();
-    if (size <= 0) return;
-    QChar command = breakdown[0].at(1);
+    const ResponseFields& fields = record.fields;
+    int size = fields.size;
+    char command = fields.identifier[1];
 // Check for ident response
     if (command == 'E')
     {
-        if (size != 4) return;
+        QStringList breakdown = record.line.split(",");
+        if (breakdown.size() != 4) return;
         PowerManagementConfigUi.firmwareVersion->setText(breakdown[2]);
         PowerManagementConfigUi.boardVersion->setText("Interface Board Version: " + breakdown[3]);
         return;
     }
-    QChar battery = breakdown[0].at(2);
-    QChar parameter = breakdown[0].at(2);
-    int controlByte = 0;
-    if (size > 1) controlByte = breakdown[1].simplified().toInt();
+    char battery = fields.identifier[2];
+    char parameter = fields.identifier[2];
+    int controlByte = fields.field[1];
 // Error Code
-    switch (command.toLatin1())
+    switch (command)
     {
 // Show Measured Quiescent Current
         case 'Q':
         {
             if (size < 2) break;
-            quiescentCurrent = breakdown[1].simplified();
-            int test = breakdown[2].simplified().toInt();
+            quiescentCurrent = fields.field[1];
+            int test = fields.field[2];
             if (test < 6)
                 PowerManagementConfigUi.calibrateProgressBar->setValue(test+1);
             else
             {
                 PowerManagementConfigUi.quiescentCurrent
-                        ->setText(QString("%1 A").arg(quiescentCurrent.
-                                  toFloat()/256,0,'f',3));
+                        ->setText(QString("%1 A").arg((float)quiescentCurrent/256,
+                                  0,'f',3));
                 this->setEnabled(true);
                 PowerManagementConfigUi.calibrateProgressBar->setVisible(false);
                 PowerManagementConfigUi.calibrateProgressBar->setValue(0);
@@ -756,8 +748,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
         case 'R':
         {
             if (size < 2) break;
-            QString batteryResistance = QString("%1 m").arg(breakdown[1]
-                                         .simplified().toFloat()/65.536,0,'f',0)
+            QString batteryResistance = QString("%1 m")
+                                         .arg((float)fields.field[1]/65.536,0,'f',0)
                                          .append(QChar(0x03A9));
             if (battery == '1')
                 PowerManagementConfigUi.battery1Resistance
@@ -774,8 +766,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
         case 'T':
         {
             if (size < 3) break;
-            int batteryType = breakdown[1].simplified().toInt();
-            int batteryCapacity = breakdown[2].simplified().toInt();
+            int batteryType = fields.field[1];
+            int batteryCapacity = fields.field[2];
             if (battery == '1')
             {
                 PowerManagementConfigUi.battery1TypeCombo
@@ -803,8 +795,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
         case 'A':
         {
             if (size < 3) break;
-            float absorptionVoltage = breakdown[2].simplified().toFloat()/256;
-            float bulkCurrentScale = breakdown[1].simplified().toFloat();
+            float absorptionVoltage = (float)fields.field[2]/256;
+            float bulkCurrentScale = (float)fields.field[1];
             if (battery == '1')
             {
                 PowerManagementConfigUi.battery1AbsorptionVoltage
@@ -838,8 +830,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
         case 'F':
         {
             if (size < 3) break;
-            float floatVoltage = breakdown[2].simplified().toFloat()/256;
-            float floatCurrentScale = breakdown[1].simplified().toFloat();
+            float floatVoltage = (float)fields.field[2]/256;
+            float floatCurrentScale = (float)fields.field[1];
             if (battery == '1')
             {
                 PowerManagementConfigUi.battery1FloatVoltage
@@ -889,8 +881,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
         case 'H':
         {
             if (size < 2) break;
-            QDateTime systemTime =
-                QDateTime::fromString(breakdown[1].simplified(),Qt::ISODate);
+            QDateTime systemTime = QDateTime::fromString(
+                record.line.section(',',1,1).simplified(),Qt::ISODate);
             PowerManagementConfigUi.date->setText(systemTime.date().toString("dd.MM.yyyy"));
             PowerManagementConfigUi.time->setText(systemTime.time().toString("H.mm.ss"));
             break;
@@ -971,8 +963,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
 // Low voltage and critical voltage thresholds.
             if (parameter == 'V')
             {
-                float lowVoltage = (float)breakdown[1].simplified().toInt()/256;
-                float criticalVoltage = (float)breakdown[2].simplified().toInt()/256;
+                float lowVoltage = (float)fields.field[1]/256;
+                float criticalVoltage = (float)fields.field[2]/256;
                 PowerManagementConfigUi.lowVoltageDoubleSpinBox
                     ->setValue(lowVoltage);
                 PowerManagementConfigUi.criticalVoltageDoubleSpinBox
@@ -981,8 +973,8 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
 // Low SoC and critical SoC thresholds.
             else if (parameter == 'S')
             {
-                int lowSoC = (float)breakdown[1].simplified().toInt()/256;
-                int criticalSoC = (float)breakdown[2].simplified().toInt()/256;
+                int lowSoC = (float)fields.field[1]/256;
+                int criticalSoC = (float)fields.field[2]/256;
                 PowerManagementConfigUi.lowSoCSpinBox
                     ->setValue(lowSoC);
                 PowerManagementConfigUi.criticalSoCSpinBox
@@ -992,7 +984,7 @@ void PowerManagementConfigGui::onMessageReceived(const QString &response)
 battery; bit 1 is to maintain an isolated battery in normal conditions. */
             else if (parameter == 's')
             {
-                int monitorStrategy = (float)breakdown[1].simplified().toInt();
+                int monitorStrategy = fields.field[1];
                 bool separateLoad = (monitorStrategy & 1) > 0;
                 PowerManagementConfigUi.loadChargeCheckBox
                     ->setChecked(separateLoad);
@@ -1008,8 +1000,8 @@ battery; bit 1 is to maintain an isolated battery in normal conditions. */
             if (size < 3) break;
             if (parameter == 'R')
             {
-                int restTime = (float)breakdown[1].simplified().toInt();
-                int absorptionTime = (float)breakdown[2].simplified().toInt();
+                int restTime = fields.field[1];
+                int absorptionTime = fields.field[2];
                 PowerManagementConfigUi.restTimeSpinBox
                     ->setValue(restTime);
                 PowerManagementConfigUi.absorptionTimeSpinBox
@@ -1017,14 +1009,14 @@ battery; bit 1 is to maintain an isolated battery in normal conditions. */
             }
             else if (parameter == 'D')
             {
-                int dutyCycleMin = (float)breakdown[1].simplified().toInt()/256;
+                int dutyCycleMin = (float)fields.field[1]/256;
                 PowerManagementConfigUi.minimumDutyCycleSpinBox
                     ->setValue(dutyCycleMin);
             }
             else if (parameter == 'F')
             {
-                int floatTime = (float)breakdown[1].simplified().toInt();
-                int floatSoC = (float)breakdown[2].simplified().toInt()/256;
+                int floatTime = fields.field[1];
+                int floatSoC = (float)fields.field[2]/256;
                 PowerManagementConfigUi.floatDelaySpinBox
                     ->setValue(floatTime);
                 PowerManagementConfigUi.floatBulkSoCSpinBox
@@ -1033,7 +1025,7 @@ battery; bit 1 is to maintain an isolated battery in normal conditions. */
 /* Charger strategy byte. Bit 0 is to suppress the absortion phase for EMI. */
             else if (parameter == 's')
             {
-                int chargerStrategy = (float)breakdown[1].simplified().toInt();
+                int chargerStrategy = fields.field[1];
                 bool suppressAbsorptionPhase = (chargerStrategy & 1) > 0;
                 PowerManagementConfigUi.absorptionMuteCheckbox
                     ->setChecked(suppressAbsorptionPhase);
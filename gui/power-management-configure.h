@@ -30,6 +30,7 @@
 #define _TTY_POSIX_
 
 #include "power-management.h"
+#include "power-management-comms.h"
 #include "ui_power-management-configure.h"
 #include <QSerialPort>
 #include <QSerialPortInfo>
@@ -46,11 +47,7 @@ class PowerManagementConfigGui : public QDialog
 {
     Q_OBJECT
 public:
-#ifdef SERIAL
-    PowerManagementConfigGui(QSerialPort*, QWidget* parent = 0);
-#else
-    PowerManagementConfigGui(QTcpSocket* socket, QWidget* parent = 0);
-#endif
+    PowerManagementConfigGui(PowerManagementComms* socket, QWidget* parent = 0);
     ~PowerManagementConfigGui();
     QString error();
 private slots:
@@ -77,19 +74,15 @@ private slots:
     void on_setTrackOptionButton_clicked();
     void on_setChargeOptionButton_clicked();
     void on_absorptionMuteCheckbox_clicked();
-    void onMessageReceived(const QString &text);
+    void onRecordReceived(const CommsRecord& record);
     void displayErrorMessage(const QString message);
 private:
 // User Interface object instance
     Ui::PowerManagementConfigDialog PowerManagementConfigUi;
-#ifdef SERIAL
-    QSerialPort *socket;           //!< Serial port object pointer
-#else
-    QTcpSocket *socket;
-#endif
+    PowerManagementComms* socket;  //!< Serial port or TCP socket on its I/O thread
     QString errorMessage;
     QString response;           // String to build a line of characters
-    QString quiescentCurrent;
+    int quiescentCurrent;
 };
 
 #endif
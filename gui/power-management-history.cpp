@@ -0,0 +1,196 @@
+/*       Power Management Monitor History
+
+Measurements of each monitor frame are held in a circular array for each
+channel, together with minimum and maximum values over buckets of increasing
+length. This lets the monitor window show anything from a few minutes to the
+whole history with about the same amount of work.
+
+@date 16 October 2026
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-history.h"
+#include <QtGlobal>
+
+// Number of frames in each bucket of an aggregate level
+#define bucketShift(level) (HISTORY_LEVEL_SHIFT*((level)+1))
+
+//-----------------------------------------------------------------------------
+/** @brief Monitor History Constructor
+
+All storage is allocated here so that appending never allocates.
+*/
+
+MonitorHistory::MonitorHistory() : frames(0)
+{
+    for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+    {
+        data[channel] = new float[HISTORY_POINTS];
+        pending[channel] = 0;
+        for (int level=0; level<HISTORY_LEVELS; level++)
+        {
+            int buckets = HISTORY_POINTS >> bucketShift(level);
+            minimum[level][channel] = new float[buckets];
+            maximum[level][channel] = new float[buckets];
+        }
+    }
+}
+
+MonitorHistory::~MonitorHistory()
+{
+    for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+    {
+        delete[] data[channel];
+        for (int level=0; level<HISTORY_LEVELS; level++)
+        {
+            delete[] minimum[level][channel];
+            delete[] maximum[level][channel];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set a Value for the Frame being Collected
+
+A channel that is not set in a frame keeps its value from the previous frame.
+
+@param[in] int channel: channel number.
+@param[in] float value: measured value.
+*/
+
+void MonitorHistory::setValue(int channel, float value)
+{
+    if ((channel >= 0) && (channel < HISTORY_CHANNELS))
+        pending[channel] = value;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Append the Collected Frame
+
+The values are written to each channel and folded into the bucket of each
+aggregate level that the frame falls in. A bucket is started afresh by the
+first frame that falls in it, overwriting the oldest bucket in the level.
+*/
+
+void MonitorHistory::commitFrame()
+{
+    int index = frames & (HISTORY_POINTS-1);
+    for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        data[channel][index] = pending[channel];
+    for (int level=0; level<HISTORY_LEVELS; level++)
+    {
+        int shift = bucketShift(level);
+        int slot = (frames >> shift) & ((HISTORY_POINTS >> shift)-1);
+        bool start = ((frames & ((1 << shift)-1)) == 0);
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        {
+            float value = pending[channel];
+            float* low = &minimum[level][channel][slot];
+            float* high = &maximum[level][channel][slot];
+            if (start || (value < *low)) *low = value;
+            if (start || (value > *high)) *high = value;
+        }
+    }
+    frames++;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief The Oldest Frame Held
+
+@returns qint64 the number of the oldest frame still in the history.
+*/
+
+qint64 MonitorHistory::first() const
+{
+    if (frames > HISTORY_POINTS) return frames - HISTORY_POINTS;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief The Value of a Channel in a Frame
+
+@param[in] int channel: channel number.
+@param[in] qint64 frame: frame number, between first() and count()-1.
+@returns float the value.
+*/
+
+float MonitorHistory::value(int channel, qint64 frame) const
+{
+    return data[channel][frame & (HISTORY_POINTS-1)];
+}
+
+//-----------------------------------------------------------------------------
+/** @brief The Extremes of a Channel over a Span of Frames
+
+The span is covered from start to end by the longest aggregate bucket that
+starts at each point and lies within the span, and by single frames where no
+bucket fits. The newest bucket of each level holds only the frames appended so
+far, so it can be used whenever the span runs to the latest frame.
+
+@param[in] int channel: channel number.
+@param[in] qint64 from: first frame of the span.
+@param[in] qint64 to: frame after the end of the span.
+@param[out] float* low: the minimum value.
+@param[out] float* high: the maximum value.
+@returns bool false if none of the span is held.
+*/
+
+bool MonitorHistory::extremes(int channel, qint64 from, qint64 to,
+                              float* low, float* high) const
+{
+    if ((channel < 0) || (channel >= HISTORY_CHANNELS)) return false;
+    if (from < first()) from = first();
+    if (to > frames) to = frames;
+    bool found = false;
+    qint64 frame = from;
+    while (frame < to)
+    {
+        int level = HISTORY_LEVELS-1;
+        qint64 size = 1;
+        while (level >= 0)
+        {
+            size = qint64(1) << bucketShift(level);
+            if (((frame & (size-1)) == 0) &&
+                ((frame+size <= to) || (to == frames))) break;
+            level--;
+        }
+        float bucketLow, bucketHigh;
+        if (level < 0)
+        {
+            bucketLow = bucketHigh = value(channel, frame);
+            size = 1;
+        }
+        else
+        {
+            int shift = bucketShift(level);
+            int slot = (frame >> shift) & ((HISTORY_POINTS >> shift)-1);
+            bucketLow = minimum[level][channel][slot];
+            bucketHigh = maximum[level][channel][slot];
+        }
+        if (! found || (bucketLow < *low)) *low = bucketLow;
+        if (! found || (bucketHigh > *high)) *high = bucketHigh;
+        found = true;
+        frame += size;
+    }
+    return found;
+}
@@ -0,0 +1,79 @@
+/*          Power Management GUI Monitor History Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef POWER_MANAGEMENT_HISTORY_H
+#define POWER_MANAGEMENT_HISTORY_H
+
+#include <QtGlobal>
+
+// Channels held: current and voltage of each source, then the temperature
+#define HISTORY_CHANNELS    13
+#define HISTORY_TEMPERATURE 12
+// Frames held for each channel, about 36 hours at the firmware rate (power of 2)
+#define HISTORY_POINTS      262144
+// Levels of min/max aggregates, each with buckets 16 times longer than the last
+#define HISTORY_LEVELS      3
+#define HISTORY_LEVEL_SHIFT 4
+
+//-----------------------------------------------------------------------------
+/** @brief Monitor History.
+
+Holds the measurements of every channel for each monitor frame, so that the
+monitor window can scroll back over a day or more. Each channel is stored in
+its own circular array, so that appending a frame writes one value per channel
+and reading a channel over time runs through contiguous memory.
+
+For each channel a set of minimum and maximum values is also kept over buckets
+of 16, 256 and 4096 frames, updated as each frame is appended. The extremes of
+a long span are found from the longest buckets that fit in it, so the work done
+does not grow with the length of the span.
+
+Frames are numbered from zero when the history is created. Only the last
+HISTORY_POINTS frames are held.
+*/
+
+class MonitorHistory
+{
+public:
+    MonitorHistory();
+    ~MonitorHistory();
+    void setValue(int channel, float value);
+    void commitFrame();
+    qint64 count() const { return frames; }
+    qint64 first() const;
+    float value(int channel, qint64 frame) const;
+    bool extremes(int channel, qint64 from, qint64 to,
+                  float* low, float* high) const;
+private:
+    float* data[HISTORY_CHANNELS];
+    float* minimum[HISTORY_LEVELS][HISTORY_CHANNELS];
+    float* maximum[HISTORY_LEVELS][HISTORY_CHANNELS];
+    float pending[HISTORY_CHANNELS];
+    qint64 frames;
+};
+
+#endif
@@ -0,0 +1,341 @@
+/*       Power Management Session Log
+
+Lines received from the remote unit are saved by a writer on a dedicated
+thread. The user interface only adds each line to a lock-free queue, and the
+writer takes them in batches, flushing and synchronising the file at intervals
+so that a long capture does not cost a system call for every line.
+
+@date 16 October 2026
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-log.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QMetaObject>
+#include <QDebug>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------
+/** @brief Log Queue Constructor
+*/
+
+LogQueue::LogQueue() : head(0), tail(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add a line to the queue
+
+Called only from the user interface thread.
+
+@param[in] LogLine line: the line to be added.
+@returns bool false if the queue is full.
+*/
+
+bool LogQueue::push(const LogLine& line)
+{
+    int position = tail.loadAcquire();
+    int next = (position+1) & (LOG_QUEUE_SIZE-1);
+    if (next == head.loadAcquire()) return false;
+    lines[position] = line;
+    tail.storeRelease(next);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Take a line from the queue
+
+Called only from the log thread.
+
+@param[out] LogLine* line: the line taken.
+@returns bool false if the queue is empty.
+*/
+
+bool LogQueue::pop(LogLine* line)
+{
+    int position = head.loadAcquire();
+    if (position == tail.loadAcquire()) return false;
+    *line = lines[position];
+    lines[position].line = QByteArray();
+    head.storeRelease((position+1) & (LOG_QUEUE_SIZE-1));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Log Writer Constructor
+
+@param[in] LogQueue* queue: queue from which lines are written.
+*/
+
+LogWorker::LogWorker(LogQueue* lineQueue) : QObject(0)
+{
+    queue = lineQueue;
+    file = NULL;
+    capture = NULL;
+    writeTimer = NULL;
+    format = textLog;
+    fileNumber = 0;
+    rotateSize = 0;
+    rotateTime = 0;
+    syncInterval = 0;
+}
+
+LogWorker::~LogWorker()
+{
+    closeFile();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open the log file
+
+Any file already open is closed first.
+
+@param[in] QString fileName: name of the first file.
+@param[in] int format: textLog or captureLog.
+@param[in] qint64 size: size in bytes to start a new file, 0 for never.
+@param[in] int time: time in s to start a new file, 0 for never.
+@param[in] int interval: time in s between syncs to disk, 0 for never.
+@returns bool true if the file was opened.
+*/
+
+bool LogWorker::openFile(const QString& fileName, int fileFormat, qint64 size,
+                         int time, int interval)
+{
+    closeFile();
+    baseName = fileName;
+    format = fileFormat;
+    fileNumber = 0;
+    rotateSize = size;
+    rotateTime = time;
+    syncInterval = interval;
+    if (! openNext()) return false;
+    writeTimer = new QTimer(this);
+    connect(writeTimer, SIGNAL(timeout()), this, SLOT(writeLines()));
+    writeTimer->start(LOG_WRITE_INTERVAL);
+    flushTime.start();
+    syncTime.start();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write the remaining lines and close the log file
+*/
+
+void LogWorker::closeFile()
+{
+    if (file == NULL) return;
+    delete writeTimer;
+    writeTimer = NULL;
+    writeLines();
+    endFile();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Write the waiting lines
+
+The file is flushed and synchronised when their intervals have passed, and a
+new file is started when the size or time limit has been reached.
+*/
+
+void LogWorker::writeLines()
+{
+    if (file == NULL) return;
+    LogLine line;
+    while (queue->pop(&line))
+    {
+        if (capture != NULL)
+        {
+            capture->add(line.line,line.tick);
+            continue;
+        }
+        line.line.append("\r\n");
+        if (file->write(line.line) < 0)
+            qDebug() << "Save file write failed" << file->errorString();
+    }
+    if (flushTime.elapsed() >= LOG_FLUSH_INTERVAL)
+    {
+        file->flush();
+        flushTime.restart();
+    }
+    if ((syncInterval > 0) && (syncTime.elapsed() >= syncInterval*1000))
+    {
+        if (capture != NULL) capture->writeBlock();
+        file->flush();
+        fsync(file->handle());
+        syncTime.restart();
+    }
+    if (((rotateSize > 0) && (file->pos() >= rotateSize)) ||
+        ((rotateTime > 0) && (fileTime.elapsed() >= (qint64)rotateTime*1000)))
+    {
+        endFile();
+// The timer may be the sender of this call, so it is not deleted here
+        if (! openNext() && (writeTimer != NULL))
+        {
+            writeTimer->stop();
+            writeTimer->deleteLater();
+            writeTimer = NULL;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open the next file of the log
+
+The first file has the name given. Later files have a number added to the
+base of the name.
+
+@returns bool true if the file was opened.
+*/
+
+bool LogWorker::openNext()
+{
+    QString fileName = baseName;
+    if (fileNumber > 0)
+    {
+        QFileInfo fileInfo(baseName);
+        QString name = QString("%1-%2").arg(fileInfo.completeBaseName())
+                                       .arg(fileNumber,3,10,QChar('0'));
+        if (! fileInfo.suffix().isEmpty()) name.append('.').append(fileInfo.suffix());
+        fileName = fileInfo.dir().filePath(name);
+    }
+    fileNumber++;
+    file = new QFile(fileName);
+    if (! file->open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Could not open save file" << fileName;
+        delete file;
+        file = NULL;
+        return false;
+    }
+    if (format == captureLog)
+    {
+        capture = new CaptureWriter(file);
+        if (! capture->start())
+            qDebug() << "Save file write failed" << file->errorString();
+    }
+    fileTime.start();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Flush, synchronise and close the current file
+*/
+
+void LogWorker::endFile()
+{
+    if (file == NULL) return;
+    delete capture;
+    capture = NULL;
+    file->flush();
+    if (syncInterval > 0) fsync(file->handle());
+    file->close();
+    delete file;
+    file = NULL;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Session Log Constructor
+
+The log thread is started, with no file open.
+
+@param[in] parent Parent object.
+*/
+
+SessionLog::SessionLog(QObject* parent) : QObject(parent)
+{
+    opened = false;
+    dropped = 0;
+    worker = new LogWorker(&queue);
+    worker->moveToThread(&logThread);
+// The worker is deleted on the log thread, with its file, as the thread ends
+    connect(&logThread, SIGNAL(finished()), worker, SLOT(deleteLater()));
+    logThread.start();
+}
+
+SessionLog::~SessionLog()
+{
+    close();
+    logThread.quit();
+    logThread.wait();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open the log file on the log thread
+
+@param[in] QString fileName: name of the first file.
+@param[in] LogFormat format: text lines or compressed capture.
+@param[in] qint64 rotateSize: size in bytes to start a new file, 0 for never.
+@param[in] int rotateTime: time in s to start a new file, 0 for never.
+@param[in] int syncInterval: time in s between syncs to disk, 0 for never.
+@returns bool true if the file was opened.
+*/
+
+bool SessionLog::open(const QString& fileName, LogFormat format,
+                      qint64 rotateSize, int rotateTime, int syncInterval)
+{
+    close();
+    dropped = 0;
+    QMetaObject::invokeMethod(worker, "openFile",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, opened),
+                              Q_ARG(QString, fileName),
+                              Q_ARG(int, format),
+                              Q_ARG(qint64, rotateSize),
+                              Q_ARG(int, rotateTime),
+                              Q_ARG(int, syncInterval));
+    return opened;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Close the log file
+
+Waits until the lines already queued have been written.
+*/
+
+void SessionLog::close()
+{
+    if (! opened) return;
+    QMetaObject::invokeMethod(worker, "closeFile",
+                              Qt::BlockingQueuedConnection);
+    opened = false;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Queue a line to be written
+
+@param[in] QString line: the line, without a line ending.
+@param[in] qint64 tick: monotonic time in ms when the line was received.
+@returns bool false if the line was dropped because the writer is behind.
+*/
+
+bool SessionLog::write(const QString& line, qint64 tick)
+{
+    if (! opened) return false;
+    LogLine logLine;
+    logLine.line = line.toLocal8Bit();
+    logLine.tick = tick;
+    if (queue.push(logLine)) return true;
+    dropped++;
+    return false;
+}
@@ -0,0 +1,159 @@
+/*          Power Management GUI Session Log Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef POWER_MANAGEMENT_LOG_H
+#define POWER_MANAGEMENT_LOG_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "power-management-capture.h"
+
+// Number of lines that can wait to be written (power of two)
+#define LOG_QUEUE_SIZE 8192
+// Interval in ms at which waiting lines are written
+#define LOG_WRITE_INTERVAL 250
+// Interval in ms at which written lines are passed to the system
+#define LOG_FLUSH_INTERVAL 1000
+// Interval in s at which the file is synchronised to the disk, 0 for never
+#define LOG_SYNC_INTERVAL 30
+// File size in bytes at which a new file is started, 0 for never
+#define LOG_ROTATE_SIZE 0
+// Time in s after which a new file is started, 0 for never
+#define LOG_ROTATE_TIME 0
+
+// Save file formats
+typedef enum {textLog, captureLog} LogFormat;
+
+//-----------------------------------------------------------------------------
+/** @brief A line waiting to be saved with the time it was received.
+*/
+
+typedef struct
+{
+    QByteArray line;
+    qint64 tick;                // monotonic ms
+} LogLine;
+
+//-----------------------------------------------------------------------------
+/** @brief Queue of lines from the user interface to the log writer.
+
+There is a single producer and a single consumer, each of which only moves its
+own end of the queue, so no lock is needed.
+*/
+
+class LogQueue
+{
+public:
+    LogQueue();
+    bool push(const LogLine& line);
+    bool pop(LogLine* line);
+private:
+    LogLine lines[LOG_QUEUE_SIZE];
+    QAtomicInt head;
+    QAtomicInt tail;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Log Writer.
+
+Lives in the log thread and owns the file. Waiting lines are written in a batch
+at each write interval, and the file is flushed and synchronised at longer
+intervals. A new numbered file is started when the size or time limit is
+reached.
+
+A capture file is written in compressed blocks. A part block is written when
+the file is synchronised, so that no more than that interval is lost if the
+program stops.
+*/
+
+class LogWorker : public QObject
+{
+    Q_OBJECT
+public:
+    LogWorker(LogQueue* queue);
+    ~LogWorker();
+public slots:
+    bool openFile(const QString& fileName, int format, qint64 size, int time,
+                  int interval);
+    void closeFile();
+private slots:
+    void writeLines();
+private:
+    bool openNext();
+    void endFile();
+    LogQueue* queue;
+    QFile* file;
+    CaptureWriter* capture;
+    QTimer* writeTimer;
+    int format;
+    QString baseName;
+    int fileNumber;
+    qint64 rotateSize;
+    int rotateTime;
+    int syncInterval;
+    QElapsedTimer fileTime;
+    QElapsedTimer flushTime;
+    QElapsedTimer syncTime;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Session Log.
+
+Lines received during a session are saved to a file by a writer on its own
+thread, so that a slow disk does not hold up the user interface. Lines are
+dropped and counted if the writer falls behind by more than the queue.
+*/
+
+class SessionLog : public QObject
+{
+    Q_OBJECT
+public:
+    SessionLog(QObject* parent = 0);
+    ~SessionLog();
+    bool open(const QString& fileName, LogFormat format = textLog,
+              qint64 rotateSize = LOG_ROTATE_SIZE,
+              int rotateTime = LOG_ROTATE_TIME,
+              int syncInterval = LOG_SYNC_INTERVAL);
+    void close();
+    bool isOpen() const { return opened; }
+    bool write(const QString& line, qint64 tick);
+    quint32 droppedLines() const { return dropped; }
+private:
+    QThread logThread;
+    LogQueue queue;
+    LogWorker* worker;
+    bool opened;
+    quint32 dropped;
+};
+
+#endif
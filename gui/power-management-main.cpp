@@ -58,6 +58,7 @@ socat /dev/ttyUSB0,echo=0,ispeed=115200,ospeed=115200,raw tcp-l:6666,reuseaddr,f
 #include <QFileInfo>
 #include <QDebug>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <unistd.h>
 
@@ -66,10 +67,21 @@ const qint32 bauds[8] = {1200,2400,4800,9600,19200,38400,57600,115200};
 //-----------------------------------------------------------------------------
 /** Power Management Main Window Constructor
 
+If a replay file is given, the saved session is replayed in place of a
+connection to the remote unit.
+
+@param[in] device Serial port or TCP address.
+@param[in] parameter Baud rate index or TCP port.
+@param[in] replayFile Saved session to be replayed, or empty.
+@param[in] replaySpeed Times faster than received, 0 for as fast as possible.
+@param[in] rotateSize Size in bytes to start a new save file, 0 for never.
+@param[in] rotateTime Time in s to start a new save file, 0 for never.
 @param[in] parent Parent widget.
 */
 
 PowerManagementGui::PowerManagementGui(QString device, uint parameter,
+                                       QString replayFile, double replaySpeed,
+                                       qint64 rotateSize, int rotateTime,
                                        QWidget* parent) : QDialog(parent)
 {
 // Build the User Interface display from the Ui class in ui_mainwindowform.h
@@ -77,15 +89,31 @@ PowerManagementGui::PowerManagementGui(QString device, uint parameter,
     initMainWindow(PowerManagementMainUi);
 
     saveFile.clear();
-    response.clear();
+    saveLog = new SessionLog(this);
+    cardListing.changes = -1;
+    saveRotateSize = rotateSize;
+    saveRotateTime = rotateTime;
+    tick.start();
+
+// Received values are shown together at the display refresh interval
+    memset(&displayState,0,sizeof(displayState));
+    displayPending = false;
+    historyPending = false;
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(DISPLAY_REFRESH);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refreshDisplay()));
 
     socket = NULL;
+    replaying = false;
+    replayRecords = 0;
+    rateRecords = 0;
 #ifdef SERIAL
     baudrate = parameter;
     serialDevice = device;
     setSourceComboBox(0);
 /* Create serial port if it has been specified, otherwise leave to the GUI. */
-    on_connectButton_clicked();
+    if (replayFile.isEmpty()) on_connectButton_clicked();
 #else
 // Query the TCP socket to establish a connection
     connectAddress = device;
@@ -94,8 +122,29 @@ PowerManagementGui::PowerManagementGui(QString device, uint parameter,
     PowerManagementMainUi.tcpAddressEdit->setText(connectAddress);
     PowerManagementMainUi.tcpPortEdit->setText(QString("%1").arg(connectPort));
 /* Open TCP port if it has been specified, otherwise leave to the GUI. */
-    if (! connectAddress.isEmpty()) on_connectButton_clicked();
+    if (replayFile.isEmpty() && ! connectAddress.isEmpty())
+        on_connectButton_clicked();
 #endif
+/* Replay a saved session through the same path as received data. */
+    if (! replayFile.isEmpty())
+    {
+        socket = new PowerManagementComms(this);
+        connect(socket, SIGNAL(recordsAvailable()), this, SLOT(onDataAvailable()));
+        connect(socket, SIGNAL(replayEnded(qint64)), this, SLOT(onReplayEnded(qint64)));
+        if (socket->openReplay(replayFile,replaySpeed))
+        {
+            replaying = true;
+            replayClock.start();
+            rateClock.start();
+            PowerManagementMainUi.connectButton->setText("Disconnect");
+        }
+        else
+        {
+            delete socket;
+            socket = NULL;
+            displayErrorMessage("Unable to open the replay file");
+        }
+    }
     if (socket != NULL)
     {
 /* Turn on microcontroller communications */
@@ -246,1049 +295,634 @@ void PowerManagementGui::setSourceComboBox(int index)
 //-----------------------------------------------------------------------------
 /** @brief Handle incoming serial data
 
-This is called when data appears in the serial buffer. Data is pulled in until
-a newline occurs, at which point the assembled command QString is processed.
+This is called when records have been received. The lines are framed and
+decoded on the I/O thread, and here the waiting records are taken from the
+queue and processed.
 
 All incoming messages are processed here and passed to other windows as appropriate.
 */
 
 void PowerManagementGui::onDataAvailable()
 {
-#ifndef SERIAL
-    if (! validsocket()) return;
-#endif
-    QByteArray data = socket->readAll();
-    int n=0;
-    while (n < data.size())
+    if (socket == NULL) return;
+    socket->clearNotify();
+    CommsRecord record;
+    int count = 0;
+    while (socket->readRecord(&record))
     {
-        if ((data.at(n) != '\r') && (data.at(n) != '\n')) response += data.at(n);
-        if (data.at(n) == '\n')
-        {
-// The current time is saved to ms precision followed by the line.
-            tick.restart();
-            processResponse(response);
-            response.clear();
-        }
-        n++;
+        processResponse(record);
+        count++;
+    }
+// Show the rate at which records are being processed in the status line
+    if (! replaying) return;
+    replayRecords += count;
+    rateRecords += count;
+    qint64 elapsed = rateClock.elapsed();
+    if (elapsed >= 1000)
+    {
+        setLabelText(PowerManagementMainUi.errorLabel,
+                     QString("Replay: %1 records/s")
+                        .arg(rateRecords*1000/elapsed));
+        rateRecords = 0;
+        rateClock.restart();
     }
 }
 
+//-----------------------------------------------------------------------------
+/** @brief Report the end of a replay
+
+The totals are left in the status line.
+
+@param[in] qint64 lines: number of lines replayed.
+*/
+
+void PowerManagementGui::onReplayEnded(qint64 lines)
+{
+    replaying = false;
+    qint64 elapsed = replayClock.elapsed();
+    if (elapsed <= 0) elapsed = 1;
+    setLabelText(PowerManagementMainUi.errorLabel,
+                 QString("Replay ended: %1 lines, %2 records in %3 ms, "
+                         "%4 records/s").arg(lines).arg(replayRecords)
+                    .arg(elapsed).arg(replayRecords*1000/elapsed));
+}
+
 //-----------------------------------------------------------------------------
 /** @brief Process the incoming serial data
 
-Parse the line and take action on the command received.
+Take action on the command received.
+
+The line is dispatched on its identifier, packed into an integer, to the
+handler for that record. Records for the other windows are passed on already
+decoded.
+
+@param[in] CommsRecord record: the line received and its decoded fields.
 */
 
-void PowerManagementGui::processResponse(const QString response)
+void PowerManagementGui::processResponse(const CommsRecord& record)
 {
-    QStringList breakdown = response.split(",");
-    int size = breakdown.size();
-    QString firstField;
-    firstField = breakdown[0].simplified();
-    QString secondField;
-    if (size > 1) secondField = breakdown[1].simplified();
-    QString current, voltage;
-    if (! saveFile.isEmpty()) saveLine(response);
-/* When the time field is received, send back a short message to keep comms
-alive. Also check for calibration as time messages stop during this process. */
-    if ((size > 0) && ((firstField == "pH") || (firstField == "pQ")))
-    {
-        socket->write("pc+\n\r");
-    }
-// Load 1 current/voltage values
-    if ((size > 0) && (firstField == "dL1"))
+    const ResponseFields& fields = record.fields;
+    if (! saveFile.isEmpty()) saveLine(record.line);
+    switch (fields.code)
     {
-        getCurrentVoltage(breakdown,&current,&voltage);
-        if (PowerManagementMainUi.load1CheckBox->isChecked())
+/* The time field starts a new frame. The keep-alive reply has already been
+sent back by the I/O thread. */
+        case RESPONSE_CODE('p','H',0):
+        case RESPONSE_CODE('p','Q',0):
+// The values of the previous frame are complete. Its history frame is
+// normally committed by the temperature, but is committed here if that was lost.
+            if (historyPending) history.commitFrame();
+            historyPending = false;
+            refreshDisplay();
+            break;
+// Load, panel and battery current/voltage values
+        case RESPONSE_CODE('d','B','1'):
+            storeCurrentVoltage(battery1Source,record);
+            break;
+        case RESPONSE_CODE('d','B','2'):
+            storeCurrentVoltage(battery2Source,record);
+            break;
+        case RESPONSE_CODE('d','B','3'):
+            storeCurrentVoltage(battery3Source,record);
+            break;
+        case RESPONSE_CODE('d','L','1'):
+            storeCurrentVoltage(load1Source,record);
+            break;
+        case RESPONSE_CODE('d','L','2'):
+            storeCurrentVoltage(load2Source,record);
+            break;
+        case RESPONSE_CODE('d','M','1'):
+            storeCurrentVoltage(panelSource,record);
+            break;
+// Restore the current software settings.
+// Bit 0 = autotrack
+        case RESPONSE_CODE('d','D',0):
         {
-            if (testIndicator(load1UnderVoltage) || testIndicator(load1OverCurrent))
-            {
-                PowerManagementMainUi.load1Current->setText(QString("---"));
-                PowerManagementMainUi.load1Voltage->setText(QString("---"));
-            }
-            else
-            {
-                if (size > 1)
-                    PowerManagementMainUi.load1Current->setText(current);
-                if (size > 2)
-                    PowerManagementMainUi.load1Voltage->setText(voltage);
-            }
+            bool autoTrackOn = ((fields.field[1] & 0x01) > 0);
+            PowerManagementMainUi.autoTrackCheckBox->setChecked(autoTrackOn);
+            disableRadioButtons(autoTrackOn);
+            break;
         }
-        else
-        {
-            PowerManagementMainUi.load1Current->clear();
-            PowerManagementMainUi.load1Voltage->clear();
+// Upper case S is used for initialization and after calibration.
+// Lower case s is used for autotrack to allow switch settings to be observed.
+        case RESPONSE_CODE('d','S',0):
+            showSwitchSettings(fields.field[1],true);
+            break;
+        case RESPONSE_CODE('d','s',0):
+            showSwitchSettings(fields.field[1],false);
+            break;
+        case RESPONSE_CODE('d','I',0):
+            showIndicators(fields.field[1]);
+            requestRefresh();
+            break;
+/* Battery Fill, Health and Operational State Indicators */
+        case RESPONSE_CODE('d','O','1'):
+        case RESPONSE_CODE('d','O','2'):
+        case RESPONSE_CODE('d','O','3'):
+        {
+            int battery = fields.identifier[2] - '1';
+            displayState.stateValid[battery] = true;
+            displayState.batteryState[battery] = fields.field[1];
+            requestRefresh();
+            break;
         }
+/* SoC estimates */
+        case RESPONSE_CODE('d','C','1'):
+        case RESPONSE_CODE('d','C','2'):
+        case RESPONSE_CODE('d','C','3'):
+        {
+            int battery = fields.identifier[2] - '1';
+            displayState.chargeFields[battery] = fields.size;
+            displayState.charge[battery] = fields.field[1];
+            requestRefresh();
+            break;
+        }
+// The temperature is the last measurement of the frame, so completes it in the
+// history and lets the monitor window draw it.
+        case RESPONSE_CODE('d','T',0):
+            if (fields.size > 1)
+                history.setValue(HISTORY_TEMPERATURE,(float)fields.field[1]/256);
+            history.commitFrame();
+            historyPending = false;
+            emit this->monitorReceived(record);
+            displayState.temperatureFields = fields.size;
+            displayState.temperature = fields.field[1];
+            requestRefresh();
+            break;
     }
-// Load 2 current/voltage values
-    if ((size > 0) && (firstField == "dL2"))
+    char first = fields.identifier[0];
+    char second = fields.identifier[1];
+/* Messages for the File Task start with f */
+    if (first == 'f')
     {
-        getCurrentVoltage(breakdown,&current,&voltage);
-        if (PowerManagementMainUi.load2CheckBox->isChecked())
-        {
-            if (testIndicator(load2UnderVoltage) || testIndicator(load2OverCurrent))
-            {
-                PowerManagementMainUi.load2Current->setText(QString("---"));
-                PowerManagementMainUi.load2Voltage->setText(QString("---"));
-            }
-            else
-            {
-                if (size > 1)
-                    PowerManagementMainUi.load2Current->setText(current);
-                if (size > 2)
-                    PowerManagementMainUi.load2Voltage->setText(voltage);
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.load2Current->clear();
-            PowerManagementMainUi.load2Voltage->clear();
-        }
+        emit this->recordReceived(record);
     }
-// Panel current/voltage values
-    if ((size > 0) && (firstField == "dM1"))
+/* Messages for the Configure Task start with p or certain of the data responses */
+    if ((first == 'p') || ((first == 'd') &&
+        ((second == 'O') || (second == 'E') || (second == 'D'))))
     {
-        getCurrentVoltage(breakdown,&current,&voltage);
-        if (PowerManagementMainUi.panelCheckBox->isChecked())
-        {
-            if (testIndicator(panelUnderVoltage) || testIndicator(panelOverCurrent))
-            {
-                PowerManagementMainUi.panelCurrent->setText(QString("---"));
-                PowerManagementMainUi.panelVoltage->setText(QString("---"));
-            }
-            else
-            {
-                if (size > 1)
-                    PowerManagementMainUi.panelCurrent->setText(current);
-                if (size > 2)
-                    PowerManagementMainUi.panelVoltage->setText(voltage);
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.panelCurrent->clear();
-            PowerManagementMainUi.panelVoltage->clear();
-        }
+        emit this->configureReceived(record);
     }
-// Battery 1 current/voltage values
-    if ((size > 0) && (firstField == "dB1"))
+/* This allows debug messages to be displayed on the terminal. */
+    if (first == 'D')
     {
-        getCurrentVoltage(breakdown,&current,&voltage);
-        if (PowerManagementMainUi.battery1CheckBox->isChecked())
-        {
-            if (testIndicator(battery1UnderVoltage) || testIndicator(battery1OverCurrent))
-            {
-                PowerManagementMainUi.battery1Current->setText(QString("---"));
-                PowerManagementMainUi.battery1Voltage->setText(QString("---"));
-            }
-            else
-            {
-                if (size > 1)
-                    PowerManagementMainUi.battery1Current->setText(current);
-                if (size > 2)
-                    PowerManagementMainUi.battery1Voltage->setText(voltage);
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.battery1Current->clear();
-            PowerManagementMainUi.battery1Voltage->clear();
-        }
+        qDebug() << record.line;
+        if (! saveFile.isEmpty()) saveLine(record.line);
     }
-// Battery 2 current/voltage values
-    if ((size > 0) && (firstField == "dB2"))
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Store the Current and Voltage of a Load, Panel or Battery
+
+The values are added to the monitor history, and the record is sent on to the
+monitor window straight away. The values are shown in the main window at the
+next refresh. The frame is completed in the history by the temperature that
+follows the sources.
+
+@param[in] SourceType source: the load, panel or battery.
+@param[in] CommsRecord record: fields 1 - current, 2 - voltage.
+*/
+
+void PowerManagementGui::storeCurrentVoltage(const SourceType source,
+                                             const CommsRecord& record)
+{
+    const ResponseFields& fields = record.fields;
+    if (fields.size > 1)
+        history.setValue(2*source,(float)fields.field[1]/256);
+    if (fields.size > 2)
+        history.setValue(2*source+1,(float)fields.field[2]/256);
+    historyPending = true;
+    emit this->monitorReceived(record);
+    displayState.sourceFields[source] = fields.size;
+    displayState.current[source] = fields.field[1];
+    displayState.voltage[source] = fields.field[2];
+    requestRefresh();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start the display refresh timer if it is not already running
+
+Values arriving before the timer expires are all shown by the one refresh.
+*/
+
+void PowerManagementGui::requestRefresh()
+{
+    displayPending = true;
+    if (! refreshTimer->isActive()) refreshTimer->start();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the values received since the last refresh
+
+Called at the display refresh interval while values are arriving, and at the
+end of each frame of values from the microcontroller. Only labels whose text
+or style has changed are updated.
+*/
+
+void PowerManagementGui::refreshDisplay()
+{
+    refreshTimer->stop();
+    if (! displayPending) return;
+    displayPending = false;
+    for (int source=0; source<NUM_SOURCES; source++)
+        showCurrentVoltage((SourceType)source);
+    for (int battery=0; battery<3; battery++) showCharge(battery);
+    if (displayState.temperatureFields > 1)
+        setLabelText(PowerManagementMainUi.temperature,QString("%1")
+            .arg((float)displayState.temperature/256,0,'f',1)
+            .append(QChar(0x00B0)).append("C"));
+// A missing battery blanks its other values so is shown last
+    for (int battery=0; battery<3; battery++)
+        if (displayState.stateValid[battery])
+            showBatteryState(battery,displayState.batteryState[battery]);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the text and style of a label only if they have changed
+
+This avoids the label being laid out again when its value is unchanged.
+*/
+
+void PowerManagementGui::setLabelText(QLabel* label, const QString& text)
+{
+    if (label->text() != text) label->setText(text);
+}
+
+void PowerManagementGui::setLabelStyle(QLabel* label, const QString& style)
+{
+    if (label->styleSheet() != style) label->setStyleSheet(style);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the Current and Voltage of a Load, Panel or Battery
+
+@param[in] SourceType source: the load, panel or battery.
+*/
+
+void PowerManagementGui::showCurrentVoltage(const SourceType source)
+{
+    QCheckBox* enable[NUM_SOURCES] = {PowerManagementMainUi.battery1CheckBox,
+                                      PowerManagementMainUi.battery2CheckBox,
+                                      PowerManagementMainUi.battery3CheckBox,
+                                      PowerManagementMainUi.load1CheckBox,
+                                      PowerManagementMainUi.load2CheckBox,
+                                      PowerManagementMainUi.panelCheckBox};
+    QLabel* currentLabel[NUM_SOURCES] = {PowerManagementMainUi.battery1Current,
+                                         PowerManagementMainUi.battery2Current,
+                                         PowerManagementMainUi.battery3Current,
+                                         PowerManagementMainUi.load1Current,
+                                         PowerManagementMainUi.load2Current,
+                                         PowerManagementMainUi.panelCurrent};
+    QLabel* voltageLabel[NUM_SOURCES] = {PowerManagementMainUi.battery1Voltage,
+                                         PowerManagementMainUi.battery2Voltage,
+                                         PowerManagementMainUi.battery3Voltage,
+                                         PowerManagementMainUi.load1Voltage,
+                                         PowerManagementMainUi.load2Voltage,
+                                         PowerManagementMainUi.panelVoltage};
+    IndicatorType underVoltage[NUM_SOURCES] = {battery1UnderVoltage,
+                                               battery2UnderVoltage,
+                                               battery3UnderVoltage,
+                                               load1UnderVoltage,
+                                               load2UnderVoltage,
+                                               panelUnderVoltage};
+    IndicatorType overCurrent[NUM_SOURCES] = {battery1OverCurrent,
+                                              battery2OverCurrent,
+                                              battery3OverCurrent,
+                                              load1OverCurrent,
+                                              load2OverCurrent,
+                                              panelOverCurrent};
+    int size = displayState.sourceFields[source];
+    if (size == 0) return;
+    if (enable[source]->isChecked())
     {
-        getCurrentVoltage(breakdown,&current,&voltage);
-        if (PowerManagementMainUi.battery2CheckBox->isChecked())
+        if (testIndicator(underVoltage[source]) ||
+            testIndicator(overCurrent[source]))
         {
-            if (testIndicator(battery2UnderVoltage) || testIndicator(battery2OverCurrent))
-            {
-                PowerManagementMainUi.battery2Current->setText(QString("---"));
-                PowerManagementMainUi.battery2Voltage->setText(QString("---"));
-            }
-            else
-            {
-                if (size > 1)
-                    PowerManagementMainUi.battery2Current->setText(current);
-                if (size > 2)
-                    PowerManagementMainUi.battery2Voltage->setText(voltage);
-            }
+            setLabelText(currentLabel[source],QString("---"));
+            setLabelText(voltageLabel[source],QString("---"));
         }
         else
         {
-            PowerManagementMainUi.battery2Current->clear();
-            PowerManagementMainUi.battery2Voltage->clear();
+            if (size > 1) setLabelText(currentLabel[source],QString("%1")
+                .arg((float)displayState.current[source]/256,0,'f',2));
+            if (size > 2) setLabelText(voltageLabel[source],QString("%1")
+                .arg((float)displayState.voltage[source]/256,0,'f',2));
         }
     }
-// Battery 3 current/voltage values
-    if ((size > 0) && (firstField == "dB3"))
+    else
     {
-        getCurrentVoltage(breakdown,&current,&voltage);
-        if (PowerManagementMainUi.battery3CheckBox->isChecked())
-        {
-            if (testIndicator(battery3UnderVoltage) || testIndicator(battery3OverCurrent))
-            {
-                PowerManagementMainUi.battery3Current->setText(QString("---"));
-                PowerManagementMainUi.battery3Voltage->setText(QString("---"));
-            }
-            else
-            {
-                if (size > 1)
-                    PowerManagementMainUi.battery3Current->setText(current);
-                if (size > 2)
-                    PowerManagementMainUi.battery3Voltage->setText(voltage);
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.battery3Current->clear();
-            PowerManagementMainUi.battery3Voltage->clear();
-        }
+        setLabelText(currentLabel[source],QString());
+        setLabelText(voltageLabel[source],QString());
     }
-// Restore the current software settings.
-// Bit 0 = autotrack
-    if ((size > 0) && (firstField == "dD"))
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the Switch Settings
+
+Read all the microcontroller's switch settings and set display accordingly.
+
+For initialization, disable unused batteries and associated buttons, and set
+checkboxes. Otherwise the original settings of the checkboxes are preserved.
+
+@param[in] int settings: two bits each for load 1, load 2 and panel.
+@param[in] bool initial: true if the settings are being initialized.
+*/
+
+void PowerManagementGui::showSwitchSettings(const int settings,
+                                            const bool initial)
+{
+    unsigned int load1Setting = (settings & 0x03);
+    unsigned int load2Setting = ((settings >> 2) & 0x03);
+    unsigned int panelSetting = ((settings >> 4) & 0x03);
+    bool battery1Enabled = ((load1Setting == 1) || (load2Setting == 1)\
+                                   || (panelSetting == 1));
+    bool battery2Enabled = ((load1Setting == 2) || (load2Setting == 2)\
+                                   || (panelSetting == 2));
+    bool battery3Enabled = ((load1Setting == 3) || (load2Setting == 3)\
+                                   || (panelSetting == 3));
+// Disable a battery if none of the load/panels are selected for it
+    if (initial)
     {
-        bool autoTrackOn = ((secondField.toInt() & 0x01) > 0);
-        PowerManagementMainUi.autoTrackCheckBox->setChecked(autoTrackOn);
-        disableRadioButtons(autoTrackOn);
+        PowerManagementMainUi.battery1CheckBox->setChecked(battery1Enabled);
+        PowerManagementMainUi.battery2CheckBox->setChecked(battery2Enabled);
+        PowerManagementMainUi.battery3CheckBox->setChecked(battery3Enabled);
+        PowerManagementMainUi.load1Battery1->setEnabled(battery1Enabled);
+        PowerManagementMainUi.load1Battery2->setEnabled(battery2Enabled);
+        PowerManagementMainUi.load1Battery3->setEnabled(battery3Enabled);
+        PowerManagementMainUi.load2Battery1->setEnabled(battery1Enabled);
+        PowerManagementMainUi.load2Battery2->setEnabled(battery2Enabled);
+        PowerManagementMainUi.load2Battery3->setEnabled(battery3Enabled);
+        PowerManagementMainUi.panelBattery1->setEnabled(battery1Enabled);
+        PowerManagementMainUi.panelBattery2->setEnabled(battery2Enabled);
+        PowerManagementMainUi.panelBattery3->setEnabled(battery3Enabled);
+        PowerManagementMainUi.load1CheckBox->setChecked(true);
+        PowerManagementMainUi.load2CheckBox->setChecked(true);
+        PowerManagementMainUi.panelBattery1->setChecked(true);
     }
-// Read all the microcontroller's switch settings and set display accordingly
-// Upper case S is used for initialization and after calibration.
-// Disable unused batteries and associated buttons, and set checkboxes.
-// Lower case s is used for autotrack to allow switch settings to be observed.
-// In that case the original settings of the checkboxes are preserved.
-    if ((size > 0) && ((firstField == "dS") || (firstField == "ds")))
-    {
-        unsigned int settings = secondField.toInt();
-        unsigned int load1Setting = (settings & 0x03);
-        unsigned int load2Setting = ((settings >> 2) & 0x03);
-        unsigned int panelSetting = ((settings >> 4) & 0x03);
-        bool battery1Enabled = ((load1Setting == 1) || (load2Setting == 1)\
-                                       || (panelSetting == 1));
-        bool battery2Enabled = ((load1Setting == 2) || (load2Setting == 2)\
-                                       || (panelSetting == 2));
-        bool battery3Enabled = ((load1Setting == 3) || (load2Setting == 3)\
-                                       || (panelSetting == 3));
-// Disable a battery if none of the load/panels are selected for it
-        if (firstField == "dS")
-        {
-            PowerManagementMainUi.battery1CheckBox->setChecked(battery1Enabled);
-            PowerManagementMainUi.battery2CheckBox->setChecked(battery2Enabled);
-            PowerManagementMainUi.battery3CheckBox->setChecked(battery3Enabled);
-            PowerManagementMainUi.load1Battery1->setEnabled(battery1Enabled);
-            PowerManagementMainUi.load1Battery2->setEnabled(battery2Enabled);
-            PowerManagementMainUi.load1Battery3->setEnabled(battery3Enabled);
-            PowerManagementMainUi.load2Battery1->setEnabled(battery1Enabled);
-            PowerManagementMainUi.load2Battery2->setEnabled(battery2Enabled);
-            PowerManagementMainUi.load2Battery3->setEnabled(battery3Enabled);
-            PowerManagementMainUi.panelBattery1->setEnabled(battery1Enabled);
-            PowerManagementMainUi.panelBattery2->setEnabled(battery2Enabled);
-            PowerManagementMainUi.panelBattery3->setEnabled(battery3Enabled);
-        }
 // Set each of the switch settings
-        if (firstField == "dS")
-            PowerManagementMainUi.load1CheckBox->setChecked(true);
-        bool load1Battery1enabled = PowerManagementMainUi.load1Battery1->isEnabled();
-        bool load1Battery2enabled = PowerManagementMainUi.load1Battery2->isEnabled();
-        bool load1Battery3enabled = PowerManagementMainUi.load1Battery3->isEnabled();
-        PowerManagementMainUi.load1Battery1->setEnabled(true);
-        PowerManagementMainUi.load1Battery2->setEnabled(true);
-        PowerManagementMainUi.load1Battery3->setEnabled(true);
-        switch (load1Setting)
-        {
-// No battery allocated to load 1
-            case 0:
-                PowerManagementMainUi.load1Battery1->setAutoExclusive(false);
-                PowerManagementMainUi.load1Battery1->setChecked(false);
-                PowerManagementMainUi.load1Battery1->setAutoExclusive(true);
-                PowerManagementMainUi.load1Battery2->setAutoExclusive(false);
-                PowerManagementMainUi.load1Battery2->setChecked(false);
-                PowerManagementMainUi.load1Battery2->setAutoExclusive(true);
-                PowerManagementMainUi.load1Battery3->setAutoExclusive(false);
-                PowerManagementMainUi.load1Battery3->setChecked(false);
-                PowerManagementMainUi.load1Battery3->setAutoExclusive(true);
-                break;
-            case 1:
-                PowerManagementMainUi.load1Battery1->setAutoExclusive(true);
-                PowerManagementMainUi.load1Battery1->setChecked(true);
-                break;            
-            case 2:
-                PowerManagementMainUi.load1Battery2->setAutoExclusive(true);
-                PowerManagementMainUi.load1Battery2->setChecked(true);
-                break;            
-            case 3:
-                PowerManagementMainUi.load1Battery3->setAutoExclusive(true);
-                PowerManagementMainUi.load1Battery3->setChecked(true);
-                break;
-            }
-        if (! load1Battery1enabled) PowerManagementMainUi.load1Battery1->setEnabled(false);
-        if (! load1Battery2enabled) PowerManagementMainUi.load1Battery2->setEnabled(false);
-        if (! load1Battery3enabled) PowerManagementMainUi.load1Battery3->setEnabled(false);
-
-        if (firstField == "dS")
-            PowerManagementMainUi.load2CheckBox->setChecked(true);
-        bool load2Battery1enabled = PowerManagementMainUi.load2Battery1->isEnabled();
-        bool load2Battery2enabled = PowerManagementMainUi.load2Battery2->isEnabled();
-        bool load2Battery3enabled = PowerManagementMainUi.load2Battery3->isEnabled();
-        PowerManagementMainUi.load2Battery1->setEnabled(true);
-        PowerManagementMainUi.load2Battery2->setEnabled(true);
-        PowerManagementMainUi.load2Battery3->setEnabled(true);
-        switch (load2Setting)
-            {
-// No battery allocated to load 2
-            case 0:
-                PowerManagementMainUi.load2Battery1->setAutoExclusive(false);
-                PowerManagementMainUi.load2Battery1->setChecked(false);
-                PowerManagementMainUi.load2Battery1->setAutoExclusive(true);
-                PowerManagementMainUi.load2Battery2->setAutoExclusive(false);
-                PowerManagementMainUi.load2Battery2->setChecked(false);
-                PowerManagementMainUi.load2Battery2->setAutoExclusive(true);
-                PowerManagementMainUi.load2Battery3->setAutoExclusive(false);
-                PowerManagementMainUi.load2Battery3->setChecked(false);
-                PowerManagementMainUi.load2Battery3->setAutoExclusive(true);
-                break;
-            case 1:
-                PowerManagementMainUi.load2Battery1->setAutoExclusive(true);
-                PowerManagementMainUi.load2Battery1->setChecked(true);
-                break;            
-            case 2:
-                PowerManagementMainUi.load2Battery2->setAutoExclusive(true);
-                PowerManagementMainUi.load2Battery2->setChecked(true);
-                break;            
-            case 3:
-                PowerManagementMainUi.load2Battery3->setAutoExclusive(true);
-                PowerManagementMainUi.load2Battery3->setChecked(true);
-                break;
-            }
-        if (! load2Battery1enabled) PowerManagementMainUi.load2Battery1->setEnabled(false);
-        if (! load2Battery2enabled) PowerManagementMainUi.load2Battery2->setEnabled(false);
-        if (! load2Battery3enabled) PowerManagementMainUi.load2Battery3->setEnabled(false);
-
-        if (firstField == "dS")
-            PowerManagementMainUi.panelBattery1->setChecked(true);
-        bool panelBattery1enabled = PowerManagementMainUi.panelBattery1->isEnabled();
-        bool panelBattery2enabled = PowerManagementMainUi.panelBattery2->isEnabled();
-        bool panelBattery3enabled = PowerManagementMainUi.panelBattery3->isEnabled();
-        PowerManagementMainUi.panelBattery1->setEnabled(true);
-        PowerManagementMainUi.panelBattery2->setEnabled(true);
-        PowerManagementMainUi.panelBattery3->setEnabled(true);
-        switch (panelSetting)
-            {
-// No battery allocated to the panel
-            case 0:
-                PowerManagementMainUi.panelBattery1->setAutoExclusive(false);
-                PowerManagementMainUi.panelBattery1->setChecked(false);
-                PowerManagementMainUi.panelBattery1->setAutoExclusive(true);
-                PowerManagementMainUi.panelBattery2->setAutoExclusive(false);
-                PowerManagementMainUi.panelBattery2->setChecked(false);
-                PowerManagementMainUi.panelBattery2->setAutoExclusive(true);
-                PowerManagementMainUi.panelBattery3->setAutoExclusive(false);
-                PowerManagementMainUi.panelBattery3->setChecked(false);
-                PowerManagementMainUi.panelBattery3->setAutoExclusive(true);
-                break;
-// Battery x allocated to the panel
-            case 1:
-                PowerManagementMainUi.panelBattery1->setAutoExclusive(true);
-                PowerManagementMainUi.panelBattery1->setChecked(true);
-                break;            
-            case 2:
-                PowerManagementMainUi.panelBattery2->setAutoExclusive(true);
-                PowerManagementMainUi.panelBattery2->setChecked(true);
-                break;            
-            case 3:
-                PowerManagementMainUi.panelBattery3->setAutoExclusive(true);
-                PowerManagementMainUi.panelBattery3->setChecked(true);
-                break;
-        }
-        if (! panelBattery1enabled) PowerManagementMainUi.panelBattery1->setEnabled(false);
-        if (! panelBattery2enabled) PowerManagementMainUi.panelBattery2->setEnabled(false);
-        if (! panelBattery3enabled) PowerManagementMainUi.panelBattery3->setEnabled(false);
+    setSwitch(load1Setting,PowerManagementMainUi.load1Battery1,
+                           PowerManagementMainUi.load1Battery2,
+                           PowerManagementMainUi.load1Battery3);
+    setSwitch(load2Setting,PowerManagementMainUi.load2Battery1,
+                           PowerManagementMainUi.load2Battery2,
+                           PowerManagementMainUi.load2Battery3);
+    setSwitch(panelSetting,PowerManagementMainUi.panelBattery1,
+                           PowerManagementMainUi.panelBattery2,
+                           PowerManagementMainUi.panelBattery3);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the Radio Buttons of one Switch
+
+The buttons are enabled while being set, and are then returned to their
+previous enabled state.
+
+@param[in] int setting: 0 for no battery, otherwise the battery allocated.
+@param[in] QRadioButton* battery1, battery2, battery3: buttons of the switch.
+*/
+
+void PowerManagementGui::setSwitch(const int setting, QRadioButton* battery1,
+                                   QRadioButton* battery2, QRadioButton* battery3)
+{
+    QRadioButton* button[3] = {battery1, battery2, battery3};
+    bool enabled[3];
+    for (int i=0; i<3; i++)
+    {
+        enabled[i] = button[i]->isEnabled();
+        button[i]->setEnabled(true);
     }
-// Overload and undervoltage indicators from the I/Fs
-// Battery 1, Battery 2, Battery 3, Load 1, Load 2, Panel
-// ON is low.
-    if ((size > 0) && (firstField == "dI"))
+// No battery allocated to the switch
+    if (setting == 0)
     {
-        indicators = secondField.toInt();
-        if (testIndicator(battery1OverCurrent))
-        {
-            PowerManagementMainUi.battery1OverCurrent->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.battery1OverCurrent->
-                setText("OC");
-        }
-        else
-        {
-            PowerManagementMainUi.battery1OverCurrent->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery1OverCurrent->
-                setText("");
-        }
-        if (testIndicator(battery1UnderVoltage))
-        {
-            PowerManagementMainUi.battery1UnderVoltage->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.battery1UnderVoltage->
-                setText("UV");
-        }
-        else
-        {
-            PowerManagementMainUi.battery1UnderVoltage->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery1UnderVoltage->
-                setText("");
-        }
-        if (testIndicator(battery2OverCurrent))
-        {
-            PowerManagementMainUi.battery2OverCurrent->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.battery2OverCurrent->
-                setText("OC");
-        }
-        else
-        {
-            PowerManagementMainUi.battery2OverCurrent->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery2OverCurrent->
-                setText("");
-        }
-        if (testIndicator(battery2UnderVoltage))
-        {
-            PowerManagementMainUi.battery2UnderVoltage->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.battery2UnderVoltage->
-                setText("UV");
-        }
-        else
-        {
-            PowerManagementMainUi.battery2UnderVoltage->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery2UnderVoltage->
-                setText("");
-        }
-        if (testIndicator(battery3OverCurrent))
-        {
-            PowerManagementMainUi.battery3OverCurrent->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.battery3OverCurrent->
-                setText("OC");
-        }
-        else
-        {
-            PowerManagementMainUi.battery3OverCurrent->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery3OverCurrent->
-                setText("");
-        }
-        if (testIndicator(battery3UnderVoltage))
-        {
-            PowerManagementMainUi.battery3UnderVoltage->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.battery3UnderVoltage->
-                setText("UV");
-        }
-        else
-        {
-            PowerManagementMainUi.battery3UnderVoltage->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery3UnderVoltage->
-                setText("");
-        }
-        if (testIndicator(load1OverCurrent))
-        {
-            PowerManagementMainUi.load1OverCurrent->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.load1OverCurrent->
-                setText("OC");
-        }
-        else
-        {
-            PowerManagementMainUi.load1OverCurrent->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.load1OverCurrent->
-                setText("");
-        }
-        if (testIndicator(load1UnderVoltage))
-        {
-            PowerManagementMainUi.load1UnderVoltage->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.load1UnderVoltage->
-                setText("UV");
-        }
-        else
-        {
-            PowerManagementMainUi.load1UnderVoltage->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.load1UnderVoltage->
-                setText("");
-        }
-        if (testIndicator(load2OverCurrent))
-        {
-            PowerManagementMainUi.load2OverCurrent->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.load2OverCurrent->
-                setText("OC");
-        }
-        else
-        {
-            PowerManagementMainUi.load2OverCurrent->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.load2OverCurrent->
-                setText("");
-        }
-        if (testIndicator(load2UnderVoltage))
-        {
-            PowerManagementMainUi.load2UnderVoltage->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.load2UnderVoltage->
-                setText("UV");
-        }
-        else
-        {
-            PowerManagementMainUi.load2UnderVoltage->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.load2UnderVoltage->
-                setText("");
-        }
-        if (testIndicator(panelOverCurrent))
+        for (int i=0; i<3; i++)
         {
-            PowerManagementMainUi.panelOverCurrent->
-                setStyleSheet("color:white; background-color:red;");
-            PowerManagementMainUi.panelOverCurrent->
-                setText("OC");
-        }
-        else
-        {
-            PowerManagementMainUi.panelOverCurrent->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.panelOverCurrent->
-                setText("");
-        }
-        if (testIndicator(panelUnderVoltage))
-        {
-            PowerManagementMainUi.panelUnderVoltage->
-                setStyleSheet("color:white; color:white; background-color:red;");
-            PowerManagementMainUi.panelUnderVoltage->
-                setText("UV");
-        }
-        else
-        {
-            PowerManagementMainUi.panelUnderVoltage->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.panelUnderVoltage->
-                setText("");
+            button[i]->setAutoExclusive(false);
+            button[i]->setChecked(false);
+            button[i]->setAutoExclusive(true);
         }
     }
-/* Battery 1 Fill, Health and Operational State Indicators */
-    if ((size > 0) && (firstField == "dO1"))
+// Battery x allocated to the switch
+    else if (setting <= 3)
     {
-        int opState = secondField.toInt() & 0x03;
-        int fillState = (secondField.toInt() >> 2) & 0x03;
-        int chargingState = (secondField.toInt() >> 4) & 0x03;
-        int healthState = (secondField.toInt() >> 6) & 0x03;
-        if (fillState == 0)         // Normal
-        {
-            PowerManagementMainUi.battery1Fill->
-                setStyleSheet("background-color:lightgreen;");
-        }
-        else if (fillState == 1)    // Low
-        {
-            PowerManagementMainUi.battery1Fill->
-                setStyleSheet("background-color:yellow;");
-        }
-        else if (fillState == 2)    // Critical
-        {
-            PowerManagementMainUi.battery1Fill->
-                setStyleSheet("background-color:red;");
-        }
-        else if (fillState == 3)    // Faulty
-        {
-            PowerManagementMainUi.battery1Fill->
-                setStyleSheet("background-color:black;");
-        }
-        else                        // Invalid
-        {
-            PowerManagementMainUi.battery1Fill->
-                setStyleSheet("background-color:white;");
-        }
-        if (PowerManagementMainUi.autoTrackCheckBox->isChecked())
-        {
-            if (opState == 0)
-            {
-                PowerManagementMainUi.battery1Op->
-                    setText("L");
-            }
-            else if (opState == 1)
-            {
-                PowerManagementMainUi.battery1Op->
-                    setText("C");
-            }
-            else
-            {
-                PowerManagementMainUi.battery1Op->
-                    setText("I");
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.battery1Op->
-                setText("");
-        }
-        if (chargingState == 0)
-        {
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:orange;");
-            PowerManagementMainUi.battery1Charging->
-                setText("B");
-        }
-        else if (chargingState == 1)
-        {
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:yellow;");
-            PowerManagementMainUi.battery1Charging->
-                setText("A");
-        }
-        else if (chargingState == 2)
-        {
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery1Charging->
-                setText("F");
-        }
-        else if (chargingState == 3)
-        {
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:pink;");
-            PowerManagementMainUi.battery1Charging->
-                setText("R");
-        }
-        else if (chargingState == 4)
-        {
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:lightblue;");
-            PowerManagementMainUi.battery1Charging->
-                setText("E");
-        }
-        else
-        {
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery1Charging->
-                setText(" ");
-        }
-        if (healthState == 0)
-        {
-            PowerManagementMainUi.battery1Health->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery1Health->
-                setText("");
-        }
-        else if (healthState == 1)
-        {
-            PowerManagementMainUi.battery1Health->
-                setStyleSheet("background-color:orange;");
-            PowerManagementMainUi.battery1Health->
-                setText("F");
-        }
-        else if (healthState == 3)
-        {
-            PowerManagementMainUi.battery1Health->
-                setStyleSheet("background-color:red;");
-            PowerManagementMainUi.battery1Health->
-                setText("F");
-        }
-        else if (healthState == 2)
-        {
-            PowerManagementMainUi.battery1Health->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery1Health->
-                setText("X");
-            PowerManagementMainUi.battery1Charging->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery1Charging->
-                setText("");
-            PowerManagementMainUi.battery1Fill->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery1Fill->
-                setText("");
-            PowerManagementMainUi.battery1Op->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery1Op->
-                setText("");
-            PowerManagementMainUi.battery1Charge->
-                setText(QString(""));
-            PowerManagementMainUi.battery1Current->setText(QString(""));
-            PowerManagementMainUi.battery1Voltage->setText(QString(""));
-        }
+        button[setting-1]->setAutoExclusive(true);
+        button[setting-1]->setChecked(true);
     }
-/* Battery 2 Fill, Health and Operational State Indicators */
-    if ((size > 0) && (firstField == "dO2"))
+    for (int i=0; i<3; i++)
+        if (! enabled[i]) button[i]->setEnabled(false);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the Overload and Undervoltage Indicators
+
+Indicators from the I/Fs for Battery 1, Battery 2, Battery 3, Load 1, Load 2,
+Panel. ON is low.
+
+@param[in] int indicatorBits: indicator fields as received.
+*/
+
+void PowerManagementGui::showIndicators(const int indicatorBits)
+{
+    indicators = indicatorBits;
+    setOverCurrent(PowerManagementMainUi.battery1OverCurrent,
+                   testIndicator(battery1OverCurrent));
+    setUnderVoltage(PowerManagementMainUi.battery1UnderVoltage,
+                    testIndicator(battery1UnderVoltage));
+    setOverCurrent(PowerManagementMainUi.battery2OverCurrent,
+                   testIndicator(battery2OverCurrent));
+    setUnderVoltage(PowerManagementMainUi.battery2UnderVoltage,
+                    testIndicator(battery2UnderVoltage));
+    setOverCurrent(PowerManagementMainUi.battery3OverCurrent,
+                   testIndicator(battery3OverCurrent));
+    setUnderVoltage(PowerManagementMainUi.battery3UnderVoltage,
+                    testIndicator(battery3UnderVoltage));
+    setOverCurrent(PowerManagementMainUi.load1OverCurrent,
+                   testIndicator(load1OverCurrent));
+    setUnderVoltage(PowerManagementMainUi.load1UnderVoltage,
+                    testIndicator(load1UnderVoltage));
+    setOverCurrent(PowerManagementMainUi.load2OverCurrent,
+                   testIndicator(load2OverCurrent));
+    setUnderVoltage(PowerManagementMainUi.load2UnderVoltage,
+                    testIndicator(load2UnderVoltage));
+    setOverCurrent(PowerManagementMainUi.panelOverCurrent,
+                   testIndicator(panelOverCurrent));
+    setUnderVoltage(PowerManagementMainUi.panelUnderVoltage,
+                    testIndicator(panelUnderVoltage));
+}
+
+void PowerManagementGui::setOverCurrent(QPushButton* indicator, const bool on)
+{
+    if (on)
     {
-        int opState = secondField.toInt() & 0x03;
-        int fillState = (secondField.toInt() >> 2) & 0x03;
-        int chargingState = (secondField.toInt() >> 4) & 0x03;
-        int healthState = (secondField.toInt() >> 6) & 0x03;
-        if (fillState == 0)         // Normal
-        {
-            PowerManagementMainUi.battery2Fill->
-                setStyleSheet("background-color:lightgreen;");
-        }
-        else if (fillState == 1)    // Low
-        {
-            PowerManagementMainUi.battery2Fill->
-                setStyleSheet("background-color:yellow;");
-        }
-        else if (fillState == 2)    // Critical
-        {
-            PowerManagementMainUi.battery2Fill->
-                setStyleSheet("background-color:red;");
-        }
-        else if (fillState == 3)    // Faulty
-        {
-            PowerManagementMainUi.battery2Fill->
-                setStyleSheet("background-color:black;");
-        }
-        else                        // Invalid
-        {
-            PowerManagementMainUi.battery2Fill->
-                setStyleSheet("background-color:white;");
-        }
-        if (PowerManagementMainUi.autoTrackCheckBox->isChecked())
-        {
-            if (opState == 0)
-            {
-                PowerManagementMainUi.battery2Op->
-                    setText("L");
-            }
-            else if (opState == 1)
-            {
-                PowerManagementMainUi.battery2Op->
-                    setText("C");
-            }
-            else
-            {
-                PowerManagementMainUi.battery2Op->
-                    setText("I");
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.battery2Op->
-                setText("");
-        }
-        if (chargingState == 0)
-        {
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:orange;");
-            PowerManagementMainUi.battery2Charging->
-                setText("B");
-        }
-        else if (chargingState == 1)
-        {
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:yellow;");
-            PowerManagementMainUi.battery2Charging->
-                setText("A");
-        }
-        else if (chargingState == 2)
-        {
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery2Charging->
-                setText("F");
-        }
-        else if (chargingState == 3)
-        {
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:pink;");
-            PowerManagementMainUi.battery2Charging->
-                setText("R");
-        }
-        else if (chargingState == 4)
-        {
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:lightblue;");
-            PowerManagementMainUi.battery2Charging->
-                setText("E");
-        }
-        else
-        {
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery2Charging->
-                setText(" ");
-        }
-        if (healthState == 0)
-        {
-            PowerManagementMainUi.battery2Health->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery2Health->
-                setText("");
-        }
-        else if (healthState == 1)
-        {
-            PowerManagementMainUi.battery2Health->
-                setStyleSheet("background-color:orange;");
-            PowerManagementMainUi.battery2Health->
-                setText("F");
-        }
-        else
-        {
-            PowerManagementMainUi.battery2Health->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery2Health->
-                setText("X");
-            PowerManagementMainUi.battery2Charging->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery2Charging->
-                setText("");
-            PowerManagementMainUi.battery2Fill->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery2Fill->
-                setText("");
-            PowerManagementMainUi.battery2Op->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery2Op->
-                setText("");
-            PowerManagementMainUi.battery2Charge->
-                setText(QString(""));
-            PowerManagementMainUi.battery2Current->setText(QString(""));
-            PowerManagementMainUi.battery2Voltage->setText(QString(""));
-        }
+        indicator->setStyleSheet("color:white; background-color:red;");
+        indicator->setText("OC");
     }
-/* Battery 3 Fill, Health and Operational State Indicators */
-    if ((size > 0) && (firstField == "dO3"))
+    else
     {
-        int opState = secondField.toInt() & 0x03;
-        int fillState = (secondField.toInt() >> 2) & 0x03;
-        int chargingState = (secondField.toInt() >> 4) & 0x03;
-        int healthState = (secondField.toInt() >> 6) & 0x03;
-        if (fillState == 0)         // Normal
-        {
-            PowerManagementMainUi.battery3Fill->
-                setStyleSheet("background-color:lightgreen;");
-        }
-        else if (fillState == 1)    // Low
-        {
-            PowerManagementMainUi.battery3Fill->
-                setStyleSheet("background-color:yellow;");
-        }
-        else if (fillState == 2)    // Critical
-        {
-            PowerManagementMainUi.battery3Fill->
-                setStyleSheet("background-color:red;");
-        }
-        else if (fillState == 3)    // Faulty
-        {
-            PowerManagementMainUi.battery3Fill->
-                setStyleSheet("background-color:black;");
-        }
-        else                        // Invalid
-        {
-            PowerManagementMainUi.battery3Fill->
-                setStyleSheet("background-color:white;");
-        }
-        if (PowerManagementMainUi.autoTrackCheckBox->isChecked())
-        {
-            if (opState == 0)
-            {
-                PowerManagementMainUi.battery3Op->
-                    setText("L");
-            }
-            else if (opState == 1)
-            {
-                PowerManagementMainUi.battery3Op->
-                    setText("C");
-            }
-            else
-            {
-                PowerManagementMainUi.battery3Op->
-                    setText("I");
-            }
-        }
-        else
-        {
-            PowerManagementMainUi.battery3Op->
-                setText("");
-        }
-        if (chargingState == 0)
-        {
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:orange;");
-            PowerManagementMainUi.battery3Charging->
-                setText("B");
-        }
-        else if (chargingState == 1)
-        {
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:yellow;");
-            PowerManagementMainUi.battery3Charging->
-                setText("A");
-        }
-        else if (chargingState == 2)
-        {
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery3Charging->
-                setText("F");
-        }
-        else if (chargingState == 3)
-        {
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:pink;");
-            PowerManagementMainUi.battery3Charging->
-                setText("R");
-        }
-        else if (chargingState == 4)
-        {
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:lightblue;");
-            PowerManagementMainUi.battery3Charging->
-                setText("E");
-        }
-        else
-        {
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery3Charging->
-                setText(" ");
-        }
-        if (healthState == 0)
-        {
-            PowerManagementMainUi.battery3Health->
-                setStyleSheet("background-color:lightgreen;");
-            PowerManagementMainUi.battery3Health->
-                setText("");
-        }
-        else if (healthState == 1)
-        {
-            PowerManagementMainUi.battery3Health->
-                setStyleSheet("background-color:orange;");
-            PowerManagementMainUi.battery3Health->
-                setText("F");
-        }
-        else
-        {
-            PowerManagementMainUi.battery3Health->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery3Health->
-                setText("X");
-            PowerManagementMainUi.battery3Charging->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery3Charging->
-                setText("");
-            PowerManagementMainUi.battery3Fill->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery3Fill->
-                setText("");
-            PowerManagementMainUi.battery3Op->
-                setStyleSheet("background-color:white;");
-            PowerManagementMainUi.battery3Op->
-                setText("");
-            PowerManagementMainUi.battery3Charge->
-                setText(QString(""));
-            PowerManagementMainUi.battery3Current->setText(QString(""));
-            PowerManagementMainUi.battery3Voltage->setText(QString(""));
-        }
+        indicator->setStyleSheet("background-color:lightgreen;");
+        indicator->setText("");
     }
-/* SoC estimates */
-    if ((size > 0) && (firstField == "dC1"))
+}
+
+void PowerManagementGui::setUnderVoltage(QLabel* indicator, const bool on)
+{
+    if (on)
     {
-        if (PowerManagementMainUi.battery1CheckBox->isChecked())
-        {
-            if (size > 1) PowerManagementMainUi.battery1Charge
-                ->setText(QString("%1").arg(secondField
-                        .toFloat()/256,0,'f',0).append('%'));
-        }
-        else
-        {
-            PowerManagementMainUi.battery1Charge->clear();
-        }
+        indicator->setStyleSheet("color:white; background-color:red;");
+        indicator->setText("UV");
     }
-    if ((size > 0) && (firstField == "dC2"))
+    else
     {
-        if (PowerManagementMainUi.battery2CheckBox->isChecked())
-        {
-            if (size > 1) PowerManagementMainUi.battery2Charge
-                ->setText(QString("%1").arg(secondField
-                        .toFloat()/256,0,'f',0).append('%'));
-        }
-        else
-        {
-            PowerManagementMainUi.battery2Charge->clear();
-        }
+        indicator->setStyleSheet("background-color:lightgreen;");
+        indicator->setText("");
     }
-    if ((size > 0) && (firstField == "dC3"))
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the Fill, Health and Operational State of a Battery
+
+@param[in] int battery: battery 0-2.
+@param[in] int state: two bits each for op, fill, charging and health states.
+*/
+
+void PowerManagementGui::showBatteryState(const int battery, const int state)
+{
+    QLabel* fillLabel[3] = {PowerManagementMainUi.battery1Fill,
+                            PowerManagementMainUi.battery2Fill,
+                            PowerManagementMainUi.battery3Fill};
+    QLabel* opLabel[3] = {PowerManagementMainUi.battery1Op,
+                          PowerManagementMainUi.battery2Op,
+                          PowerManagementMainUi.battery3Op};
+    QLabel* chargingLabel[3] = {PowerManagementMainUi.battery1Charging,
+                                PowerManagementMainUi.battery2Charging,
+                                PowerManagementMainUi.battery3Charging};
+    QLabel* healthLabel[3] = {PowerManagementMainUi.battery1Health,
+                              PowerManagementMainUi.battery2Health,
+                              PowerManagementMainUi.battery3Health};
+    QLabel* fill = fillLabel[battery];
+    QLabel* op = opLabel[battery];
+    QLabel* charging = chargingLabel[battery];
+    QLabel* health = healthLabel[battery];
+    int opState = state & 0x03;
+    int fillState = (state >> 2) & 0x03;
+    int chargingState = (state >> 4) & 0x03;
+    int healthState = (state >> 6) & 0x03;
+    if (fillState == 0)         // Normal
+        setLabelStyle(fill,"background-color:lightgreen;");
+    else if (fillState == 1)    // Low
+        setLabelStyle(fill,"background-color:yellow;");
+    else if (fillState == 2)    // Critical
+        setLabelStyle(fill,"background-color:red;");
+    else if (fillState == 3)    // Faulty
+        setLabelStyle(fill,"background-color:black;");
+    else                        // Invalid
+        setLabelStyle(fill,"background-color:white;");
+    if (PowerManagementMainUi.autoTrackCheckBox->isChecked())
     {
-        if (PowerManagementMainUi.battery3CheckBox->isChecked())
-        {
-            if (size > 1) PowerManagementMainUi.battery3Charge
-                ->setText(QString("%1").arg(secondField
-                        .toFloat()/256,0,'f',0).append('%'));
-        }
-        else
-        {
-            PowerManagementMainUi.battery3Charge->clear();
-        }
+        if (opState == 0) setLabelText(op,"L");
+        else if (opState == 1) setLabelText(op,"C");
+        else setLabelText(op,"I");
     }
-    if ((size > 0) && (firstField == "dT"))
+    else setLabelText(op,"");
+    if (chargingState == 0)
     {
-        if (size > 1) PowerManagementMainUi.temperature
-            ->setText(QString("%1").arg(secondField
-                .toFloat()/256,0,'f',1).append(QChar(0x00B0)).append("C"));
+        setLabelStyle(charging,"background-color:orange;");
+        setLabelText(charging,"B");
     }
-/* Messages for the File Task start with f */
-    if ((size > 0) && (firstField.left(1) == "f"))
+    else if (chargingState == 1)
     {
-        emit this->recordMessageReceived(response);
+        setLabelStyle(charging,"background-color:yellow;");
+        setLabelText(charging,"A");
     }
-/* Messages for the Configure Task start with p or certain of the data responses */
-    if ((size > 0) && ((firstField.left(1) == "p") || (firstField.left(2) == "dO")
-                                                   || (firstField.left(2) == "dE")
-                                                   || (firstField.left(2) == "dD")))
+    else if (chargingState == 2)
     {
-        emit this->configureMessageReceived(response);
+        setLabelStyle(charging,"background-color:lightgreen;");
+        setLabelText(charging,"F");
     }
-/* This allows debug messages to be displayed on the terminal. */
-    if ((size > 0) && (firstField.left(1) == "D"))
+    else if (chargingState == 3)
+    {
+        setLabelStyle(charging,"background-color:pink;");
+        setLabelText(charging,"R");
+    }
+    else if (chargingState == 4)
+    {
+        setLabelStyle(charging,"background-color:lightblue;");
+        setLabelText(charging,"E");
+    }
+    else
+    {
+        setLabelStyle(charging,"background-color:white;");
+        setLabelText(charging," ");
+    }
+    if (healthState == 0)
+    {
+        setLabelStyle(health,"background-color:lightgreen;");
+        setLabelText(health,"");
+    }
+    else if (healthState == 1)
+    {
+        setLabelStyle(health,"background-color:orange;");
+        setLabelText(health,"F");
+    }
+// Only battery 1 shows a weak state, batteries 2 and 3 are shown as missing
+    else if ((healthState == 3) && (battery == 0))
+    {
+        setLabelStyle(health,"background-color:red;");
+        setLabelText(health,"F");
+    }
+// Battery missing
+    else
     {
-        qDebug() << response;
-        if (! saveFile.isEmpty()) saveLine(response);
+        QLabel* chargeLabel[3] = {PowerManagementMainUi.battery1Charge,
+                                  PowerManagementMainUi.battery2Charge,
+                                  PowerManagementMainUi.battery3Charge};
+        QLabel* currentLabel[3] = {PowerManagementMainUi.battery1Current,
+                                   PowerManagementMainUi.battery2Current,
+                                   PowerManagementMainUi.battery3Current};
+        QLabel* voltageLabel[3] = {PowerManagementMainUi.battery1Voltage,
+                                   PowerManagementMainUi.battery2Voltage,
+                                   PowerManagementMainUi.battery3Voltage};
+        setLabelStyle(health,"background-color:white;");
+        setLabelText(health,"X");
+        setLabelStyle(charging,"background-color:white;");
+        setLabelText(charging,"");
+        setLabelStyle(fill,"background-color:white;");
+        setLabelText(fill,"");
+        setLabelStyle(op,"background-color:white;");
+        setLabelText(op,"");
+        setLabelText(chargeLabel[battery],QString(""));
+        setLabelText(currentLabel[battery],QString(""));
+        setLabelText(voltageLabel[battery],QString(""));
     }
 }
 
 //-----------------------------------------------------------------------------
-/** @brief Convert Voltage and Current Strings for Display
-
-The current and voltage values are obtained from the command string breakdown
-converted to a QString form suitable for display. The breakdown is
-0 - command, 1 - current, 2- voltage.
+/** @brief Show the SoC Estimate of a Battery
 
-An entry is saved in the save file if it is open.
-The entry is sent to the monitor window.
+@param[in] int battery: battery 0-2.
 */
 
-void PowerManagementGui::getCurrentVoltage(const QStringList breakdown,
-                                           QString* sCurrent, QString* sVoltage)
+void PowerManagementGui::showCharge(const int battery)
 {
-    int size = breakdown.size();
-    QString entry = breakdown[0].simplified();
-    if (size > 1)
+    QCheckBox* enable[3] = {PowerManagementMainUi.battery1CheckBox,
+                            PowerManagementMainUi.battery2CheckBox,
+                            PowerManagementMainUi.battery3CheckBox};
+    QLabel* chargeLabel[3] = {PowerManagementMainUi.battery1Charge,
+                              PowerManagementMainUi.battery2Charge,
+                              PowerManagementMainUi.battery3Charge};
+    if (displayState.chargeFields[battery] == 0) return;
+    if (enable[battery]->isChecked())
     {
-        float fCurrent = breakdown[1].simplified().toFloat()/256;
-        *sCurrent = QString("%1").arg(fCurrent,0,'f',2);
-        entry = entry.append(",").append(*sCurrent);
+        if (displayState.chargeFields[battery] > 1)
+            setLabelText(chargeLabel[battery],QString("%1")
+                .arg((float)displayState.charge[battery]/256,0,'f',0)
+                .append('%'));
     }
-    if (size > 2)
+    else
     {
-        float fVoltage = breakdown[2].simplified().toFloat()/256;
-        *sVoltage = QString("%1").arg(fVoltage,0,'f',2);
-        entry = entry.append(",").append(*sVoltage);
+        setLabelText(chargeLabel[battery],QString());
     }
-    emit this->monitorMessageReceived(entry);
-//    if (! saveFile.isEmpty()) saveLine(entry);
 }
+
 //-----------------------------------------------------------------------------
 /** @brief Test indicators on the Interface Cards.
 
@@ -1675,7 +1309,9 @@ void PowerManagementGui::on_battery3SoCReset_clicked()
 /** @brief Obtain a save file name and path and attempt to open it.
 
 The files are csv but the ending can be arbitrary to allow compatibility
-with the data processing application.
+with the data processing application. A file ending in .bmr, or chosen with
+the capture filter, is saved in the compressed capture format instead, which
+the data processing application also reads.
 */
 
 void PowerManagementGui::on_saveFileButton_clicked()
@@ -1687,17 +1323,25 @@ void PowerManagementGui::on_saveFileButton_clicked()
         return;
     }
     PowerManagementMainUi.errorLabel->clear();
+    QString captureFilter = QString("Compressed Capture (*%1)")
+                                .arg(CAPTURE_SUFFIX);
+    QString selectedFilter;
     QString filename = QFileDialog::getSaveFileName(this,
                         "Acquisition Save Acquired Data",
                         QString(),
-                        "Comma Separated Variables (*.csv *.txt)");
+                        "Comma Separated Variables (*.csv *.txt);;"
+                        + captureFilter, &selectedFilter);
     if (filename.isEmpty()) return;
 //    if (! filename.endsWith(".csv")) filename.append(".csv");
+    LogFormat format = textLog;
+    if ((selectedFilter == captureFilter) && QFileInfo(filename).suffix().isEmpty())
+        filename.append(CAPTURE_SUFFIX);
+    if (filename.endsWith(CAPTURE_SUFFIX)) format = captureLog;
     QFileInfo fileInfo(filename);
     saveDirectory = fileInfo.absolutePath();
     saveFile = saveDirectory.filePath(filename);
-    outFile = new QFile(saveFile);             // Open file for output
-    if (! outFile->open(QIODevice::WriteOnly))
+// Open file for output, written on the log thread
+    if (! saveLog->open(saveFile,format,saveRotateSize,saveRotateTime))
     {
         displayErrorMessage("Could not open the output file");
         return;
@@ -1707,6 +1351,7 @@ void PowerManagementGui::on_saveFileButton_clicked()
 //-----------------------------------------------------------------------------
 /** @brief Save a line to the opened save file.
 
+The line is queued and written by the log thread.
 */
 void PowerManagementGui::saveLine(QString line)
 {
@@ -1716,13 +1361,15 @@ void PowerManagementGui::saveLine(QString line)
         displayErrorMessage("Output File not defined");
         return;
     }
-    if (! outFile->isOpen())
+    if (! saveLog->isOpen())
     {
         displayErrorMessage("Output File not open");
         return;
     }
-    QTextStream out(outFile);
-    out << line << "\r\n";
+// Report only the first line lost, the total is given when the file is closed
+    if (! saveLog->write(line,tick.elapsed()) &&
+        (saveLog->droppedLines() == 1))
+        displayErrorMessage("Output File is behind, lines are being lost");
 }
 
 //-----------------------------------------------------------------------------
@@ -1736,8 +1383,10 @@ void PowerManagementGui::on_closeFileButton_clicked()
         displayErrorMessage("File already closed");
     else
     {
-        outFile->close();
-        delete outFile;
+        saveLog->close();
+        if (saveLog->droppedLines() > 0)
+            displayErrorMessage(QString("%1 lines could not be saved")
+                                .arg(saveLog->droppedLines()));
 //! Save the name to prevent the same file being used.
         saveFile = QString();
     }
@@ -1750,10 +1399,10 @@ void PowerManagementGui::on_closeFileButton_clicked()
 void PowerManagementGui::on_recordingButton_clicked()
 {
     PowerManagementRecordGui* powerManagementRecordForm =
-                    new PowerManagementRecordGui(socket,this);
+                    new PowerManagementRecordGui(socket,&cardListing,this);
     powerManagementRecordForm->setAttribute(Qt::WA_DeleteOnClose);
-    connect(this, SIGNAL(recordMessageReceived(const QString&)),
-                    powerManagementRecordForm, SLOT(onMessageReceived(const QString&)));
+    connect(this, SIGNAL(recordReceived(const CommsRecord&)),
+                    powerManagementRecordForm, SLOT(onRecordReceived(const CommsRecord&)));
     powerManagementRecordForm->exec();
 }
 
@@ -1767,10 +1416,10 @@ placed to the background.
 void PowerManagementGui::on_monitorButton_clicked()
 {
     PowerManagementMonitorGui* powerManagementMonitorForm =
-                    new PowerManagementMonitorGui(socket,NULL);   
+                    new PowerManagementMonitorGui(socket,&history,NULL);
     powerManagementMonitorForm->setAttribute(Qt::WA_DeleteOnClose);
-    connect(this, SIGNAL(monitorMessageReceived(const QString&)),
-                  powerManagementMonitorForm, SLOT(onMessageReceived(const QString&)));
+    connect(this, SIGNAL(monitorReceived(const CommsRecord&)),
+                  powerManagementMonitorForm, SLOT(onRecordReceived(const CommsRecord&)));
     powerManagementMonitorForm->setModal(false);
     powerManagementMonitorForm->show();
 }
@@ -1785,8 +1434,8 @@ void PowerManagementGui::on_configureButton_clicked()
     PowerManagementConfigGui* powerManagementConfigForm =
                     new PowerManagementConfigGui(socket,this);
     powerManagementConfigForm->setAttribute(Qt::WA_DeleteOnClose);
-    connect(this, SIGNAL(configureMessageReceived(const QString&)),
-                    powerManagementConfigForm, SLOT(onMessageReceived(const QString&)));
+    connect(this, SIGNAL(configureReceived(const CommsRecord&)),
+                    powerManagementConfigForm, SLOT(onRecordReceived(const CommsRecord&)));
     powerManagementConfigForm->exec();
 }
 
@@ -1885,23 +1534,6 @@ void PowerManagementGui::ssleep(int centiseconds)
     }
 }
 
-//-----------------------------------------------------------------------------
-/** @brief Check if a socket is valid, that is, connected.
-*/
-bool PowerManagementGui::validsocket()
-{
-    if (socket == NULL)
-    {
-        QMessageBox msgBox;
-        msgBox.open();
-        msgBox.setText("Not yet connected. Click the connect button.");
-        ssleep(20);
-        msgBox.close();
-        return false;
-    }
-    return true;
-}
-
 //-----------------------------------------------------------------------------
 /** @brief Attempt to connect to the remote system.
 
@@ -1914,17 +1546,12 @@ void PowerManagementGui::on_connectButton_clicked()
     if (socket == NULL)
     {
         serialDevice = PowerManagementMainUi.sourceComboBox->currentText();
-        if (socket != NULL) delete socket;
-        socket = new QSerialPort(serialDevice);
-        bool ok = socket->open(QIODevice::ReadWrite);
+// The port is opened and read on its own thread
+        socket = new PowerManagementComms(this);
+        bool ok = socket->openSerial(serialDevice,bauds[baudrate]);
         if (ok)
         {
-            socket->setBaudRate(bauds[baudrate]);
-            socket->setDataBits(QSerialPort::Data8);
-            socket->setParity(QSerialPort::NoParity);
-            socket->setStopBits(QSerialPort::OneStop);
-            socket->setFlowControl(QSerialPort::NoFlowControl);
-            connect(socket, SIGNAL(readyRead()), this, SLOT(onDataAvailable()));
+            connect(socket, SIGNAL(recordsAvailable()), this, SLOT(onDataAvailable()));
             PowerManagementMainUi.connectButton->setText("Disconnect");
 /* Turn on microcontroller communications */
             socket->write("pc+\n\r");
@@ -1940,23 +1567,31 @@ void PowerManagementGui::on_connectButton_clicked()
     }
     else
     {
-        disconnect(socket, SIGNAL(readyRead()), this, SLOT(onDataAvailable()));
+        disconnect(socket, SIGNAL(recordsAvailable()), this, SLOT(onDataAvailable()));
         delete socket;
         socket = NULL;
+// A replay stopped here does not report its end
+        replaying = false;
+// The card listing held belongs to the link, which may next be to another unit
+        cardListing.entries.clear();
+        cardListing.changes = -1;
         PowerManagementMainUi.connectButton->setText("Connect");
     }
     setSourceComboBox(PowerManagementMainUi.sourceComboBox->currentIndex());
 #else
     if (socket == NULL)
     {
-// Create the TCP socket to the internet process
-        socket = new QTcpSocket(this);
+// Create the TCP socket to the internet process, read on its own thread
+        socket = new PowerManagementComms(this);
 // Setup QT signal/slots for reading and error handling
-// The readyRead signal from the QAbstractSocket is linked to the onDataAvailable slot
-        connect(socket, SIGNAL(readyRead()), this, SLOT(onDataAvailable()));
+// The recordsAvailable signal is linked to the onDataAvailable slot
+        connect(socket, SIGNAL(recordsAvailable()), this, SLOT(onDataAvailable()));
 // Obtain the address and port from the edit boxes.
         connectAddress = PowerManagementMainUi.tcpAddressEdit->text();
         connectPort = PowerManagementMainUi.tcpPortEdit->text().toUInt();
+// An address of the form host/site selects one site served by an aggregator
+        QString site = connectAddress.section('/',1);
+        connectAddress = connectAddress.section('/',0,0);
 // Connect to the host
         blockSize = 0;
         QMessageBox msgBox;
@@ -1966,9 +1601,7 @@ void PowerManagementGui::on_connectButton_clicked()
         for (count=0; count<100;count++)
         {
             ssleep(1);
-            socket->abort();
-            socket->connectToHost(connectAddress, connectPort);
-            if (socket->waitForConnected(1000)) break;
+            if (socket->connectToHost(connectAddress, connectPort)) break;
         }
         if (count >= 100) 
         {
@@ -1977,6 +1610,8 @@ void PowerManagementGui::on_connectButton_clicked()
         }
         msgBox.close();
         PowerManagementMainUi.connectButton->setText("Disconnect");
+        if (! site.isEmpty())
+            socket->write(QString("@%1\n\r").arg(site).toLocal8Bit().data());
 /* Turn on microcontroller communications */
         socket->write("pc+\n\r");
 /* This should cause the microcontroller to respond with all data */
@@ -1984,9 +1619,14 @@ void PowerManagementGui::on_connectButton_clicked()
     }
     else
     {
-        disconnect(socket, SIGNAL(readyRead()), this, SLOT(onDataAvailable()));
+        disconnect(socket, SIGNAL(recordsAvailable()), this, SLOT(onDataAvailable()));
         delete socket;
         socket = NULL;
+// A replay stopped here does not report its end
+        replaying = false;
+// The card listing held belongs to the link, which may next be to another unit
+        cardListing.entries.clear();
+        cardListing.changes = -1;
         PowerManagementMainUi.connectButton->setText("Connect");
     }
 #endif
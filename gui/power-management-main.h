@@ -30,15 +30,24 @@
 
 #include "ui_power-management-main.h"
 #include "power-management.h"
+#include "power-management-comms.h"
+#include "power-management-log.h"
+#include "power-management-history.h"
 #include <QSerialPort>
 #include <QSerialPortInfo>
 #include <QTcpSocket>
 #include <QDir>
 #include <QFile>
 #include <QTime>
+#include <QElapsedTimer>
 #include <QListWidgetItem>
 #include <QDialog>
 #include <QCloseEvent>
+#include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QRadioButton>
+#include <QTimer>
 
 typedef enum {battery1UnderVoltage, battery2UnderVoltage, battery3UnderVoltage, 
               battery1OverCurrent, battery2OverCurrent, battery3OverCurrent,
@@ -46,13 +55,43 @@ typedef enum {battery1UnderVoltage, battery2UnderVoltage, battery3UnderVoltage,
               load1OverCurrent, load2OverCurrent, panelOverCurrent, }
               IndicatorType;
 
+typedef enum {battery1Source, battery2Source, battery3Source,
+              load1Source, load2Source, panelSource}
+              SourceType;
+#define NUM_SOURCES 6
+
 #define DEFAULT_SERIAL_PORT "/dev/ttyUSB0"
 #define DEFAULT_BAUDRATE    5
 #define DEFAULT_TCP_ADDRESS "192.168.2.16"
 #define DEFAULT_TCP_PORT    6666
+// Replay speed, times faster than received, 0 for as fast as possible
+#define DEFAULT_REPLAY_SPEED 1
 
 #define millisleep(a) usleep(a*1000)
 
+// Interval in ms at which received values are shown, about the frame rate
+#define DISPLAY_REFRESH     40
+
+//-----------------------------------------------------------------------------
+/** @brief Latest values received for display.
+
+Values are held as received, with the number of fields received for each, zero
+if none has been received yet.
+*/
+
+typedef struct
+{
+    int sourceFields[NUM_SOURCES];
+    int current[NUM_SOURCES];
+    int voltage[NUM_SOURCES];
+    int chargeFields[3];
+    int charge[3];
+    bool stateValid[3];
+    int batteryState[3];
+    int temperatureFields;
+    int temperature;
+} DisplayState;
+
 //-----------------------------------------------------------------------------
 /** @brief Power Management Main Window.
 
@@ -62,13 +101,19 @@ class PowerManagementGui : public QDialog
 {
     Q_OBJECT
 public:
-    PowerManagementGui(QString device, uint parameter, QWidget* parent = 0);
+    PowerManagementGui(QString device, uint parameter,
+                       QString replayFile = QString(),
+                       double replaySpeed = DEFAULT_REPLAY_SPEED,
+                       qint64 rotateSize = LOG_ROTATE_SIZE,
+                       int rotateTime = LOG_ROTATE_TIME,
+                       QWidget* parent = 0);
     ~PowerManagementGui();
     bool success();
     QString error();
 private slots:
     void on_connectButton_clicked();
     void onDataAvailable();
+    void onReplayEnded(qint64 lines);
     void on_load1Battery1_pressed();
     void on_load1Battery2_pressed();
     void on_load1Battery3_pressed();
@@ -102,10 +147,11 @@ private slots:
     void on_autoTrackCheckBox_clicked();
     void closeEvent(QCloseEvent*);
     void disableRadioButtons(bool enable);
+    void refreshDisplay();
 signals:
-    void monitorMessageReceived(const QString response);
-    void recordMessageReceived(const QString response);
-    void configureMessageReceived(const QString response);
+    void monitorReceived(const CommsRecord& record);
+    void recordReceived(const CommsRecord& record);
+    void configureReceived(const CommsRecord& record);
 private:
 // User Interface object instance
     Ui::PowerManagementMainDialog PowerManagementMainUi;
@@ -113,8 +159,21 @@ private:
     void initMainWindow(Ui::PowerManagementMainDialog);
     void setSourceComboBox(int index);
 // Methods
-    void processResponse(const QString response);
-    void getCurrentVoltage(const QStringList breakdown,QString* sVoltage, QString* sCurrent);
+    void processResponse(const CommsRecord& record);
+    void storeCurrentVoltage(const SourceType source,
+                             const CommsRecord& record);
+    void requestRefresh();
+    void setLabelText(QLabel* label, const QString& text);
+    void setLabelStyle(QLabel* label, const QString& style);
+    void showCurrentVoltage(const SourceType source);
+    void showSwitchSettings(const int settings, const bool initial);
+    void setSwitch(const int setting, QRadioButton* battery1,
+                   QRadioButton* battery2, QRadioButton* battery3);
+    void showIndicators(const int indicatorBits);
+    void setOverCurrent(QPushButton* indicator, const bool on);
+    void setUnderVoltage(QLabel* indicator, const bool on);
+    void showBatteryState(const int battery, const int state);
+    void showCharge(const int battery);
     void displayErrorMessage(const QString message);
     void saveLine(QString line);    // Save line to a file
     void ssleep(int seconds);
@@ -125,21 +184,28 @@ private:
     QString connectAddress;
     quint16 connectPort;
     QString errorMessage;
-    QString response;
-#ifdef SERIAL
-    QSerialPort* socket;           //!< Serial port object pointer
-#else
-    QTcpSocket* socket;
-#endif
-    bool validsocket();
+    PowerManagementComms* socket;  //!< Serial port or TCP socket on its I/O thread
+    MonitorHistory history;        //!< Measurements for the monitor window
+    bool historyPending;           //!< Values set in the frame not yet committed
     quint16 blockSize;
-    QTime tick;
+    QElapsedTimer tick;            //!< Monotonic time for saved lines
+    bool replaying;
+    QElapsedTimer replayClock;     //!< Time since the replay started
+    QElapsedTimer rateClock;       //!< Time since the rate was last shown
+    qint64 replayRecords;
+    qint64 rateRecords;
     QDir saveDirectory;
     QString saveFile;
-    QFile* outFile;
+    SessionLog* saveLog;           //!< Save file written on its own thread
+    qint64 saveRotateSize;         //!< Size in bytes to start a new save file
+    int saveRotateTime;            //!< Time in s to start a new save file
+    CardListing cardListing;       //!< Card root listing held for the link
     int load1Current;
     int load1Voltage;
     unsigned int indicators;
+    DisplayState displayState;
+    bool displayPending;
+    QTimer* refreshTimer;
     char timeTick;
 };
 
@@ -3,21 +3,23 @@
 Incoming data is displayed in time graphical form.
 
 Two plots are provided with choices of all six interfaces and voltage or
-current to display. only one curve per plot is provided. Sliders are provided
-to scale and offset the curves. Data is stored in arrays for 500 ticks
-(usually seconds but depends on the frequency of incoming messages). The
-x-axis is nominally 100 ticks.
+current, or the temperature, to display. The chosen source sets the scale of
+each plot, and any other channels can be overlaid on it from the overlay menu.
+The minimum, maximum, mean and RMS of each trace over the frames in view are
+shown beside the plot. Sliders are provided to scale and offset the curves. Data is taken from the history held by the
+main window, which covers about 36 hours of monitor frames whether or not this
+window is open. The x-axis is nominally 100 ticks, each of one or more frames.
 
 At the beginning the curve is built up until it reaches the plot end. then
-it jumps back to allow later data to be displayed.
+it jumps back to allow later data to be displayed. Frames are drawn in batches
+at a fixed refresh interval, and on a jump the drawn plot is scrolled so that
+only the newly uncovered strip is drawn. The curves read the history directly
+rather than holding copies of the data.
 
-@todo A slider to offset the x-axis. Once offset the jump effect needs to be
-disabled. The view must remain stable until the slider is changed, then it
-must jump to the correct position relative to the last data plotted, and
-according to the slider setting. This will take into account old plot data
-being deleted as time goes on.
-
-@todo A widget to set the x-axis scale between 1 and 5 time ticks per axis tick.
+The x offset slider moves the view back over the whole history. Once offset
+the view remains stable until the slider is changed or returned to the end.
+Where a tick covers several frames, the minimum and maximum over each tick are
+drawn from the aggregates in the history so that peaks are not lost.
 
 Parts of QWT 6.1.0 examples "realtime" were adapted for this code.
 */
@@ -55,6 +57,7 @@ Parts of QWT 6.1.0 examples "realtime" were adapted for this code.
 #include <QDebug>
 #include <QtNetwork>
 #include <QTcpSocket>
+#include <QPainter>
 #include <qwt_plot.h>
 #include <qwt_plot_grid.h>
 #include <qwt_plot_canvas.h>
@@ -70,23 +73,61 @@ Parts of QWT 6.1.0 examples "realtime" were adapted for this code.
 #include <cstdlib>
 #include <iostream>
 #include <unistd.h>
+#include <cmath>
+
+// Names of the channels in the history, in full and as shown with statistics
+static const char* channelNames[HISTORY_CHANNELS] =
+    {"Battery 1 Current", "Battery 1 Voltage", "Battery 2 Current",
+     "Battery 2 Voltage", "Battery 3 Current", "Battery 3 Voltage",
+     "Load 1 Current", "Load 1 Voltage", "Load 2 Current", "Load 2 Voltage",
+     "Panel Current", "Panel Voltage", "Temperature"};
+static const char* channelShortNames[HISTORY_CHANNELS] =
+    {"Bat 1 A", "Bat 1 V", "Bat 2 A", "Bat 2 V", "Bat 3 A", "Bat 3 V",
+     "Load 1 A", "Load 1 V", "Load 2 A", "Load 2 V", "Panel A", "Panel V",
+     "Temp C"};
+// Colour of each channel's trace
+static const Qt::GlobalColor traceColours[HISTORY_CHANNELS] =
+    {Qt::black, Qt::red, Qt::darkGreen, Qt::blue, Qt::magenta, Qt::darkCyan,
+     Qt::darkYellow, Qt::darkRed, Qt::darkBlue, Qt::darkMagenta, Qt::green,
+     Qt::darkGray, Qt::cyan};
 
 //-----------------------------------------------------------------------------
-/** @brief Curve Data Subclass of QwtArraySeriesData
+/** @brief Curve Data Subclass of QwtSeriesData
+
+The curve is a view over one channel of the monitor history, so nothing is
+copied when the plot is redrawn or moved. The view starts on a multiple of the
+step and holds only whole steps. With a step of one frame each frame is a
+point. With a longer step each step gives two points, the minimum and maximum
+over the step, so that no peak is lost.
 
 In QwtSeriesData the bounding rectangle of each type of data series is
 computed through qwtBoundingRect, by iterating over the entire series.
 d_boundingRect is a class member of QwtSeriesData intended for caching the
 resulting rectangle.
-
-d_samples is a QVector of the samples.
 */
 
-class CurveData: public QwtArraySeriesData<QPointF>
+class CurveData: public QwtSeriesData<QPointF>
 {
 public:
-    CurveData()
+    CurveData(const MonitorHistory* history, int channel)
+        : history(history), channel(channel), start(0), steps(0), step(1)
+    {
+    }
+
+    virtual size_t size() const
     {
+        return (step > 1) ? 2*steps : steps;
+    }
+
+    virtual QPointF sample(size_t i) const
+    {
+        if (step == 1)
+            return QPointF(start+i, history->value(channel, start+i));
+        qint64 frame = start + (i/2)*step;
+        float low = 0;
+        float high = 0;
+        history->extremes(channel, frame, frame+step, &low, &high);
+        return QPointF(frame, (i & 1) ? high : low);
     }
 
     virtual QRectF boundingRect() const
@@ -97,37 +138,141 @@ public:
         return d_boundingRect;
     }
 
-    inline void append( const QPointF &point )
+/* Set the view to the whole steps from the frame from to the frame before to,
+leaving out any step that has been partly lost from the history. */
+    void setView(qint64 from, qint64 to, int length)
     {
-        d_samples += point;
+        step = length;
+        start = from - from % step;
+        if (start < history->first()) start += step;
+        steps = (to > start) ? (to - start)/step : 0;
+        d_boundingRect = QRectF( 0.0, 0.0, -1.0, -1.0 );
     }
 
-    void clear()
+/* The frame after the last whole step in the view. */
+    qint64 end() const
     {
-        d_samples.clear();
-        d_samples.squeeze();
-        d_boundingRect = QRectF( 0.0, 0.0, -1.0, -1.0 );
+        return start + steps*step;
     }
+
+/* The number of points in the view before a frame on a step boundary. */
+    size_t index(qint64 frame) const
+    {
+        if (frame <= start) return 0;
+        return ((frame - start)/step)*((step > 1) ? 2 : 1);
+    }
+
+private:
+    const MonitorHistory* history;
+    int channel;
+    qint64 start;
+    qint64 steps;
+    int step;
 };
 
+//-----------------------------------------------------------------------------
+/** @brief Clear the Statistics of a Trace
+
+*/
+
+void TraceStatistics::clear()
+{
+    start = 0;
+    end = 0;
+    sum = 0;
+    sumSquares = 0;
+    lows.clear();
+    highs.clear();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Move the Statistics Window
+
+Frames leaving the window are taken out of the sums, and the extremes they
+hold are dropped from the front of the queues. Frames coming into view are
+added to the sums, and each drops from the back of the queues any value that
+it will outlast and that it equals or betters. Each frame is added and taken
+out once, so a window following the data in real time costs a constant amount
+for each frame. A window that moves back, jumps ahead, or would have to take
+out frames already lost from the history is started afresh.
+
+@param[in] MonitorHistory* history: the measurements.
+@param[in] int channel: the channel of the trace.
+@param[in] qint64 from: first frame of the window.
+@param[in] qint64 to: frame after the end of the window.
+*/
+
+void TraceStatistics::update(const MonitorHistory* history, int channel,
+                             qint64 from, qint64 to)
+{
+    if (from < history->first()) from = history->first();
+    if (to > history->count()) to = history->count();
+    if (to < from) to = from;
+    if ((from < start) || (from > end) || (to < end) ||
+        (start < history->first()))
+    {
+        clear();
+        start = end = from;
+    }
+    while (start < from)
+    {
+        double value = history->value(channel, start);
+        sum -= value;
+        sumSquares -= value*value;
+        start++;
+    }
+    while (! lows.isEmpty() && (lows.first().first < from)) lows.removeFirst();
+    while (! highs.isEmpty() && (highs.first().first < from)) highs.removeFirst();
+    while (end < to)
+    {
+        float value = history->value(channel, end);
+        sum += value;
+        sumSquares += (double)value*value;
+        while (! lows.isEmpty() && (lows.last().second >= value)) lows.removeLast();
+        lows.append(qMakePair(end, value));
+        while (! highs.isEmpty() && (highs.last().second <= value)) highs.removeLast();
+        highs.append(qMakePair(end, value));
+        end++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Mean of the Trace over the Window
+
+*/
+
+double TraceStatistics::mean() const
+{
+    if (count() == 0) return 0;
+    return sum/count();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Root Mean Square of the Trace over the Window
+
+*/
+
+double TraceStatistics::rms() const
+{
+    if (count() == 0) return 0;
+    return sqrt(qMax(sumSquares/count(), 0.0));
+}
+
 //-----------------------------------------------------------------------------
 /** Monitor GUI Constructor
 
-@param[in] p TCP Socket object pointer
+@param[in] p Communications link to the remote unit
+@param[in] h History of measurements, filled by the main window.
 @param[in] parent Parent widget.
 */
 
-#ifdef SERIAL
-PowerManagementMonitorGui::PowerManagementMonitorGui(QSerialPort* p, QWidget* parent)
+PowerManagementMonitorGui::PowerManagementMonitorGui(PowerManagementComms* p,
+                                                     MonitorHistory* h,
+                                                     QWidget* parent)
                                                     : QDialog(parent)
 {
     socket = p;
-#else
-PowerManagementMonitorGui::PowerManagementMonitorGui(QTcpSocket* tcpSocket, QWidget* parent)
-                                                    : QDialog(parent)
-{
-    socket = tcpSocket;
-#endif
+    history = h;
     PowerManagementMonitorUi.setupUi(this);
     PowerManagementMonitorUi.qwtPlot1->setFrameStyle(QFrame::NoFrame);
     PowerManagementMonitorUi.qwtPlot1->setLineWidth(0);
@@ -175,8 +320,15 @@ PowerManagementMonitorGui::PowerManagementMonitorGui(QTcpSocket* tcpSocket, QWid
     PowerManagementMonitorUi.rangeLabelVertical2->setText("Volts");
     PowerManagementMonitorUi.qwtPlot2->replot();
 
-    d_directPainter1 = new QwtPlotDirectPainter(this);
-    d_directPainter2 = new QwtPlotDirectPainter(this);
+/* Incremental drawing also goes to the canvas backing store, so that it can be
+scrolled. */
+    for (int index=0; index<NUM_PLOTS; index++)
+    {
+        d_directPainter[index] = new QwtPlotDirectPainter(this);
+        d_directPainter[index]->
+            setAttribute(QwtPlotDirectPainter::CopyBackingStore, true);
+        scrollError[index] = 0;
+    }
 
     if (QwtPainter::isX11GraphicsSystem())
     {
@@ -192,114 +344,86 @@ PowerManagementMonitorGui::PowerManagementMonitorGui(QTcpSocket* tcpSocket, QWid
             canvas()->setAttribute(Qt::WA_PaintOnScreen, true);
     }
 
-    d_curve1 = new QwtPlotCurve("Monitor");
-    d_curve1->setData(new CurveData());
-    d_curve1->setStyle(QwtPlotCurve::Lines);
-    d_curve1->setPen(Qt::black);
-    d_curve1->attach(PowerManagementMonitorUi.qwtPlot1);
-
-    d_curve2 = new QwtPlotCurve("Monitor");
-    d_curve2->setData(new CurveData());
-    d_curve2->setStyle(QwtPlotCurve::Lines);
-    d_curve2->setPen(Qt::black);
-    d_curve2->attach(PowerManagementMonitorUi.qwtPlot2);
+/* Each plot has a curve for every channel, attached while it is shown. The
+overlay menu of each plot chooses the channels shown along with the source. */
+    for (int index=0; index<NUM_PLOTS; index++)
+    {
+        overlayMenu[index] = new QMenu(this);
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        {
+            QwtPlotCurve* curve = new QwtPlotCurve(channelNames[channel]);
+            curve->setData(new CurveData(history, channel));
+            curve->setStyle(QwtPlotCurve::Lines);
+            curve->setPen(traceColours[channel]);
+            d_curves[index][channel] = curve;
+            overlay[index][channel] = false;
+            QAction* action = overlayMenu[index]->addAction(channelNames[channel]);
+            action->setCheckable(true);
+            action->setData(index*HISTORY_CHANNELS+channel);
+        }
+        connect(overlayMenu[index], SIGNAL(triggered(QAction*)),
+                this, SLOT(onOverlayTriggered(QAction*)));
+    }
+    PowerManagementMonitorUi.overlayButton1->setMenu(overlayMenu[0]);
+    PowerManagementMonitorUi.overlayButton2->setMenu(overlayMenu[1]);
 
     PowerManagementMonitorUi.qwtPlot1->setAutoReplot(false);
     PowerManagementMonitorUi.qwtPlot2->setAutoReplot(false);
 
-    xindex = 0;
     plotStartIndex = 0;
     plotEnd = 0;
     xoffset = 0;
     lastIndex = 0;
     xSamples = 1;
+    source1 = 0;
+    source2 = 1;
+
+/* New frames are drawn together when the timer expires. */
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(MONITOR_REFRESH);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(updatePlots()));
 
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Battery 1 Current");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Battery 1 Voltage");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Battery 2 Current");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Battery 2 Voltage");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Battery 3 Current");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Battery 3 Voltage");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Load 1 Current");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Load 1 Voltage");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Load 2 Current");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Load 2 Voltage");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Panel Current");
-    PowerManagementMonitorUi.sourceComboBox1->addItem("Panel Voltage");
+    for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        PowerManagementMonitorUi.sourceComboBox1->addItem(channelNames[channel]);
     PowerManagementMonitorUi.sourceComboBox1->setCurrentIndex(0);
 
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Battery 1 Current");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Battery 1 Voltage");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Battery 2 Current");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Battery 2 Voltage");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Battery 3 Current");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Battery 3 Voltage");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Load 1 Current");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Load 1 Voltage");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Load 2 Current");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Load 2 Voltage");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Panel Current");
-    PowerManagementMonitorUi.sourceComboBox2->addItem("Panel Voltage");
+    for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        PowerManagementMonitorUi.sourceComboBox2->addItem(channelNames[channel]);
     PowerManagementMonitorUi.sourceComboBox2->setCurrentIndex(1);
 
-    source1 = yDataB1Current;
-    source2 = yDataB1Voltage;
+/* Allow the plot to cover the whole history, and the slider to reach back over
+it. The slider end is the latest data. */
+    PowerManagementMonitorUi.sampleSpinBox->setMaximum(HISTORY_POINTS/VISIBLE_POINTS);
+    PowerManagementMonitorUi.xoffsetSlider->setRange(0, OFFSET_STEPS);
+    PowerManagementMonitorUi.xoffsetSlider->setValue(OFFSET_STEPS);
 }
 
 PowerManagementMonitorGui::~PowerManagementMonitorGui()
 {
-    delete d_curve1;
-    delete d_curve2;
+    for (int index=0; index<NUM_PLOTS; index++)
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+            delete d_curves[index][channel];
 }
 
 //-----------------------------------------------------------------------------
 /** @brief Change the Display Graph Data Series
 
+The source sets the vertical scale of the plot, and is always shown.
 */
 void PowerManagementMonitorGui::on_sourceComboBox1_currentIndexChanged(int index)
 {
-    switch (index)
+    source1 = index;
+    showTraces(0);
+/* Set the vertical ranges for temperature, current or voltage.
+Assumes the entries alternate between current/voltage. */
+    if (index == HISTORY_TEMPERATURE)
     {
-        case 0:
-            source1 = yDataB1Current;
-            break;
-        case 1:
-            source1 = yDataB1Voltage;
-            break;
-        case 2:
-            source1 = yDataB2Current;
-            break;
-        case 3:
-            source1 = yDataB2Voltage;
-            break;
-        case 4:
-            source1 = yDataB3Current;
-            break;
-        case 5:
-            source1 = yDataB3Voltage;
-            break;
-        case 6:
-            source1 = yDataL1Current;
-            break;
-        case 7:
-            source1 = yDataL1Voltage;
-            break;
-        case 8:
-            source1 = yDataL2Current;
-            break;
-        case 9:
-            source1 = yDataL2Voltage;
-            break;
-        case 10:
-            source1 = yDataM1Current;
-            break;
-        case 11:
-            source1 = yDataM1Voltage;
-            break;
+        yScaleBase1 = 60;
+        yOffsetBase1 = 30;
+        PowerManagementMonitorUi.rangeLabelVertical1->setText("Deg C");
     }
-/* Set the vertical ranges for current or voltage.
-Assumes the entries alternate between current/voltage. */
-    if ((index % 2) == 0)
+    else if ((index % 2) == 0)
     {
         yScaleBase1 = 10;
         yOffsetBase1 = 0;
@@ -325,48 +449,17 @@ Assumes the entries alternate between current/voltage. */
 
 void PowerManagementMonitorGui::on_sourceComboBox2_currentIndexChanged(int index)
 {
-    switch (index)
+    source2 = index;
+    showTraces(1);
+/* Set the vertical ranges for temperature, current or voltage.
+Assumes the entries alternate between current/voltage. */
+    if (index == HISTORY_TEMPERATURE)
     {
-        case 0:
-            source2 = yDataB1Current;
-            break;
-        case 1:
-            source2 = yDataB1Voltage;
-            break;
-        case 2:
-            source2 = yDataB2Current;
-            break;
-        case 3:
-            source2 = yDataB2Voltage;
-            break;
-        case 4:
-            source2 = yDataB3Current;
-            break;
-        case 5:
-            source2 = yDataB3Voltage;
-            break;
-        case 6:
-            source2 = yDataL1Current;
-            break;
-        case 7:
-            source2 = yDataL1Voltage;
-            break;
-        case 8:
-            source2 = yDataL2Current;
-            break;
-        case 9:
-            source2 = yDataL2Voltage;
-            break;
-        case 10:
-            source2 = yDataM1Current;
-            break;
-        case 11:
-            source2 = yDataM1Voltage;
-            break;
+        yScaleBase2 = 60;
+        yOffsetBase2 = 30;
+        PowerManagementMonitorUi.rangeLabelVertical2->setText("Deg C");
     }
-/* Set the vertical ranges for current or voltage.
-Assumes the entries alternate between current/voltage. */
-    if ((index % 2) == 0)
+    else if ((index % 2) == 0)
     {
         yScaleBase2 = 10;
         yOffsetBase2 = 0;
@@ -391,125 +484,277 @@ Assumes the entries alternate between current/voltage. */
 }
 
 //-----------------------------------------------------------------------------
-/** @brief Process a Message.
+/** @brief Process a Record.
+
+Current and voltage records from the remote are passed here already decoded,
+followed by the temperature. The main window has already stored the values in
+the history, and the temperature completes the frame. Frames are drawn together at the next refresh, so that
+frames arriving in a burst cost a single drawing.
+
+@param CommsRecord record: identifier with fixed point current and voltage.
+*/
 
-After a command is sent, response messages from the remote are passed here for
-processing. Appropriate fields on the form are updated.
+void PowerManagementMonitorGui::onRecordReceived(const CommsRecord& record)
+{
+    if (record.fields.code != RESPONSE_CODE('d','T',0)) return;
+/* Plots are only added to while following in real time. */
+    if ((xoffset == 0) && (! refreshTimer->isActive())) refreshTimer->start();
+}
 
-@param QString entry: A csv string with identifier and FP current and voltage.
+//-----------------------------------------------------------------------------
+/** @brief Draw the Frames Received since the Last Refresh
+
+The new whole steps are added to the curves in one drawing for each plot.
+The plot runs from zero time index to the end of the plot. When the data runs
+past the end, the plot moves on to the next grid line after the latest data.
+What is already drawn is scrolled where possible rather than being redrawn.
 */
 
-void PowerManagementMonitorGui::onMessageReceived(const QString &entry)
+void PowerManagementMonitorGui::updatePlots()
 {
-/* Update plots.
-This makes an assumption that all quantities will be sent each time tick,
-and that the last in the set is module 1. Collect all data first then plot
-the selected series. Some data will come through that is ignored. */
-    QStringList breakdown = entry.split(",");
-    float current = 0;
-    if (breakdown.size() > 1) current = breakdown[1].simplified().toFloat();
-    float voltage = 0;
-    if (breakdown.size() > 2) voltage = breakdown[2].simplified().toFloat();
-/* xindex is proportional to time and continuously increases. To access the
-arrays, index is the modulo of xindex and wraps around the array bounds
-to form a circular buffer. NUMBER_POINTS is the array size. */
-    int index = xindex % NUMBER_POINTS;
-/* Fill the data arrays */
-    if (breakdown[0].simplified() == "dB1")
+    if (xoffset != 0) return;
+    qint64 latest = history->count();
+    int plotLength = VISIBLE_POINTS*xSamples;
+    qint64 drawn[NUM_PLOTS][HISTORY_CHANNELS];
+    bool scrolled[NUM_PLOTS];
+    for (int index=0; index<NUM_PLOTS; index++)
     {
-        yDataB1Current[index] = current;
-        yDataB1Voltage[index] = voltage;
+        scrolled[index] = true;
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+            drawn[index][channel] = static_cast<CurveData *>
+                (d_curves[index][channel]->data())->end();
     }
-    else if (breakdown[0].simplified() == "dB2")
+    if (latest > plotStartIndex + plotLength)
     {
-        yDataB2Current[index] = current;
-        yDataB2Voltage[index] = voltage;
+        qint64 plotEndIndex = latest + JUMP - latest % JUMP;
+        qint64 newStart = plotEndIndex - plotLength;
+        if ((newStart - plotStartIndex >= plotLength) ||
+            (newStart < history->first()))
+        {
+            showLatest();
+            return;
+        }
+        plotStartIndex = newStart;
+        xRangeMin = (double)plotStartIndex;
+        xRangeMax = xRangeMin+plotLength;
+        setViews(plotStartIndex, latest);
+        for (int index=0; index<NUM_PLOTS; index++)
+            scrolled[index] = scrollPlot(plot(index), xRangeMin, xRangeMax,
+                                         &scrollError[index]);
     }
-    else if (breakdown[0].simplified() == "dB3")
+    else setViews(plotStartIndex, latest);
+    qint64 end = latest - plotStartIndex;
+    plotEnd = (end > plotLength) ? plotLength : (int)end;
+/* Draw from the last point already drawn to join up each curve. A plot that
+could not be scrolled has been redrawn in full. */
+    for (int index=0; index<NUM_PLOTS; index++)
     {
-        yDataB3Current[index] = current;
-        yDataB3Voltage[index] = voltage;
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        {
+            if (! traceVisible(index, channel)) continue;
+            QwtPlotCurve* curve = d_curves[index][channel];
+            CurveData *data = static_cast<CurveData *> (curve->data());
+            size_t size = scrolled[index] ?
+                            data->index(drawn[index][channel]) : data->size();
+            if (data->size() > size)
+                d_directPainter[index]->drawSeries(curve, (size > 0) ? size-1 : 0,
+                                                   data->size()-1);
+        }
     }
-    else if (breakdown[0].simplified() == "dL1")
+    updateStatistics();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Scroll a Plot to a New Time Range
+
+The canvas backing store is moved by the whole number of pixels nearest to the
+shift, and only the strip uncovered at the end is drawn, along with the axis.
+The rounding is carried to the next scroll so that the drawing never drifts
+by more than a pixel. If the canvas has no backing store, or the shift is as
+wide as the canvas, the plot is redrawn in full instead.
+
+@param[in] QwtPlot* plot: the plot to scroll.
+@param[in] double rangeMin: the new start of the x-axis.
+@param[in] double rangeMax: the new end of the x-axis.
+@param[in,out] double* error: the rounding carried between scrolls.
+@returns bool false if the plot was redrawn in full.
+*/
+
+bool PowerManagementMonitorGui::scrollPlot(QwtPlot* plot, double rangeMin,
+                                           double rangeMax, double* error)
+{
+    QwtPlotCanvas* canvas = qobject_cast<QwtPlotCanvas*>(plot->canvas());
+    const QPixmap* backingStore = (canvas == NULL) ? NULL : canvas->backingStore();
+    if ((backingStore == NULL) || backingStore->isNull() ||
+        (backingStore->size() != canvas->size()))
     {
-        yDataL1Current[index] = current;
-        yDataL1Voltage[index] = voltage;
+        *error = 0;
+        plot->setAxisScale(QwtPlot::xBottom, rangeMin, rangeMax);
+        plot->replot();
+        return false;
     }
-    else if (breakdown[0].simplified() == "dL2")
+    const QwtScaleMap map = plot->canvasMap(QwtPlot::xBottom);
+    double shift = map.transform(rangeMin) - map.transform(map.s1()) + *error;
+    int dx = qRound(shift);
+    QRect contents = canvas->contentsRect();
+    plot->setAxisScale(QwtPlot::xBottom, rangeMin, rangeMax);
+    if (dx >= contents.width())
     {
-        yDataL2Current[index] = current;
-        yDataL2Voltage[index] = voltage;
+        *error = 0;
+        plot->replot();
+        return false;
     }
-    else if (breakdown[0].simplified() == "dM1")
+    *error = shift - dx;
+    plot->updateAxes();
+    plot->axisWidget(QwtPlot::xBottom)->update();
+/* The backing store is owned by the canvas, and is drawn from on the next
+paint event. */
+    QPixmap* store = const_cast<QPixmap*>(backingStore);
+    QRegion exposed;
+    store->scroll(-dx, 0, contents, &exposed);
+    QwtScaleMap maps[QwtPlot::axisCnt];
+    for (int axis=0; axis<QwtPlot::axisCnt; axis++)
+        maps[axis] = plot->canvasMap(axis);
+    QPainter painter(store);
+    painter.setClipRegion(exposed);
+    painter.fillRect(exposed.boundingRect(), plot->canvasBackground());
+    plot->drawItems(&painter, contents, maps);
+    painter.end();
+    canvas->update();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Replot the Display Graphs
+
+This sets the curves to view the history over the new range, and redraws the
+plots, with one point or one minimum and maximum pair for each tick of the
+x-axis.
+
+Global xSamples: the x-axis scale factor.
+
+@param qint64 plotStartIndex: frame number at the start of the plot.
+@param int plotEnd: number of frames from the start to plot.
+*/
+void PowerManagementMonitorGui::replot(qint64 plotStartIndex, int plotEnd)
+{
+    int plotLength = VISIBLE_POINTS*xSamples;
+    xRangeMin = (double)plotStartIndex;
+    xRangeMax = xRangeMin+plotLength;
+    setViews(plotStartIndex, plotStartIndex+plotEnd);
+    for (int index=0; index<NUM_PLOTS; index++)
     {
-        yDataM1Current[index] = current;
-        yDataM1Voltage[index] = voltage;
+        plot(index)->setAxisScale(QwtPlot::xBottom, xRangeMin, xRangeMax);
+        scrollError[index] = 0;
+        plot(index)->replot();
+    }
+    updateStatistics();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the Curves Shown to View a Range of the History
+
+@param qint64 from: first frame to show.
+@param qint64 to: frame after the last to show.
+*/
+void PowerManagementMonitorGui::setViews(qint64 from, qint64 to)
+{
+    for (int index=0; index<NUM_PLOTS; index++)
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+            if (traceVisible(index, channel))
+                static_cast<CurveData *> (d_curves[index][channel]->data())->
+                    setView(from, to, xSamples);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief The Plot with a Given Index
+
+@param int index: 0 for the upper plot, 1 for the lower.
+*/
+QwtPlot* PowerManagementMonitorGui::plot(int index) const
+{
+    if (index == 0) return PowerManagementMonitorUi.qwtPlot1;
+    return PowerManagementMonitorUi.qwtPlot2;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Whether a Channel is Shown on a Plot
+
+The source of the plot is always shown, along with any overlays chosen.
+*/
+bool PowerManagementMonitorGui::traceVisible(int index, int channel) const
+{
+    int source = (index == 0) ? source1 : source2;
+    return (channel == source) || overlay[index][channel];
+}
 
-        xData[index] = (float)xindex;
-/* Process Plots with new incoming data, using the incremental plot feature. */
-/* Only every xSamples item. */
-        if ((index % xSamples) == 0)
+//-----------------------------------------------------------------------------
+/** @brief Attach the Curves Shown on a Plot
+
+Curves no longer shown are detached and their statistics dropped. The plot
+is redrawn by the caller.
+*/
+void PowerManagementMonitorGui::showTraces(int index)
+{
+    for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+    {
+        if (traceVisible(index, channel))
+            d_curves[index][channel]->attach(plot(index));
+        else
         {
-/* The plot runs from zero time index to the end of the plot.
-It then jumps back by a single discrete time step to allow room for more data.
-This only happens when the xoffset is zero and is being followed in real time. */
-            int plotLength = VISIBLE_POINTS*xSamples;
-            if ((plotEnd == plotLength) && (xoffset == 0))
-            {
-                on_xoffsetSlider_valueChanged(JUMP);
-            }
-/* Incrementally add to the end of the plots if they are still growing. */
-            plotEnd += xSamples;
-            if (plotEnd >= plotLength) plotEnd = plotLength;
-            CurveData *data1 = static_cast<CurveData *> (d_curve1->data());
-            data1->append(QPointF(xData[index], source1[index]));
-            d_directPainter1->drawSeries(d_curve1,data1->size()-2,data1->size()-1);
-            CurveData *data2 = static_cast<CurveData *> (d_curve2->data());
-            data2->append(QPointF(xData[index], source2[index]));
-            d_directPainter2->drawSeries(d_curve2,data2->size()-2,data2->size()-1);
+            d_curves[index][channel]->detach();
+            statistics[index][channel].clear();
         }
-        xindex++;
     }
 }
 
 //-----------------------------------------------------------------------------
-/** @brief Replot the Display Graphs
+/** @brief Add or Remove an Overlay
 
-This computes the index of the plot start in the data array, wipes the plot
-and replots from the old data.
+The action data holds the plot index and the channel.
+*/
+void PowerManagementMonitorGui::onOverlayTriggered(QAction* action)
+{
+    int index = action->data().toInt() / HISTORY_CHANNELS;
+    int channel = action->data().toInt() % HISTORY_CHANNELS;
+    overlay[index][channel] = action->isChecked();
+    showTraces(index);
+    on_sampleSpinBox_valueChanged(xSamples);
+}
 
-Global xSamples: the x-axis scale factor.
+//-----------------------------------------------------------------------------
+/** @brief Update and Show the Statistics of the Traces
 
-@param int 
+The statistics of each trace shown are moved to cover the frames now on the
+plot, and listed beside the plot in the colour of the trace.
 */
-void PowerManagementMonitorGui::replot(int plotStartIndex, int plotEnd)
+void PowerManagementMonitorGui::updateStatistics()
 {
-    int plotLength = VISIBLE_POINTS*xSamples;
-    int dataStartIndex = plotStartIndex % NUMBER_POINTS;
-    xRangeMin = (float)plotStartIndex;
-    xRangeMax = xRangeMin+plotLength;
-    PowerManagementMonitorUi.qwtPlot1->
-        setAxisScale(QwtPlot::xBottom, xRangeMin, xRangeMax);
-    PowerManagementMonitorUi.qwtPlot2->
-        setAxisScale(QwtPlot::xBottom, xRangeMin, xRangeMax);
-    CurveData *data1 = static_cast<CurveData *> (d_curve1->data());
-    data1->clear();
-    CurveData *data2 = static_cast<CurveData *> (d_curve2->data());
-    data2->clear();
-    QPolygonF points1, points2;
-/* Back fill the plot with old data */
-    for (int i=0; i<plotEnd; i+=xSamples)
+    QLabel* labels[NUM_PLOTS] = {PowerManagementMonitorUi.statisticsLabel1,
+                                 PowerManagementMonitorUi.statisticsLabel2};
+    for (int index=0; index<NUM_PLOTS; index++)
     {
-        int index = (i+dataStartIndex) % NUMBER_POINTS;
-        points1 << QPointF(xData[index],source1[index]);
-        points2 << QPointF(xData[index],source2[index]);
+        QString text("<table><tr><td></td><td>Min</td><td>Max</td>"
+                     "<td>Mean</td><td>RMS</td></tr>");
+        for (int channel=0; channel<HISTORY_CHANNELS; channel++)
+        {
+            if (! traceVisible(index, channel)) continue;
+            TraceStatistics& trace = statistics[index][channel];
+            trace.update(history, channel, plotStartIndex, plotStartIndex+plotEnd);
+            text += QString("<tr><td><font color=\"%1\">%2</font></td>")
+                        .arg(QColor(traceColours[channel]).name())
+                        .arg(channelShortNames[channel]);
+            if (trace.count() > 0)
+                text += QString("<td>%1</td><td>%2</td><td>%3</td><td>%4</td>")
+                        .arg(trace.minimum(),0,'f',2)
+                        .arg(trace.maximum(),0,'f',2)
+                        .arg(trace.mean(),0,'f',2)
+                        .arg(trace.rms(),0,'f',2);
+            text += "</tr>";
+        }
+        text += "</table>";
+        labels[index]->setText(text);
     }
-    d_curve1->setSamples(points1);
-    PowerManagementMonitorUi.qwtPlot1->replot();
-    PowerManagementMonitorUi.qwtPlot1->repaint();
-    d_curve2->setSamples(points2);
-    PowerManagementMonitorUi.qwtPlot2->replot();
-    PowerManagementMonitorUi.qwtPlot2->repaint();
 }
 
 //-----------------------------------------------------------------------------
@@ -539,87 +784,73 @@ void PowerManagementMonitorGui::on_offsetSlider2_valueChanged(int value)
 //-----------------------------------------------------------------------------
 /** @brief Change the Display Graph Horizontal Time Offset
 
-Work back through the array to find the first point to plot. Replot the graph
-from that point on. It will remain steady until xoffset becomes zero.
+The slider covers the whole of the history held, back from the latest data at
+the time the view was last moved from real time. The plot is replotted ending
+at the chosen point, and remains steady until xoffset becomes zero.
 
-xindex is the time index of the latest data point.
-plotEndIndex is the time index at the next discrete time step.
-plotStartIndex is the time index where the plot starts.
-(These indexes are translated to actual indexes in the data circular buffer)
+lastIndex is the frame after the latest data when real time was last viewed.
+plotEndIndex is the frame at the end of the plot, on a grid line.
+plotStartIndex is the frame where the plot starts.
 plotEnd is the point on the plot where the data plot stops.
 plotLength is the length of the plot in xSamples time steps.
 
-value ranges from 0 to 20 in steps of 1.
+value ranges from 0 to OFFSET_STEPS in steps of 1.
 */
 void PowerManagementMonitorGui::on_xoffsetSlider_valueChanged(int offset)
 {
     int plotLength = VISIBLE_POINTS*xSamples;
-/* If the last offset was zero, start from normal operation at xindex which
-is the time index for the latest data point to arrive.
-lastIndex is the point where we last viewed the realtime graph. When offset,
-this remains unchanged until a return to realtime. */
-    if (xoffset == 0) lastIndex = xindex;
-    xoffset = (JUMP-offset)*JUMP;
-/* The number of data points to move the plot back is the offset plus a bit
-to bring the curve to the grid line. */
-    int stepback = lastIndex % JUMP + xoffset;
-/* If the offset is now zero, reset back to normal operation at xindex */
+/* If the last offset was zero, start from the latest data point to arrive.
+When offset, this remains unchanged until a return to realtime. */
+    if (xoffset == 0) lastIndex = history->count();
+    xoffset = OFFSET_STEPS-offset;
     if (xoffset == 0)
     {
-        lastIndex = xindex;
-        stepback = 0;
+        showLatest();
+        return;
     }
-/* If the last index is shorter than the plot length, set end to the index */
-    int plotEndIndex = lastIndex;
-    if (lastIndex > plotLength)
-        plotEndIndex = lastIndex + JUMP - lastIndex % JUMP;
-    int plotStartIndex = plotEndIndex - plotLength;
-/* Deal with very short plots */
-    if (plotStartIndex < 0) plotStartIndex = 0;
-/* Step back the full way if there is room */
-    else if (plotStartIndex > stepback)
-    {
-        plotStartIndex -= stepback;
-        plotEndIndex -= stepback;
-    }
-/* Otherwise start at zero and plot from there */
-    else if (plotStartIndex > 0)
-    {
-        plotStartIndex = 0;
-        plotEndIndex -= plotStartIndex;
-    }
-/* Don't move back to times before the buffered data starts */
-    if (plotStartIndex < xindex - NUMBER_POINTS)
-    {
-        plotStartIndex = xindex - NUMBER_POINTS;
-        plotEndIndex = plotStartIndex + plotLength;
-    }
-    plotEnd = lastIndex - plotStartIndex;
-    if (plotEnd > plotLength) plotEnd = plotLength;
+    qint64 oldest = history->first();
+    qint64 stepback = (lastIndex-oldest)*xoffset/OFFSET_STEPS;
+    qint64 plotEndIndex = lastIndex - stepback;
+    plotEndIndex -= plotEndIndex % JUMP;
+    plotStartIndex = plotEndIndex - plotLength;
+/* Don't move back to times before the held data starts */
+    if (plotStartIndex < oldest) plotStartIndex = oldest;
+    qint64 end = lastIndex - plotStartIndex;
+    plotEnd = (end > plotLength) ? plotLength : (int)end;
+    replot(plotStartIndex, plotEnd);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Show the Latest Data
+
+The plot is set to end at the next grid line after the latest data, so that
+there is room for data to be added in real time.
+*/
+void PowerManagementMonitorGui::showLatest()
+{
+    int plotLength = VISIBLE_POINTS*xSamples;
+    qint64 latest = history->count();
+    qint64 plotEndIndex = latest;
+    if (latest > plotLength)
+        plotEndIndex = latest + JUMP - latest % JUMP;
+    plotStartIndex = plotEndIndex - plotLength;
+    if (plotStartIndex < history->first()) plotStartIndex = history->first();
+    qint64 end = latest - plotStartIndex;
+    plotEnd = (end > plotLength) ? plotLength : (int)end;
     replot(plotStartIndex, plotEnd);
 }
 
 //-----------------------------------------------------------------------------
 /** @brief Change the Display Graph Sample Period
 
-Period can be changed between 1 and 5.
+Period can be changed between 1 and enough frames per tick to show the whole
+history.
 */
 void PowerManagementMonitorGui::on_sampleSpinBox_valueChanged(int value)
 {
     xSamples = value;
-    int plotLength = VISIBLE_POINTS*xSamples;
 /* Refresh the plot for no xoffset similarly to that done for normal plots. */
-    if (xoffset == 0)
-    {
-        int plotEndIndex = xindex;
-        if (xindex > plotLength)
-            plotEndIndex = xindex + JUMP - xindex % JUMP;
-        plotStartIndex = plotEndIndex - plotLength;
-        if (plotStartIndex < 0) plotStartIndex = 0;
-        plotEnd = xindex - plotStartIndex;
-        if (plotEnd > plotLength) plotEnd = plotLength;
-        replot(plotStartIndex, plotEnd);
-    }
+    if (xoffset == 0) showLatest();
 /* For shifted plots need to refresh around the shifted point. */
     else
     {
@@ -30,6 +30,8 @@
 #define _TTY_POSIX_
 
 #include "power-management.h"
+#include "power-management-comms.h"
+#include "power-management-history.h"
 #include "ui_power-management-monitor.h"
 #include <QSerialPort>
 #include <QSerialPortInfo>
@@ -37,14 +39,54 @@
 #include <QDialog>
 #include <QtNetwork>
 #include <QTcpSocket>
+#include <QTimer>
+#include <QMenu>
+#include <QAction>
+#include <QList>
+#include <QPair>
 
-#define NUMBER_POINTS   600
 #define VISIBLE_POINTS  100
 #define JUMP             20
+// Positions of the x offset slider, the last being the latest data
+#define OFFSET_STEPS   1000
+// Time in ms over which new frames are gathered before being drawn
+#define MONITOR_REFRESH 100
+// Number of plots in the window
+#define NUM_PLOTS         2
 
 class QwtPlotCurve;
 class QwtPlotDirectPainter;
 
+//-----------------------------------------------------------------------------
+/** @brief Statistics of a Trace over the Visible Window.
+
+The window is moved by adding the frames that come into view and removing
+those that leave it, each at constant cost. The sums give the mean and RMS.
+The minimum and maximum are the first of two queues holding only the values
+that can still become the extreme as earlier frames leave the window.
+*/
+
+class TraceStatistics
+{
+public:
+    TraceStatistics() { clear(); }
+    void clear();
+    void update(const MonitorHistory* history, int channel,
+                qint64 from, qint64 to);
+    qint64 count() const { return end - start; }
+    double minimum() const { return lows.isEmpty() ? 0 : lows.first().second; }
+    double maximum() const { return highs.isEmpty() ? 0 : highs.first().second; }
+    double mean() const;
+    double rms() const;
+private:
+    qint64 start;
+    qint64 end;
+    double sum;
+    double sumSquares;
+    QList<QPair<qint64,float> > lows;
+    QList<QPair<qint64,float> > highs;
+};
+
 //-----------------------------------------------------------------------------
 /** @brief Power Management Monitor Window.
 
@@ -54,14 +96,11 @@ class PowerManagementMonitorGui : public QDialog
 {
     Q_OBJECT
 public:
-#ifdef SERIAL
-    PowerManagementMonitorGui(QSerialPort* socket, QWidget* parent = 0);
-#else
-    PowerManagementMonitorGui(QTcpSocket* socket, QWidget* parent = 0);
-#endif
+    PowerManagementMonitorGui(PowerManagementComms* socket,
+                              MonitorHistory* history, QWidget* parent = 0);
     ~PowerManagementMonitorGui();
 private slots:
-    void onMessageReceived(const QString &entry);
+    void onRecordReceived(const CommsRecord& record);
     void on_sourceComboBox1_currentIndexChanged(int index);
     void on_offsetSlider1_valueChanged(int value);
     void on_scaleSlider1_valueChanged(int value);
@@ -71,37 +110,36 @@ private slots:
     void on_xoffsetSlider_valueChanged(int value);
     void on_sampleSpinBox_valueChanged(int value);
     void on_closeButton_clicked();
+    void updatePlots();
+    void onOverlayTriggered(QAction* action);
 private:
 // User Interface object instance
     Ui::PowerManagementMonitorDialog PowerManagementMonitorUi;
-#ifdef SERIAL
-    QSerialPort *socket;           //!< Serial port object pointer
-#else
-    QTcpSocket *socket;
-#endif
-    void replot(int plotStartIndex, int plotEnd);
-    QwtPlotCurve *d_curve1, *d_curve2;
-    QwtPlotDirectPainter *d_directPainter1, *d_directPainter2;
+    PowerManagementComms* socket;  //!< Serial port or TCP socket on its I/O thread
+    MonitorHistory* history;       //!< Measurements held by the main window
+    void replot(qint64 plotStartIndex, int plotEnd);
+    void showLatest();
+    bool scrollPlot(QwtPlot* plot, double rangeMin, double rangeMax,
+                    double* error);
+    void setViews(qint64 from, qint64 to);
+    QwtPlot* plot(int index) const;
+    bool traceVisible(int index, int channel) const;
+    void showTraces(int index);
+    void updateStatistics();
+    QwtPlotCurve* d_curves[NUM_PLOTS][HISTORY_CHANNELS];
+    QwtPlotDirectPainter* d_directPainter[NUM_PLOTS];
+    QTimer* refreshTimer;
+    double scrollError[NUM_PLOTS];
+    QMenu* overlayMenu[NUM_PLOTS];
+    bool overlay[NUM_PLOTS][HISTORY_CHANNELS];
+    TraceStatistics statistics[NUM_PLOTS][HISTORY_CHANNELS];
     int xoffset;
     int xSamples;
-    float xRangeMax;
-    float xRangeMin;
-    float xData[NUMBER_POINTS];
-    float yDataB1Current[NUMBER_POINTS];
-    float yDataB1Voltage[NUMBER_POINTS];
-    float yDataB2Current[NUMBER_POINTS];
-    float yDataB2Voltage[NUMBER_POINTS];
-    float yDataB3Current[NUMBER_POINTS];
-    float yDataB3Voltage[NUMBER_POINTS];
-    float yDataL1Current[NUMBER_POINTS];
-    float yDataL1Voltage[NUMBER_POINTS];
-    float yDataL2Current[NUMBER_POINTS];
-    float yDataL2Voltage[NUMBER_POINTS];
-    float yDataM1Current[NUMBER_POINTS];
-    float yDataM1Voltage[NUMBER_POINTS];
-    long long xindex;
-    long long lastIndex;
-    int plotStartIndex, plotEnd;
+    double xRangeMax;
+    double xRangeMin;
+    qint64 lastIndex;
+    qint64 plotStartIndex;
+    int plotEnd;
 
     float yScaleBase1;
     float yScale1;
@@ -109,7 +147,7 @@ private:
     float yOffset1;
     float yRangeMax1;
     float yRangeMin1;
-    float* source1;
+    int source1;
 
     float yScaleBase2;
     float yScale2;
@@ -117,7 +155,7 @@ private:
     float yOffset2;
     float yRangeMax2;
     float yRangeMin2;
-    float* source2;
+    int source2;
 };
 
 #endif
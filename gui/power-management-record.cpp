@@ -5,6 +5,13 @@ file on the attached medium, notably an SD card.
 
 The files on the card are displayed and a new one suggested.
 Recording is started and stopped, at which the file is closed.
+
+A file on the card can be downloaded to a local file. The download can be
+paused and carried on later from the end of the local file.
+
+The listing of the card is kept while the link to the remote unit is open, and
+fetched again in batches only when the remote unit shows that the card
+directory has changed.
 */
 /****************************************************************************
  *   Copyright (C) 2013 by Ken Sarkies                                      *
@@ -41,6 +48,8 @@ Recording is started and stopped, at which the file is closed.
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileDialog>
+#include <QTimer>
 #include <QDebug>
 #include <QStandardItemModel>
 #include <QtNetwork>
@@ -53,23 +62,21 @@ Recording is started and stopped, at which the file is closed.
 /** Recording GUI Constructor
 
 The remote unit is queried for status of recording and storage drive statistics.
-The directory listing is obtained from the remote unit. 
+The directory listing held from before is shown, and is obtained again from the
+remote unit if the card has changed.
 
-@param[in] socket TCP Socket object pointer
+@param[in] socket Communications link to the remote unit
+@param[in] cardListing Card root listing held for the link.
 @param[in] parent Parent widget.
 */
 
-#ifdef SERIAL
-PowerManagementRecordGui::PowerManagementRecordGui(QSerialPort* p, QWidget* parent)
+PowerManagementRecordGui::PowerManagementRecordGui(PowerManagementComms* p,
+                                                   CardListing* cardListing,
+                                                   QWidget* parent)
                                                     : QDialog(parent)
 {
     socket = p;
-#else
-PowerManagementRecordGui::PowerManagementRecordGui(QTcpSocket* tcpSocket, QWidget* parent)
-                                                    : QDialog(parent)
-{
-    socket = tcpSocket;
-#endif
+    cachedListing = cardListing;
     PowerManagementRecordUi.setupUi(this);
     requestRecordingStatus();
 // Ask for the microcontroller SD card free space (process response later)
@@ -86,13 +93,26 @@ PowerManagementRecordGui::PowerManagementRecordGui(QTcpSocket* tcpSocket, QWidge
     connect(PowerManagementRecordUi.fileTableView,
                      SIGNAL(clicked(const QModelIndex)),
                      this,SLOT(onListItemClicked(const QModelIndex)));
+    listing = false;
+    directoryTimer = new QTimer(this);
+    directoryTimer->setSingleShot(true);
+    connect(directoryTimer, SIGNAL(timeout()), this, SLOT(onDirectoryTimeout()));
 // Send a command to refresh the directory
     refreshDirectory();
     writeFileHandle = 0xFF;
+    readFileHandle = 0xFF;
+    readFileOpen = false;
+    localFile = NULL;
+    downloading = false;
+    downloadSize = 0;
+    downloadTimer = new QTimer(this);
+    downloadTimer->setSingleShot(true);
+    connect(downloadTimer, SIGNAL(timeout()), this, SLOT(onDownloadTimeout()));
 }
 
 PowerManagementRecordGui::~PowerManagementRecordGui()
 {
+    delete localFile;
 }
 
 //-----------------------------------------------------------------------------
@@ -186,26 +206,25 @@ void PowerManagementRecordGui::on_closeFileButton_clicked()
 }
 
 //-----------------------------------------------------------------------------
-/** @brief Process a Message.
+/** @brief Process a Record.
 
-After a command is sent, response messages from the remote are passed here for
-processing. Appropriate fields on the form are updated.
+After a command is sent, response records from the remote are passed here
+already decoded, and appropriate fields on the form are updated. Only the
+directory listings and file names are taken from the text of the line.
 
-@todo This interprets response as done in main. See if this can be made
-independent of formats.
+@param CommsRecord record: the line received and its decoded fields.
 */
 
-void PowerManagementRecordGui::onMessageReceived(const QString &response)
+void PowerManagementRecordGui::onRecordReceived(const CommsRecord& record)
 {
-    QStringList breakdown = response.split(",");
-    QString command = breakdown[0].right(1);
-// Error Code
-    switch (command[0].toLatin1())
+    const ResponseFields& fields = record.fields;
+    switch (fields.identifier[1])
     {
 // Show Free Space
         case 'F':
         {
-            int freeSpace = breakdown[2].toInt()*breakdown[1].toInt()/2048;
+            if (fields.size <= 2) break;
+            int freeSpace = fields.field[2]*fields.field[1]/2048;
             PowerManagementRecordUi.diskSpaceAvailable->setText(QString("%1 M")\
                                                     .arg(freeSpace, 0, 10));
             break;
@@ -216,34 +235,11 @@ The response will be a comma separated list of items preceded by a type.
 */
         case 'D':
         {
+            QStringList breakdown = record.line.split(",");
             model->clear();
             if (breakdown.size() <= 1) break;
             for (int i=1; i<breakdown.size(); i++)
-            {
-                QChar type = breakdown[i][0];
-                bool ok;
-                QString fileSize = QString("%1")
-                    .arg((float)breakdown[i].mid(1,8).toInt(&ok,16)/1000000,8,'f',3);
-                if (type == 'd')
-                    fileSize = "";
-                if ((type == 'f') || (type == 'd'))
-                {
-                    QString fileName = breakdown[i].mid(9,breakdown[i].length()-1);
-                    QFont font;
-                    if (type == 'd') font.setBold(true);
-                    QStandardItem *nameItem = new QStandardItem(fileName);
-                    QStandardItem *sizeItem = new QStandardItem(fileSize);
-                    QList<QStandardItem *> row;
-                    nameItem->setFont(font);
-                    nameItem->setData(Qt::AlignLeft, Qt::TextAlignmentRole);
-                    sizeItem->setData(Qt::AlignRight, Qt::TextAlignmentRole);
-                    row.append(nameItem);
-                    row.append(sizeItem);
-                    nameItem->setData(QVariant(type));
-//                    item->setIcon(...);
-                    model->appendRow(row);
-                }
-            }
+                appendDirectoryEntry(breakdown[i]);
             break;
         }
 /* Directory listing incremental.
@@ -254,6 +250,7 @@ the previous entry has been fully received.
 */
         case 'd':
         {
+            QStringList breakdown = record.line.split(",");
             if (breakdown.size() < 1) break;
 // Empty parameters received indicates the directory listing has ended.
             directoryEnded = (breakdown.size() == 1);
@@ -261,70 +258,75 @@ the previous entry has been fully received.
             nextDirectoryEntry = true;
             for (int i=1; i<breakdown.size(); i++)
             {
-                QChar type = breakdown[i][0];
-                bool ok;
-                QString fileSize = QString("%1")
-                    .arg((float)breakdown[i].mid(1,8).toInt(&ok,16)/1000000,8,'f',3);
-                if (type == 'd')
-                    fileSize = "";
-                if ((type == 'f') || (type == 'd'))
-                {
-                    QString fileName = breakdown[i].mid(9,breakdown[i].length()-1);
-                    QFont font;
-                    if (type == 'd') font.setBold(true);
-                    QStandardItem *nameItem = new QStandardItem(fileName);
-                    QStandardItem *sizeItem = new QStandardItem(fileSize);
-                    QList<QStandardItem *> row;
-                    nameItem->setFont(font);
-                    nameItem->setData(Qt::AlignLeft, Qt::TextAlignmentRole);
-                    sizeItem->setData(Qt::AlignRight, Qt::TextAlignmentRole);
-                    row.append(nameItem);
-                    row.append(sizeItem);
-                    nameItem->setData(QVariant(type));
-//                    item->setIcon(...);
-                    model->appendRow(row);
-                }
+                appendDirectoryEntry(breakdown[i]);
 /* Request the next entry by sending another incremental directory command with
 no directory name. */
                 socket->write("fd\r\n");
             }
             break;
         }
+/* Directory listing in batches, or the count of changes to the directory. */
+        case 'l':
+        {
+            receiveListing(record.line);
+            break;
+        }
 // Status of recording and open files.
 // The write and read file handles are retrieved from this
         case 's':
         {
-            if (breakdown.size() <= 1) break;
-            recordingOn = (breakdown[1].toInt() & 0x02) > 0;
+            if (fields.size <= 1) break;
+            recordingOn = (fields.field[1] & 0x02) > 0;
             if (recordingOn)  // recording on
                 PowerManagementRecordUi.startButton->
                     setStyleSheet("background-color:lightgreen;");
             else
                 PowerManagementRecordUi.startButton->
                     setStyleSheet("background-color:lightpink;");
-            if (breakdown.size() <= 2) break;
-            writeFileHandle = breakdown[2].toInt();
+            if (fields.size <= 2) break;
+            writeFileHandle = fields.field[2];
             writeFileOpen = (writeFileHandle < 255);
             if (writeFileOpen)
             {
                 PowerManagementRecordUi.recordFileButton->
                     setStyleSheet("background-color:lightgreen;");
-                PowerManagementRecordUi.recordFileName->setText(breakdown[3]);
+                PowerManagementRecordUi.recordFileName->
+                    setText(record.line.section(',',3,3));
             }
             else
                 PowerManagementRecordUi.recordFileButton->
                     setStyleSheet("background-color:lightpink;");
-            if (breakdown.size() <= 3) break;
-            readFileHandle = breakdown[3].toInt();
+            if (fields.size <= 3) break;
+            readFileHandle = fields.field[3];
             readFileOpen = (readFileHandle < 255);
             if (readFileOpen)
-                 PowerManagementRecordUi.readFileName->setText(breakdown[3]);
+                 PowerManagementRecordUi.readFileName->
+                    setText(record.line.section(',',3,3));
            break;
         }
 // Open a file for recording.
         case 'W':
         {
-            writeFileHandle = extractValue(response);
+            writeFileHandle = fields.field[1];
+            break;
+        }
+// Open a file for reading.
+        case 'R':
+        {
+            readFileHandle = fields.field[1];
+            readFileOpen = (readFileHandle < 255);
+            if (readFileOpen)
+                PowerManagementRecordUi.readFileButton->
+                    setStyleSheet("background-color:lightgreen;");
+            else
+                PowerManagementRecordUi.readFileButton->
+                    setStyleSheet("background-color:lightpink;");
+            break;
+        }
+// Block of a file being downloaded.
+        case 'b':
+        {
+            receiveBlock(record.line);
             break;
         }
         case 'E':
@@ -348,7 +350,7 @@ no directory name. */
                                      "LFN working buffer could not be allocated",
                                      "Too many open files",
                                      "Invalid Parameter"};
-            int status = breakdown[1].toInt();
+            int status = fields.field[1];
             if ((status > 0) && (status < 20))
                 PowerManagementRecordUi.errorLabel->setText(errorText[status-1]);
             break;
@@ -356,23 +358,6 @@ no directory name. */
     }
 }
 
-//-----------------------------------------------------------------------------
-/** @brief Extract an Integer Value from a Response.
-
-*/
-
-int PowerManagementRecordGui::extractValue(const QString &response)
-{
-    int i = 4;
-    QString temp;
-    while (response[i] >= '0')
-    {
-        temp[i-4] = response[i];
-        i++;
-    }
-    return temp.toInt();
-}
-
 //-----------------------------------------------------------------------------
 /** @brief Slot to process Directory Entry Clicks.
 
@@ -382,13 +367,14 @@ Display filename in edit box, or enter a directory and redisplay.
 void PowerManagementRecordGui::onListItemClicked(const QModelIndex & index)
 {
     PowerManagementRecordUi.recordFileName->clear();
-    QStandardItem *item = model->itemFromIndex(index);
+    QStandardItem *item = model->itemFromIndex(index.sibling(index.row(),0));
     QString fileName = item->text();
     QChar type = item->data().toChar();
     if (type == 'f')
     {
         PowerManagementRecordUi.recordFileName->setText(fileName);
         PowerManagementRecordUi.readFileName->setText(fileName);
+        if (! downloading) downloadSize = item->data(FILE_SIZE_ROLE).toLongLong();
     }
     if (type == 'd')
         socket->write(QString("fD%1\n\r").arg(fileName).toLocal8Bit().data());
@@ -418,15 +404,17 @@ void PowerManagementRecordGui::on_registerButton_clicked()
 //-----------------------------------------------------------------------------
 /** @brief Refresh the Directory.
 
-This requests the first directory entry for the top directory only.
-Subsequent directory entries are obtained when the response to the previous
-one has been received.
+The listing held for the top directory is shown, and the count of changes to
+the card directory is asked for. The listing is fetched again when the response
+shows that the count differs from that of the listing held.
 */
 
 void PowerManagementRecordGui::refreshDirectory()
 {
     model->clear();
-    socket->write("fd/\n\r");
+    for (int i=0; i<cachedListing->entries.size(); i++)
+        appendDirectoryEntry(cachedListing->entries[i]);
+    socket->write("fl0\n\r");
 }
 
 //-----------------------------------------------------------------------------
@@ -449,4 +437,357 @@ void PowerManagementRecordGui::getFreeSpace()
     socket->write("fF\n\r");
 }
 
+//-----------------------------------------------------------------------------
+/** @brief CRC-16 of a Downloaded Block.
+
+CCITT polynomial 0x1021 with initial value 0xFFFF, most significant bit first,
+as computed by the firmware.
+*/
+
+static quint16 crc16(const QByteArray& data)
+{
+    quint16 crc = 0xFFFF;
+    for (int i=0; i<data.size(); i++)
+    {
+        crc ^= (quint16)((quint8)data[i] << 8);
+        for (int bit=0; bit<8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open the Remote File for Reading.
+
+Any file already open for reading is closed first. The handle is taken from
+the response later.
+*/
+
+void PowerManagementRecordGui::on_readFileButton_clicked()
+{
+    QString fileName = PowerManagementRecordUi.readFileName->text();
+    if (downloading || (fileName.length() == 0)) return;
+    if (readFileOpen)
+        socket->write(QString("fC%1\n\r").arg(readFileHandle).toLocal8Bit().data());
+    readFileHandle = 0xFF;
+    readFileOpen = false;
+    socket->write("fR");
+    socket->write(fileName.toLocal8Bit().data());
+    socket->write("\n\r");
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Choose the Local File.
+
+An existing file is not overwritten, as the download carries on from its end.
+*/
+
+void PowerManagementRecordGui::on_localFileButton_clicked()
+{
+    if (downloading) return;
+    QString fileName = QFileDialog::getSaveFileName(this,
+                            "Local File for Download",
+                            PowerManagementRecordUi.readFileName->text(),
+                            QString(), NULL, QFileDialog::DontConfirmOverwrite);
+    if (! fileName.isEmpty())
+        PowerManagementRecordUi.localFileName->setText(fileName);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start or Resume a Download.
+
+The remote file must be open for reading. Blocks are asked for from the end
+of the local file, so that a download that was paused or broken off carries
+on where it stopped.
+*/
+
+void PowerManagementRecordGui::on_downloadButton_clicked()
+{
+    if (downloading) return;
+    if (! readFileOpen)
+    {
+        PowerManagementRecordUi.errorLabel->setText("Remote file not open");
+        return;
+    }
+    QString fileName = PowerManagementRecordUi.localFileName->text();
+    if (fileName.isEmpty())
+    {
+        PowerManagementRecordUi.errorLabel->setText("No local file");
+        return;
+    }
+    delete localFile;
+    localFile = new QFile(fileName);
+    if (! localFile->open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        PowerManagementRecordUi.errorLabel->setText("Could not open local file");
+        delete localFile;
+        localFile = NULL;
+        return;
+    }
+    downloadOffset = localFile->size();
+    requestedOffset = downloadOffset;
+    resendOffset = -1;
+    downloading = true;
+    PowerManagementRecordUi.errorLabel->setText("Downloading");
+    PowerManagementRecordUi.downloadButton->
+        setStyleSheet("background-color:lightgreen;");
+    PowerManagementRecordUi.progressBar->setValue(0);
+    requestBlocks();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Pause the Download.
+
+The local file is closed, and the download carries on from its end when
+started again.
+*/
+
+void PowerManagementRecordGui::on_pauseDownloadButton_clicked()
+{
+    if (downloading) stopDownload("Download paused");
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Cancel the Download.
+
+The download is stopped and the remote file closed. The part already received
+is kept in the local file.
+*/
+
+void PowerManagementRecordGui::on_cancelDownloadButton_clicked()
+{
+    stopDownload("Download cancelled");
+    if (readFileOpen)
+        socket->write(QString("fC%1\n\r").arg(readFileHandle).toLocal8Bit().data());
+    readFileHandle = 0xFF;
+    readFileOpen = false;
+    PowerManagementRecordUi.readFileButton->setStyleSheet("");
+    PowerManagementRecordUi.progressBar->setValue(0);
+}
 
+//-----------------------------------------------------------------------------
+/** @brief Ask for the Download Again after a Silence.
+
+A request or its blocks may have been lost altogether, so the download is asked
+for again from the first block still wanted.
+*/
+
+void PowerManagementRecordGui::onDownloadTimeout()
+{
+    if (! downloading) return;
+    requestedOffset = downloadOffset;
+    resendOffset = downloadOffset;
+    requestBlocks();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Ask for Blocks of the Remote File.
+
+Requests are sent until DOWNLOAD_REQUESTS of them are waiting beyond the blocks
+received, so that the remote unit always has the next request to hand when it
+finishes a request.
+*/
+
+void PowerManagementRecordGui::requestBlocks()
+{
+    const qint64 window = DOWNLOAD_BLOCKS*DOWNLOAD_BLOCK_SIZE;
+    while (requestedOffset - downloadOffset < DOWNLOAD_REQUESTS*window)
+    {
+        socket->write(QString("fB%1,%2,%3\n\r").arg(readFileHandle)
+                                               .arg(requestedOffset)
+                                               .arg(DOWNLOAD_BLOCKS)
+                                               .toLocal8Bit().data());
+        requestedOffset += window;
+    }
+    downloadTimer->start(DOWNLOAD_TIMEOUT);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Process a Block of the Remote File.
+
+The line is fb,offset,data,crc with the offset and CRC in hex and the data in
+base64. Only the block at the next offset wanted is written. A block further on
+or with a bad CRC shows that something was lost, so the download is asked for
+again from the next offset wanted, once only until that block arrives, as the
+blocks already on their way will also be out of place. Blocks from earlier
+offsets are repeats and are dropped. A short block ends the file.
+
+@param QString line: the line received.
+*/
+
+void PowerManagementRecordGui::receiveBlock(const QString& line)
+{
+    if (! downloading) return;
+    bool ok;
+    qint64 offset = line.section(',',1,1).toLongLong(&ok,16);
+    if (! ok || (offset < downloadOffset)) return;
+    QByteArray block = QByteArray::fromBase64(line.section(',',2,2).toLatin1());
+    uint crc = line.section(',',3,3).toUInt(&ok,16);
+    if ((offset > downloadOffset) || ! ok || (crc != crc16(block)) ||
+        (block.size() > DOWNLOAD_BLOCK_SIZE))
+    {
+        if (resendOffset != downloadOffset)
+        {
+            requestedOffset = downloadOffset;
+            resendOffset = downloadOffset;
+            requestBlocks();
+        }
+        return;
+    }
+    if (localFile->write(block) != block.size())
+    {
+        stopDownload("Could not write local file");
+        return;
+    }
+    downloadOffset += block.size();
+    if ((downloadSize > 0) && (downloadOffset <= downloadSize))
+        PowerManagementRecordUi.progressBar->
+            setValue((int)(downloadOffset*100/downloadSize));
+    if (block.size() < DOWNLOAD_BLOCK_SIZE)
+    {
+        PowerManagementRecordUi.progressBar->setValue(100);
+        stopDownload("Download complete");
+        return;
+    }
+    requestBlocks();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Stop the Download.
+
+Blocks still on their way are dropped when they arrive.
+
+@param QString message: text for the error label.
+*/
+
+void PowerManagementRecordGui::stopDownload(const QString& message)
+{
+    downloading = false;
+    downloadTimer->stop();
+    if (localFile != NULL) localFile->close();
+    PowerManagementRecordUi.downloadButton->setStyleSheet("");
+    PowerManagementRecordUi.errorLabel->setText(message);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add an Entry to the Directory Listing.
+
+@param QString entry: the type, size as eight hex digits, and name.
+*/
+
+void PowerManagementRecordGui::appendDirectoryEntry(const QString& entry)
+{
+    if (entry.isEmpty()) return;
+    QChar type = entry[0];
+    bool ok;
+    QString fileSize = QString("%1")
+        .arg((float)entry.mid(1,8).toInt(&ok,16)/1000000,8,'f',3);
+    if (type == 'd')
+        fileSize = "";
+    if ((type == 'f') || (type == 'd'))
+    {
+        QString fileName = entry.mid(9,entry.length()-1);
+        QFont font;
+        if (type == 'd') font.setBold(true);
+        QStandardItem *nameItem = new QStandardItem(fileName);
+        QStandardItem *sizeItem = new QStandardItem(fileSize);
+        QList<QStandardItem *> row;
+        nameItem->setFont(font);
+        nameItem->setData(Qt::AlignLeft, Qt::TextAlignmentRole);
+        sizeItem->setData(Qt::AlignRight, Qt::TextAlignmentRole);
+        row.append(nameItem);
+        row.append(sizeItem);
+        nameItem->setData(QVariant(type));
+        nameItem->setData(entry.mid(1,8).toLongLong(&ok,16),
+                          FILE_SIZE_ROLE);
+//            item->setIcon(...);
+        model->appendRow(row);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start Fetching the Directory Listing.
+
+The first request names the directory and the others carry on from it, so that
+the next batch is already asked for when each batch arrives.
+*/
+
+void PowerManagementRecordGui::startListing()
+{
+    listing = true;
+    listingRestarted = true;
+    listingChanges = -1;
+    pendingListing.clear();
+    socket->write(QString("fl%1,/\n\r").arg(DIRECTORY_BATCH).toLocal8Bit().data());
+    for (int i=1; i<DIRECTORY_REQUESTS; i++)
+        socket->write(QString("fl%1\n\r").arg(DIRECTORY_BATCH).toLocal8Bit().data());
+    directoryTimer->start(DIRECTORY_TIMEOUT);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Process a Batch of the Directory Listing.
+
+The line is fl,changes or fl,changes,position,entries... with the count of
+changes in hex. A line with no position answers a request for the count only,
+and starts the listing if the count differs from that of the listing held.
+
+A batch is taken only if its position follows on from the entries already
+held. A batch further on shows that one was lost, so the listing is started
+again, and batches are then dropped until the first arrives. Fewer entries than
+asked for ends the listing, which is then shown and kept. If the count changed
+while the listing was fetched it is not taken as current, so that it is fetched
+again at the next refresh.
+
+@param QString line: the line received.
+*/
+
+void PowerManagementRecordGui::receiveListing(const QString& line)
+{
+    QStringList breakdown = line.split(",");
+    if (breakdown.size() < 2) return;
+    bool ok;
+    qint64 changes = breakdown[1].toLongLong(&ok,16);
+    if (! ok) return;
+    if (breakdown.size() == 2)
+    {
+        if (! listing && (changes != cachedListing->changes)) startListing();
+        return;
+    }
+    if (! listing) return;
+    int position = breakdown[2].toInt(&ok);
+    if (! ok) return;
+    if (position != pendingListing.size())
+    {
+        if ((position > pendingListing.size()) && ! listingRestarted)
+            startListing();
+        return;
+    }
+    listingRestarted = false;
+    if (position == 0) listingChanges = changes;
+    else if (changes != listingChanges) listingChanges = -1;
+    pendingListing.append(breakdown.mid(3));
+    if (breakdown.size()-3 < DIRECTORY_BATCH)
+    {
+        listing = false;
+        directoryTimer->stop();
+        cachedListing->entries = pendingListing;
+        cachedListing->changes = listingChanges;
+        model->clear();
+        for (int i=0; i<cachedListing->entries.size(); i++)
+            appendDirectoryEntry(cachedListing->entries[i]);
+        return;
+    }
+    socket->write(QString("fl%1\n\r").arg(DIRECTORY_BATCH).toLocal8Bit().data());
+    directoryTimer->start(DIRECTORY_TIMEOUT);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start the Listing Again after a Silence.
+
+A response may have been lost after which no more requests are waiting.
+*/
+
+void PowerManagementRecordGui::onDirectoryTimeout()
+{
+    if (listing) startListing();
+}
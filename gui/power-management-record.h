@@ -30,28 +30,69 @@
 #define _TTY_POSIX_
 
 #include "power-management.h"
+#include "power-management-comms.h"
 #include "ui_power-management-record.h"
 #include <QSerialPort>
 #include <QSerialPortInfo>
 #include <QDialog>
 #include <QStandardItemModel>
+#include <QFile>
+#include <QTimer>
 #include <QtNetwork>
 #include <QTcpSocket>
 
+// Bytes in each block of a download, and blocks asked for in each request, as
+// FILE_BLOCK_SIZE and FILE_BLOCK_WINDOW in the firmware
+#define DOWNLOAD_BLOCK_SIZE 180
+#define DOWNLOAD_BLOCKS     16
+// Requests kept waiting at the remote unit so that the link does not idle
+#define DOWNLOAD_REQUESTS   2
+// Time in ms without a good block before the download is asked for again
+#define DOWNLOAD_TIMEOUT    3000
+// Item data role holding the size in bytes of a file in the directory listing
+#define FILE_SIZE_ROLE      (Qt::UserRole+2)
+// Directory entries asked for in each request, as FILE_LIST_BATCH in the firmware
+#define DIRECTORY_BATCH     10
+// Listing requests kept waiting at the remote unit
+#define DIRECTORY_REQUESTS  2
+// Time in ms without a response before the listing is started again
+#define DIRECTORY_TIMEOUT   5000
+
+//-----------------------------------------------------------------------------
+/** @brief Listing of the card root held between openings of the window.
+
+It belongs to the communications link and is emptied when the link is closed,
+so that the listing of one unit is never shown for another.
+*/
+
+typedef struct
+{
+    QStringList entries;
+    qint64 changes;             // count of card changes when fetched, -1 if none
+} CardListing;
+
 //-----------------------------------------------------------------------------
 /** @brief Power Management Recording Window.
 
+Files on the remote unit are downloaded in blocks, each with its offset in the
+file and a CRC. More than one request for blocks is kept waiting so that the
+link stays busy, and the download goes back to the first block that is missing
+or bad. The local file is appended to, so that a paused or broken download
+carries on from where it stopped.
+
+The listing of the card root is fetched in batches of entries, with the next
+batch asked for before the last has arrived. It is kept by the main window
+between openings of this window together with a count of changes to the card
+directory from the remote unit, and is only fetched again when that count has
+changed.
 */
 
 class PowerManagementRecordGui : public QDialog
 {
     Q_OBJECT
 public:
-#ifdef SERIAL
-    PowerManagementRecordGui(QSerialPort* socket, QWidget* parent = 0);
-#else
-    PowerManagementRecordGui(QTcpSocket* socket, QWidget* parent = 0);
-#endif
+    PowerManagementRecordGui(PowerManagementComms* socket,
+                             CardListing* cachedListing, QWidget* parent = 0);
     ~PowerManagementRecordGui();
 private slots:
     void on_deleteButton_clicked();
@@ -59,22 +100,31 @@ private slots:
     void on_stopButton_clicked();
     void on_closeFileButton_clicked();
     void on_recordFileButton_clicked();
-    void onMessageReceived(const QString &text);
+    void onRecordReceived(const CommsRecord& record);
     void onListItemClicked(const QModelIndex & index);
     void on_registerButton_clicked();
     void on_closeButton_clicked();
+    void on_readFileButton_clicked();
+    void on_localFileButton_clicked();
+    void on_downloadButton_clicked();
+    void on_pauseDownloadButton_clicked();
+    void on_cancelDownloadButton_clicked();
+    void onDownloadTimeout();
+    void onDirectoryTimeout();
 private:
 // User Interface object instance
     Ui::PowerManagementRecordDialog PowerManagementRecordUi;
-#ifdef SERIAL
-    QSerialPort *socket;           //!< Serial port object pointer
-#else
-    QTcpSocket *socket;
-#endif
-    int extractValue(const QString &response);
+    PowerManagementComms* socket;  //!< Serial port or TCP socket on its I/O thread
+    CardListing* cachedListing;    //!< Card root listing kept by the main window
     void requestRecordingStatus();
     void refreshDirectory();
     void getFreeSpace();
+    void receiveBlock(const QString& line);
+    void requestBlocks();
+    void stopDownload(const QString& message);
+    void appendDirectoryEntry(const QString& entry);
+    void receiveListing(const QString& line);
+    void startListing();
     int writeFileHandle;
     int readFileHandle;
     bool recordingOn;
@@ -84,6 +134,18 @@ private:
     int row;
     bool directoryEnded;
     bool nextDirectoryEntry;
+    QFile* localFile;
+    QTimer* downloadTimer;
+    bool downloading;
+    qint64 downloadOffset;          //!< Next byte wanted from the remote file
+    qint64 requestedOffset;         //!< Byte after the last one asked for
+    qint64 resendOffset;            //!< Offset last asked for again
+    qint64 downloadSize;            //!< Size of the remote file if known
+    QTimer* directoryTimer;
+    bool listing;
+    bool listingRestarted;          //!< Waiting for the first batch again
+    qint64 listingChanges;          //!< Change count of the batches so far
+    QStringList pendingListing;
 
 };
 
@@ -12,6 +12,9 @@ Call with power-management [options]
 -b   baudrate (from 2400, 4800, 9600, 19200, 38400 default, 57600, 115200)
 -a   TCP address (192.168.2.14 default)
 -p   TCP port (6666 default)
+-B   saved session over which to time the response decoding, then exit
+-R   size in MB at which a new save file is started (0 default, never)
+-T   time in minutes after which a new save file is started (0 default, never)
 
 The first two are used only when compiled for serial comms, and the latter when
 compiled for TCP/IP.
@@ -47,6 +50,7 @@ Uses: Qt version 4.8.1
 #include "power-management-main.h"
 #include <QApplication>
 #include <QMessageBox>
+#include "power-management-benchmark.h"
 
 //-----------------------------------------------------------------------------
 /** @brief Power Management GUI Main Program
@@ -58,15 +62,20 @@ int main(int argc,char ** argv)
 /* Interpret any command line options */
     char c;
     opterr = 0;
+    QString replayFile;
+    QString benchmarkFile;
+    double replaySpeed = DEFAULT_REPLAY_SPEED;
+    qint64 rotateSize = LOG_ROTATE_SIZE;
+    int rotateTime = LOG_ROTATE_TIME;
 #ifdef SERIAL
     QString serialDevice = DEFAULT_SERIAL_PORT;
     uint initialBaudrate = DEFAULT_BAUDRATE;
     int baudParm;
-    while ((c = getopt (argc, argv, "P:b:")) != -1)
+    while ((c = getopt (argc, argv, "B:P:R:T:b:r:s:")) != -1)
 #else
     QString tcpAddress = DEFAULT_TCP_ADDRESS;
     uint tcpPort = DEFAULT_TCP_PORT;
-    while ((c = getopt (argc, argv, "a:p:")) != -1)
+    while ((c = getopt (argc, argv, "B:R:T:a:p:r:s:")) != -1)
 #endif
     {
         switch (c)
@@ -104,13 +113,52 @@ int main(int argc,char ** argv)
             tcpPort = atoi(optarg);
             break;
 #endif
+// Saved session over which to time the response decoding
+        case 'B':
+            benchmarkFile = optarg;
+            break;
+// Saved session to replay
+        case 'r':
+            replayFile = optarg;
+            break;
+// Replay speed
+        case 's':
+            replaySpeed = atof(optarg);
+            if (replaySpeed < 0)
+            {
+                fprintf (stderr, "Invalid replay speed %s.\n", optarg);
+                return false;
+            }
+            break;
+// Save file size limit
+        case 'R':
+            rotateSize = (qint64)(atof(optarg)*1048576);
+            if (rotateSize < 0)
+            {
+                fprintf (stderr, "Invalid save file size %s.\n", optarg);
+                return false;
+            }
+            break;
+// Save file time limit
+        case 'T':
+            rotateTime = atoi(optarg)*60;
+            if (rotateTime < 0)
+            {
+                fprintf (stderr, "Invalid save file time %s.\n", optarg);
+                return false;
+            }
+            break;
 // Unknown
         case '?':
 #ifdef SERIAL
-            if ((optopt == 'P') || (optopt == 'b'))
+            if ((optopt == 'P') || (optopt == 'b') || (optopt == 'B') ||
+                (optopt == 'R') || (optopt == 'T') ||
+                (optopt == 'r') || (optopt == 's'))
                 fprintf (stderr, "Option -%c requires an argument.\n", optopt);
 #else
-            if ((optopt == 'a') || (optopt == 'p'))
+            if ((optopt == 'a') || (optopt == 'p') || (optopt == 'B') ||
+                (optopt == 'R') || (optopt == 'T') ||
+                (optopt == 'r') || (optopt == 's'))
                 fprintf (stderr, "Option -%c requires an argument.\n", optopt);
 #endif
             else if (isprint (optopt))
@@ -120,6 +168,7 @@ int main(int argc,char ** argv)
             default: return false;
         }
     }
+    if (! benchmarkFile.isEmpty()) return benchmarkResponses(benchmarkFile);
     QString inDevice;
     uint parameter;
 #ifdef SERIAL
@@ -131,7 +180,9 @@ int main(int argc,char ** argv)
 #endif
 
     QApplication application(argc,argv);
-    PowerManagementGui powerManagementGui(inDevice,parameter);
+    PowerManagementGui powerManagementGui(inDevice,parameter,
+                                          replayFile,replaySpeed,
+                                          rotateSize,rotateTime);
     if (powerManagementGui.success())
     {
         powerManagementGui.show();
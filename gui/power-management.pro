@@ -29,9 +29,19 @@ HEADERS         += power-management-main.h
 HEADERS         += power-management-monitor.h
 HEADERS         += power-management-configure.h
 HEADERS         += power-management-record.h
+HEADERS         += power-management-comms.h
+HEADERS         += power-management-log.h
+HEADERS         += power-management-capture.h
+HEADERS         += power-management-history.h
+HEADERS         += power-management-benchmark.h
 SOURCES         += power-management.cpp
 SOURCES         += power-management-main.cpp
 SOURCES         += power-management-monitor.cpp
 SOURCES         += power-management-configure.cpp
 SOURCES         += power-management-record.cpp
+SOURCES         += power-management-comms.cpp
+SOURCES         += power-management-log.cpp
+SOURCES         += power-management-capture.cpp
+SOURCES         += power-management-history.cpp
+SOURCES         += power-management-benchmark.cpp
 
@@ -0,0 +1,1116 @@
+/*       Power Management Simulator Unit
+
+The simulated unit answers the command set of the Battery Management System
+firmware and produces its measurement records, so that the GUI and the data
+processing programs can be run against realistic traffic with no hardware
+attached.
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include "power-management-sim-unit.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDebug>
+#include <QtMath>
+
+//-----------------------------------------------------------------------------
+/** @brief Convert leading ASCII decimal digits to an integer.
+
+As in the firmware, conversion stops at the first character that is not a
+digit, and no sign is accepted.
+
+@param[in] QByteArray line: the command line.
+@param[in] int position: index of the first digit.
+@returns int the value, or zero if there are no digits.
+*/
+
+static int asciiToInt(const QByteArray& line, int position)
+{
+    int number = 0;
+    while ((position < line.size()) &&
+           (line[position] >= '0') && (line[position] <= '9'))
+    {
+        number = number*10+(line[position] - '0');
+        position++;
+    }
+    return number;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief CRC-16 of a file block as computed by the firmware.
+
+CCITT polynomial 0x1021 with initial value 0xFFFF, most significant bit first.
+*/
+
+static quint16 crc16(const QByteArray& data)
+{
+    quint16 crc = 0xFFFF;
+    for (int i=0; i<data.size(); i++)
+    {
+        crc ^= (quint16)((quint8)data[i] << 8);
+        for (int bit=0; bit<8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Small random variation in the range -0.5 to 0.5.
+*/
+
+static double noise()
+{
+    return (double)(qrand() % 1000)/1000 - 0.5;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Append a record with one or two integer parameters.
+*/
+
+static void appendRecord(QByteArray* out, const char* ident, int param1)
+{
+    out->append(ident);
+    out->append(',');
+    out->append(QByteArray::number(param1));
+    out->append("\r\n");
+}
+
+static void appendRecord(QByteArray* out, const char* ident, int param1,
+                         int param2)
+{
+    out->append(ident);
+    out->append(',');
+    out->append(QByteArray::number(param1));
+    out->append(',');
+    out->append(QByteArray::number(param2));
+    out->append("\r\n");
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Simulated Unit Constructor
+
+The configuration starts with the firmware defaults. The first battery takes
+the loads and the second, if present, the panel.
+
+@param[in] int batteries: number of batteries, 1 to SIM_MAX_BATTERIES.
+@param[in] QString cardDirectory: directory standing in for the SD card.
+*/
+
+SimulatedUnit::SimulatedUnit(int batteries, const QString& cardDirectory)
+            : batteries(batteries), card(cardDirectory)
+{
+    for (int i=0; i<SIM_MAX_BATTERIES; i++)
+    {
+        battery[i].current = 0;
+        battery[i].soc = 60+10*(i % 4);
+        battery[i].voltage = 11.9+0.012*battery[i].soc;
+        battery[i].resistance = 0.015+0.005*(i % 3);
+        battery[i].type = ((i % 3) == 1) ? 1 : 0;   // wet, gel, wet
+        battery[i].capacity = 100;
+        battery[i].missing = false;
+        setChargeParameters(i);
+    }
+    for (int i=0; i<SIM_LOADS; i++)
+    {
+        loadCurrent[i] = 0;
+        loadVoltage[i] = 0;
+    }
+    for (int i=0; i<SIM_PANELS; i++)
+    {
+        panelCurrent[i] = 0;
+        panelVoltage[i] = 0;
+    }
+    temperature = 20;
+// Loads on battery 1, panel on battery 2 (or 1)
+    switchBits = 1 | (1 << 2) | (((batteries > 1) ? 2 : 1) << 4);
+    indicators = 0;
+    decisionStatus = 0;
+    quiescentCurrent = 0;
+    unitTime = QDateTime::currentMSecsSinceEpoch();
+    frames = 0;
+    enableSend = false;
+    measurementSend = true;
+    debugMessageSend = false;
+    autoTrack = false;
+    recording = false;
+    monitorStrategy = 0xFF;
+    lowVoltage = 3072;
+    criticalVoltage = 2995;
+    lowSoC = 60*256;
+    criticalSoC = 45*256;
+    floatBulkSoC = 95*256;
+    chargerStrategy = 0;
+    restTime = 30;
+    absorptionTime = 90;
+    minDutyCycle = 256;
+    floatTime = 7200;
+    writeFile = NULL;
+    writeOpenSize = 0;
+    readFile = NULL;
+    directoryChanges = (quint32)(QDateTime::currentMSecsSinceEpoch()/1000) << 8;
+    listPosition = 0;
+    lapseClock.start();
+}
+
+SimulatedUnit::~SimulatedUnit()
+{
+    delete writeFile;
+    delete readFile;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Act on a command line.
+
+Commands are a category character (a=action, d=data request, p=parameter,
+f=file) followed by a command character and parameters, as interpreted by
+parseCommand in the firmware. Unrecognizable commands are discarded.
+
+Any command, even an empty line, keeps the unit sending. Nothing is sent back
+unless sending has been enabled by pc+.
+
+@param[in] QByteArray line: command without its line ending.
+@returns QByteArray response lines, or empty if there is no response.
+*/
+
+QByteArray SimulatedUnit::command(const QByteArray& line)
+{
+    lapseClock.restart();
+    QByteArray out;
+    if (line.size() < 2) return out;
+    switch (line[0])
+    {
+    case 'a': parseAction(line,&out); break;
+    case 'd': parseDataRequest(line,&out); break;
+    case 'p': parseParameter(line,&out); break;
+    case 'f': parseFile(line,&out); break;
+    }
+    if (! enableSend) out.clear();
+    return out;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Action commands.
+*/
+
+void SimulatedUnit::parseAction(const QByteArray& line, QByteArray* out)
+{
+    switch (line[1])
+    {
+// Snm Manually set switch, battery n (0 = none) to load/panel m (1-3)
+    case 'S':
+        if (line.size() < 4) break;
+        setSwitch(line[2]-'0',line[3]-'0'-1);
+        break;
+// Rn Reset a tripped overcurrent circuit breaker n (0-5)
+    case 'R':
+        {
+            int intf = line.size() > 2 ? line[2]-'0' : -1;
+            if ((intf >= 0) && (intf < 6)) indicators &= ~(3 << (2*intf));
+            break;
+        }
+// W Write the configuration block to FLASH. Nothing is kept.
+    case 'W':
+        break;
+// E Send an ident response
+    case 'E':
+        string(out,"dE",QByteArray("Battery Management System,")
+                        .append(SIM_FIRMWARE_VERSION).append(',')
+                        .append(QByteArray::number(SIM_HARDWARE_VERSION)));
+        break;
+// Bn Set the battery SoC from the measured open circuit voltage
+    case 'B':
+        {
+            int i = line.size() > 2 ? line[2]-'1' : -1;
+            if ((i < 0) || (i >= batteries)) break;
+            battery[i].soc = qBound(0.0,(battery[i].voltage-11.9)/0.012,100.0);
+            break;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Data request commands.
+*/
+
+void SimulatedUnit::parseDataRequest(const QByteArray& line, QByteArray* out)
+{
+    switch (line[1])
+    {
+// S Switch settings and controls
+    case 'S':
+        response(out,"dS",switchBits);
+        response(out,"dD",controls());
+        break;
+// Bn Battery n parameters
+    case 'B':
+        {
+            int i = line.size() > 2 ? line[2]-'1' : -1;
+            if ((i < 0) || (i >= batteries)) break;
+            char id[] = "pR0";
+            id[2] = line[2];
+            dataMessage(out,id,(int)(battery[i].resistance*65536),0);
+            id[1] = 'T';
+            dataMessage(out,id,battery[i].type,battery[i].capacity);
+            id[1] = 'F';
+            dataMessage(out,id,battery[i].floatStageCurrentScale,
+                               battery[i].floatVoltage);
+            id[1] = 'A';
+            dataMessage(out,id,battery[i].bulkCurrentLimitScale,
+                               battery[i].absorptionVoltage);
+            break;
+        }
+// T Monitor strategy parameters
+    case 'T':
+        dataMessage(out,"pts",monitorStrategy,0);
+        dataMessage(out,"ptV",lowVoltage,criticalVoltage);
+        dataMessage(out,"ptS",lowSoC,criticalSoC);
+        dataMessage(out,"ptF",floatBulkSoC,0);
+        break;
+// C Charger strategy parameters
+    case 'C':
+        dataMessage(out,"pcs",chargerStrategy,0);
+        dataMessage(out,"pcR",restTime,absorptionTime);
+        dataMessage(out,"pcD",minDutyCycle,0);
+        dataMessage(out,"pcF",floatTime,floatBulkSoC);
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Parameter setting commands.
+*/
+
+void SimulatedUnit::parseParameter(const QByteArray& line, QByteArray* out)
+{
+    char setting = line.size() > 2 ? line[2] : 0;
+    int i = setting-'1';
+    bool isBattery = (i >= 0) && (i < batteries);
+    switch (line[1])
+    {
+// a-, a+ autoTracking
+    case 'a':
+        if (setting == '-') autoTrack = false;
+        else if (setting == '+') autoTrack = true;
+        break;
+// c-, c+ communications sending
+    case 'c':
+        if (setting == '-') enableSend = false;
+        else if (setting == '+') enableSend = true;
+        break;
+// C calibration, which completes at once with a quiescent current measured
+    case 'C':
+        {
+            for (int test=0; test<6; test++) dataMessage(out,"pQ",0,test);
+            quiescentCurrent = (int)((0.05+0.01*noise())*256);
+            dataMessage(out,"pQ",quiescentCurrent,7);
+            response(out,"dS",switchBits);
+            break;
+        }
+// d-, d+ debug messages
+    case 'd':
+        if (setting == '+') debugMessageSend = true;
+        if (setting == '-') debugMessageSend = false;
+        break;
+// Hxxxx time from an ISO 8601 formatted string
+    case 'H':
+        {
+            QDateTime time = QDateTime::fromString(QString::fromLatin1(
+                                                   line.mid(2)),Qt::ISODate);
+            if (time.isValid()) unitTime = time.toMSecsSinceEpoch();
+            break;
+        }
+// M-, M+ data messaging
+    case 'M':
+        if (setting == '-') measurementSend = false;
+        else if (setting == '+') measurementSend = true;
+        break;
+// r-, r+ recording, only with a write file open
+    case 'r':
+        if (setting == '-') recording = false;
+        else if ((setting == '+') && (writeFile != NULL)) recording = true;
+        break;
+// Tntxx battery type t and capacity xx
+    case 'T':
+        if (isBattery && (line.size() > 3) && (line[3] >= '0') && (line[3] < '3'))
+        {
+            battery[i].type = line[3]-'0';
+            battery[i].capacity = asciiToInt(line,4);
+            setChargeParameters(i);
+        }
+        break;
+// mn-, mn+ battery missing
+    case 'm':
+        if (! isBattery || (line.size() < 4)) break;
+        if (line[3] == '-') battery[i].missing = false;
+        else if (line[3] == '+') battery[i].missing = true;
+        break;
+// Inxx bulk current limit
+    case 'I':
+        if (isBattery) battery[i].bulkCurrentLimitScale = asciiToInt(line,3);
+        break;
+// Anxx gassing voltage limit
+    case 'A':
+        if (isBattery) battery[i].absorptionVoltage = asciiToInt(line,3);
+        break;
+// fnxx float current trigger
+    case 'f':
+        if (isBattery) battery[i].floatStageCurrentScale = asciiToInt(line,3);
+        break;
+// Fnxx float voltage limit
+    case 'F':
+        if (isBattery) battery[i].floatVoltage = asciiToInt(line,3);
+        break;
+// zn zero current calibration. The simulated currents have no offset.
+    case 'z':
+        break;
+// sm monitor strategy
+    case 's':
+        if ((setting >= '0') && (setting <= '3')) monitorStrategy = setting-'0';
+        break;
+// vx, Vx, xx, Xx low and critical voltage and SoC thresholds
+    case 'v': lowVoltage = asciiToInt(line,2); break;
+    case 'V': criticalVoltage = asciiToInt(line,2); break;
+    case 'x': lowSoC = asciiToInt(line,2); break;
+    case 'X': criticalSoC = asciiToInt(line,2); break;
+// Sm charger strategy
+    case 'S':
+        if ((setting >= '0') && (setting < '2')) chargerStrategy = setting-'0';
+        break;
+// Rx, Gx, Dx, ex, Bx charger times, duty cycle and float to bulk SoC
+    case 'R': restTime = asciiToInt(line,2); break;
+    case 'G': absorptionTime = asciiToInt(line,2); break;
+    case 'D': minDutyCycle = asciiToInt(line,2); break;
+    case 'e': floatTime = asciiToInt(line,2); break;
+    case 'B': floatBulkSoC = asciiToInt(line,2); break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief File commands.
+
+All commands except the status request return an fE status. Only one file for
+writing and a second for reading can be open.
+*/
+
+void SimulatedUnit::parseFile(const QByteArray& line, QByteArray* out)
+{
+    QByteArray name = line.mid(2);
+    int status = SIM_FR_INT_ERR;
+    switch (line[1])
+    {
+// F Free clusters and the cluster size in bytes
+    case 'F':
+        dataMessage(out,"fF",(int)((SIM_CARD_SIZE-cardUsed())/SIM_CLUSTER_SIZE),
+                    SIM_CLUSTER_SIZE);
+        status = SIM_FR_OK;
+        break;
+// Wf, Rf Open file f for writing (appending) or reading
+    case 'W':
+    case 'R':
+        {
+            if (name.size() >= SIM_NAME_LENGTH) return;
+            int handle = SIM_NO_HANDLE;
+            status = openFile(name,line[1] == 'W',&handle);
+            response(out,line[1] == 'W' ? "fW" : "fR",handle);
+            break;
+        }
+// Chh Close the file with handle hh
+    case 'C':
+        status = closeFile(asciiToInt(line,2));
+        break;
+// Ghh Read records from the read file. As in the firmware the number of records
+// is taken from the same field as the handle.
+    case 'G':
+        {
+            int numberRecords = qMax(asciiToInt(line,2),1);
+            status = SIM_FR_DENIED;
+            if (readFile == NULL) break;
+            status = SIM_FR_OK;
+            while (numberRecords-- > 0)
+            {
+                QByteArray record = readFile->readLine(79);
+                if (record.isEmpty())
+                {
+                    status = SIM_FR_DENIED;
+                    break;
+                }
+                string(out,"fG",record);
+            }
+            break;
+        }
+// Bhh,o,n Send n blocks of the read file from byte offset o, each as
+// fb,offset,base64 data,CRC with the offset and CRC in hex. A short block ends
+// the request.
+    case 'B':
+        {
+            int position = 2;
+            while ((position < line.size()) && (line[position] != ',')) position++;
+            qint64 offset = asciiToInt(line,position+1);
+            position++;
+            while ((position < line.size()) && (line[position] != ',')) position++;
+            int numberBlocks = qBound(1,asciiToInt(line,position+1),SIM_BLOCK_WINDOW);
+            status = SIM_FR_DENIED;
+            if ((readFile == NULL) || (asciiToInt(line,2) != 1)) break;
+            status = SIM_FR_OK;
+            readFile->seek(qMin(offset,readFile->size()));
+            while (numberBlocks-- > 0)
+            {
+                QByteArray block = readFile->read(SIM_BLOCK_SIZE);
+                out->append("fb,");
+                out->append(QByteArray::number(offset,16).toUpper()
+                                .rightJustified(8,'0'));
+                out->append(',');
+                out->append(block.toBase64());
+                out->append(',');
+                out->append(QByteArray::number(crc16(block),16).toUpper()
+                                .rightJustified(4,'0'));
+                out->append("\r\n");
+                offset += block.size();
+                if (block.size() < SIM_BLOCK_SIZE) break;
+            }
+            break;
+        }
+// Dd Full listing of directory d, each entry preceded by a comma
+    case 'D':
+        {
+            QString path;
+            status = SIM_FR_NO_PATH;
+            out->append("fD");
+            if (cardPath(name,&path) && QFileInfo(path).isDir())
+            {
+                directoryList = QDir(path).entryList(QDir::AllEntries |
+                                      QDir::NoDotAndDotDot,QDir::Name);
+                directoryPath = path;
+                while (! directoryList.isEmpty()) directoryEntry(out);
+                status = SIM_FR_OK;
+            }
+            out->append("\r\n");
+            break;
+        }
+// d[d] First entry of directory d, or the next entry if no name is given. An
+// empty entry ends the listing.
+    case 'd':
+        {
+            status = SIM_FR_OK;
+            if (! name.isEmpty())
+            {
+                QString path;
+                directoryList.clear();
+                if (cardPath(name,&path) && QFileInfo(path).isDir())
+                {
+                    directoryList = QDir(path).entryList(QDir::AllEntries |
+                                          QDir::NoDotAndDotDot,QDir::Name);
+                    directoryPath = path;
+                }
+                else status = SIM_FR_NO_PATH;
+            }
+            out->append("fd");
+            if (! directoryList.isEmpty()) directoryEntry(out);
+            out->append("\r\n");
+            break;
+        }
+// ln[,d] Up to n entries of directory d, or the next n entries if no name is
+// given, preceded by the count of changes to the directory entries and the
+// position of the first entry. Fewer than n entries ends the listing. With n
+// zero only the count is sent.
+    case 'l':
+        {
+            int numberEntries = qMin(asciiToInt(line,2),SIM_LIST_BATCH);
+            int comma = line.indexOf(',');
+            QByteArray directory = (comma < 0) ? QByteArray() : line.mid(comma+1);
+            status = SIM_FR_OK;
+            if ((numberEntries > 0) && ! directory.isEmpty())
+            {
+                QString path;
+                directoryList.clear();
+                listPosition = 0;
+                if (cardPath(directory,&path) && QFileInfo(path).isDir())
+                {
+                    directoryList = QDir(path).entryList(QDir::AllEntries |
+                                          QDir::NoDotAndDotDot,QDir::Name);
+                    directoryPath = path;
+                }
+                else status = SIM_FR_NO_PATH;
+            }
+            out->append("fl,");
+            out->append(QByteArray::number(directoryChanges,16).toUpper()
+                            .rightJustified(8,'0'));
+            if (numberEntries > 0)
+            {
+                out->append(',');
+                out->append(QByteArray::number(listPosition));
+            }
+            while ((numberEntries-- > 0) && ! directoryList.isEmpty())
+            {
+                directoryEntry(out);
+                listPosition++;
+            }
+            out->append("\r\n");
+            break;
+        }
+// M Mount the SD card
+    case 'M':
+        status = card.exists() ? SIM_FR_OK : SIM_FR_NO_PATH;
+        directoryChanges++;
+        break;
+// s Status of recording and names of the open files. No status follows.
+    case 's':
+        out->append("fs,");
+        out->append(QByteArray::number(controls()));
+        out->append(',');
+        out->append(QByteArray::number(writeFile != NULL ? 0 : SIM_NO_HANDLE));
+        out->append(',');
+        if (writeFile != NULL)
+        {
+            out->append(writeFileName.toLatin1());
+            out->append(',');
+        }
+        out->append(QByteArray::number(readFile != NULL ? 1 : SIM_NO_HANDLE));
+        if (readFile != NULL)
+        {
+            out->append(',');
+            out->append(readFileName.toLatin1());
+        }
+        out->append("\r\n");
+        return;
+// Xf Delete file f, which must not be open
+    case 'X':
+        {
+            QString path;
+            status = SIM_FR_NO_FILE;
+            if (! cardPath(name,&path) || ! QFileInfo(path).isFile()) break;
+            if ((name == writeFileName.toLatin1()) ||
+                (name == readFileName.toLatin1())) status = SIM_FR_DENIED;
+            else if (QFile::remove(path))
+            {
+                status = SIM_FR_OK;
+                directoryChanges++;
+            }
+            else status = SIM_FR_DENIED;
+            break;
+        }
+    default:
+        return;
+    }
+    response(out,"fE",status);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Produce one frame of measurement records.
+
+The model is advanced by one monitor period of unit time, so that at the
+default rate the unit clock keeps pace with real time and at higher rates the
+records look as they would from a unit running for longer. The frame is
+recorded to the write file if recording is on.
+
+@returns QByteArray the records to be sent, empty if sending is off.
+*/
+
+QByteArray SimulatedUnit::frame()
+{
+    if (enableSend && lapseClock.hasExpired(SIM_LAPSE_TIME)) enableSend = false;
+    step();
+    QByteArray out;
+    out.append("pH,");
+    out.append(QDateTime::fromMSecsSinceEpoch(unitTime)
+                    .toString("yyyy-MM-ddThh:mm:ss").toLatin1());
+    out.append("\r\n");
+    int timeLength = out.size();
+    char id[] = "d00";
+    for (int i=0; i<batteries; i++)
+    {
+        id[2] = '1'+i;
+        id[1] = 'B';
+        appendRecord(&out,id,(int)(battery[i].current*256),
+                             (int)(battery[i].voltage*256));
+        id[1] = 'C';
+        appendRecord(&out,id,(int)(battery[i].soc*256));
+        id[1] = 'O';
+        appendRecord(&out,id,batteryStates(i));
+    }
+    id[1] = 'L';
+    for (int i=0; i<SIM_LOADS; i++)
+    {
+        id[2] = '1'+i;
+        appendRecord(&out,id,(int)(loadCurrent[i]*256),(int)(loadVoltage[i]*256));
+    }
+    id[1] = 'M';
+    for (int i=0; i<SIM_PANELS; i++)
+    {
+        id[2] = '1'+i;
+        appendRecord(&out,id,(int)(panelCurrent[i]*256),
+                             (int)(panelVoltage[i]*256));
+    }
+    appendRecord(&out,"dT",(int)(temperature*256));
+    appendRecord(&out,"dD",controls());
+    appendRecord(&out,"ds",switchBits);
+    if (autoTrack) appendRecord(&out,"dd",decisionStatus);
+    appendRecord(&out,"dI",indicators);
+    record(out);
+// The time record is sent as a debug string regardless of data messaging
+    if (! enableSend) return QByteArray();
+    if (! measurementSend) out.truncate(timeLength);
+    return out;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Advance the model by one monitor period.
+
+The panel follows the sun through the unit day and the loads switch between
+light and heavy use. Each battery carries the current of the loads and panel
+switched to it, and its state of charge and terminal voltage follow.
+*/
+
+void SimulatedUnit::step()
+{
+    double interval = (double)SIM_MONITOR_PERIOD/1000;
+    unitTime += SIM_MONITOR_PERIOD;
+    frames++;
+    double hour = (double)QDateTime::fromMSecsSinceEpoch(unitTime).time()
+                    .msecsSinceStartOfDay()/3600000;
+    double sun = qMax(0.0,qSin(M_PI*(hour-6)/12));
+    temperature = 18+8*sun+0.1*noise();
+    for (int i=0; i<batteries; i++) battery[i].current = 0;
+    loadCurrent[0] = 1.5+0.2*noise();
+    loadCurrent[1] = (((frames/256) % 4) == 0 ? 4.0 : 0.5)+0.2*noise();
+    for (int i=0; i<SIM_LOADS; i++)
+    {
+        int b = switchedBattery(i);
+        if ((b < 0) || battery[b].missing) loadCurrent[i] = 0;
+        else battery[b].current -= loadCurrent[i];
+    }
+    for (int i=0; i<SIM_PANELS; i++)
+    {
+        panelCurrent[i] = qMax(0.0,12*sun+0.1*noise());
+        int b = switchedBattery(SIM_LOADS+i);
+        if ((b < 0) || battery[b].missing) panelCurrent[i] = 0;
+        else battery[b].current += panelCurrent[i];
+    }
+    for (int i=0; i<batteries; i++)
+    {
+        if (battery[i].missing)
+        {
+            battery[i].current = 0;
+            battery[i].voltage = 0;
+            continue;
+        }
+        battery[i].soc = qBound(0.0,battery[i].soc+battery[i].current*interval
+                                    /36/battery[i].capacity,100.0);
+        battery[i].voltage = 11.9+0.012*battery[i].soc
+                           +battery[i].current*battery[i].resistance
+                           +0.005*noise();
+    }
+    for (int i=0; i<SIM_LOADS; i++)
+    {
+        int b = switchedBattery(i);
+        loadVoltage[i] = (b < 0) ? 0 : battery[b].voltage;
+    }
+    for (int i=0; i<SIM_PANELS; i++)
+    {
+        int b = switchedBattery(SIM_LOADS+i);
+        panelVoltage[i] = (b < 0) ? 21*sun : battery[b].voltage+0.3*sun;
+    }
+    decisionStatus = autoTrack ? 0x100 : 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the switch.
+
+Each two bit field of the switch holds the battery (1-3, 0 = none) connected to
+load 1, load 2 and the panel in turn. Batteries beyond the third cannot be
+switched and stay isolated.
+
+@param[in] int battery: battery 1-3 or 0 to disconnect.
+@param[in] int setting: 0-1 for the loads, 2 for the panel.
+*/
+
+void SimulatedUnit::setSwitch(int battery, int setting)
+{
+    if ((battery < 0) || (battery > 3) || (battery > batteries)) return;
+    if ((setting < 0) || (setting > 2)) return;
+    switchBits = (switchBits & ~(3 << (2*setting))) | (battery << (2*setting));
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Battery switched to a load or panel.
+
+@param[in] int setting: 0-1 for the loads, 2 for the panel.
+@returns int battery index, or -1 if none.
+*/
+
+int SimulatedUnit::switchedBattery(int setting) const
+{
+    return ((switchBits >> (2*setting)) & 3)-1;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Control bits as sent in dD and fs records.
+*/
+
+int SimulatedUnit::controls() const
+{
+    int bits = 0;
+    if (autoTrack) bits |= 1 << 0;
+    if (recording) bits |= 1 << 1;
+    if (measurementSend) bits |= 1 << 3;
+    if (debugMessageSend) bits |= 1 << 4;
+    return bits;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Battery states as sent in dO records.
+
+The two bit fields are the operational state (loaded, charging, isolated), the
+fill state (normal, low, critical), the charging phase (bulk, absorption, float)
+and the health (good, missing).
+*/
+
+int SimulatedUnit::batteryStates(int i) const
+{
+    int op = 2;
+    if ((switchedBattery(0) == i) || (switchedBattery(1) == i)) op = 0;
+    if (switchedBattery(SIM_LOADS) == i) op = 1;
+    int fill = 0;
+    if (battery[i].soc*256 < criticalSoC) fill = 2;
+    else if (battery[i].soc*256 < lowSoC) fill = 1;
+    int phase = 0;
+    if (battery[i].soc*256 >= floatBulkSoC) phase = 2;
+    else if (battery[i].voltage*256 >= battery[i].absorptionVoltage) phase = 1;
+    int health = battery[i].missing ? 2 : 0;
+    return op | (fill << 2) | (phase << 4) | (health << 6);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the charge parameters for the battery type at 25C.
+*/
+
+void SimulatedUnit::setChargeParameters(int i)
+{
+    switch (battery[i].type)
+    {
+    case 0:                                     // wet
+        battery[i].absorptionVoltage = 3686;
+        battery[i].floatVoltage = 3379;
+        break;
+    case 2:                                     // agm
+        battery[i].absorptionVoltage = 3738;
+        battery[i].floatVoltage = 3482;
+        break;
+    default:                                    // gel
+        battery[i].absorptionVoltage = 3584;
+        battery[i].floatVoltage = 3532;
+    }
+    battery[i].floatStageCurrentScale = 50;
+    battery[i].bulkCurrentLimitScale = 5;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Responses that are only sent while data messaging is on.
+*/
+
+void SimulatedUnit::dataMessage(QByteArray* out, const char* ident, int param1,
+                                int param2) const
+{
+    if (measurementSend) appendRecord(out,ident,param1,param2);
+}
+
+void SimulatedUnit::response(QByteArray* out, const char* ident,
+                             int parameter) const
+{
+    if (measurementSend) appendRecord(out,ident,parameter);
+}
+
+void SimulatedUnit::string(QByteArray* out, const char* ident,
+                           const QByteArray& text) const
+{
+    if (! measurementSend) return;
+    out->append(ident);
+    out->append(',');
+    out->append(text);
+    out->append("\r\n");
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Record lines to the write file while recording.
+*/
+
+void SimulatedUnit::record(const QByteArray& lines)
+{
+    if (! recording || (writeFile == NULL)) return;
+    writeFile->write(lines);
+    writeFile->flush();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Find the host path of a name on the card.
+
+Names are taken relative to the card directory, and an empty name or / is the
+card root. Names that would leave the card are refused.
+
+@param[in] QByteArray name: file or directory name.
+@param[out] QString* path: host path.
+@returns bool false if the name is refused.
+*/
+
+bool SimulatedUnit::cardPath(const QByteArray& name, QString* path) const
+{
+    QString cardName = QString::fromLatin1(name).trimmed();
+    while (cardName.startsWith('/')) cardName.remove(0,1);
+    if (cardName.split('/').contains("..")) return false;
+    *path = cardName.isEmpty() ? card.absolutePath()
+                               : card.absoluteFilePath(cardName);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Open a file on the card.
+
+The write file is opened for appending and is created if needed. It is given
+handle 0 and the read file handle 1.
+
+@param[in] QByteArray name: 8.3 file name.
+@param[in] bool write: true to open the write file.
+@param[out] int* handle: handle of the file, or SIM_NO_HANDLE.
+@returns int file status.
+*/
+
+int SimulatedUnit::openFile(const QByteArray& name, bool write, int* handle)
+{
+    QString path;
+    *handle = SIM_NO_HANDLE;
+    if (! cardPath(name,&path) || name.isEmpty()) return SIM_FR_NO_FILE;
+    if ((write ? writeFile : readFile) != NULL) return SIM_FR_DENIED;
+    bool created = ! QFile::exists(path);
+    QFile* file = new QFile(path);
+    if (! file->open(write ? (QIODevice::WriteOnly | QIODevice::Append)
+                           : QIODevice::ReadOnly))
+    {
+        delete file;
+        return write ? SIM_FR_DENIED : SIM_FR_NO_FILE;
+    }
+    if (write)
+    {
+        writeFile = file;
+        writeFileName = QString::fromLatin1(name);
+        writeOpenSize = file->size();
+        *handle = 0;
+        if (created) directoryChanges++;
+    }
+    else
+    {
+        readFile = file;
+        readFileName = QString::fromLatin1(name);
+        *handle = 1;
+    }
+    return SIM_FR_OK;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Close a file on the card.
+
+Recording stops when the write file is closed.
+
+@param[in] int handle: 0 for the write file, 1 for the read file.
+@returns int file status.
+*/
+
+int SimulatedUnit::closeFile(int handle)
+{
+    if ((handle == 0) && (writeFile != NULL))
+    {
+        recording = false;
+        if (writeFile->size() != writeOpenSize) directoryChanges++;
+        delete writeFile;
+        writeFile = NULL;
+        writeFileName.clear();
+        return SIM_FR_OK;
+    }
+    if ((handle == 1) && (readFile != NULL))
+    {
+        delete readFile;
+        readFile = NULL;
+        readFileName.clear();
+        return SIM_FR_OK;
+    }
+    return SIM_FR_INT_ERR;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Send the next directory entry.
+
+The entry is a comma, the type (f or d), the size as eight hex digits and the
+name.
+*/
+
+void SimulatedUnit::directoryEntry(QByteArray* out)
+{
+    QFileInfo info(QDir(directoryPath),directoryList.takeFirst());
+    out->append(',');
+    out->append(info.isDir() ? 'd' : 'f');
+    out->append(QByteArray::number(info.isDir() ? 0 : (uint)info.size(),16)
+                    .toUpper().rightJustified(8,'0'));
+    out->append(info.fileName().toLatin1());
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Bytes used by files in the card root.
+*/
+
+qint64 SimulatedUnit::cardUsed() const
+{
+    qint64 used = 0;
+    foreach (const QFileInfo& info, card.entryInfoList(QDir::Files))
+        used += info.size();
+    return used;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Simulator Constructor
+
+@param[in] SimulatedUnit* unit: the unit answering commands.
+@param[in] double rate: measurement frames per second.
+@param[in] parent Parent object.
+*/
+
+Simulator::Simulator(SimulatedUnit* unit, double rate, QObject* parent)
+            : QObject(parent), unit(unit), rate(rate)
+{
+    server = new QTcpServer(this);
+    connect(server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    frameTimer = new QTimer(this);
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    int interval = (int)(1000/rate);
+    frameTimer->setInterval(interval < 1 ? 1 : interval);
+    connect(frameTimer, SIGNAL(timeout()), this, SLOT(sendFrames()));
+    framesSent = 0;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Start listening and sending frames.
+
+@param[in] quint16 port: TCP port.
+@returns bool false if the port could not be opened.
+*/
+
+bool Simulator::listen(quint16 port)
+{
+    if (! server->listen(QHostAddress::Any, port)) return false;
+    frameClock.start();
+    frameTimer->start();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Accept clients.
+*/
+
+void Simulator::newConnection()
+{
+    while (server->hasPendingConnections())
+    {
+        QTcpSocket* client = server->nextPendingConnection();
+        connect(client, SIGNAL(readyRead()), this, SLOT(readCommands()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+        clients.append(client);
+        droppedFrames.insert(client,0);
+        qDebug() << "Connection from" << client->peerAddress().toString();
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Collect command lines from a client.
+
+As in the firmware a line ends at a carriage return or line feed, or is cut
+at 79 characters.
+*/
+
+void Simulator::readCommands()
+{
+    QTcpSocket* client = qobject_cast<QTcpSocket*>(sender());
+    if (client == NULL) return;
+    QByteArray& line = commandLines[client];
+    QByteArray data = client->readAll();
+    for (int i=0; i<data.size(); i++)
+    {
+        char character = data[i];
+        if ((character == '\r') || (character == '\n') || (line.size() > 78))
+        {
+            QByteArray reply = unit->command(line);
+            line.clear();
+            if (! reply.isEmpty()) client->write(reply);
+        }
+        else line.append(character);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief A client has gone.
+*/
+
+void Simulator::clientDisconnected()
+{
+    QTcpSocket* client = qobject_cast<QTcpSocket*>(sender());
+    if (client == NULL) return;
+    qDebug() << "Disconnected" << client->peerAddress().toString()
+             << "frames dropped" << droppedFrames.value(client);
+    clients.removeAll(client);
+    commandLines.remove(client);
+    droppedFrames.remove(client);
+    client->deleteLater();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Send the frames that are due.
+
+The number due is taken from the time since the start so that the rate holds
+above the timer resolution. Frames due in one call are written together. If
+the simulator falls too far behind, the backlog is abandoned rather than sent
+in a burst.
+*/
+
+void Simulator::sendFrames()
+{
+    qint64 due = (qint64)(frameClock.elapsed()*rate/1000)-framesSent;
+    if (due > SIM_FRAME_BURST)
+    {
+        framesSent += due-SIM_FRAME_BURST;
+        due = SIM_FRAME_BURST;
+    }
+    QByteArray data;
+    qint64 frameCount = due;
+    for (; due > 0; due--)
+    {
+        data.append(unit->frame());
+        framesSent++;
+    }
+    if (data.isEmpty()) return;
+    foreach (QTcpSocket* client, clients)
+    {
+        if (client->bytesToWrite() > SIM_WRITE_LIMIT)
+            droppedFrames[client] += frameCount;
+        else client->write(data);
+    }
+}
@@ -0,0 +1,226 @@
+/*          Power Management Simulator Unit Header
+
+@date 16 October 2026
+*/
+
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#ifndef POWER_MANAGEMENT_SIM_UNIT_H
+#define POWER_MANAGEMENT_SIM_UNIT_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// TCP port listened on by default, as used by the GUI
+#define SIM_PORT 6666
+// Directory standing in for the SD card by default, created if needed. The
+// file commands can delete files in it, so it is kept apart from other files.
+#define SIM_CARD_DIRECTORY "sim-card"
+// Identification sent in response to aE, as given by the firmware
+#define SIM_FIRMWARE_VERSION "1.07b - 10.2.1 - 0.13c - 2019-07-07"
+#define SIM_HARDWARE_VERSION 1
+// Number of batteries simulated by default, and the most that can be named
+#define SIM_BATTERIES 3
+#define SIM_MAX_BATTERIES 9
+#define SIM_LOADS 2
+#define SIM_PANELS 1
+// Unit time in ms between measurement frames, as the firmware monitor task
+#define SIM_MONITOR_PERIOD 512
+// Time in ms without a command after which the unit stops sending
+#define SIM_LAPSE_TIME 10000
+// Unsent bytes held for a client before frames to it are dropped
+#define SIM_WRITE_LIMIT (1 << 20)
+// Most frames sent in one burst when the frame timer falls behind
+#define SIM_FRAME_BURST 1000
+// Simulated SD card size and cluster size in bytes
+#define SIM_CARD_SIZE (4LL << 30)
+#define SIM_CLUSTER_SIZE 32768
+// Longest 8.3 file name accepted by the file commands
+#define SIM_NAME_LENGTH 12
+// Handle of a file that is not open
+#define SIM_NO_HANDLE 0xFF
+// Bytes in each block of a file download, and most blocks sent per request
+#define SIM_BLOCK_SIZE 180
+#define SIM_BLOCK_WINDOW 16
+// Most directory entries sent in one line of a batched listing
+#define SIM_LIST_BATCH 10
+
+// FatFs result codes sent in fE responses
+#define SIM_FR_OK 0
+#define SIM_FR_INT_ERR 2
+#define SIM_FR_NO_FILE 4
+#define SIM_FR_NO_PATH 5
+#define SIM_FR_DENIED 7
+
+//-----------------------------------------------------------------------------
+/** @brief State of a simulated battery.
+
+Values are held in natural units and scaled by 256 when sent, as the firmware
+does.
+*/
+
+typedef struct
+{
+    double current;             // A, positive when charging
+    double voltage;             // V
+    double soc;                 // percent
+    double resistance;          // ohm
+    int type;
+    int capacity;               // Ah
+    int absorptionVoltage;
+    int floatVoltage;
+    int floatStageCurrentScale;
+    int bulkCurrentLimitScale;
+    bool missing;
+} SimBattery;
+
+//-----------------------------------------------------------------------------
+/** @brief Simulated Battery Management Unit.
+
+Holds the configuration and measured state of the unit and answers commands
+with the response lines the firmware would send. The measurements follow a
+simple model of a solar panel, loads and batteries connected through the
+switch, so that values move as they would on a real system.
+
+The SD card is simulated by a host directory, which holds the files written
+while recording and those read back by the file commands.
+*/
+
+class SimulatedUnit
+{
+public:
+    SimulatedUnit(int batteries, const QString& cardDirectory);
+    ~SimulatedUnit();
+    QByteArray command(const QByteArray& line);
+    QByteArray frame();
+    bool sending() const { return enableSend; }
+    int batteryCount() const { return batteries; }
+private:
+    void parseAction(const QByteArray& line, QByteArray* out);
+    void parseDataRequest(const QByteArray& line, QByteArray* out);
+    void parseParameter(const QByteArray& line, QByteArray* out);
+    void parseFile(const QByteArray& line, QByteArray* out);
+    void step();
+    void setSwitch(int battery, int setting);
+    int switchedBattery(int setting) const;
+    int controls() const;
+    int batteryStates(int battery) const;
+    void setChargeParameters(int battery);
+    void dataMessage(QByteArray* out, const char* ident, int param1,
+                     int param2) const;
+    void response(QByteArray* out, const char* ident, int parameter) const;
+    void string(QByteArray* out, const char* ident,
+                const QByteArray& text) const;
+    void record(const QByteArray& lines);
+    bool cardPath(const QByteArray& name, QString* path) const;
+    int openFile(const QByteArray& name, bool write, int* handle);
+    int closeFile(int handle);
+    void directoryEntry(QByteArray* out);
+    qint64 cardUsed() const;
+    int batteries;
+    SimBattery battery[SIM_MAX_BATTERIES];
+    double loadCurrent[SIM_LOADS];
+    double loadVoltage[SIM_LOADS];
+    double panelCurrent[SIM_PANELS];
+    double panelVoltage[SIM_PANELS];
+    double temperature;
+    int switchBits;
+    int indicators;
+    int decisionStatus;
+    int quiescentCurrent;
+    qint64 unitTime;            // ms since epoch
+    qint64 frames;
+    bool enableSend;
+    bool measurementSend;
+    bool debugMessageSend;
+    bool autoTrack;
+    bool recording;
+    int monitorStrategy;
+    int lowVoltage;
+    int criticalVoltage;
+    int lowSoC;
+    int criticalSoC;
+    int floatBulkSoC;
+    int chargerStrategy;
+    int restTime;
+    int absorptionTime;
+    int minDutyCycle;
+    int floatTime;
+    QElapsedTimer lapseClock;
+    QDir card;
+    QFile* writeFile;
+    QFile* readFile;
+    QString writeFileName;
+    qint64 writeOpenSize;
+    QString readFileName;
+    QStringList directoryList;
+    QString directoryPath;
+    quint32 directoryChanges;
+    int listPosition;
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Simulator server.
+
+Listens on a TCP port in place of the serial to TCP bridge in front of a real
+unit. Measurement frames are sent to every connected client at the configured
+rate, and the responses to a command go back to the client that sent it.
+
+A client that does not read fast enough has frames dropped rather than being
+allowed to hold an unbounded amount of data in the server.
+*/
+
+class Simulator : public QObject
+{
+    Q_OBJECT
+public:
+    Simulator(SimulatedUnit* unit, double rate, QObject* parent = 0);
+    bool listen(quint16 port);
+    QString errorString() const { return server->errorString(); }
+private slots:
+    void newConnection();
+    void readCommands();
+    void clientDisconnected();
+    void sendFrames();
+private:
+    SimulatedUnit* unit;
+    double rate;
+    QTcpServer* server;
+    QList<QTcpSocket*> clients;
+    QHash<QTcpSocket*,QByteArray> commandLines;
+    QHash<QTcpSocket*,qint64> droppedFrames;
+    QTimer* frameTimer;
+    QElapsedTimer frameClock;
+    qint64 framesSent;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/**
+@mainpage Power Management Simulator
+@version 1.0
+@author Ken Sarkies (www.jiggerjuice.net)
+@date 16 October 2026
+
+This stands in for the Solar-Battery Power Management System on a TCP port, so
+that the GUI and load tests can be run with no hardware attached.
+
+Call with power-management-sim [options]
+
+-p   TCP port (6666 default)
+-r   measurement frames per second (1.95 default, as the firmware)
+-b   number of batteries (1-9, 3 default)
+-d   existing directory standing in for the SD card (sim-card default, created
+     in the current directory if needed)
+*/
+/****************************************************************************
+ *   Copyright (C) 2013 by Ken Sarkies                                      *
+ *   ksarkies@internode.on.net                                              *
+ *                                                                          *
+ *   This file is part of Power Management GUI                              *
+ *                                                                          *
+ *   Power Management GUI is free software; you can redistribute it and/or  *
+ *   modify it under the terms of the GNU General Public License as         *
+ *   published by the Free Software Foundation; either version 2 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   Power Management GUI is distributed in the hope that it will be useful,*
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with Power Management GUI if not, write to the                   *
+ *   Free Software Foundation, Inc.,                                        *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.              *
+ ***************************************************************************/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "power-management-sim-unit.h"
+#include <QCoreApplication>
+#include <QDir>
+
+//-----------------------------------------------------------------------------
+/** @brief Power Management Simulator Main Program
+
+*/
+
+int main(int argc,char ** argv)
+{
+/* Interpret any command line options */
+    int c;
+    opterr = 0;
+    uint port = SIM_PORT;
+    double rate = 1000.0/SIM_MONITOR_PERIOD;
+    int batteries = SIM_BATTERIES;
+    QString cardDirectory = SIM_CARD_DIRECTORY;
+    while ((c = getopt (argc, argv, "p:r:b:d:")) != -1)
+    {
+        switch (c)
+        {
+// TCP port number
+        case 'p':
+            port = atoi(optarg);
+            break;
+// Frame rate
+        case 'r':
+            rate = atof(optarg);
+            if (rate <= 0)
+            {
+                fprintf (stderr, "Invalid frame rate %s.\n", optarg);
+                return 1;
+            }
+            break;
+// Number of batteries
+        case 'b':
+            batteries = atoi(optarg);
+            if ((batteries < 1) || (batteries > SIM_MAX_BATTERIES))
+            {
+                fprintf (stderr, "Invalid number of batteries %s.\n", optarg);
+                return 1;
+            }
+            break;
+// SD card directory
+        case 'd':
+            cardDirectory = optarg;
+            break;
+// Unknown
+        case '?':
+            if ((optopt == 'p') || (optopt == 'r') ||
+                (optopt == 'b') || (optopt == 'd'))
+                fprintf (stderr, "Option -%c requires an argument.\n", optopt);
+            else if (isprint (optopt))
+                fprintf (stderr, "Unknown option `-%c'.\n", optopt);
+            else
+                fprintf (stderr,"Unknown option character `\\x%x'.\n",optopt);
+            default: return 1;
+        }
+    }
+    if ((cardDirectory == SIM_CARD_DIRECTORY) && ! QDir(cardDirectory).exists())
+        QDir().mkdir(cardDirectory);
+    if (! QDir(cardDirectory).exists())
+    {
+        fprintf (stderr, "No card directory %s.\n", qPrintable(cardDirectory));
+        return 1;
+    }
+
+    QCoreApplication application(argc,argv);
+    SimulatedUnit unit(batteries,cardDirectory);
+    Simulator simulator(&unit,rate);
+    if (! simulator.listen(port))
+    {
+        fprintf (stderr, "Unable to listen on port %u: %s\n", port,
+                 qPrintable(simulator.errorString()));
+        return 1;
+    }
+    printf ("Simulating %d batteries on port %u at %.2f frames/s\n",
+            batteries, port, rate);
+    fflush (stdout);
+    return application.exec();
+}
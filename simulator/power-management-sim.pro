@@ -0,0 +1,16 @@
+PROJECT =       Power Management Simulator
+TEMPLATE =      app
+TARGET          +=
+DEPENDPATH      += .
+QT              -= gui
+QT              += network
+
+OBJECTS_DIR     = obj
+MOC_DIR         = moc
+LANGUAGE        = C++
+CONFIG          += qt warn_on release console
+
+# Input
+HEADERS         += power-management-sim-unit.h
+SOURCES         += power-management-sim.cpp
+SOURCES         += power-management-sim-unit.cpp